@@ -132,9 +132,9 @@ static int64_t getmaxrss(void);
 static int ifilter_has_all_input_formats(FilterGraph *fg);
 
 static int run_as_daemon  = 0;
-static int nb_frames_dup = 0;
+static atomic_int nb_frames_dup = ATOMIC_VAR_INIT(0);
 static unsigned dup_warning = 1000;
-static int nb_frames_drop = 0;
+static atomic_int nb_frames_drop = ATOMIC_VAR_INIT(0);
 static int64_t decode_error_stat[2];
 static unsigned nb_output_dumped = 0;
 
@@ -167,8 +167,20 @@ static int restore_tty;
 
 #if HAVE_THREADS
 static void free_input_threads(void);
+static void free_encoder_threads(int drain);
+static int flush_encoder_backlog(OutputStream *ost, int block);
 #endif
 
+/* A frame taken from a filtergraph sink, along with the timing information
+ * the encoding side needs from that sink. */
+typedef struct EncoderMessage {
+    AVFrame   *frame;       /* NULL when flushing the video sync logic */
+    double     float_pts;
+    AVRational frame_rate;
+    int64_t    recording_time; /* of->recording_time when the frame was taken */
+    int        close;       /* close the stream after the frames before it */
+} EncoderMessage;
+
 /* sub2video hack:
    Convert subtitles to video with alpha to insert them in filter graphs.
    This is a temporary solution until libavfilter gets real subtitles support.
@@ -516,6 +528,22 @@ static void ffmpeg_cleanup(int ret)
 {
     int i, j;
 
+#if HAVE_THREADS
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        if (ost && ost->enc_thread_queue &&
+            pthread_equal(pthread_self(), ost->enc_thread)) {
+            /* exit_program() was called from an encoder thread; the main
+             * thread may still be using everything, so leave it all alone
+             * and let the process exit. */
+            term_exit();
+            ffmpeg_exited = 1;
+            return;
+        }
+    }
+    free_encoder_threads(0);
+#endif
+
     if (do_benchmark) {
         int maxrss = getmaxrss() / 1024;
         av_log(NULL, AV_LOG_INFO, "bench: maxrss=%ikB\n", maxrss);
@@ -579,6 +607,10 @@ static void ffmpeg_cleanup(int ret)
             avio_closep(&s->pb);
         avformat_free_context(s);
         av_dict_free(&of->opts);
+#if HAVE_THREADS
+        pthread_mutex_destroy(&of->mux_lock);
+        pthread_cond_destroy(&of->enc_cond);
+#endif
 
         av_freep(&output_files[i]);
     }
@@ -722,10 +754,32 @@ static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream,
     int i;
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost2 = output_streams[i];
-        ost2->finished |= ost == ost2 ? this_stream : others;
+        atomic_fetch_or(&ost2->finished, ost == ost2 ? this_stream : others);
     }
 }
 
+static void lock_output_file(OutputFile *of)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&of->mux_lock);
+#endif
+}
+
+static void unlock_output_file(OutputFile *of)
+{
+#if HAVE_THREADS
+    pthread_mutex_unlock(&of->mux_lock);
+#endif
+}
+
+/* exit_program() from a section where of is locked */
+static void exit_program_locked(OutputFile *of, int ret)
+{
+    unlock_output_file(of);
+    exit_program(ret);
+}
+
+/* must be called with the output file locked */
 static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
 {
     AVFormatContext *s = of->ctx;
@@ -763,18 +817,18 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                 av_log(NULL, AV_LOG_ERROR,
                        "Too many packets buffered for output stream %d:%d.\n",
                        ost->file_index, ost->st->index);
-                exit_program(1);
+                exit_program_locked(of, 1);
             }
             ret = av_fifo_realloc2(ost->muxing_queue, new_size);
             if (ret < 0)
-                exit_program(1);
+                exit_program_locked(of, 1);
         }
         ret = av_packet_make_refcounted(pkt);
         if (ret < 0)
-            exit_program(1);
+            exit_program_locked(of, 1);
         tmp_pkt = av_packet_alloc();
         if (!tmp_pkt)
-            exit_program(1);
+            exit_program_locked(of, 1);
         av_packet_move_ref(tmp_pkt, pkt);
         ost->muxing_queue_data_size += tmp_pkt->size;
         av_fifo_generic_write(ost->muxing_queue, &tmp_pkt, sizeof(tmp_pkt), NULL);
@@ -835,7 +889,7 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                        ost->file_index, ost->st->index, ost->last_mux_dts, pkt->dts);
                 if (exit_on_error) {
                     av_log(NULL, AV_LOG_FATAL, "aborting.\n");
-                    exit_program(1);
+                    exit_program_locked(of, 1);
                 }
                 av_log(s, loglevel, "changing to %"PRId64". This may result "
                        "in incorrect timestamps in the output file.\n",
@@ -876,10 +930,35 @@ static void close_output_stream(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
 
-    ost->finished |= ENCODER_FINISHED;
+    atomic_fetch_or(&ost->finished, ENCODER_FINISHED);
     if (of->shortest) {
-        int64_t end = av_rescale_q(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, AV_TIME_BASE_Q);
+        int64_t end;
+#if HAVE_THREADS
+        /* the stream only ends once its encoder thread has encoded the
+         * frames queued for it, and sync_opts belongs to that thread. Wait
+         * for it, so that the frames taken from the filtergraphs from now on
+         * are cut at the new end. If the thread cannot be reached, it is
+         * being stopped and its frames are dropped anyway. */
+        if (ost->enc_thread_queue && !pthread_equal(pthread_self(), ost->enc_thread)) {
+            EncoderMessage msg = { .close = 1 };
+            if (flush_encoder_backlog(ost, 1) < 0 ||
+                av_thread_message_queue_send(ost->enc_thread_queue, &msg, 0) < 0)
+                return;
+            lock_output_file(of);
+            while (!ost->enc_closed)
+                pthread_cond_wait(&of->enc_cond, &of->mux_lock);
+            unlock_output_file(of);
+            return;
+        }
+#endif
+        end = av_rescale_q(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, AV_TIME_BASE_Q);
+        lock_output_file(of);
         of->recording_time = FFMIN(of->recording_time, end);
+#if HAVE_THREADS
+        ost->enc_closed = 1;
+        pthread_cond_broadcast(&of->enc_cond);
+#endif
+        unlock_output_file(of);
     }
 }
 
@@ -904,12 +983,18 @@ static void output_packet(OutputFile *of, AVPacket *pkt,
         ret = av_bsf_send_packet(ost->bsf_ctx, eof ? NULL : pkt);
         if (ret < 0)
             goto finish;
-        while ((ret = av_bsf_receive_packet(ost->bsf_ctx, pkt)) >= 0)
+        while ((ret = av_bsf_receive_packet(ost->bsf_ctx, pkt)) >= 0) {
+            lock_output_file(of);
             write_packet(of, pkt, ost, 0);
+            unlock_output_file(of);
+        }
         if (ret == AVERROR(EAGAIN))
             ret = 0;
-    } else if (!eof)
+    } else if (!eof) {
+        lock_output_file(of);
         write_packet(of, pkt, ost, 0);
+        unlock_output_file(of);
+    }
 
 finish:
     if (ret < 0 && ret != AVERROR_EOF) {
@@ -923,9 +1008,23 @@ finish:
 static int check_recording_time(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
+    int64_t recording_time;
 
-    if (of->recording_time != INT64_MAX &&
-        av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, of->recording_time,
+#if HAVE_THREADS
+    /* use the limit the frame was taken from the filtergraph with, so that
+     * -shortest cuts the same frames however the encoder threads run */
+    if (ost->enc_thread_queue)
+        recording_time = ost->enc_recording_time;
+    else
+#endif
+    {
+        lock_output_file(of);
+        recording_time = of->recording_time;
+        unlock_output_file(of);
+    }
+
+    if (recording_time != INT64_MAX &&
+        av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, recording_time,
                       AV_TIME_BASE_Q) >= 0) {
         close_output_stream(ost);
         return 0;
@@ -1008,8 +1107,6 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
     AVPacket *pkt = ost->pkt;
     int ret;
 
-    adjust_frame_pts_to_encoder_tb(of, ost, frame);
-
     if (!check_recording_time(ost))
         return;
 
@@ -1142,29 +1239,29 @@ static void do_subtitle_out(OutputFile *of,
     }
 }
 
+/*
+ * The output stream must already be initialized and next_picture's pts
+ * converted to the encoder time base; sync_ipts and frame_rate are the
+ * values obtained from the filtergraph sink along with the picture.
+ */
 static void do_video_out(OutputFile *of,
                          OutputStream *ost,
-                         AVFrame *next_picture)
+                         AVFrame *next_picture,
+                         double sync_ipts,
+                         AVRational frame_rate)
 {
     int ret, format_video_sync;
     AVPacket *pkt = ost->pkt;
     AVCodecContext *enc = ost->enc_ctx;
-    AVRational frame_rate;
     int nb_frames, nb0_frames, i;
     double delta, delta0;
     double duration = 0;
-    double sync_ipts = AV_NOPTS_VALUE;
     int frame_size = 0;
     InputStream *ist = NULL;
-    AVFilterContext *filter = ost->filter->filter;
-
-    init_output_stream_wrapper(ost, next_picture, 1);
-    sync_ipts = adjust_frame_pts_to_encoder_tb(of, ost, next_picture);
 
     if (ost->source_index >= 0)
         ist = input_streams[ost->source_index];
 
-    frame_rate = av_buffersink_get_frame_rate(filter);
     if (frame_rate.num > 0 && frame_rate.den > 0)
         duration = 1/(av_q2d(frame_rate) * av_q2d(enc->time_base));
 
@@ -1268,7 +1365,7 @@ static void do_video_out(OutputFile *of,
     ost->last_nb0_frames[0] = nb0_frames;
 
     if (nb0_frames == 0 && ost->last_dropped) {
-        nb_frames_drop++;
+        atomic_fetch_add(&nb_frames_drop, 1);
         av_log(NULL, AV_LOG_VERBOSE,
                "*** dropping frame %d from stream %d at ts %"PRId64"\n",
                ost->frame_number, ost->st->index, ost->last_frame->pts);
@@ -1276,12 +1373,12 @@ static void do_video_out(OutputFile *of,
     if (nb_frames > (nb0_frames && ost->last_dropped) + (nb_frames > nb0_frames)) {
         if (nb_frames > dts_error_threshold * 30) {
             av_log(NULL, AV_LOG_ERROR, "%d frame duplication too large, skipping\n", nb_frames - 1);
-            nb_frames_drop++;
+            atomic_fetch_add(&nb_frames_drop, 1);
             return;
         }
-        nb_frames_dup += nb_frames - (nb0_frames && ost->last_dropped) - (nb_frames > nb0_frames);
+        atomic_fetch_add(&nb_frames_dup, nb_frames - (nb0_frames && ost->last_dropped) - (nb_frames > nb0_frames));
         av_log(NULL, AV_LOG_VERBOSE, "*** %d dup!\n", nb_frames - 1);
-        if (nb_frames_dup > dup_warning) {
+        if (atomic_load(&nb_frames_dup) > dup_warning) {
             av_log(NULL, AV_LOG_WARNING, "More than %d frames duplicated\n", dup_warning);
             dup_warning *= 10;
         }
@@ -1412,7 +1509,9 @@ static void do_video_out(OutputFile *of,
          * But there may be reordering, so we can't throw away frames on encoder
          * flush, we need to limit them here, before they go into encoder.
          */
+        lock_output_file(of);
         ost->frame_number++;
+        unlock_output_file(of);
 
         if (vstats_filename && frame_size)
             do_video_stats(ost, frame_size);
@@ -1440,6 +1539,7 @@ static double psnr(double d)
 static void do_video_stats(OutputStream *ost, int frame_size)
 {
     AVCodecContext *enc;
+    AVBPrint buf;
     int frame_number;
     double ti1, bitrate, avg_bitrate;
 
@@ -1454,19 +1554,22 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
     enc = ost->enc_ctx;
     if (enc->codec_type == AVMEDIA_TYPE_VIDEO) {
+        /* the line is printed at once, as encoder threads may share the file */
+        av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
+
         frame_number = ost->st->nb_frames;
         if (vstats_version <= 1) {
-            fprintf(vstats_file, "frame= %5d q= %2.1f ", frame_number,
-                    ost->quality / (float)FF_QP2LAMBDA);
+            av_bprintf(&buf, "frame= %5d q= %2.1f ", frame_number,
+                       ost->quality / (float)FF_QP2LAMBDA);
         } else  {
-            fprintf(vstats_file, "out= %2d st= %2d frame= %5d q= %2.1f ", ost->file_index, ost->index, frame_number,
-                    ost->quality / (float)FF_QP2LAMBDA);
+            av_bprintf(&buf, "out= %2d st= %2d frame= %5d q= %2.1f ", ost->file_index, ost->index, frame_number,
+                       ost->quality / (float)FF_QP2LAMBDA);
         }
 
         if (ost->error[0]>=0 && (enc->flags & AV_CODEC_FLAG_PSNR))
-            fprintf(vstats_file, "PSNR= %6.2f ", psnr(ost->error[0] / (enc->width * enc->height * 255.0 * 255.0)));
+            av_bprintf(&buf, "PSNR= %6.2f ", psnr(ost->error[0] / (enc->width * enc->height * 255.0 * 255.0)));
 
-        fprintf(vstats_file,"f_size= %6d ", frame_size);
+        av_bprintf(&buf, "f_size= %6d ", frame_size);
         /* compute pts value */
         ti1 = av_stream_get_end_pts(ost->st) * av_q2d(ost->st->time_base);
         if (ti1 < 0.01)
@@ -1474,9 +1577,12 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
         bitrate     = (frame_size * 8) / av_q2d(enc->time_base) / 1000.0;
         avg_bitrate = (double)(ost->data_size * 8) / ti1 / 1000.0;
-        fprintf(vstats_file, "s_size= %8.0fkB time= %0.3f br= %7.1fkbits/s avg_br= %7.1fkbits/s ",
-               (double)ost->data_size / 1024, ti1, bitrate, avg_bitrate);
-        fprintf(vstats_file, "type= %c\n", av_get_picture_type_char(ost->pict_type));
+        av_bprintf(&buf, "s_size= %8.0fkB time= %0.3f br= %7.1fkbits/s avg_br= %7.1fkbits/s ",
+                   (double)ost->data_size / 1024, ti1, bitrate, avg_bitrate);
+        av_bprintf(&buf, "type= %c\n", av_get_picture_type_char(ost->pict_type));
+
+        fputs(buf.str, vstats_file);
+        av_bprint_finalize(&buf, NULL);
     }
 }
 
@@ -1485,21 +1591,250 @@ static void finish_output_stream(OutputStream *ost)
     OutputFile *of = output_files[ost->file_index];
     int i;
 
-    ost->finished = ENCODER_FINISHED | MUXER_FINISHED;
+    atomic_store(&ost->finished, ENCODER_FINISHED | MUXER_FINISHED);
 
     if (of->shortest) {
         for (i = 0; i < of->ctx->nb_streams; i++)
-            output_streams[of->ost_index + i]->finished = ENCODER_FINISHED | MUXER_FINISHED;
+            atomic_store(&output_streams[of->ost_index + i]->finished, ENCODER_FINISHED | MUXER_FINISHED);
+    }
+}
+
+static void encode_frame(OutputFile *of, OutputStream *ost, EncoderMessage *msg)
+{
+    AVCodecContext *enc = ost->enc_ctx;
+    AVFrame *frame = msg->frame;
+
+    switch (enc->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (frame && !ost->frame_aspect_ratio.num)
+            enc->sample_aspect_ratio = frame->sample_aspect_ratio;
+
+        do_video_out(of, ost, frame, msg->float_pts, msg->frame_rate);
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        if (!(enc->codec->capabilities & AV_CODEC_CAP_PARAM_CHANGE) &&
+            enc->channels != frame->channels) {
+            av_log(NULL, AV_LOG_ERROR,
+                   "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
+            break;
+        }
+        do_audio_out(of, ost, frame);
+        break;
+    default:
+        av_assert0(0);
+    }
+}
+
+#if HAVE_THREADS
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    OutputFile    *of = output_files[ost->file_index];
+    EncoderMessage msg;
+
+    while (av_thread_message_queue_recv(ost->enc_thread_queue, &msg, 0) >= 0) {
+        ost->enc_recording_time = msg.recording_time;
+        if (msg.close)
+            close_output_stream(ost);
+        else
+            encode_frame(of, ost, &msg);
+        av_frame_free(&msg.frame);
+    }
+
+    return NULL;
+}
+
+static void free_encoder_message(void *msg)
+{
+    av_frame_free(&((EncoderMessage *)msg)->frame);
+}
+
+/*
+ * Pass the frames held back for ost on to its encoder thread, in order.
+ * Unless block is set, stop with AVERROR(EAGAIN) when its queue is full.
+ */
+static int flush_encoder_backlog(OutputStream *ost, int block)
+{
+    EncoderMessage msg;
+    int ret;
+
+    while (av_fifo_size(ost->enc_backlog)) {
+        av_fifo_generic_peek(ost->enc_backlog, &msg, sizeof(msg), NULL);
+        ret = av_thread_message_queue_send(ost->enc_thread_queue, &msg,
+                                           block ? 0 : AV_THREAD_MESSAGE_NONBLOCK);
+        if (ret < 0)
+            return ret;
+        av_fifo_drain(ost->enc_backlog, sizeof(msg));
+    }
+    return 0;
+}
+
+/*
+ * Stop the encoder thread of ost. If drain is set, the frames already queued
+ * are encoded first, otherwise they are discarded.
+ */
+static void free_encoder_thread(OutputStream *ost, int drain)
+{
+    if (!ost->enc_thread_queue)
+        return;
+    if (drain)
+        flush_encoder_backlog(ost, 1);
+    else
+        av_thread_message_flush(ost->enc_thread_queue);
+    av_thread_message_queue_set_err_recv(ost->enc_thread_queue, AVERROR_EOF);
+    pthread_join(ost->enc_thread, NULL);
+    av_thread_message_queue_free(&ost->enc_thread_queue);
+
+    while (av_fifo_size(ost->enc_backlog)) {
+        EncoderMessage msg;
+        av_fifo_generic_read(ost->enc_backlog, &msg, sizeof(msg), NULL);
+        av_frame_free(&msg.frame);
     }
+    av_fifo_freep(&ost->enc_backlog);
+}
+
+static void free_encoder_threads(int drain)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i])
+            free_encoder_thread(output_streams[i], drain);
+}
+
+static int init_encoder_thread(OutputStream *ost)
+{
+    int ret;
+
+    ret = av_thread_message_queue_alloc(&ost->enc_thread_queue,
+                                        ost->enc_queue_size,
+                                        sizeof(EncoderMessage));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(ost->enc_thread_queue,
+                                          free_encoder_message);
+
+    ost->enc_backlog = av_fifo_alloc_array(ost->enc_queue_size,
+                                           sizeof(EncoderMessage));
+    if (!ost->enc_backlog) {
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+        return AVERROR(ENOMEM);
+    }
+    ost->enc_sent_pts = AV_NOPTS_VALUE;
+
+    if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+        av_fifo_freep(&ost->enc_backlog);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+
+static int init_encoder_threads(void)
+{
+    int i, ret;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost->encoding_needed || !ost->filter)
+            continue;
+        if (ost->enc_queue_size < 0)
+            ost->enc_queue_size = do_pipeline ? 8 : 0;
+        if (!ost->enc_queue_size)
+            continue;
+
+        /* do_video_stats() would otherwise open it lazily from several threads */
+        if (vstats_filename && !vstats_file) {
+            vstats_file = fopen(vstats_filename, "w");
+            if (!vstats_file) {
+                perror("fopen");
+                return AVERROR(errno);
+            }
+        }
+
+        ret = init_encoder_thread(ost);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+#endif
+
+/*
+ * Hand a frame taken from the filtergraph to the encoder of ost, either
+ * directly or through its encoder thread. The frame reference is consumed
+ * in the latter case.
+ *
+ * Unless block is set, a frame for a busy encoder thread is held back, so
+ * that a slow encoder does not hold back the other outputs. Once as many
+ * frames as the encoder queue holds are waiting, this waits for the encoder,
+ * which bounds the memory used by a slow output.
+ */
+static int send_to_encoder(OutputFile *of, OutputStream *ost, EncoderMessage *msg,
+                           int block)
+{
+#if HAVE_THREADS
+    if (ost->enc_thread_queue) {
+        EncoderMessage queued = *msg;
+        int ret;
+
+        lock_output_file(of);
+        queued.recording_time = of->recording_time;
+        unlock_output_file(of);
+        if (msg->frame && msg->frame->pts != AV_NOPTS_VALUE)
+            ost->enc_sent_pts = av_rescale_q(msg->frame->pts, ost->enc_ctx->time_base,
+                                             AV_TIME_BASE_Q);
+
+        if (msg->frame) {
+            queued.frame = av_frame_alloc();
+            if (!queued.frame)
+                return AVERROR(ENOMEM);
+            av_frame_move_ref(queued.frame, msg->frame);
+        }
+
+        ret = flush_encoder_backlog(ost, block);
+        if (ret >= 0)
+            ret = av_thread_message_queue_send(ost->enc_thread_queue, &queued,
+                                               block ? 0 : AV_THREAD_MESSAGE_NONBLOCK);
+        if (ret == AVERROR(EAGAIN)) {
+            if (!av_fifo_space(ost->enc_backlog)) {
+                EncoderMessage oldest;
+
+                av_fifo_generic_read(ost->enc_backlog, &oldest, sizeof(oldest), NULL);
+                ret = av_thread_message_queue_send(ost->enc_thread_queue, &oldest, 0);
+                if (ret < 0) {
+                    av_frame_free(&oldest.frame);
+                    av_frame_free(&queued.frame);
+                    return ret;
+                }
+            }
+            av_fifo_generic_write(ost->enc_backlog, &queued, sizeof(queued), NULL);
+            return 0;
+        }
+        if (ret < 0)
+            av_frame_free(&queued.frame);
+        return ret;
+    }
+#endif
+    encode_frame(of, ost, msg);
+    return 0;
 }
 
 /**
  * Get and encode new output from any of the filtergraphs, without causing
  * activity.
  *
+ * Unless flushing, the frames for a stream whose encoder thread is busy are
+ * held back up to the encoder queue size (see send_to_encoder()); only the
+ * stream selected for this transcoding step, if any, waits for its encoder.
+ *
+ * @param cur_ost  the output stream being processed, or NULL
  * @return  0 for success, <0 for severe errors
  */
-static int reap_filters(int flush)
+static int reap_filters(int flush, OutputStream *cur_ost)
 {
     AVFrame *filtered_frame = NULL;
     int i;
@@ -1509,7 +1844,6 @@ static int reap_filters(int flush)
         OutputStream *ost = output_streams[i];
         OutputFile    *of = output_files[ost->file_index];
         AVFilterContext *filter;
-        AVCodecContext *enc = ost->enc_ctx;
         int ret = 0;
 
         if (!ost->filter || !ost->filter->graph->graph)
@@ -1536,7 +1870,17 @@ static int reap_filters(int flush)
         }
         filtered_frame = ost->filtered_frame;
 
+#if HAVE_THREADS
+        if (ost->enc_thread_queue) {
+            ret = flush_encoder_backlog(ost, flush || ost == cur_ost);
+            if (ret < 0 && ret != AVERROR(EAGAIN))
+                return ret;
+        }
+#endif
+
         while (1) {
+            EncoderMessage msg = { filtered_frame };
+
             ret = av_buffersink_get_frame_flags(filter, filtered_frame,
                                                AV_BUFFERSINK_FLAG_NO_REQUEST);
             if (ret < 0) {
@@ -1544,38 +1888,40 @@ static int reap_filters(int flush)
                     av_log(NULL, AV_LOG_WARNING,
                            "Error in av_buffersink_get_frame_flags(): %s\n", av_err2str(ret));
                 } else if (flush && ret == AVERROR_EOF) {
-                    if (av_buffersink_get_type(filter) == AVMEDIA_TYPE_VIDEO)
-                        do_video_out(of, ost, NULL);
+                    if (av_buffersink_get_type(filter) == AVMEDIA_TYPE_VIDEO) {
+                        init_output_stream_wrapper(ost, NULL, 1);
+                        msg.frame      = NULL;
+                        msg.float_pts  = adjust_frame_pts_to_encoder_tb(of, ost, NULL);
+                        msg.frame_rate = av_buffersink_get_frame_rate(filter);
+                        ret = send_to_encoder(of, ost, &msg, 1);
+                        if (ret < 0)
+                            return ret;
+                    }
                 }
                 break;
             }
-            if (ost->finished) {
+            if (atomic_load(&ost->finished)) {
                 av_frame_unref(filtered_frame);
                 continue;
             }
 
             switch (av_buffersink_get_type(filter)) {
             case AVMEDIA_TYPE_VIDEO:
-                if (!ost->frame_aspect_ratio.num)
-                    enc->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
-
-                do_video_out(of, ost, filtered_frame);
+                init_output_stream_wrapper(ost, filtered_frame, 1);
                 break;
             case AVMEDIA_TYPE_AUDIO:
-                if (!(enc->codec->capabilities & AV_CODEC_CAP_PARAM_CHANGE) &&
-                    enc->channels != filtered_frame->channels) {
-                    av_log(NULL, AV_LOG_ERROR,
-                           "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
-                    break;
-                }
-                do_audio_out(of, ost, filtered_frame);
                 break;
             default:
                 // TODO support subtitle filters
                 av_assert0(0);
             }
 
+            msg.float_pts  = adjust_frame_pts_to_encoder_tb(of, ost, filtered_frame);
+            msg.frame_rate = av_buffersink_get_frame_rate(filter);
+            ret = send_to_encoder(of, ost, &msg, flush || ost == cur_ost);
             av_frame_unref(filtered_frame);
+            if (ret < 0)
+                return ret;
         }
     }
 
@@ -1689,6 +2035,21 @@ static void print_final_stats(int64_t total_size)
         av_log(NULL, AV_LOG_VERBOSE, "  Total: %"PRIu64" packets (%"PRIu64" bytes) muxed\n",
                total_packets, total_size);
     }
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+        int64_t frames = 0, bytes = 0;
+
+        if (fg->graph)
+            avfilter_graph_get_copy_stats(fg->graph, &frames, &bytes);
+        frames += fg->frames_copied;
+        bytes  += fg->bytes_copied;
+
+        av_log(NULL, AV_LOG_VERBOSE, "Filtergraph #%d: %"PRIu64" frames sent; "
+               "%"PRId64" frames copied (%"PRId64" bytes, %"PRId64" bytes per frame sent)\n",
+               i, fg->frames_sent, frames, bytes,
+               fg->frames_sent ? bytes / (int64_t)fg->frames_sent : 0);
+    }
     if(video_size + data_size + audio_size + subtitle_size + extra_size == 0){
         av_log(NULL, AV_LOG_WARNING, "Output file is empty, nothing was encoded ");
         if (pass1_used) {
@@ -1699,6 +2060,62 @@ static void print_final_stats(int64_t total_size)
     }
 }
 
+static void print_buffer_pool_stats(int is_last_report)
+{
+    AVBufferPoolStats *stats, total = { 0 };
+    AVBufferCopyStats *copies = NULL;
+    AVBufferCopyStats total_copies = { 0 };
+    AVBPrint buf;
+    size_t nb_stats, nb_copies = 0, i;
+    uint64_t bytes = 0;
+
+    if (av_buffer_pool_get_all_stats(&stats, &nb_stats) < 0)
+        return;
+    if (av_buffer_get_copy_stats(&copies, &nb_copies) < 0)
+        nb_copies = 0;
+
+    for (i = 0; i < nb_stats; i++) {
+        total.nb_allocated += stats[i].nb_allocated;
+        total.nb_free      += stats[i].nb_free;
+        total.nb_in_use    += stats[i].nb_in_use;
+        total.max_in_use   += stats[i].max_in_use;
+        total.nb_gets      += stats[i].nb_gets;
+        total.nb_misses    += stats[i].nb_misses;
+        bytes += (uint64_t)stats[i].size * stats[i].nb_allocated;
+    }
+    for (i = 0; i < nb_copies; i++) {
+        total_copies.nb_copies += copies[i].nb_copies;
+        total_copies.bytes     += copies[i].bytes;
+    }
+
+    av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
+    av_bprintf(&buf, "Buffer pools: %"SIZE_SPECIFIER" pools, %"SIZE_SPECIFIER
+               " buffers allocated (%"PRIu64"kB), %"SIZE_SPECIFIER" in use, %"
+               SIZE_SPECIFIER" free, %"SIZE_SPECIFIER" peak, %"PRIu64"/%"PRIu64
+               " misses; %"PRIu64" copies (%"PRIu64"kB)", nb_stats,
+               total.nb_allocated, bytes >> 10, total.nb_in_use, total.nb_free,
+               total.max_in_use, total.nb_misses, total.nb_gets,
+               total_copies.nb_copies, total_copies.bytes >> 10);
+    av_log(NULL, AV_LOG_INFO, "%s\n", buf.str);
+    av_bprint_finalize(&buf, NULL);
+
+    for (i = 0; i < nb_copies; i++)
+        av_log(NULL, AV_LOG_INFO, "  copies at %s: %"PRIu64" (%"PRIu64"kB)\n",
+               copies[i].site, copies[i].nb_copies, copies[i].bytes >> 10);
+
+    if (is_last_report) {
+        for (i = 0; i < nb_stats; i++)
+            av_log(NULL, AV_LOG_INFO, "  pool #%"SIZE_SPECIFIER": size %"SIZE_SPECIFIER
+                   ", %"SIZE_SPECIFIER" allocated, %"SIZE_SPECIFIER" in use, %"
+                   SIZE_SPECIFIER" free, %"SIZE_SPECIFIER" peak, %"PRIu64"/%"
+                   PRIu64" misses\n", i, stats[i].size, stats[i].nb_allocated,
+                   stats[i].nb_in_use, stats[i].nb_free, stats[i].max_in_use,
+                   stats[i].nb_misses, stats[i].nb_gets);
+    }
+    av_free(copies);
+    av_free(stats);
+}
+
 static void print_report(int is_last_report, int64_t timer_start, int64_t cur_time)
 {
     AVBPrint buf, buf_script;
@@ -1718,7 +2135,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     int ret;
     float t;
 
-    if (!print_stats && !is_last_report && !progress_avio)
+    if (!print_stats && !is_last_report && !progress_avio && !print_buffer_stats)
         return;
 
     if (!is_last_report) {
@@ -1731,24 +2148,47 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         last_time = cur_time;
     }
 
+    if (print_buffer_stats)
+        print_buffer_pool_stats(is_last_report);
+    if (!print_stats && !is_last_report && !progress_avio) {
+        first_report = 0;
+        return;
+    }
+
     t = (cur_time-timer_start) / 1000000.0;
 
 
     oc = output_files[0]->ctx;
 
+    /* avio_size() may seek, keep the encoder threads out of the muxer */
+    lock_output_file(output_files[0]);
     total_size = avio_size(oc->pb);
     if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
         total_size = avio_tell(oc->pb);
+    unlock_output_file(output_files[0]);
 
     vid = 0;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
     av_bprint_init(&buf_script, 0, AV_BPRINT_SIZE_AUTOMATIC);
     for (i = 0; i < nb_output_streams; i++) {
+        OutputFile *of;
         float q = -1;
+        int pict_type;
+        int64_t sse[4], end_pts;
+
         ost = output_streams[i];
+        of  = output_files[ost->file_index];
         enc = ost->enc_ctx;
+
+        /* the encoder threads update these while muxing */
+        lock_output_file(of);
         if (!ost->stream_copy)
             q = ost->quality / (float) FF_QP2LAMBDA;
+        frame_number = ost->frame_number;
+        pict_type    = ost->pict_type;
+        memcpy(sse, ost->error, sizeof(sse));
+        end_pts      = av_stream_get_end_pts(ost->st);
+        unlock_output_file(of);
 
         if (vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             av_bprintf(&buf, "q=%2.1f ", q);
@@ -1758,7 +2198,6 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         if (!vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             float fps;
 
-            frame_number = ost->frame_number;
             fps = t > 1 ? frame_number / t : 0;
             av_bprintf(&buf, "frame=%5d fps=%3.*f q=%3.1f ",
                      frame_number, fps < 9.95, fps, q);
@@ -1777,7 +2216,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                     av_bprintf(&buf, "%X", av_log2(qp_histogram[j] + 1));
             }
 
-            if ((enc->flags & AV_CODEC_FLAG_PSNR) && (ost->pict_type != AV_PICTURE_TYPE_NONE || is_last_report)) {
+            if ((enc->flags & AV_CODEC_FLAG_PSNR) && (pict_type != AV_PICTURE_TYPE_NONE || is_last_report)) {
                 int j;
                 double error, error_sum = 0;
                 double scale, scale_sum = 0;
@@ -1789,7 +2228,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                         error = enc->error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0 * frame_number;
                     } else {
-                        error = ost->error[j];
+                        error = sse[j];
                         scale = enc->width * enc->height * 255.0 * 255.0;
                     }
                     if (j)
@@ -1809,8 +2248,8 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             vid = 1;
         }
         /* compute min output value */
-        if (av_stream_get_end_pts(ost->st) != AV_NOPTS_VALUE) {
-            pts = FFMAX(pts, av_rescale_q(av_stream_get_end_pts(ost->st),
+        if (end_pts != AV_NOPTS_VALUE) {
+            pts = FFMAX(pts, av_rescale_q(end_pts,
                                           ost->st->time_base, AV_TIME_BASE_Q));
             if (copy_ts) {
                 if (copy_ts_first_pts == AV_NOPTS_VALUE && pts > 1)
@@ -1821,7 +2260,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         }
 
         if (is_last_report)
-            nb_frames_drop += ost->last_dropped;
+            atomic_fetch_add(&nb_frames_drop, ost->last_dropped);
     }
 
     secs = FFABS(pts) / AV_TIME_BASE;
@@ -1865,10 +2304,10 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                    hours_sign, hours, mins, secs, us);
     }
 
-    if (nb_frames_dup || nb_frames_drop)
-        av_bprintf(&buf, " dup=%d drop=%d", nb_frames_dup, nb_frames_drop);
-    av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
-    av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
+    if (atomic_load(&nb_frames_dup) || atomic_load(&nb_frames_drop))
+        av_bprintf(&buf, " dup=%d drop=%d", atomic_load(&nb_frames_dup), atomic_load(&nb_frames_drop));
+    av_bprintf(&buf_script, "dup_frames=%d\n", atomic_load(&nb_frames_dup));
+    av_bprintf(&buf_script, "drop_frames=%d\n", atomic_load(&nb_frames_drop));
 
     if (speed < 0) {
         av_bprintf(&buf, " speed=N/A");
@@ -2015,7 +2454,7 @@ static void flush_encoders(void)
                 output_packet(of, pkt, ost, 1);
                 break;
             }
-            if (ost->finished & MUXER_FINISHED) {
+            if (atomic_load(&ost->finished) & MUXER_FINISHED) {
                 av_packet_unref(pkt);
                 continue;
             }
@@ -2040,7 +2479,7 @@ static int check_output_constraints(InputStream *ist, OutputStream *ost)
     if (ost->source_index != ist_index)
         return 0;
 
-    if (ost->finished)
+    if (atomic_load(&ost->finished))
         return 0;
 
     if (of->start_time != AV_NOPTS_VALUE && ist->pts < of->start_time)
@@ -2179,6 +2618,8 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
     FilterGraph *fg = ifilter->graph;
     int need_reinit, ret, i;
 
+    fg->frames_sent++;
+
     /* determine if the parameters for this input changed */
     need_reinit = ifilter->format != frame->format;
 
@@ -2228,7 +2669,7 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
             }
         }
 
-        ret = reap_filters(1);
+        ret = reap_filters(1, NULL);
         if (ret < 0 && ret != AVERROR_EOF) {
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
             return ret;
@@ -2936,6 +3377,23 @@ static enum AVPixelFormat get_format(AVCodecContext *s, const enum AVPixelFormat
     return *p;
 }
 
+/* Decode straight into the frame pools of the filter graph the stream feeds,
+ * so the frames handed over to it need no copy to be filtered in place. Only
+ * done without frame threading, as the graph must not be accessed from the
+ * decoding threads. */
+static int get_filter_buffer(AVCodecContext *s, AVFilterContext *buffersrc,
+                             AVFrame *frame)
+{
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    int w = frame->width, h = frame->height, align = 1, i;
+
+    avcodec_align_dimensions2(s, &w, &h, linesize_align);
+    for (i = 0; i < 4; i++)
+        align = FFMAX(align, linesize_align[i]);
+
+    return av_buffersrc_get_video_buffer(buffersrc, frame, w, h, align);
+}
+
 static int get_buffer(AVCodecContext *s, AVFrame *frame, int flags)
 {
     InputStream *ist = s->opaque;
@@ -2943,6 +3401,13 @@ static int get_buffer(AVCodecContext *s, AVFrame *frame, int flags)
     if (ist->hwaccel_get_buffer && frame->format == ist->hwaccel_pix_fmt)
         return ist->hwaccel_get_buffer(s, frame, flags);
 
+    if (filter_frame_pool && s->codec_type == AVMEDIA_TYPE_VIDEO &&
+        ist->nb_filters && ist->filters[0]->filter &&
+        (s->codec->capabilities & AV_CODEC_CAP_DR1) &&
+        !(s->active_thread_type & FF_THREAD_FRAME) &&
+        !(av_pix_fmt_desc_get(frame->format)->flags & AV_PIX_FMT_FLAG_HWACCEL))
+        return get_filter_buffer(s, ist->filters[0]->filter, frame);
+
     return avcodec_default_get_buffer2(s, frame, flags);
 }
 
@@ -3037,8 +3502,10 @@ static int check_init_output_file(OutputFile *of, int file_index)
 
     of->ctx->interrupt_callback = int_cb;
 
+    lock_output_file(of);
     ret = avformat_write_header(of->ctx, &of->opts);
     if (ret < 0) {
+        unlock_output_file(of);
         av_log(NULL, AV_LOG_ERROR,
                "Could not write header for output file #%d "
                "(incorrect codec parameters ?): %s\n",
@@ -3059,7 +3526,12 @@ static int check_init_output_file(OutputFile *of, int file_index)
         OutputStream *ost = output_streams[of->ost_index + i];
 
         /* try to improve muxing time_base (only possible if nothing has been written yet) */
-        if (!av_fifo_size(ost->muxing_queue))
+        if (!av_fifo_size(ost->muxing_queue)
+#if HAVE_THREADS
+            /* packets may be on their way from the encoder thread */
+            && !ost->enc_thread_queue
+#endif
+           )
             ost->mux_timebase = ost->st->time_base;
 
         while (av_fifo_size(ost->muxing_queue)) {
@@ -3070,6 +3542,7 @@ static int check_init_output_file(OutputFile *of, int file_index)
             av_packet_free(&pkt);
         }
     }
+    unlock_output_file(of);
 
     return 0;
 }
@@ -3916,11 +4389,18 @@ static int need_output(void)
         OutputStream *ost    = output_streams[i];
         OutputFile *of       = output_files[ost->file_index];
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
+        int over_limit, frame_number;
 
-        if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+        if (atomic_load(&ost->finished))
             continue;
-        if (ost->frame_number >= ost->max_frames) {
+        /* the encoder threads update these while muxing */
+        lock_output_file(of);
+        over_limit   = os->pb && avio_tell(os->pb) >= of->limit_filesize;
+        frame_number = ost->frame_number;
+        unlock_output_file(of);
+        if (over_limit)
+            continue;
+        if (frame_number >= ost->max_frames) {
             int j;
             for (j = 0; j < of->ctx->nb_streams; j++)
                 close_output_stream(output_streams[of->ost_index + j]);
@@ -3946,18 +4426,30 @@ static OutputStream *choose_output(void)
 
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
-        int64_t opts = ost->st->cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
-                       av_rescale_q(ost->st->cur_dts, ost->st->time_base,
-                                    AV_TIME_BASE_Q);
-        if (ost->st->cur_dts == AV_NOPTS_VALUE)
-            av_log(NULL, AV_LOG_DEBUG,
-                "cur_dts is invalid st:%d (%d) [init:%d i_done:%d finish:%d] (this is harmless if it occurs once at the start per stream)\n",
-                ost->st->index, ost->st->id, ost->initialized, ost->inputs_done, ost->finished);
+        int64_t opts;
+
+#if HAVE_THREADS
+        /* the muxed dts of a stream encoded in its own thread depends on how
+         * far that thread got; use the frames handed to it instead, so that
+         * the choice does not depend on the thread scheduling */
+        if (ost->enc_thread_queue) {
+            opts = ost->enc_sent_pts == AV_NOPTS_VALUE ? INT64_MIN : ost->enc_sent_pts;
+        } else
+#endif
+        {
+            opts = ost->st->cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
+                   av_rescale_q(ost->st->cur_dts, ost->st->time_base,
+                                AV_TIME_BASE_Q);
+            if (ost->st->cur_dts == AV_NOPTS_VALUE)
+                av_log(NULL, AV_LOG_DEBUG,
+                    "cur_dts is invalid st:%d (%d) [init:%d i_done:%d finish:%d] (this is harmless if it occurs once at the start per stream)\n",
+                    ost->st->index, ost->st->id, ost->initialized, ost->inputs_done, atomic_load(&ost->finished));
+        }
 
         if (!ost->initialized && !ost->inputs_done)
             return ost->unavailable ? NULL : ost;
 
-        if (!ost->finished && opts < opts_min) {
+        if (!atomic_load(&ost->finished) && opts < opts_min) {
             opts_min = opts;
             ost_min  = ost->unavailable ? NULL : ost;
         }
@@ -4625,10 +5117,12 @@ discard_packet:
  * Perform a step of transcoding for the specified filter graph.
  *
  * @param[in]  graph     filter graph to consider
+ * @param[in]  ost       output stream the step is performed for
  * @param[out] best_ist  input stream where a frame would allow to continue
  * @return  0 for success, <0 for error
  */
-static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
+static int transcode_from_filter(FilterGraph *graph, OutputStream *ost,
+                                 InputStream **best_ist)
 {
     int i, ret;
     int nb_requests, nb_requests_max = 0;
@@ -4638,10 +5132,10 @@ static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
     *best_ist = NULL;
     ret = avfilter_graph_request_oldest(graph->graph);
     if (ret >= 0)
-        return reap_filters(0);
+        return reap_filters(0, ost);
 
     if (ret == AVERROR_EOF) {
-        ret = reap_filters(1);
+        ret = reap_filters(1, ost);
         for (i = 0; i < graph->nb_outputs; i++)
             close_output_stream(graph->outputs[i]->ost);
         return ret;
@@ -4726,7 +5220,7 @@ static int transcode_step(void)
         if (av_buffersink_get_type(ost->filter->filter) == AVMEDIA_TYPE_AUDIO)
             init_output_stream_wrapper(ost, NULL, 1);
 
-        if ((ret = transcode_from_filter(ost->filter->graph, &ist)) < 0)
+        if ((ret = transcode_from_filter(ost->filter->graph, ost, &ist)) < 0)
             return ret;
         if (!ist)
             return 0;
@@ -4758,7 +5252,7 @@ static int transcode_step(void)
     if (ret < 0)
         return ret == AVERROR_EOF ? 0 : ret;
 
-    return reap_filters(0);
+    return reap_filters(0, ost);
 }
 
 /*
@@ -4786,6 +5280,8 @@ static int transcode(void)
 #if HAVE_THREADS
     if ((ret = init_input_threads()) < 0)
         goto fail;
+    if ((ret = init_encoder_threads()) < 0)
+        goto fail;
 #endif
 
     while (!received_sigterm) {
@@ -4822,6 +5318,9 @@ static int transcode(void)
             process_input_packet(ist, NULL, 0);
         }
     }
+#if HAVE_THREADS
+    free_encoder_threads(1);
+#endif
     flush_encoders();
 
     term_exit();
@@ -4882,6 +5381,7 @@ static int transcode(void)
  fail:
 #if HAVE_THREADS
     free_input_threads();
+    free_encoder_threads(0);
 #endif
 
     if (output_streams) {
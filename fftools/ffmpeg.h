@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
@@ -219,6 +220,8 @@ typedef struct OptionsContext {
     int        nb_max_muxing_queue_size;
     SpecifierOpt *muxing_queue_data_threshold;
     int        nb_muxing_queue_data_threshold;
+    SpecifierOpt *enc_queue_size;
+    int        nb_enc_queue_size;
     SpecifierOpt *guess_layout_max;
     int        nb_guess_layout_max;
     SpecifierOpt *apad;
@@ -295,6 +298,11 @@ typedef struct FilterGraph {
     int          nb_inputs;
     OutputFilter **outputs;
     int         nb_outputs;
+
+    /* stats of the previous configurations of the graph */
+    uint64_t frames_sent;
+    int64_t  frames_copied;
+    int64_t  bytes_copied;
 } FilterGraph;
 
 typedef struct InputStream {
@@ -521,7 +529,9 @@ typedef struct OutputStream {
     AVDictionary *swr_opts;
     AVDictionary *resample_opts;
     char *apad;
-    OSTFinished finished;        /* no more packets should be written for this stream */
+    /* OSTFinished flags: no more packets should be written for this stream;
+     * atomic as encoder threads set them too */
+    atomic_int finished;
     int unavailable;                     /* true if the steram is unavailable (possibly temporarily) */
     int stream_copy;
 
@@ -570,6 +580,24 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+    /* maximum number of frames queued to the encoder thread, 0 for no thread
+     * and -1 for the default */
+    int enc_queue_size;
+#if HAVE_THREADS
+    AVThreadMessageQueue *enc_thread_queue;
+    AVFifoBuffer *enc_backlog;  /* EncoderMessages held back while the queue is full */
+    pthread_t enc_thread;       /* thread running the encoder of this stream */
+    /* pts of the last frame handed to the encoder thread, in AV_TIME_BASE
+     * units; used instead of the muxed dts to choose the next output */
+    int64_t enc_sent_pts;
+    /* OutputFile.recording_time when the frame being encoded was taken from
+     * the filtergraph, only used by the encoder thread */
+    int64_t enc_recording_time;
+    /* set by the encoder thread once it has closed the stream, protected by
+     * the output file lock */
+    int enc_closed;
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -583,6 +611,11 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+#if HAVE_THREADS
+    pthread_mutex_t mux_lock;   /* serializes muxer access between encoder threads */
+    pthread_cond_t  enc_cond;   /* signaled with mux_lock when a stream is closed */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -629,10 +662,14 @@ extern AVIOContext *progress_avio;
 extern float max_error_rate;
 extern char *videotoolbox_pixfmt;
 
+extern int do_pipeline;
 extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern int filter_thread_pool;
+extern int filter_frame_pool;
 extern int vstats_version;
 extern int auto_conversion_filters;
+extern int print_buffer_stats;
 
 extern const AVIOInterruptCB int_cb;
 
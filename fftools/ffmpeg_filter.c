@@ -973,6 +973,13 @@ static int configure_input_filter(FilterGraph *fg, InputFilter *ifilter,
 static void cleanup_filtergraph(FilterGraph *fg)
 {
     int i;
+
+    if (fg->graph) {
+        int64_t frames, bytes;
+        avfilter_graph_get_copy_stats(fg->graph, &frames, &bytes);
+        fg->frames_copied += frames;
+        fg->bytes_copied  += bytes;
+    }
     for (i = 0; i < fg->nb_outputs; i++)
         fg->outputs[i]->filter = (AVFilterContext *)NULL;
     for (i = 0; i < fg->nb_inputs; i++)
@@ -990,6 +997,8 @@ int configure_filtergraph(FilterGraph *fg)
     cleanup_filtergraph(fg);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->thread_pool = filter_thread_pool;
+    fg->graph->frame_pool  = filter_frame_pool;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -89,6 +89,7 @@ static const char *const opt_name_pass[]                      = {"pass", NULL};
 static const char *const opt_name_passlogfiles[]              = {"passlogfile", NULL};
 static const char *const opt_name_max_muxing_queue_size[]     = {"max_muxing_queue_size", NULL};
 static const char *const opt_name_muxing_queue_data_threshold[] = {"muxing_queue_data_threshold", NULL};
+static const char *const opt_name_enc_queue_size[]            = {"enc_queue_size", NULL};
 static const char *const opt_name_guess_layout_max[]          = {"guess_layout_max", NULL};
 static const char *const opt_name_apad[]                      = {"apad", NULL};
 static const char *const opt_name_discard[]                   = {"discard", NULL};
@@ -171,11 +172,15 @@ int qp_hist           = 0;
 int stdin_interaction = 1;
 int frame_bits_per_raw_sample = 0;
 float max_error_rate  = 2.0/3;
+int do_pipeline      = 0;
 int filter_nbthreads = 0;
 int filter_complex_nbthreads = 0;
+int filter_thread_pool = 0;
+int filter_frame_pool = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
 int64_t stats_period = 500000;
+int print_buffer_stats = 0;
 
 
 static int intra_only         = 0;
@@ -1581,6 +1586,9 @@ static OutputStream *new_output_stream(OptionsContext *o, AVFormatContext *oc, e
     ost->muxing_queue_data_threshold = 50*1024*1024;
     MATCH_PER_STREAM_OPT(muxing_queue_data_threshold, i, ost->muxing_queue_data_threshold, oc, st);
 
+    ost->enc_queue_size = -1;
+    MATCH_PER_STREAM_OPT(enc_queue_size, i, ost->enc_queue_size, oc, st);
+
     if (oc->oformat->flags & AVFMT_GLOBALHEADER)
         ost->enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
@@ -2001,7 +2009,7 @@ static OutputStream *new_attachment_stream(OptionsContext *o, AVFormatContext *o
 {
     OutputStream *ost = new_output_stream(o, oc, AVMEDIA_TYPE_ATTACHMENT, source_index);
     ost->stream_copy = 1;
-    ost->finished    = 1;
+    atomic_store(&ost->finished, ENCODER_FINISHED);
     return ost;
 }
 
@@ -2184,6 +2192,13 @@ static int open_output_file(OptionsContext *o, const char *filename)
         exit_program(1);
     output_files[nb_output_files - 1] = of;
 
+#if HAVE_THREADS
+    if (pthread_mutex_init(&of->mux_lock, NULL))
+        exit_program(1);
+    if (pthread_cond_init(&of->enc_cond, NULL))
+        exit_program(1);
+#endif
+
     of->ost_index      = nb_output_streams;
     of->recording_time = o->recording_time;
     of->start_time     = o->start_time;
@@ -3576,16 +3591,26 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_threads", HAS_ARG | OPT_INT,                   { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "filter_thread_pool", OPT_BOOL | OPT_EXPERT,                   { &filter_thread_pool },
+        "run filter threads on the pool shared with codecs" },
+    { "filter_frame_pool", OPT_BOOL | OPT_EXPERT,                    { &filter_frame_pool },
+        "let video decoders allocate frames from the filter graph pools" },
     { "lavfi",          HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
         "read complex filtergraph description from a file", "filename" },
     { "auto_conversion_filters", OPT_BOOL | OPT_EXPERT,              { &auto_conversion_filters },
         "enable automatic conversion filters globally" },
+#if HAVE_THREADS
+    { "pipeline",       OPT_BOOL | OPT_EXPERT,                       { &do_pipeline },
+        "run each encoder and its muxing in a separate thread" },
+#endif
     { "stats",          OPT_BOOL,                                    { &print_stats },
         "print progress report during encoding", },
     { "stats_period",    HAS_ARG | OPT_EXPERT,                       { .func_arg = opt_stats_period },
         "set the period at which ffmpeg updates stats and -progress output", "time" },
+    { "buffer_stats",   OPT_BOOL | OPT_EXPERT,                       { &print_buffer_stats },
+        "print buffer pool and copy-on-write statistics periodically" },
     { "attach",         HAS_ARG | OPT_PERFILE | OPT_EXPERT |
                         OPT_OUTPUT,                                  { .func_arg = opt_attach },
         "add an attachment to the output file", "filename" },
@@ -3801,6 +3826,10 @@ const OptionDef options[] = {
         "maximum number of packets that can be buffered while waiting for all streams to initialize", "packets" },
     { "muxing_queue_data_threshold", HAS_ARG | OPT_INT | OPT_SPEC | OPT_EXPERT | OPT_OUTPUT, { .off = OFFSET(muxing_queue_data_threshold) },
         "set the threshold after which max_muxing_queue_size is taken into account", "bytes" },
+#if HAVE_THREADS
+    { "enc_queue_size", HAS_ARG | OPT_INT | OPT_SPEC | OPT_EXPERT | OPT_OUTPUT, { .off = OFFSET(enc_queue_size) },
+        "encode in a separate thread fed with at most this number of frames", "frames" },
+#endif
 
     /* data codec support */
     { "dcodec", HAS_ARG | OPT_DATA | OPT_PERFILE | OPT_EXPERT | OPT_INPUT | OPT_OUTPUT, { .func_arg = opt_data_codec },
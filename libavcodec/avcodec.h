@@ -2382,6 +2382,32 @@ typedef struct AVCodecContext {
      * - decoding: unused
      */
     int (*get_encode_buffer)(struct AVCodecContext *s, AVPacket *pkt, int flags);
+
+    /**
+     * Run frame and slice threads on a worker pool shared by all codec
+     * contexts of the process, instead of starting thread_count threads for
+     * this context alone. The pool has one thread per CPU, so the total
+     * number of threads stays the same however many codecs are open;
+     * thread_count still sets how many frames or slices may be processed
+     * in parallel.
+     *
+     * - encoding: Set by user, only slice threading uses the pool.
+     * - decoding: Set by user.
+     */
+    int thread_pool;
+
+    /**
+     * Maximum number of frames a frame-threaded encoder may have in flight,
+     * i.e. being encoded or encoded and waiting to be returned in order.
+     * Workers keep encoding later frames while an earlier one is still
+     * being worked on, until this many frames are outstanding. 0 selects
+     * thread_count + 1 with AV_CODEC_FLAG_LOW_DELAY, twice thread_count
+     * otherwise.
+     *
+     * - encoding: Set by user.
+     * - decoding: unused
+     */
+    int frame_thread_depth;
 } AVCodecContext;
 
 #if FF_API_CODEC_GET_SET
@@ -116,6 +116,10 @@ void av_shrink_packet(AVPacket *pkt, int size)
     if (pkt->size <= size)
         return;
     pkt->size = size;
+    /* the bytes after the data may belong to someone else */
+    if (pkt->buf && !av_buffer_is_writable(pkt->buf) &&
+        av_packet_make_writable(pkt) < 0)
+        return;
     memset(pkt->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
 }
 
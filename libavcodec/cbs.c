@@ -23,6 +23,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/buffer.h"
 #include "libavutil/common.h"
+#include "libavutil/internal.h"
 #include "libavutil/opt.h"
 
 #include "cbs.h"
@@ -1030,7 +1031,7 @@ int ff_cbs_make_unit_writable(CodedBitstreamContext *ctx,
 
     switch (desc->content_type) {
     case CBS_CONTENT_TYPE_POD:
-        err = av_buffer_make_writable(&unit->content_ref);
+        err = ff_buffer_make_writable(&unit->content_ref);
         break;
 
     case CBS_CONTENT_TYPE_INTERNAL_REFS:
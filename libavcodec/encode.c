@@ -186,6 +186,10 @@ static int encode_simple_internal(AVCodecContext *avctx, AVPacket *avpkt)
     if (!frame->buf[0] && !avci->draining) {
         av_frame_unref(frame);
         ret = ff_encode_get_frame(avctx, frame);
+        /* no new input, but hand out what the frame threads have finished */
+        if (CONFIG_FRAME_THREAD_ENCODER && ret == AVERROR(EAGAIN) &&
+            avci->frame_thread_encoder && (avctx->active_thread_type & FF_THREAD_FRAME))
+            return ff_thread_video_receive_packet(avctx, avpkt);
         if (ret < 0 && ret != AVERROR_EOF)
             return ret;
     }
@@ -31,11 +31,7 @@
 #include "thread.h"
 
 #define MAX_THREADS 64
-/* There can be as many as MAX_THREADS + 1 outstanding tasks.
- * An additional + 1 is needed so that one can distinguish
- * the case of zero and MAX_THREADS + 1 outstanding tasks modulo
- * the number of buffers. */
-#define BUFFER_SIZE (MAX_THREADS + 2)
+#define MAX_DEPTH   (4 * MAX_THREADS)
 
 typedef struct{
     AVFrame  *indata;
@@ -51,8 +47,11 @@ typedef struct{
     pthread_mutex_t task_fifo_mutex; /* Used to guard (next_)task_index */
     pthread_cond_t task_fifo_cond;
 
+    /* There can be as many as max_tasks - 1 outstanding tasks, the extra
+     * entry is needed to distinguish the case of zero and max_tasks - 1
+     * outstanding tasks modulo the number of buffers. */
     unsigned max_tasks;
-    Task tasks[BUFFER_SIZE];
+    Task *tasks;
     pthread_mutex_t finished_task_mutex; /* Guards tasks[i].finished */
     pthread_cond_t finished_task_cond;
 
@@ -122,7 +121,7 @@ end:
 }
 
 int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
-    int i=0;
+    int i=0, depth;
     ThreadContext *c;
     AVCodecContext *thread_avctx = NULL;
 
@@ -194,7 +193,14 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
     pthread_cond_init(&c->finished_task_cond, NULL);
     atomic_init(&c->exit, 0);
 
-    c->max_tasks = avctx->thread_count + 2;
+    depth = avctx->frame_thread_depth;
+    if (!depth)
+        depth = avctx->flags & AV_CODEC_FLAG_LOW_DELAY ? avctx->thread_count + 1 :
+                                                         avctx->thread_count * 2;
+    c->max_tasks = av_clip(depth, 1, MAX_DEPTH) + 1;
+    c->tasks     = av_calloc(c->max_tasks, sizeof(*c->tasks));
+    if (!c->tasks)
+        goto fail;
     for (unsigned i = 0; i < c->max_tasks; i++) {
         if (!(c->tasks[i].indata  = av_frame_alloc()) ||
             !(c->tasks[i].outdata = av_packet_alloc()))
@@ -265,10 +271,11 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
          pthread_join(c->worker[i], NULL);
     }
 
-    for (unsigned i = 0; i < c->max_tasks; i++) {
+    for (unsigned i = 0; c->tasks && i < c->max_tasks; i++) {
         av_frame_free(&c->tasks[i].indata);
         av_packet_free(&c->tasks[i].outdata);
     }
+    av_freep(&c->tasks);
 
     pthread_mutex_destroy(&c->task_fifo_mutex);
     pthread_mutex_destroy(&c->finished_task_mutex);
@@ -278,6 +285,22 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
     av_freep(&avctx->internal->frame_thread_encoder);
 }
 
+/* Must only be called once the oldest outstanding task has finished. */
+static int return_task(ThreadContext *c, AVPacket *pkt, int *got_packet_ptr)
+{
+    Task *outtask = &c->tasks[c->finished_task_index];
+
+    /* We now own outtask completely: No worker thread touches it any more,
+     * because there is no outstanding task with this index. */
+    outtask->finished = 0;
+    av_packet_move_ref(pkt, outtask->outdata);
+    if(pkt->data)
+        *got_packet_ptr = 1;
+    c->finished_task_index = (c->finished_task_index + 1) % c->max_tasks;
+
+    return outtask->return_code;
+}
+
 int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                                  AVFrame *frame, int *got_packet_ptr)
 {
@@ -301,7 +324,7 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
      * because it is only ever changed by the main thread. */
     if (c->task_index == c->finished_task_index ||
         (frame && !outtask->finished &&
-         (c->task_index - c->finished_task_index + c->max_tasks) % c->max_tasks <= avctx->thread_count)) {
+         (c->task_index - c->finished_task_index + c->max_tasks) % c->max_tasks < c->max_tasks - 1)) {
             pthread_mutex_unlock(&c->finished_task_mutex);
             return 0;
         }
@@ -309,13 +332,24 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
     }
     pthread_mutex_unlock(&c->finished_task_mutex);
-    /* We now own outtask completely: No worker thread touches it any more,
-     * because there is no outstanding task with this index. */
-    outtask->finished = 0;
-    av_packet_move_ref(pkt, outtask->outdata);
-    if(pkt->data)
-        *got_packet_ptr = 1;
-    c->finished_task_index = (c->finished_task_index + 1) % c->max_tasks;
 
-    return outtask->return_code;
+    return return_task(c, pkt, got_packet_ptr);
+}
+
+int ff_thread_video_receive_packet(AVCodecContext *avctx, AVPacket *pkt)
+{
+    ThreadContext *c = avctx->internal->frame_thread_encoder;
+    int finished, got_packet = 0, ret;
+
+    pthread_mutex_lock(&c->finished_task_mutex);
+    finished = c->task_index != c->finished_task_index &&
+               c->tasks[c->finished_task_index].finished;
+    pthread_mutex_unlock(&c->finished_task_mutex);
+    if (!finished)
+        return AVERROR(EAGAIN);
+
+    ret = return_task(c, pkt, &got_packet);
+    if (ret < 0 || !got_packet)
+        av_packet_unref(pkt);
+    return ret;
 }
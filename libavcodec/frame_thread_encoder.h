@@ -32,4 +32,14 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx);
 int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                                  AVFrame *frame, int *got_packet_ptr);
 
+/**
+ * Return the packet of the oldest outstanding frame if its encoding has
+ * finished, without submitting a new frame or waiting.
+ *
+ * @return 0 with pkt possibly empty, AVERROR(EAGAIN) if the oldest frame
+ *         is still being encoded or there is none, or the error returned
+ *         by the encoder for that frame
+ */
+int ff_thread_video_receive_packet(AVCodecContext *avctx, AVPacket *pkt);
+
 #endif /* AVCODEC_FRAME_THREAD_ENCODER_H */
@@ -28,6 +28,7 @@
 #define UNCHECKED_BITSTREAM_READER 1
 
 #include "libavutil/cpu.h"
+#include "libavutil/internal.h"
 #include "libavutil/video_enc_params.h"
 
 #include "avcodec.h"
@@ -706,7 +707,7 @@ frame_end:
         if (   pict->format == AV_PIX_FMT_YUV420P
             && (s->codec_tag == AV_RL32("GEOV") || s->codec_tag == AV_RL32("GEOX"))) {
             int x, y, p;
-            av_frame_make_writable(pict);
+            ff_frame_make_writable(pict);
             for (p=0; p<3; p++) {
                 int w = AV_CEIL_RSHIFT(pict-> width, !!p);
                 int h = AV_CEIL_RSHIFT(pict->height, !!p);
@@ -24,6 +24,7 @@
 #include "libavutil/common.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/internal.h"
 
 #include "avcodec.h"
 #include "motion_est.h"
@@ -36,7 +37,7 @@ static int make_tables_writable(Picture *pic)
 #define MAKE_WRITABLE(table) \
 do {\
     if (pic->table &&\
-       (ret = av_buffer_make_writable(&pic->table)) < 0)\
+       (ret = ff_buffer_make_writable(&pic->table)) < 0)\
     return ret;\
 } while (0)
 
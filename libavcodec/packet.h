@@ -501,6 +501,9 @@ int av_new_packet(AVPacket *pkt, int size);
 /**
  * Reduce packet size, correctly zeroing padding
  *
+ * If the packet data is not writable, it is copied first, unless that fails,
+ * in which case the padding is left as is.
+ *
  * @param pkt packet
  * @param size new size
  */
@@ -43,6 +43,7 @@
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/thread.h"
 
 enum {
@@ -77,6 +78,7 @@ typedef struct PerThreadContext {
     struct FrameThreadContext *parent;
 
     pthread_t      thread;
+    AVSliceThreadTask task;         ///< Used instead of thread when running on the shared pool.
     int            thread_init;
     unsigned       pthread_init_cnt;///< Number of successfully initialized mutexes/conditions
     pthread_cond_t input_cond;      ///< Used to wait for a new packet from the main thread.
@@ -126,6 +128,7 @@ typedef struct PerThreadContext {
 typedef struct FrameThreadContext {
     PerThreadContext *threads;     ///< The contexts for each thread.
     PerThreadContext *prev_thread; ///< The last thread submit_packet() was called on.
+    AVSliceThreadPool *pool;       ///< Shared worker pool, NULL if each thread has its own.
 
     unsigned    pthread_init_cnt;  ///< Number of successfully initialized mutexes/conditions
     pthread_mutex_t buffer_mutex;  ///< Mutex used to protect get/release_buffer().
@@ -171,87 +174,108 @@ static void async_unlock(FrameThreadContext *fctx)
 }
 
 /**
- * Codec worker thread.
+ * Decode the packet submitted to a thread. Must be called with p->mutex held.
  *
  * Automatically calls ff_thread_finish_setup() if the codec does
  * not provide an update_thread_context method, or if the codec returns
  * before calling it.
  */
-static attribute_align_arg void *frame_worker_thread(void *arg)
+static void frame_worker_decode(PerThreadContext *p)
 {
-    PerThreadContext *p = arg;
     AVCodecContext *avctx = p->avctx;
     const AVCodec *codec = avctx->codec;
 
-    pthread_mutex_lock(&p->mutex);
-    while (1) {
-        while (atomic_load(&p->state) == STATE_INPUT_READY && !p->die)
-            pthread_cond_wait(&p->input_cond, &p->mutex);
-
-        if (p->die) break;
-
 FF_DISABLE_DEPRECATION_WARNINGS
-        if (!codec->update_thread_context
+    if (!codec->update_thread_context
 #if FF_API_THREAD_SAFE_CALLBACKS
-            && THREAD_SAFE_CALLBACKS(avctx)
+        && THREAD_SAFE_CALLBACKS(avctx)
 #endif
-            )
-            ff_thread_finish_setup(avctx);
+        )
+        ff_thread_finish_setup(avctx);
 FF_ENABLE_DEPRECATION_WARNINGS
 
-        /* If a decoder supports hwaccel, then it must call ff_get_format().
-         * Since that call must happen before ff_thread_finish_setup(), the
-         * decoder is required to implement update_thread_context() and call
-         * ff_thread_finish_setup() manually. Therefore the above
-         * ff_thread_finish_setup() call did not happen and hwaccel_serializing
-         * cannot be true here. */
-        av_assert0(!p->hwaccel_serializing);
-
-        /* if the previous thread uses hwaccel then we take the lock to ensure
-         * the threads don't run concurrently */
-        if (avctx->hwaccel) {
-            pthread_mutex_lock(&p->parent->hwaccel_mutex);
-            p->hwaccel_serializing = 1;
-        }
+    /* If a decoder supports hwaccel, then it must call ff_get_format().
+     * Since that call must happen before ff_thread_finish_setup(), the
+     * decoder is required to implement update_thread_context() and call
+     * ff_thread_finish_setup() manually. Therefore the above
+     * ff_thread_finish_setup() call did not happen and hwaccel_serializing
+     * cannot be true here. */
+    av_assert0(!p->hwaccel_serializing);
+
+    /* if the previous thread uses hwaccel then we take the lock to ensure
+     * the threads don't run concurrently */
+    if (avctx->hwaccel) {
+        pthread_mutex_lock(&p->parent->hwaccel_mutex);
+        p->hwaccel_serializing = 1;
+    }
+
+    av_frame_unref(p->frame);
+    p->got_frame = 0;
+    p->result = codec->decode(avctx, p->frame, &p->got_frame, p->avpkt);
 
+    if ((p->result < 0 || !p->got_frame) && p->frame->buf[0]) {
+        if (avctx->codec->caps_internal & FF_CODEC_CAP_ALLOCATE_PROGRESS)
+            av_log(avctx, AV_LOG_ERROR, "A frame threaded decoder did not "
+                   "free the frame on failure. This is a bug, please report it.\n");
         av_frame_unref(p->frame);
-        p->got_frame = 0;
-        p->result = codec->decode(avctx, p->frame, &p->got_frame, p->avpkt);
+    }
 
-        if ((p->result < 0 || !p->got_frame) && p->frame->buf[0]) {
-            if (avctx->codec->caps_internal & FF_CODEC_CAP_ALLOCATE_PROGRESS)
-                av_log(avctx, AV_LOG_ERROR, "A frame threaded decoder did not "
-                       "free the frame on failure. This is a bug, please report it.\n");
-            av_frame_unref(p->frame);
-        }
+    if (atomic_load(&p->state) == STATE_SETTING_UP)
+        ff_thread_finish_setup(avctx);
 
-        if (atomic_load(&p->state) == STATE_SETTING_UP)
-            ff_thread_finish_setup(avctx);
+    if (p->hwaccel_serializing) {
+        p->hwaccel_serializing = 0;
+        pthread_mutex_unlock(&p->parent->hwaccel_mutex);
+    }
 
-        if (p->hwaccel_serializing) {
-            p->hwaccel_serializing = 0;
-            pthread_mutex_unlock(&p->parent->hwaccel_mutex);
-        }
+    if (p->async_serializing) {
+        p->async_serializing = 0;
 
-        if (p->async_serializing) {
-            p->async_serializing = 0;
+        async_unlock(p->parent);
+    }
 
-            async_unlock(p->parent);
-        }
+    pthread_mutex_lock(&p->progress_mutex);
 
-        pthread_mutex_lock(&p->progress_mutex);
+    atomic_store(&p->state, STATE_INPUT_READY);
 
-        atomic_store(&p->state, STATE_INPUT_READY);
+    pthread_cond_broadcast(&p->progress_cond);
+    pthread_cond_signal(&p->output_cond);
+    pthread_mutex_unlock(&p->progress_mutex);
+}
 
-        pthread_cond_broadcast(&p->progress_cond);
-        pthread_cond_signal(&p->output_cond);
-        pthread_mutex_unlock(&p->progress_mutex);
+/**
+ * Codec worker thread.
+ */
+static attribute_align_arg void *frame_worker_thread(void *arg)
+{
+    PerThreadContext *p = arg;
+
+    pthread_mutex_lock(&p->mutex);
+    while (1) {
+        while (atomic_load(&p->state) == STATE_INPUT_READY && !p->die)
+            pthread_cond_wait(&p->input_cond, &p->mutex);
+
+        if (p->die) break;
+
+        frame_worker_decode(p);
     }
     pthread_mutex_unlock(&p->mutex);
 
     return NULL;
 }
 
+/**
+ * Pool task, run once for every packet submitted to a thread.
+ */
+static void frame_worker_task(void *arg)
+{
+    PerThreadContext *p = arg;
+
+    pthread_mutex_lock(&p->mutex);
+    frame_worker_decode(p);
+    pthread_mutex_unlock(&p->mutex);
+}
+
 /**
  * Update the next thread's AVCodecContext with values from the reference thread's context.
  *
@@ -415,6 +439,10 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
     if (!avpkt->size && !(codec->capabilities & AV_CODEC_CAP_DELAY))
         return 0;
 
+    /* the task of the previous packet may not have returned yet */
+    if (fctx->pool)
+        avpriv_slicethread_pool_wait(fctx->pool, &p->task);
+
     pthread_mutex_lock(&p->mutex);
 
     ret = update_context_from_user(p->avctx, user_avctx);
@@ -455,7 +483,10 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
     }
 
     atomic_store(&p->state, STATE_SETTING_UP);
-    pthread_cond_signal(&p->input_cond);
+    if (fctx->pool)
+        avpriv_slicethread_pool_submit(fctx->pool, &p->task);
+    else
+        pthread_cond_signal(&p->input_cond);
     pthread_mutex_unlock(&p->mutex);
 
 #if FF_API_THREAD_SAFE_CALLBACKS
@@ -646,7 +677,13 @@ void ff_thread_finish_setup(AVCodecContext *avctx) {
         !(avctx->hwaccel->caps_internal & HWACCEL_CAP_ASYNC_SAFE)) {
         p->async_serializing = 1;
 
+        /* the async lock is released by the user thread, so let the pool
+         * run other tasks meanwhile */
+        if (p->parent->pool)
+            avpriv_slicethread_pool_block(p->parent->pool, 1);
         async_lock(p->parent);
+        if (p->parent->pool)
+            avpriv_slicethread_pool_block(p->parent->pool, 0);
     }
 
     pthread_mutex_lock(&p->progress_mutex);
@@ -770,6 +807,8 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 
                 pthread_join(p->thread, NULL);
             }
+            if (fctx->pool)
+                avpriv_slicethread_pool_wait(fctx->pool, &p->task);
             if (codec->close && p->thread_init != UNINITIALIZED)
                 codec->close(ctx);
 
@@ -801,6 +840,7 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
     }
 
     av_freep(&fctx->threads);
+    avpriv_slicethread_pool_unref(&fctx->pool);
     free_pthread(fctx, thread_ctx_offsets);
 
     av_freep(&avctx->internal->thread_ctx);
@@ -878,6 +918,13 @@ static av_cold int init_thread(PerThreadContext *p, int *threads_to_free,
 
     atomic_init(&p->debug_threads, (copy->debug & FF_DEBUG_THREADS) != 0);
 
+    if (fctx->pool) {
+        p->task.func     = frame_worker_task;
+        p->task.priv     = p;
+        p->task.priority = AV_SLICETHREAD_PRIORITY_NORMAL;
+        return 0;
+    }
+
     err = AVERROR(pthread_create(&p->thread, NULL, frame_worker_thread, p));
     if (err < 0)
         return err;
@@ -922,6 +969,12 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     fctx->async_lock = 1;
     fctx->delaying = 1;
 
+    if (avctx->thread_pool) {
+        err = avpriv_slicethread_pool_ref(&fctx->pool);
+        if (err < 0)
+            goto error;
+    }
+
     if (codec->type == AVMEDIA_TYPE_VIDEO)
         avctx->delay = src->thread_count - 1;
 
@@ -35,6 +35,7 @@
 #include "libavutil/common.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/internal.h"
 #include "libavutil/opt.h"
 
 typedef struct RawVideoContext {
@@ -383,7 +384,7 @@ static int raw_decode(AVCodecContext *avctx, void *data, int *got_frame,
             av_buffer_unref(&frame->buf[0]);
             return AVERROR(ENOMEM);
         }
-        ret = av_buffer_make_writable(&context->palette);
+        ret = ff_buffer_make_writable(&context->palette);
         if (ret < 0) {
             av_buffer_unref(&frame->buf[0]);
             return ret;
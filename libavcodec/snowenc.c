@@ -19,6 +19,7 @@
  */
 
 #include "libavutil/intmath.h"
+#include "libavutil/internal.h"
 #include "libavutil/libm.h"
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
@@ -1636,7 +1637,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
         int h = s->avctx->height;
 
 #if FF_API_CODED_FRAME
-        ret = av_frame_make_writable(s->current_picture);
+        ret = ff_frame_make_writable(s->current_picture);
         if (ret < 0)
             return ret;
 #endif
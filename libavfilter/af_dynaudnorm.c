@@ -723,7 +723,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         ret = ff_filter_frame(outlink, out);
     }
 
-    av_frame_make_writable(in);
+    ff_frame_make_writable(in);
     analyze_frame(s, in);
     if (!s->eof) {
         ff_bufqueue_add(ctx, &s->queue, in);
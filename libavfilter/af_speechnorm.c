@@ -417,7 +417,7 @@ static int filter_frame(AVFilterContext *ctx)
 
         in = ff_bufqueue_get(&s->queue);
 
-        av_frame_make_writable(in);
+        ff_frame_make_writable(in);
 
         s->filter_channels[s->link](ctx, in, in->nb_samples);
 
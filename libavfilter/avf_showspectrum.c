@@ -1294,7 +1294,7 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
         }
     }
 
-    av_frame_make_writable(s->outpicref);
+    ff_frame_make_writable(s->outpicref);
     /* copy to output */
     if (s->orientation == VERTICAL) {
         if (s->sliding == SCROLL) {
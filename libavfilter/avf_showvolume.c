@@ -429,7 +429,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
     out = av_frame_clone(s->out);
     if (!out)
         return AVERROR(ENOMEM);
-    av_frame_make_writable(out);
+    ff_frame_make_writable(out);
 
     /* draw volume level */
     for (c = 0; c < inlink->channels && s->h >= 8 && s->draw_volume; c++) {
@@ -1537,7 +1537,7 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
 {
     AVFrame *frame = *rframe;
     AVFrame *out;
-    int ret;
+    int ret, size;
 
     if (av_frame_is_writable(frame))
         return 0;
@@ -1566,17 +1566,26 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
     case AVMEDIA_TYPE_VIDEO:
         av_image_copy(out->data, out->linesize, (const uint8_t **)frame->data, frame->linesize,
                       frame->format, frame->width, frame->height);
+        size = av_image_get_buffer_size(frame->format, frame->width, frame->height, 1);
         break;
     case AVMEDIA_TYPE_AUDIO:
         av_samples_copy(out->extended_data, frame->extended_data,
                         0, 0, frame->nb_samples,
                         frame->channels,
                         frame->format);
+        size = av_samples_get_buffer_size(NULL, frame->channels, frame->nb_samples,
+                                          frame->format, 1);
         break;
     default:
         av_assert0(!"reached");
     }
 
+    if (link->graph) {
+        link->graph->internal->nb_copied_frames++;
+        link->graph->internal->nb_copied_bytes += FFMAX(size, 0);
+    }
+    avpriv_buffer_count_copy(link->dst->filter->name, FFMAX(size, 0));
+
     av_frame_free(&frame);
     *rframe = out;
     return 0;
@@ -906,6 +906,24 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * Run the slice threads of this graph on the worker pool shared with
+     * other filter graphs and codecs, instead of starting nb_threads threads
+     * for this graph alone. nb_threads still limits how many threads work on
+     * one frame. May be set by the caller before adding any filters to the
+     * filtergraph.
+     */
+    int thread_pool;
+
+    /**
+     * Let the links of this graph allocate their video frames from pools
+     * shared by the whole graph, so that links of the same dimensions and
+     * format recycle the same buffers. Links which do not find a shared pool
+     * keep a pool of their own. May be set by the caller before adding any
+     * filters to the filtergraph.
+     */
+    int frame_pool;
+
     /**
      * Private fields
      *
@@ -1171,6 +1189,16 @@ char *avfilter_graph_dump(AVFilterGraph *graph, const char *options);
  */
 int avfilter_graph_request_oldest(AVFilterGraph *graph);
 
+/**
+ * Get how much frame data the graph had to copy because a filter wanted to
+ * write to a frame it did not own exclusively.
+ *
+ * @param nb_frames if not NULL, set to the number of frames copied
+ * @param nb_bytes  if not NULL, set to the number of bytes copied
+ */
+void avfilter_graph_get_copy_stats(const AVFilterGraph *graph,
+                                   int64_t *nb_frames, int64_t *nb_bytes);
+
 /**
  * @}
  */
@@ -52,6 +52,10 @@ static const AVOption filtergraph_options[] = {
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
+    { "thread_pool", "Use the worker pool shared with other graphs and codecs", OFFSET(thread_pool),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
+    { "frame_pool",  "Share video frame pools between the links of the graph", OFFSET(frame_pool),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
@@ -119,12 +123,17 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
 
 void avfilter_graph_free(AVFilterGraph **graph)
 {
+    int i;
+
     if (!*graph)
         return;
 
     while ((*graph)->nb_filters)
         avfilter_free((*graph)->filters[0]);
 
+    for (i = 0; i < FF_GRAPH_VIDEO_POOLS; i++)
+        ff_frame_pool_uninit(&(*graph)->internal->video_pools[i].pool);
+
     ff_graph_thread_free(*graph);
 
     av_freep(&(*graph)->sink_links);
@@ -1388,6 +1397,15 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+void avfilter_graph_get_copy_stats(const AVFilterGraph *graph,
+                                   int64_t *nb_frames, int64_t *nb_bytes)
+{
+    if (nb_frames)
+        *nb_frames = graph->internal->nb_copied_frames;
+    if (nb_bytes)
+        *nb_bytes  = graph->internal->nb_copied_bytes;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
     AVFilterContext *filter;
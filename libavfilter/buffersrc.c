@@ -239,6 +239,33 @@ int av_buffersrc_close(AVFilterContext *ctx, int64_t pts, unsigned flags)
     return (flags & AV_BUFFERSRC_FLAG_PUSH) ? push_frame(ctx->graph) : 0;
 }
 
+int av_buffersrc_get_video_buffer(AVFilterContext *ctx, AVFrame *frame,
+                                  int width, int height, int align)
+{
+    AVFrame *tmp;
+    int i;
+
+    if (!ctx->graph || frame->format < 0 || frame->data[0] ||
+        width < frame->width || height < frame->height)
+        return AVERROR(EINVAL);
+
+    tmp = ff_graph_get_video_buffer(ctx->graph, width, height,
+                                    frame->format, align, 1);
+    if (!tmp)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
+        frame->buf[i]      = tmp->buf[i];
+        frame->data[i]     = tmp->data[i];
+        frame->linesize[i] = tmp->linesize[i];
+        tmp->buf[i]        = NULL;
+    }
+    frame->extended_data = frame->data;
+    av_frame_free(&tmp);
+
+    return 0;
+}
+
 static av_cold int init_video(AVFilterContext *ctx)
 {
     BufferSourceContext *c = ctx->priv;
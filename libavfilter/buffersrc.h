@@ -202,6 +202,30 @@ int av_buffersrc_add_frame_flags(AVFilterContext *buffer_src,
  */
 int av_buffersrc_close(AVFilterContext *ctx, int64_t pts, unsigned flags);
 
+/**
+ * Allocate the data of a video frame from the frame pools of the filter graph
+ * the buffer source belongs to, e.g. from an AVCodecContext.get_buffer2()
+ * callback. Once filled, the frame should be passed to the same buffer source
+ * without AV_BUFFERSRC_FLAG_KEEP_REF: filters can then work in place on it
+ * without copying, and its buffers go back to the pools the graph allocates
+ * its own frames from.
+ *
+ * This function must not be called concurrently with any other function
+ * operating on the same filter graph.
+ *
+ * @param ctx    an instance of the buffersrc filter
+ * @param frame  a frame with no data, frame->format must be set; the
+ *               dimensions of the frame are not changed
+ * @param width  width to allocate, at least frame->width
+ * @param height height to allocate, at least frame->height
+ * @param align  the alignment of the line sizes, a power of 2; the planes
+ *               are laid out like avcodec_default_get_buffer2() does with
+ *               the same alignment, so a decoder can mix frames from both
+ * @return 0 on success, a negative AVERROR on error
+ */
+int av_buffersrc_get_video_buffer(AVFilterContext *ctx, AVFrame *frame,
+                                  int width, int height, int align);
+
 /**
  * @}
  */
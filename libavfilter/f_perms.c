@@ -19,6 +19,7 @@
  */
 
 #include "libavutil/lfg.h"
+#include "libavutil/internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/random_seed.h"
 #include "audio.h"
@@ -96,7 +97,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
            in_perm == out_perm ? " (no-op)" : "");
 
     if (in_perm == RO && out_perm == RW) {
-        if ((ret = av_frame_make_writable(frame)) < 0)
+        if ((ret = ff_frame_make_writable(frame)) < 0)
             return ret;
     } else if (in_perm == RW && out_perm == RO) {
         out = av_frame_clone(frame);
@@ -126,6 +126,7 @@ AVFrame *ff_inlink_peek_frame(AVFilterLink *link, size_t idx);
  * Make sure a frame is writable.
  * This is similar to av_frame_make_writable() except it uses the link's
  * buffer allocation callback, and therefore allows direct rendering.
+ * Copies are counted for the destination filter, see AVBufferCopyStats.
  */
 int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe);
 
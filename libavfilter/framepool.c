@@ -48,11 +48,10 @@ struct FFFramePool {
 
 };
 
-FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(buffer_size_t size),
-                                      int width,
-                                      int height,
-                                      enum AVPixelFormat format,
-                                      int align)
+static FFFramePool *video_pool_init(AVBufferRef* (*alloc)(buffer_size_t size),
+                                    int width, int height,
+                                    enum AVPixelFormat format, int align,
+                                    int codec_layout)
 {
     int i, ret;
     FFFramePool *pool;
@@ -75,6 +74,24 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(buffer_size_t size),
         goto fail;
     }
 
+    if (codec_layout) {
+        int w = width, unaligned;
+
+        /* Same as avcodec_default_get_buffer2(): grow the width until all
+         * line sizes are aligned, so a decoder sees the same strides from
+         * both. */
+        do {
+            ret = av_image_fill_linesizes(pool->linesize, pool->format, w);
+            if (ret < 0)
+                goto fail;
+            w += w & ~(w - 1);
+
+            unaligned = 0;
+            for (i = 0; i < 4; i++)
+                unaligned |= pool->linesize[i] & (pool->align - 1);
+        } while (unaligned);
+    }
+
     if (!pool->linesize[0]) {
         for(i = 1; i <= align; i += i) {
             ret = av_image_fill_linesizes(pool->linesize, pool->format,
@@ -96,7 +113,9 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(buffer_size_t size),
         if (i == 1 || i == 2)
             h = AV_CEIL_RSHIFT(h, desc->log2_chroma_h);
 
-        pool->pools[i] = av_buffer_pool_init(pool->linesize[i] * h + 16 + 16 - 1,
+        /* libavcodec pads by up to STRIDE_ALIGN - 1, which is at most 64 */
+        pool->pools[i] = av_buffer_pool_init(pool->linesize[i] * h + 16 +
+                                             (codec_layout ? 64 : 16) - 1,
                                              alloc);
         if (!pool->pools[i])
             goto fail;
@@ -116,6 +135,24 @@ fail:
     return NULL;
 }
 
+FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(buffer_size_t size),
+                                      int width,
+                                      int height,
+                                      enum AVPixelFormat format,
+                                      int align)
+{
+    return video_pool_init(alloc, width, height, format, align, 0);
+}
+
+FFFramePool *ff_frame_pool_codec_video_init(AVBufferRef* (*alloc)(buffer_size_t size),
+                                            int width,
+                                            int height,
+                                            enum AVPixelFormat format,
+                                            int align)
+{
+    return video_pool_init(alloc, width, height, format, align, 1);
+}
+
 FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(buffer_size_t size),
                                       int channels,
                                       int nb_samples,
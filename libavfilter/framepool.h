@@ -50,6 +50,20 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(buffer_size_t size),
                                       enum AVPixelFormat format,
                                       int align);
 
+/**
+ * Allocate and initialize a video frame pool whose frames are laid out like
+ * the ones of avcodec_default_get_buffer2(), so that a decoder can switch
+ * between both without its strides changing.
+ *
+ * The parameters are the same as for ff_frame_pool_video_init(), align should
+ * be the line size alignment the decoder requires.
+ */
+FFFramePool *ff_frame_pool_codec_video_init(AVBufferRef* (*alloc)(buffer_size_t size),
+                                            int width,
+                                            int height,
+                                            enum AVPixelFormat format,
+                                            int align);
+
 /**
  * Allocate and initialize an audio frame pool.
  *
@@ -126,10 +126,28 @@ struct AVFilterPad {
     int needs_writable;
 };
 
+#define FF_GRAPH_VIDEO_POOLS 8
+
+typedef struct FFGraphVideoPool {
+    FFFramePool *pool;
+    int codec_layout;   ///< created by ff_frame_pool_codec_video_init()
+} FFGraphVideoPool;
+
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Video frame pools shared by the links of the graph when frame_pool is
+     * set and by decoders, keyed by dimensions and format, most recently
+     * used first.
+     */
+    FFGraphVideoPool video_pools[FF_GRAPH_VIDEO_POOLS];
+
+    /* frames copied by ff_inlink_make_frame_writable() */
+    int64_t nb_copied_frames;
+    int64_t nb_copied_bytes;
 };
 
 struct AVFilterInternal {
@@ -75,7 +75,10 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
-    nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
+    if (c->graph->thread_pool)
+        nb_threads = avpriv_slicethread_create_shared(&c->thread, c, worker_func, NULL, nb_threads);
+    else
+        nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
     if (nb_threads <= 1)
         avpriv_slicethread_free(&c->thread);
     return FFMAX(nb_threads, 1);
@@ -83,6 +86,7 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
 
 int ff_graph_thread_init(AVFilterGraph *graph)
 {
+    ThreadContext *c;
     int ret;
 
     if (graph->nb_threads == 1) {
@@ -90,11 +94,12 @@ int ff_graph_thread_init(AVFilterGraph *graph)
         return 0;
     }
 
-    graph->internal->thread = av_mallocz(sizeof(ThreadContext));
-    if (!graph->internal->thread)
+    graph->internal->thread = c = av_mallocz(sizeof(ThreadContext));
+    if (!c)
         return AVERROR(ENOMEM);
+    c->graph = graph;
 
-    ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
+    ret = thread_init_internal(c, graph->nb_threads);
     if (ret <= 1) {
         av_freep(&graph->internal->thread);
         graph->thread_type = 0;
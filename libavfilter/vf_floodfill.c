@@ -315,7 +315,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *frame)
             s->front++;
         }
 
-        if (ret = av_frame_make_writable(frame))
+        if (ret = ff_frame_make_writable(frame))
             return ret;
 
         while (s->front > s->back) {
@@ -452,7 +452,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     DistortionCorrectionThreadData distortion_correction_thread_data;
 
     if (lensfun->mode & VIGNETTING) {
-        av_frame_make_writable(in);
+        ff_frame_make_writable(in);
 
         vignetting_thread_data = (VignettingThreadData) {
             .width = inlink->w,
@@ -0,0 +1,576 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale the input video to several sizes at once
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/dict.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct MultiScaleContext {
+    const AVClass *class;
+    char *sizes_str;
+    char *flags_str;
+    enum AVPixelFormat format;
+    int cascade;
+    char *in_color_matrix;
+    char *out_color_matrix;
+    int in_range;
+    int out_range;
+
+    int nb_outputs;
+    int *w, *h;
+
+    int nb_scaled;          ///< number of distinct size and format pairs
+    int *scaled;            ///< for each output, the scaled image it gets
+    int *owner;             ///< for each scaled image, its first output
+    struct SwsContext **sws;  ///< one scaler per scaled image
+    int *input;             ///< scaled image scaled from, -1 for the input
+    int *order;             ///< processing order, largest images first
+    int in_w, in_h;
+    enum AVPixelFormat in_format;
+} MultiScaleContext;
+
+static int config_output(AVFilterLink *outlink);
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    char *sizes, *saveptr = NULL, *size;
+    int ret = 0;
+
+    if (!s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    sizes = av_strdup(s->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+
+    for (size = av_strtok(sizes, "|", &saveptr); size;
+         size = av_strtok(NULL, "|", &saveptr)) {
+        AVFilterPad pad = { 0 };
+        int w, h;
+
+        if (av_parse_video_size(&w, &h, size) < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid output size '%s'.\n", size);
+            ret = AVERROR(EINVAL);
+            break;
+        }
+        if ((ret = av_reallocp_array(&s->w, s->nb_outputs + 1, sizeof(*s->w))) < 0 ||
+            (ret = av_reallocp_array(&s->h, s->nb_outputs + 1, sizeof(*s->h))) < 0)
+            break;
+        s->w[s->nb_outputs] = w;
+        s->h[s->nb_outputs] = h;
+
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.config_props = config_output;
+        pad.name = av_asprintf("output%d", s->nb_outputs);
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        if ((ret = ff_insert_outpad(ctx, s->nb_outputs, &pad)) < 0) {
+            av_freep(&pad.name);
+            break;
+        }
+        s->nb_outputs++;
+    }
+    av_free(sizes);
+
+    if (!ret && !s->nb_outputs) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        ret = AVERROR(EINVAL);
+    }
+    return ret;
+}
+
+static void free_sws(MultiScaleContext *s)
+{
+    int i;
+
+    if (s->sws)
+        for (i = 0; i < s->nb_scaled; i++) {
+            sws_freeContext(s->sws[i]);
+            s->sws[i] = NULL;
+        }
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    int i;
+
+    free_sws(s);
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+    av_freep(&s->w);
+    av_freep(&s->h);
+    av_freep(&s->scaled);
+    av_freep(&s->owner);
+    av_freep(&s->sws);
+    av_freep(&s->input);
+    av_freep(&s->order);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    AVFilterFormats *formats = NULL;
+    const AVPixFmtDescriptor *desc = NULL;
+    int i, ret;
+
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+        if (sws_isSupportedInput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+    if ((ret = ff_formats_ref(formats, &ctx->inputs[0]->outcfg.formats)) < 0)
+        return ret;
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        formats = NULL;
+        if (s->format != AV_PIX_FMT_NONE) {
+            if ((ret = ff_add_format(&formats, s->format)) < 0)
+                return ret;
+        } else {
+            desc = NULL;
+            while ((desc = av_pix_fmt_desc_next(desc))) {
+                enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+                if (sws_isSupportedOutput(pix_fmt) &&
+                    (ret = ff_add_format(&formats, pix_fmt)) < 0)
+                    return ret;
+            }
+        }
+        if ((ret = ff_formats_ref(formats, &ctx->outputs[i]->incfg.formats)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx  = outlink->src;
+    AVFilterLink *inlink  = ctx->inputs[0];
+    MultiScaleContext *s  = ctx->priv;
+    int i = FF_OUTLINK_IDX(outlink);
+
+    outlink->w = s->w[i];
+    outlink->h = s->h[i];
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ outlink->h * inlink->w,
+                                                              outlink->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d: w:%d h:%d fmt:%s sar:%d/%d\n",
+           i, outlink->w, outlink->h, av_get_pix_fmt_name(outlink->format),
+           outlink->sample_aspect_ratio.num, outlink->sample_aspect_ratio.den);
+
+    return 0;
+}
+
+static const int *parse_yuv_type(const char *s, enum AVColorSpace colorspace)
+{
+    if (!s)
+        s = "bt601";
+
+    if (strstr(s, "bt709")) {
+        colorspace = AVCOL_SPC_BT709;
+    } else if (strstr(s, "fcc")) {
+        colorspace = AVCOL_SPC_FCC;
+    } else if (strstr(s, "smpte240m")) {
+        colorspace = AVCOL_SPC_SMPTE240M;
+    } else if (strstr(s, "bt601") || strstr(s, "bt470") || strstr(s, "smpte170m")) {
+        colorspace = AVCOL_SPC_BT470BG;
+    } else if (strstr(s, "bt2020")) {
+        colorspace = AVCOL_SPC_BT2020_NCL;
+    }
+
+    if (colorspace < 1 || colorspace > 10 || colorspace == 8) {
+        colorspace = AVCOL_SPC_BT470BG;
+    }
+
+    return sws_getCoefficients(colorspace);
+}
+
+static struct SwsContext *alloc_sws(int srcW, int srcH, enum AVPixelFormat srcFormat,
+                                    AVFilterLink *outlink, AVDictionary *opts)
+{
+    struct SwsContext *c = sws_alloc_context();
+    AVDictionaryEntry *e = NULL;
+
+    if (!c)
+        return NULL;
+
+    av_opt_set_int(c, "srcw",       srcW,            0);
+    av_opt_set_int(c, "srch",       srcH,            0);
+    av_opt_set_int(c, "src_format", srcFormat,       0);
+    av_opt_set_int(c, "dstw",       outlink->w,      0);
+    av_opt_set_int(c, "dsth",       outlink->h,      0);
+    av_opt_set_int(c, "dst_format", outlink->format, 0);
+
+    while ((e = av_dict_get(opts, "", e, AV_DICT_IGNORE_SUFFIX)))
+        if (av_opt_set(c, e->key, e->value, 0) < 0)
+            goto fail;
+
+    if (sws_init_context(c, NULL, NULL) < 0)
+        goto fail;
+
+    return c;
+fail:
+    sws_freeContext(c);
+    return NULL;
+}
+
+/* Outputs of the same size and format get the same image; with cascade
+ * enabled, each image is scaled from the smallest larger image of the same
+ * format instead of from the input. */
+static int init_images(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    int i, j;
+
+    s->scaled = av_malloc_array(ctx->nb_outputs, sizeof(*s->scaled));
+    s->owner  = av_malloc_array(ctx->nb_outputs, sizeof(*s->owner));
+    s->sws    = av_mallocz_array(ctx->nb_outputs, sizeof(*s->sws));
+    s->input  = av_malloc_array(ctx->nb_outputs, sizeof(*s->input));
+    s->order  = av_malloc_array(ctx->nb_outputs, sizeof(*s->order));
+    if (!s->scaled || !s->owner || !s->sws || !s->input || !s->order) {
+        av_freep(&s->sws);
+        return AVERROR(ENOMEM);
+    }
+
+    s->nb_scaled = 0;
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        for (j = 0; j < i; j++) {
+            AVFilterLink *l = ctx->outputs[j];
+            if (l->w == outlink->w && l->h == outlink->h &&
+                l->format == outlink->format)
+                break;
+        }
+        if (j < i) {
+            s->scaled[i] = s->scaled[j];
+        } else {
+            s->owner[s->nb_scaled] = i;
+            s->input[s->nb_scaled] = -1;
+            s->scaled[i] = s->nb_scaled++;
+        }
+    }
+
+    /* insertion sort, by decreasing area; equal sizes keep their order */
+    for (i = 0; i < s->nb_scaled; i++) {
+        AVFilterLink *l = ctx->outputs[s->owner[i]];
+        int64_t area = (int64_t)l->w * l->h;
+        for (j = i; j > 0; j--) {
+            AVFilterLink *prev = ctx->outputs[s->owner[s->order[j - 1]]];
+            if ((int64_t)prev->w * prev->h >= area)
+                break;
+            s->order[j] = s->order[j - 1];
+        }
+        s->order[j] = i;
+    }
+
+    if (s->cascade) {
+        for (i = 1; i < s->nb_scaled; i++) {
+            int o = s->order[i];
+            AVFilterLink *l = ctx->outputs[s->owner[o]];
+            int64_t best = (int64_t)ctx->inputs[0]->w * ctx->inputs[0]->h;
+            for (j = 0; j < i; j++) {
+                int k = s->order[j];
+                AVFilterLink *in = ctx->outputs[s->owner[k]];
+                int64_t area = (int64_t)in->w * in->h;
+                if (in->format != l->format ||
+                    in->w < l->w || in->h < l->h || area >= best)
+                    continue;
+                best        = area;
+                s->input[o] = k;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int init_sws(AVFilterContext *ctx, AVFrame *in)
+{
+    MultiScaleContext *s = ctx->priv;
+    AVDictionary *opts = NULL;
+    int i, nb_threads, ret = 0;
+
+    free_sws(s);
+
+    if (!s->sws && (ret = init_images(ctx)) < 0)
+        return ret;
+
+    if (s->flags_str)
+        av_dict_set(&opts, "sws_flags", s->flags_str, 0);
+    /* each scaler starts its own threads, unless they share the pool */
+    nb_threads = ff_filter_get_nb_threads(ctx);
+    if (!ctx->graph->thread_pool)
+        nb_threads = FFMAX(nb_threads / s->nb_scaled, 1);
+    av_dict_set_int(&opts, "threads", nb_threads, 0);
+    av_dict_set_int(&opts, "thread_pool", ctx->graph->thread_pool, 0);
+
+    for (i = 0; i < s->nb_scaled; i++) {
+        int k = s->input[i];
+
+        if (k >= 0) {
+            AVFilterLink *l = ctx->outputs[s->owner[k]];
+            s->sws[i] = alloc_sws(l->w, l->h, l->format,
+                                  ctx->outputs[s->owner[i]], opts);
+        } else {
+            s->sws[i] = alloc_sws(in->width, in->height, in->format,
+                                  ctx->outputs[s->owner[i]], opts);
+        }
+        if (!s->sws[i]) {
+            ret = AVERROR(EINVAL);
+            break;
+        }
+    }
+    av_dict_free(&opts);
+    if (ret < 0) {
+        free_sws(s);
+        return ret;
+    }
+
+    s->in_w      = in->width;
+    s->in_h      = in->height;
+    s->in_format = in->format;
+    return 0;
+}
+
+static int set_colorspace_details(struct SwsContext *c,
+                                  const int inv_table[4], int srcRange,
+                                  const int table[4], int dstRange)
+{
+    int *cur_inv_table, *cur_table, cur_srcRange, cur_dstRange, b, ct, sat;
+
+    if (sws_getColorspaceDetails(c, &cur_inv_table, &cur_srcRange,
+                                 &cur_table, &cur_dstRange, &b, &ct, &sat) < 0)
+        return AVERROR(EINVAL);
+
+    if (sws_setColorspaceDetails(c, inv_table ? inv_table : cur_inv_table,
+                                 srcRange >= 0 ? srcRange : cur_srcRange,
+                                 table ? table : cur_table,
+                                 dstRange >= 0 ? dstRange : cur_dstRange,
+                                 0, 1 << 16, 1 << 16) < 0)
+        return AVERROR(EINVAL);
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MultiScaleContext *s = ctx->priv;
+    AVFrame **out, **img;
+    const int *inv_table = NULL, *table = NULL;
+    int in_full = -1, out_full = -1;
+    int i, nb_scaled = 0, ret;
+
+    if (!s->sws || !s->sws[0] || in->width != s->in_w || in->height != s->in_h ||
+        in->format != s->in_format) {
+        if ((ret = init_sws(ctx, in)) < 0) {
+            av_frame_free(&in);
+            return ret;
+        }
+    }
+
+    if (s->in_color_matrix)
+        inv_table = parse_yuv_type(s->in_color_matrix, in->colorspace);
+    if (s->out_color_matrix)
+        table     = parse_yuv_type(s->out_color_matrix, AVCOL_SPC_UNSPECIFIED);
+    else
+        table     = inv_table;
+    if (s->in_range != AVCOL_RANGE_UNSPECIFIED)
+        in_full  = s->in_range == AVCOL_RANGE_JPEG;
+    else if (in->color_range != AVCOL_RANGE_UNSPECIFIED)
+        in_full  = in->color_range == AVCOL_RANGE_JPEG;
+    if (s->out_range != AVCOL_RANGE_UNSPECIFIED)
+        out_full = s->out_range == AVCOL_RANGE_JPEG;
+    /* Only the scalers reading the input convert between color spaces,
+     * the others read an image that is already in the output one. */
+    for (i = 0; i < s->nb_scaled; i++) {
+        if (s->input[i] < 0)
+            ret = set_colorspace_details(s->sws[i], inv_table, in_full,
+                                         table, out_full);
+        else
+            ret = set_colorspace_details(s->sws[i], table, out_full,
+                                         table, out_full);
+        if (ret < 0) {
+            av_frame_free(&in);
+            return ret;
+        }
+    }
+
+    out      = av_mallocz_array(ctx->nb_outputs, sizeof(*out));
+    img      = av_malloc_array(s->nb_scaled, sizeof(*img));
+    if (!out || !img) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        int k = s->scaled[i];
+
+        /* the first output of each image owns it, the others reference it
+         * once it is complete */
+        if (k < nb_scaled)
+            continue;
+        nb_scaled++;
+
+        out[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        av_frame_copy_props(out[i], in);
+        out[i]->width  = outlink->w;
+        out[i]->height = outlink->h;
+        av_reduce(&out[i]->sample_aspect_ratio.num, &out[i]->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+                  INT_MAX);
+        if (out_full >= 0)
+            out[i]->color_range = out_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+        img[k] = out[i];
+    }
+
+    for (i = 0; i < s->nb_scaled; i++) {
+        int o = s->order[i];
+        int k = s->input[o];
+        AVFrame *src = k >= 0 ? img[k] : in;
+
+        ret = sws_scale(s->sws[o], (const uint8_t *const *)src->data, src->linesize,
+                        0, src->height, img[o]->data, img[o]->linesize);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        int j;
+
+        if (out[i])
+            continue;
+        for (j = 0; s->scaled[j] != s->scaled[i]; j++)
+            ;
+        out[i] = av_frame_clone(out[j]);
+        if (!out[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
+    ret = AVERROR_EOF;
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        AVFrame *frame = out[i];
+
+        out[i] = NULL;
+        if (ff_outlink_get_status(ctx->outputs[i])) {
+            av_frame_free(&frame);
+            continue;
+        }
+        ret = ff_filter_frame(ctx->outputs[i], frame);
+        if (ret < 0)
+            break;
+    }
+
+end:
+    if (out)
+        for (i = 0; i < ctx->nb_outputs; i++)
+            av_frame_free(&out[i]);
+    av_free(out);
+    av_free(img);
+    av_frame_free(&in);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(MultiScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption multiscale_options[] = {
+    { "sizes",   "set the output sizes, separated by '|'", OFFSET(sizes_str), AV_OPT_TYPE_STRING,    { .str = NULL },              0, 0, FLAGS },
+    { "format",  "set the output pixel format",            OFFSET(format),    AV_OPT_TYPE_PIXEL_FMT, { .i64 = AV_PIX_FMT_NONE },  -1, INT_MAX, FLAGS },
+    { "flags",   "set libswscale scaling flags",           OFFSET(flags_str), AV_OPT_TYPE_STRING,    { .str = "bilinear" },        0, 0, FLAGS },
+    { "cascade", "scale smaller outputs from larger ones", OFFSET(cascade),   AV_OPT_TYPE_BOOL,      { .i64 = 0 },                 0, 1, FLAGS },
+    {  "in_color_matrix", "set input YCbCr type",   OFFSET(in_color_matrix),  AV_OPT_TYPE_STRING, { .str = "auto" }, .flags = FLAGS, "color" },
+    { "out_color_matrix", "set output YCbCr type",  OFFSET(out_color_matrix), AV_OPT_TYPE_STRING, { .str = NULL },   .flags = FLAGS, "color" },
+        { "auto",        NULL, 0, AV_OPT_TYPE_CONST, { .str = "auto" },      0, 0, FLAGS, "color" },
+        { "bt601",       NULL, 0, AV_OPT_TYPE_CONST, { .str = "bt601" },     0, 0, FLAGS, "color" },
+        { "bt470",       NULL, 0, AV_OPT_TYPE_CONST, { .str = "bt470" },     0, 0, FLAGS, "color" },
+        { "smpte170m",   NULL, 0, AV_OPT_TYPE_CONST, { .str = "smpte170m" }, 0, 0, FLAGS, "color" },
+        { "bt709",       NULL, 0, AV_OPT_TYPE_CONST, { .str = "bt709" },     0, 0, FLAGS, "color" },
+        { "fcc",         NULL, 0, AV_OPT_TYPE_CONST, { .str = "fcc" },       0, 0, FLAGS, "color" },
+        { "smpte240m",   NULL, 0, AV_OPT_TYPE_CONST, { .str = "smpte240m" }, 0, 0, FLAGS, "color" },
+        { "bt2020",      NULL, 0, AV_OPT_TYPE_CONST, { .str = "bt2020" },    0, 0, FLAGS, "color" },
+    {  "in_range", "set input color range",  OFFSET( in_range), AV_OPT_TYPE_INT, { .i64 = AVCOL_RANGE_UNSPECIFIED }, 0, 2, FLAGS, "range" },
+    { "out_range", "set output color range", OFFSET(out_range), AV_OPT_TYPE_INT, { .i64 = AVCOL_RANGE_UNSPECIFIED }, 0, 2, FLAGS, "range" },
+        { "auto",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVCOL_RANGE_UNSPECIFIED }, 0, 0, FLAGS, "range" },
+        { "unknown", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVCOL_RANGE_UNSPECIFIED }, 0, 0, FLAGS, "range" },
+        { "full",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVCOL_RANGE_JPEG },        0, 0, FLAGS, "range" },
+        { "limited", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVCOL_RANGE_MPEG },        0, 0, FLAGS, "range" },
+        { "jpeg",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVCOL_RANGE_JPEG },        0, 0, FLAGS, "range" },
+        { "mpeg",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVCOL_RANGE_MPEG },        0, 0, FLAGS, "range" },
+        { "tv",      NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVCOL_RANGE_MPEG },        0, 0, FLAGS, "range" },
+        { "pc",      NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVCOL_RANGE_JPEG },        0, 0, FLAGS, "range" },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(multiscale);
+
+static const AVFilterPad multiscale_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_multiscale = {
+    .name          = "multiscale",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes."),
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .priv_size     = sizeof(MultiScaleContext),
+    .priv_class    = &multiscale_class,
+    .inputs        = multiscale_inputs,
+    .outputs       = NULL,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
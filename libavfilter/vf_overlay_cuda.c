@@ -164,7 +164,7 @@ static int overlay_cuda_blend(FFFrameSync *fs)
     if (!input_overlay)
         return ff_filter_frame(outlink, input_main);
 
-    ret = av_frame_make_writable(input_main);
+    ret = ff_frame_make_writable(input_main);
     if (ret < 0) {
         av_frame_free(&input_main);
         return ret;
@@ -254,7 +254,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             /* just duplicate the frame */
             s->history[s->history_pos] = 0; /* frame was duplicated, thus, delta is zero */
         } else {
-            res = av_frame_make_writable(s->last_frame_av);
+            res = ff_frame_make_writable(s->last_frame_av);
             if (res) {
                 av_frame_free(&in);
                 return res;
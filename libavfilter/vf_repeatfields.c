@@ -118,7 +118,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in) {
         ret = ff_filter_frame(outlink, new);
 
         if (in->repeat_pict) {
-            av_frame_make_writable(out);
+            ff_frame_make_writable(out);
             update_pts(outlink, out, in->pts, 2);
             for (i = 0; i < s->nb_planes; i++) {
                 av_image_copy_plane(out->data[i], out->linesize[i] * 2,
@@ -129,7 +129,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in) {
         }
     } else {
         for (i = 0; i < s->nb_planes; i++) {
-            av_frame_make_writable(out);
+            ff_frame_make_writable(out);
             av_image_copy_plane(out->data[i] + out->linesize[i], out->linesize[i] * 2,
                                 in->data[i] + in->linesize[i], in->linesize[i] * 2,
                                 s->linesize[i], s->planeheight[i] / 2);
@@ -147,7 +147,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in) {
             ret = ff_filter_frame(outlink, new);
             state = 0;
         } else {
-            av_frame_make_writable(out);
+            ff_frame_make_writable(out);
             update_pts(outlink, out, in->pts, 1);
             for (i = 0; i < s->nb_planes; i++) {
                 av_image_copy_plane(out->data[i], out->linesize[i] * 2,
@@ -150,6 +150,7 @@ typedef struct ScaleContext {
     int force_divisible_by;
 
     int nb_slices;
+    int sws_threads;            ///< number of threads of the scaler, 0 for auto
 
     int eval_mode;              ///< expression evaluation mode
 
@@ -552,6 +553,8 @@ static int config_props(AVFilterLink *outlink)
             if (scale->out_range != AVCOL_RANGE_UNSPECIFIED)
                 av_opt_set_int(*s, "dst_range",
                                scale->out_range == AVCOL_RANGE_JPEG, 0);
+            av_opt_set_int(*s, "threads", scale->sws_threads, 0);
+            av_opt_set_int(*s, "thread_pool", ctx->graph->thread_pool, 0);
 
             if (scale->opts) {
                 AVDictionaryEntry *e = NULL;
@@ -951,6 +954,8 @@ static const AVOption scale_options[] = {
     { "param0", "Scaler param 0",             OFFSET(param[0]),  AV_OPT_TYPE_DOUBLE, { .dbl = SWS_PARAM_DEFAULT  }, INT_MIN, INT_MAX, FLAGS },
     { "param1", "Scaler param 1",             OFFSET(param[1]),  AV_OPT_TYPE_DOUBLE, { .dbl = SWS_PARAM_DEFAULT  }, INT_MIN, INT_MAX, FLAGS },
     { "nb_slices", "set the number of slices (debug purpose only)", OFFSET(nb_slices), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "sws_threads", "set the number of threads of the scaler", OFFSET(sws_threads), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, INT_MAX, FLAGS, "sws_threads" },
+        { "auto", "autodetect a suitable number", 0, AV_OPT_TYPE_CONST, { .i64 = 0 }, 0, 0, FLAGS, "sws_threads" },
     { "eval", "specify when to evaluate expressions", OFFSET(eval_mode), AV_OPT_TYPE_INT, {.i64 = EVAL_MODE_INIT}, 0, EVAL_MODE_NB-1, FLAGS, "eval" },
          { "init",  "eval expressions once during initialization", 0, AV_OPT_TYPE_CONST, {.i64=EVAL_MODE_INIT},  .flags = FLAGS, .unit = "eval" },
          { "frame", "eval expressions during initialization and per-frame", 0, AV_OPT_TYPE_CONST, {.i64=EVAL_MODE_FRAME}, .flags = FLAGS, .unit = "eval" },
@@ -596,7 +596,7 @@ static int filter_frame8(AVFilterLink *link, AVFrame *in)
 
     if (s->outfilter != FILTER_NONE) {
         out = av_frame_clone(in);
-        av_frame_make_writable(out);
+        ff_frame_make_writable(out);
     }
 
     ctx->internal->execute(ctx, compute_sat_hue_metrics8, &td_huesat,
@@ -818,7 +818,7 @@ static int filter_frame16(AVFilterLink *link, AVFrame *in)
 
     if (s->outfilter != FILTER_NONE) {
         out = av_frame_clone(in);
-        av_frame_make_writable(out);
+        ff_frame_make_writable(out);
     }
 
     ctx->internal->execute(ctx, compute_sat_hue_metrics16, &td_huesat,
@@ -168,7 +168,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     int plane;
 
     if (s->conf.show > 0 && !av_frame_is_writable(in))
-        av_frame_make_writable(in);
+        ff_frame_make_writable(in);
 
     for (plane = 0; plane < md->fi.planes; plane++) {
         frame.data[plane] = in->data[plane];
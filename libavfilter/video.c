@@ -41,6 +41,75 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
     return ff_get_video_buffer(link->dst->outputs[0], w, h);
 }
 
+/**
+ * Find the graph pool for the given parameters and move it to the front.
+ * On a miss, a new pool is created if there is room for it or if evict is
+ * set, in which case the least recently used one is dropped; otherwise
+ * NULL is returned.
+ */
+static FFFramePool *graph_video_pool(AVFilterGraph *graph, int w, int h,
+                                     enum AVPixelFormat format, int align,
+                                     int codec_layout, int evict)
+{
+    FFGraphVideoPool *pools = graph->internal->video_pools;
+    FFGraphVideoPool entry = { NULL };
+    int i;
+
+    /* Filters can use frames of any layout, decoders need the exact one
+     * they would get from libavcodec. */
+    for (i = 0; i < FF_GRAPH_VIDEO_POOLS && pools[i].pool; i++) {
+        enum AVPixelFormat pool_format;
+        int pool_width, pool_height, pool_align;
+
+        if (ff_frame_pool_get_video_config(pools[i].pool, &pool_width, &pool_height,
+                                           &pool_format, &pool_align) < 0)
+            return NULL;
+
+        if (pool_width == w && pool_height == h && pool_format == format &&
+            (codec_layout ? pools[i].codec_layout && pool_align == align
+                          : pool_align >= align)) {
+            entry = pools[i];
+            break;
+        }
+    }
+
+    if (!entry.pool) {
+        if (i == FF_GRAPH_VIDEO_POOLS && !evict)
+            return NULL;
+        entry.pool = codec_layout ?
+            ff_frame_pool_codec_video_init(av_buffer_allocz, w, h, format, align) :
+            ff_frame_pool_video_init(av_buffer_allocz, w, h, format, align);
+        if (!entry.pool)
+            return NULL;
+        entry.codec_layout = codec_layout;
+        /* Frames still in use keep their buffers alive after the pool they
+         * came from is dropped. */
+        if (i == FF_GRAPH_VIDEO_POOLS)
+            ff_frame_pool_uninit(&pools[--i].pool);
+    }
+
+    memmove(pools + 1, pools, i * sizeof(*pools));
+    pools[0] = entry;
+
+    return entry.pool;
+}
+
+AVFrame *ff_graph_get_video_buffer(AVFilterGraph *graph, int w, int h,
+                                   enum AVPixelFormat format, int align,
+                                   int codec_layout)
+{
+    FFFramePool *pool;
+
+    if (!codec_layout)
+        align = FFMAX(align, BUFFER_ALIGN);
+
+    pool = graph_video_pool(graph, w, h, format, align, codec_layout, 1);
+    if (!pool)
+        return NULL;
+
+    return ff_frame_pool_get(pool);
+}
+
 AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 {
     AVFrame *frame = NULL;
@@ -64,6 +133,18 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
         return frame;
     }
 
+    /* Once all the graph pools are taken, links which do not match any of
+     * them fall back to their own pool rather than evicting the pools of
+     * the other links on every frame. */
+    if (link->graph && link->graph->frame_pool) {
+        FFFramePool *pool = graph_video_pool(link->graph, w, h, link->format,
+                                             BUFFER_ALIGN, 0, 0);
+        if (pool) {
+            frame = ff_frame_pool_get(pool);
+            goto end;
+        }
+    }
+
     if (!link->frame_pool) {
         link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
                                                     link->format, BUFFER_ALIGN);
@@ -88,6 +169,7 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
     }
 
     frame = ff_frame_pool_get(link->frame_pool);
+end:
     if (!frame)
         return NULL;
 
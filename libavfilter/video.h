@@ -38,4 +38,17 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h);
  */
 AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h);
 
+/**
+ * Get a video frame from the pools shared by all the links of a graph.
+ *
+ * @param align        the minimum alignment of the line sizes, a power of 2
+ * @param codec_layout lay the frame out like avcodec_default_get_buffer2()
+ *                     with exactly this alignment, for decoders
+ * @return             a new frame of the given dimensions and format, NULL
+ *                     on error
+ */
+AVFrame *ff_graph_get_video_buffer(AVFilterGraph *graph, int w, int h,
+                                   enum AVPixelFormat format, int align,
+                                   int codec_layout);
+
 #endif /* AVFILTER_VIDEO_H */
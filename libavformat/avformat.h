@@ -1979,6 +1979,8 @@ int avformat_network_init(void);
 /**
  * Undo the initialization done by avformat_network_init. Call it only
  * once for each time you called avformat_network_init.
+ * This also closes the idle connections kept by the connection_pool option
+ * of the HTTP protocol.
  */
 int avformat_network_deinit(void);
 
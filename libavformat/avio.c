@@ -31,6 +31,9 @@
 #include "network.h"
 #endif
 #include "url.h"
+#if CONFIG_HTTP_PROTOCOL || CONFIG_HTTPS_PROTOCOL || CONFIG_HTTPPROXY_PROTOCOL
+#include "http.h"
+#endif
 
 /** @name Logging context. */
 /*@{*/
@@ -58,6 +61,8 @@ static const AVOption options[] = {
     {"protocol_whitelist", "List of protocols that are allowed to be used", OFFSET(protocol_whitelist), AV_OPT_TYPE_STRING, { .str = NULL },  0, 0, D },
     {"protocol_blacklist", "List of protocols that are not allowed to be used", OFFSET(protocol_blacklist), AV_OPT_TYPE_STRING, { .str = NULL },  0, 0, D },
     {"rw_timeout", "Timeout for IO operations (in microseconds)", offsetof(URLContext, rw_timeout), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM | AV_OPT_FLAG_DECODING_PARAM },
+    {"io_buffer_min", "Minimum size of the adaptive read buffer", offsetof(URLContext, io_buffer_min), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    {"io_buffer_max", "Maximum size of the adaptive read buffer, 0 for a fixed size", offsetof(URLContext, io_buffer_max), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
     { NULL }
 };
 
@@ -651,6 +656,21 @@ int ffurl_get_short_seek(URLContext *h)
     return h->prot->url_get_short_seek(h);
 }
 
+int ffurl_get_mapping(URLContext *h, AVBufferRef **map, int64_t *size)
+{
+    if (!h || !h->prot || !h->prot->url_get_mapping)
+        return AVERROR(ENOSYS);
+    return h->prot->url_get_mapping(h, map, size);
+}
+
+int ffurl_map_packet(URLContext *h, int64_t pos, int size, int padding,
+                     AVBufferRef **buf)
+{
+    if (!h || !h->prot || !h->prot->url_map_packet)
+        return AVERROR(ENOSYS);
+    return h->prot->url_map_packet(h, pos, size, padding, buf);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h || !h->prot || !h->prot->url_shutdown)
@@ -672,3 +692,12 @@ int ff_rename(const char *url_src, const char *url_dst, void *logctx)
         av_log(logctx, AV_LOG_ERROR, "failed to rename file %s to %s: %s\n", url_src, url_dst, av_err2str(ret));
     return ret;
 }
+
+void avio_get_connection_pool_stats(AVIOConnectionPoolStats *stats)
+{
+#if CONFIG_HTTP_PROTOCOL || CONFIG_HTTPS_PROTOCOL || CONFIG_HTTPPROXY_PROTOCOL
+    ff_http_get_pool_stats(stats);
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
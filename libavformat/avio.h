@@ -349,6 +349,36 @@ typedef struct AVIOContext {
      * Try to buffer at least this amount of data before flushing it
      */
     int min_packet_size;
+
+    /**
+     * Bounds of the read buffer size, adapted to the observed reads, or 0
+     * if the size is fixed.
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int buffer_size_min;
+    int buffer_size_max;
+
+    /**
+     * Statistics, see avio_get_stats().
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int64_t bytes_written;
+    int64_t nb_reads;
+    int64_t wait_time;
+
+    /**
+     * State of the buffer size adaptation.
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int adapt_size;
+    int adapt_grown;
+    int adapt_reads;
+    int adapt_full;
+    int adapt_seeks;
+    int64_t adapt_requested;
+    int64_t adapt_bytes;
+    int64_t adapt_time;
+    double adapt_throughput;
 } AVIOContext;
 
 /**
@@ -807,6 +837,47 @@ int avio_close_dyn_buf(AVIOContext *s, uint8_t **pbuffer);
  */
 const char *avio_enum_protocols(void **opaque, int output);
 
+/**
+ * Statistics of the pool of persistent HTTP(S) connections shared by the
+ * contexts opened with the connection_pool option, accumulated over the
+ * whole process.
+ */
+typedef struct AVIOConnectionPoolStats {
+    uint64_t nb_hits;          ///< requests sent on a connection taken from the pool
+    uint64_t nb_misses;        ///< connections that had to be opened
+    uint64_t nb_stale;         ///< pooled connections found closed by the server
+    uint64_t nb_idle;          ///< connections currently waiting in the pool
+    int64_t  connect_time;     ///< total time spent opening connections, in microseconds
+    int64_t  max_connect_time; ///< longest time spent opening a connection, in microseconds
+} AVIOConnectionPoolStats;
+
+/**
+ * Get the statistics of the HTTP(S) connection pool.
+ *
+ * May be called from any thread. All fields are 0 if lavf was built
+ * without HTTP support.
+ */
+void avio_get_connection_pool_stats(AVIOConnectionPoolStats *stats);
+
+/**
+ * Statistics of an AVIOContext.
+ */
+typedef struct AVIOStats {
+    int64_t bytes_read;     ///< bytes read from the underlying resource
+    int64_t bytes_written;  ///< bytes written to the underlying resource
+    int64_t nb_reads;       ///< calls to the read callback
+    int64_t nb_writes;      ///< calls to the write callback
+    int64_t nb_seeks;       ///< seeks of the underlying resource
+    int64_t wait_time;      ///< time spent in the read and seek callbacks, in microseconds,
+                            ///< only measured if the buffer size is adaptive, 0 otherwise
+    int     buffer_size;    ///< current buffer size
+} AVIOStats;
+
+/**
+ * Get the statistics of an AVIOContext since it was opened.
+ */
+void avio_get_stats(AVIOContext *s, AVIOStats *stats);
+
 /**
  * Get AVClass by names of available protocols.
  *
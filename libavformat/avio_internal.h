@@ -53,6 +53,23 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
 
+/**
+ * Read size bytes from AVIOContext without copying them, as a reference
+ * to a memory mapping of the underlying resource.
+ *
+ * This is only done for sizes large enough for the mapping to be cheaper
+ * than a copy.
+ *
+ * @param buf set to a new read-only reference whose data field points to
+ *            the bytes read, followed by AV_INPUT_BUFFER_PADDING_SIZE zero
+ *            bytes
+ * @return size on success, AVERROR(ENOSYS) if the resource is not mapped,
+ *         the data is not entirely within the mapping or it is too small,
+ *         in which case nothing was read, or another negative AVERROR on
+ *         failure
+ */
+int ffio_read_mapped(AVIOContext *s, int size, AVBufferRef **buf);
+
 void ffio_fill(AVIOContext *s, int b, int count);
 
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
@@ -26,6 +26,7 @@
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/avassert.h"
+#include "libavutil/time.h"
 #include "avformat.h"
 #include "avio.h"
 #include "avio_internal.h"
@@ -42,6 +43,14 @@
  */
 #define SHORT_SEEK_THRESHOLD 32768
 
+/**
+ * Number of reads over which the buffer size adaptation gathers statistics
+ * before deciding to grow or shrink the buffer.
+ */
+#define ADAPT_WINDOW 16
+
+#define IO_BUFFER_SIZE_MIN 4096
+
 static void *ff_avio_child_next(void *obj, void *prev)
 {
     AVIOContext *s = obj;
@@ -157,6 +166,19 @@ void avio_context_free(AVIOContext **ps)
     av_freep(ps);
 }
 
+/* The time spent in the callbacks is only measured for the buffer size
+ * adaptation, to keep the clock out of the I/O path otherwise. */
+static int64_t wait_start(AVIOContext *s)
+{
+    return s->buffer_size_max ? av_gettime_relative() : 0;
+}
+
+static void wait_end(AVIOContext *s, int64_t start)
+{
+    if (s->buffer_size_max)
+        s->wait_time += av_gettime_relative() - start;
+}
+
 static void writeout(AVIOContext *s, const uint8_t *data, int len)
 {
     if (!s->error) {
@@ -173,6 +195,7 @@ static void writeout(AVIOContext *s, const uint8_t *data, int len)
         } else {
             if (s->pos + len > s->written)
                 s->written = s->pos + len;
+            s->bytes_written += len;
         }
     }
     if (s->current_type == AVIO_DATA_MARKER_SYNC_POINT ||
@@ -250,6 +273,17 @@ void avio_flush(AVIOContext *s)
         avio_seek(s, seekback, SEEK_CUR);
 }
 
+static int64_t seek_wrapper(AVIOContext *s, int64_t offset)
+{
+    int64_t t = wait_start(s);
+    int64_t ret = s->seek(s->opaque, offset, SEEK_SET);
+
+    wait_end(s, t);
+    if (ret >= 0)
+        s->seek_count++;
+    return ret;
+}
+
 int64_t avio_seek(AVIOContext *s, int64_t offset, int whence)
 {
     int64_t offset1;
@@ -307,7 +341,7 @@ int64_t avio_seek(AVIOContext *s, int64_t offset, int whence)
         int64_t res;
 
         pos -= FFMIN(buffer_size>>1, pos);
-        if ((res = s->seek(s->opaque, pos, SEEK_SET)) < 0)
+        if ((res = seek_wrapper(s, pos)) < 0)
             return res;
         s->buf_end =
         s->buf_ptr = s->buffer;
@@ -322,9 +356,8 @@ int64_t avio_seek(AVIOContext *s, int64_t offset, int whence)
         }
         if (!s->seek)
             return AVERROR(EPIPE);
-        if ((res = s->seek(s->opaque, offset, SEEK_SET)) < 0)
+        if ((res = seek_wrapper(s, offset)) < 0)
             return res;
-        s->seek_count ++;
         if (!s->write_flag)
             s->buf_end = s->buffer;
         s->buf_ptr = s->buf_ptr_max = s->buffer;
@@ -514,11 +547,15 @@ void avio_write_marker(AVIOContext *s, int64_t time, enum AVIODataMarkerType typ
 
 static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
 {
+    int64_t t;
     int ret;
 
     if (!s->read_packet)
         return AVERROR(EINVAL);
+    t = wait_start(s);
     ret = s->read_packet(s->opaque, buf, size);
+    wait_end(s, t);
+    s->nb_reads++;
 #if FF_API_OLD_AVIO_EOF_0
     if (!ret && !s->max_packet_size) {
         av_log(NULL, AV_LOG_WARNING, "Invalid return value 0 for stream protocol\n");
@@ -532,6 +569,52 @@ static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
 
 /* Input stream */
 
+/**
+ * Choose the buffer size for the next refills from the last reads.
+ *
+ * Reads returning all that was requested mean the buffer is the limit: it
+ * grows, as long as growing it actually improved the throughput. Reads
+ * returning much less than requested, e.g. on live streams, or seeks
+ * discarding most of what was read ahead, make it shrink.
+ */
+static void adapt_buffer_size(AVIOContext *s, int requested, int len, int64_t time)
+{
+    double throughput;
+    int size = s->adapt_size;
+
+    s->adapt_reads++;
+    s->adapt_full      += len == requested;
+    s->adapt_requested += requested;
+    s->adapt_bytes     += FFMAX(len, 0);
+    s->adapt_time      += time;
+    if (s->adapt_reads < ADAPT_WINDOW)
+        return;
+
+    throughput = s->adapt_bytes / (double)FFMAX(s->adapt_time, 1);
+    if ((s->seek_count - s->adapt_seeks) * 4 > ADAPT_WINDOW ||
+        s->adapt_bytes * 4 < s->adapt_requested) {
+        size /= 2;
+        s->adapt_grown = 0;
+    } else if (s->adapt_full * 4 >= ADAPT_WINDOW * 3 &&
+               (!s->adapt_grown || throughput > s->adapt_throughput * 1.1)) {
+        size = size > INT_MAX / 2 ? INT_MAX : size * 2;
+        s->adapt_grown = 1;
+    }
+    size = av_clip(size, s->buffer_size_min, s->buffer_size_max);
+    if (size != s->adapt_size)
+        av_log(s, AV_LOG_DEBUG, "Buffer size %d -> %d, %.0f bytes/s\n",
+               s->adapt_size, size, throughput * 1000000);
+
+    s->adapt_size       = size;
+    s->adapt_throughput = throughput;
+    s->adapt_reads      = 0;
+    s->adapt_full       = 0;
+    s->adapt_seeks      = s->seek_count;
+    s->adapt_requested  = 0;
+    s->adapt_bytes      = 0;
+    s->adapt_time       = 0;
+}
+
 static void fill_buffer(AVIOContext *s)
 {
     int max_buffer_size = s->max_packet_size ?
@@ -567,7 +650,25 @@ static void fill_buffer(AVIOContext *s)
         len = s->orig_buffer_size;
     }
 
-    len = read_packet_wrapper(s, dst, len);
+    /* the buffer can only be reallocated when refilling it from the start */
+    if (s->buffer_size_max && dst == s->buffer &&
+        s->buffer_size == s->orig_buffer_size && s->buffer_size != s->adapt_size) {
+        if (ffio_set_buf_size(s, s->adapt_size) >= 0) {
+            s->checksum_ptr = dst = s->buffer;
+            len = s->buffer_size;
+        } else {
+            s->adapt_size = s->buffer_size;
+        }
+    }
+
+    if (s->buffer_size_max) {
+        int64_t wait_time = s->wait_time;
+        int requested     = len;
+        len = read_packet_wrapper(s, dst, len);
+        adapt_buffer_size(s, requested, len, s->wait_time - wait_time);
+    } else {
+        len = read_packet_wrapper(s, dst, len);
+    }
     if (len == AVERROR_EOF) {
         /* do not modify buffer if EOF reached so that a seek back can
            be done without rereading data */
@@ -689,12 +790,82 @@ int ffio_read_size(AVIOContext *s, unsigned char *buf, int size)
     return AVERROR_INVALIDDATA;
 }
 
+/**
+ * Minimum size of the reads served from a mapping: mapping a packet or
+ * seeking past the bytes takes a few system calls, which costs more than
+ * copying smaller ones out of the buffer.
+ */
+#define MAP_PACKET_SIZE_MIN 65536
+
+/* Return the current position if size bytes are mapped there. */
+static int64_t map_position(AVIOContext *s, int size, AVBufferRef **map)
+{
+    URLContext *h = ffio_geturlcontext(s);
+    int64_t pos = avio_tell(s), map_size;
+
+    if (!h || s->write_flag || s->update_checksum || size <= 0 || pos < 0 ||
+        ffurl_get_mapping(h, map, &map_size) < 0 ||
+        pos > map_size - size)
+        return AVERROR(ENOSYS);
+    return pos;
+}
+
+/* Move past the size bytes at pos without reading them. */
+static int map_skip(AVIOContext *s, int64_t pos, int size)
+{
+    int64_t ret;
+
+    if (s->buf_end - s->buf_ptr >= size) {
+        s->buf_ptr += size;
+        return 0;
+    }
+    if ((ret = s->seek(s->opaque, pos + size, SEEK_SET)) < 0)
+        return ret;
+    s->bytes_read += pos + size - s->pos;
+    s->buf_ptr     = s->buffer;
+    s->buf_end     = s->buffer;
+    s->pos         = pos + size;
+    s->eof_reached = 0;
+    return 0;
+}
+
+int ffio_read_mapped(AVIOContext *s, int size, AVBufferRef **buf)
+{
+    URLContext *h;
+    int64_t pos;
+    int ret;
+
+    if (size < MAP_PACKET_SIZE_MIN)
+        return AVERROR(ENOSYS);
+    h   = ffio_geturlcontext(s);
+    pos = avio_tell(s);
+    if (!h || s->write_flag || s->update_checksum || pos < 0)
+        return AVERROR(ENOSYS);
+    if ((ret = ffurl_map_packet(h, pos, size, AV_INPUT_BUFFER_PADDING_SIZE, buf)) < 0)
+        return ret;
+    if ((ret = map_skip(s, pos, size)) < 0) {
+        av_buffer_unref(buf);
+        return ret;
+    }
+    return size;
+}
+
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data)
 {
+    AVBufferRef *map;
+    int64_t pos;
+    int ret;
+
     if (s->buf_end - s->buf_ptr >= size && !s->write_flag) {
         *data = s->buf_ptr;
         s->buf_ptr += size;
         return size;
+    } else if (size >= MAP_PACKET_SIZE_MIN &&
+               (pos = map_position(s, size, &map)) >= 0) {
+        if ((ret = map_skip(s, pos, size)) < 0)
+            return ret;
+        *data = map->data + pos;
+        return size;
     } else {
         *data = buf;
         return avio_read(s, buf, size);
@@ -960,6 +1131,14 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     (*s)->seekable = h->is_streamed ? 0 : AVIO_SEEKABLE_NORMAL;
     (*s)->max_packet_size = max_packet_size;
     (*s)->min_packet_size = h->min_packet_size;
+    if (h->io_buffer_max && !max_packet_size && !(h->flags & AVIO_FLAG_WRITE) &&
+        !(*s)->direct) {
+        (*s)->buffer_size_max = FFMAX(h->io_buffer_max, IO_BUFFER_SIZE_MIN);
+        (*s)->buffer_size_min = av_clip(h->io_buffer_min, IO_BUFFER_SIZE_MIN,
+                                        (*s)->buffer_size_max);
+        (*s)->adapt_size      = av_clip(buffer_size, (*s)->buffer_size_min,
+                                        (*s)->buffer_size_max);
+    }
     if(h->prot) {
         (*s)->read_pause = (int (*)(void *, int))h->prot->url_read_pause;
         (*s)->read_seek  =
@@ -1166,6 +1345,17 @@ int avio_open2(AVIOContext **s, const char *filename, int flags,
     return ffio_open_whitelist(s, filename, flags, int_cb, options, NULL, NULL);
 }
 
+void avio_get_stats(AVIOContext *s, AVIOStats *stats)
+{
+    stats->bytes_read    = s->bytes_read;
+    stats->bytes_written = s->bytes_written;
+    stats->nb_reads      = s->nb_reads;
+    stats->nb_writes     = s->writeout_count;
+    stats->nb_seeks      = s->seek_count;
+    stats->wait_time     = s->wait_time;
+    stats->buffer_size   = s->buffer_size;
+}
+
 int avio_close(AVIOContext *s)
 {
     URLContext *h;
@@ -1182,6 +1372,9 @@ int avio_close(AVIOContext *s)
         av_log(s, AV_LOG_VERBOSE, "Statistics: %d seeks, %d writeouts\n", s->seek_count, s->writeout_count);
     else
         av_log(s, AV_LOG_VERBOSE, "Statistics: %"PRId64" bytes read, %d seeks\n", s->bytes_read, s->seek_count);
+    if (s->buffer_size_max)
+        av_log(s, AV_LOG_VERBOSE, "Statistics: %"PRId64" reads, %"PRId64" us waiting, buffer size %d\n",
+               s->nb_reads, s->wait_time, s->buffer_size);
     av_opt_free(s);
 
     avio_context_free(&s);
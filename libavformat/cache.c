@@ -23,7 +23,6 @@
 
 /**
  * @TODO
- *      support keeping files
  *      support filling with a background thread
  */
 
@@ -31,6 +30,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/sha.h"
 #include "libavutil/tree.h"
 #include "avformat.h"
 #include <fcntl.h>
@@ -42,9 +42,37 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <time.h>
+#include "internal.h"
 #include "os_support.h"
 #include "url.h"
 
+#define HAVE_PERSISTENT_CACHE (HAVE_DIRENT_H && HAVE_FCNTL && HAVE_UNISTD_H)
+
+#if HAVE_PERSISTENT_CACHE
+#include <dirent.h>
+#include <utime.h>
+
+/* temporary files older than this, in seconds, were left by a process which
+ * did not finish writing them */
+#define TMP_MAX_AGE 3600
+/* longer ETag or Last-Modified headers are not used to check the resource */
+#define MAX_VALIDATOR_SIZE 256
+
+enum CacheFileType {
+    CACHE_FILE_BLOCK,
+    CACHE_FILE_INFO,
+    CACHE_FILE_TMP,
+};
+
+typedef struct CacheFile {
+    char *path;
+    enum CacheFileType type;
+    int64_t size;
+    time_t mtime;
+} CacheFile;
+#endif
+
 typedef struct CacheEntry {
     int64_t logical_pos;
     int64_t physical_pos;
@@ -64,6 +92,21 @@ typedef struct Context {
     URLContext *inner;
     int64_t cache_hit, cache_miss;
     int read_ahead_limit;
+
+    /* persistent cache, blocks stored as files in cache_dir */
+    char *cache_dir;
+    int64_t cache_max_size;
+    int block_size;
+    char *prefix;           ///< cache_dir/SHA-1 of the URL-block size
+    char *url;              ///< inner URL, opened on the first missing block
+    int inner_flags;
+    AVDictionary *inner_opts;
+    int64_t size;           ///< size of the resource, -1 if unknown
+    char *validator;        ///< ETag or Last-Modified of the resource, NULL if none
+    int64_t usage;          ///< estimated size of cache_dir
+    uint8_t *block;
+    int64_t block_index;    ///< index of the block in block, -1 if none
+    int block_len;
 } Context;
 
 static int cmp(const void *key, const void *node)
@@ -71,6 +114,522 @@ static int cmp(const void *key, const void *node)
     return FFDIFFSIGN(*(const int64_t *)key, ((const CacheEntry *) node)->logical_pos);
 }
 
+static void persistent_free(Context *c)
+{
+    av_freep(&c->block);
+    av_freep(&c->url);
+    av_freep(&c->prefix);
+    av_freep(&c->validator);
+    av_dict_free(&c->inner_opts);
+    ffurl_closep(&c->inner);
+}
+
+#if HAVE_PERSISTENT_CACHE
+static int block_path(URLContext *h, char *path, int size, int64_t index)
+{
+    Context *c = h->priv_data;
+    return snprintf(path, size, "%s-%"PRId64".blk", c->prefix, index) >= size ?
+           AVERROR(ENAMETOOLONG) : 0;
+}
+
+/* Write a file of the cache directory under a temporary name, then rename it,
+ * so that other processes never see it partially written. */
+static int write_atomic(URLContext *h, const char *path, const uint8_t *buf, int size)
+{
+    char *tmp = av_asprintf("%s.%d.%p.tmp", path, (int)getpid(), h);
+    int fd, ret = 0;
+
+    if (!tmp)
+        return AVERROR(ENOMEM);
+    fd = avpriv_open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        ret = AVERROR(errno);
+        goto end;
+    }
+    while (size > 0) {
+        int len = write(fd, buf, size);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0) {
+            ret = len < 0 ? AVERROR(errno) : AVERROR(EIO);
+            break;
+        }
+        buf  += len;
+        size -= len;
+    }
+    close(fd);
+    if (ret >= 0 && rename(tmp, path) < 0)
+        ret = AVERROR(errno);
+    if (ret < 0)
+        unlink(tmp);
+end:
+    av_free(tmp);
+    return ret;
+}
+
+/* Lock the cache directory, shared with the other processes using it. */
+static int lock_dir(URLContext *h, int type)
+{
+    Context *c = h->priv_data;
+    struct flock lock = { .l_type = type, .l_whence = SEEK_SET };
+    char *path;
+    int fd, ret;
+
+    path = av_asprintf("%s/lock", c->cache_dir);
+    if (!path)
+        return AVERROR(ENOMEM);
+    fd = avpriv_open(path, O_RDWR | O_CREAT, 0666);
+    av_free(path);
+    if (fd < 0)
+        return AVERROR(errno);
+    if (fcntl(fd, F_SETLKW, &lock) < 0) {
+        ret = AVERROR(errno);
+        close(fd);
+        return ret;
+    }
+    return fd;
+}
+
+static void unlock_dir(int fd)
+{
+    struct flock lock = { .l_type = F_UNLCK, .l_whence = SEEK_SET };
+
+    fcntl(fd, F_SETLK, &lock);
+    close(fd);
+}
+
+/* The lock file holds the size of the directory: measured by the last scan,
+ * plus the blocks stored since by all the processes. Returns -1 if it was
+ * never measured. */
+static int64_t read_usage(int fd)
+{
+    char buf[32] = "";
+
+    if (lseek(fd, 0, SEEK_SET) < 0 || read(fd, buf, sizeof(buf) - 1) <= 0)
+        return -1;
+    return strtoll(buf, NULL, 10);
+}
+
+static void write_usage(URLContext *h, int fd, int64_t usage)
+{
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%020"PRId64"\n", usage);
+
+    /* always the same length, the file is never truncated */
+    if (lseek(fd, 0, SEEK_SET) < 0 || write(fd, buf, len) != len)
+        av_log(h, AV_LOG_WARNING, "Failed to store the size of the cache\n");
+}
+
+static int cmp_mtime(const void *a, const void *b)
+{
+    return FFDIFFSIGN(((const CacheFile *)a)->mtime, ((const CacheFile *)b)->mtime);
+}
+
+/* Whether any block of the resource of an info file is left. */
+static int has_blocks(const CacheFile *files, int nb_files, const CacheFile *info)
+{
+    int len = strlen(info->path) - strlen("info");
+
+    for (int i = 0; i < nb_files; i++) {
+        if (files[i].type == CACHE_FILE_BLOCK && files[i].path &&
+            !strncmp(files[i].path, info->path, len - 1) && files[i].path[len - 1] == '-')
+            return 1;
+    }
+    return 0;
+}
+
+/* Measure the cache directory and, if it is above cache_max_size, delete the
+ * least recently used blocks until it is 10% below, then the info files of
+ * the resources left without blocks. Temporary files abandoned by other
+ * processes are deleted as well. Called with the exclusive lock held. */
+static int scan_dir(URLContext *h, int lock_fd)
+{
+    Context *c = h->priv_data;
+    CacheFile *files = NULL;
+    unsigned int files_size = 0;
+    int nb_files = 0, nb_evicted = 0, i, ret = 0;
+    time_t now = time(NULL);
+    struct dirent *entry;
+    char *path;
+    DIR *dir;
+
+    dir = opendir(c->cache_dir);
+    if (!dir)
+        return AVERROR(errno);
+    c->usage = 0;
+    while ((entry = readdir(dir))) {
+        enum CacheFileType type;
+        struct stat st;
+        CacheFile *f;
+
+        if (av_match_ext(entry->d_name, "blk"))
+            type = CACHE_FILE_BLOCK;
+        else if (av_match_ext(entry->d_name, "info"))
+            type = CACHE_FILE_INFO;
+        else if (av_match_ext(entry->d_name, "tmp"))
+            type = CACHE_FILE_TMP;
+        else
+            continue;
+        path = av_asprintf("%s/%s", c->cache_dir, entry->d_name);
+        if (!path) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        if (stat(path, &st) < 0) {
+            av_free(path);
+            continue;
+        }
+        if (type == CACHE_FILE_TMP && now - st.st_mtime > TMP_MAX_AGE) {
+            unlink(path);
+            av_free(path);
+            continue;
+        }
+        f = av_fast_realloc(files, &files_size, (nb_files + 1) * sizeof(*files));
+        if (!f) {
+            av_free(path);
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        files = f;
+        files[nb_files].path  = path;
+        files[nb_files].type  = type;
+        files[nb_files].size  = st.st_size;
+        files[nb_files].mtime = st.st_mtime;
+        c->usage += st.st_size;
+        nb_files++;
+    }
+    closedir(dir);
+
+    if (ret >= 0 && c->usage > c->cache_max_size) {
+        qsort(files, nb_files, sizeof(*files), cmp_mtime);
+        for (i = 0; i < nb_files && c->usage > c->cache_max_size / 10 * 9; i++) {
+            if (files[i].type != CACHE_FILE_BLOCK || unlink(files[i].path) < 0)
+                continue;
+            c->usage -= files[i].size;
+            av_freep(&files[i].path);
+            nb_evicted++;
+        }
+        av_log(h, AV_LOG_VERBOSE, "Evicted %d blocks from %s\n", nb_evicted, c->cache_dir);
+    }
+    for (i = 0; ret >= 0 && i < nb_files; i++) {
+        if (files[i].type == CACHE_FILE_INFO &&
+            !has_blocks(files, nb_files, &files[i]) && unlink(files[i].path) >= 0)
+            c->usage -= files[i].size;
+    }
+    if (ret >= 0)
+        write_usage(h, lock_fd, c->usage);
+
+    for (i = 0; i < nb_files; i++)
+        av_free(files[i].path);
+    av_free(files);
+    return ret;
+}
+
+/* Add size bytes stored in the cache directory to its size, and evict
+ * blocks if that makes it exceed cache_max_size. The directory is only
+ * scanned if its size was never measured or is exceeded. */
+static int update_usage(URLContext *h, int64_t size)
+{
+    Context *c = h->priv_data;
+    int fd, ret = 0;
+
+    if ((fd = lock_dir(h, F_WRLCK)) < 0)
+        return fd;
+    c->usage = read_usage(fd);
+    if (c->usage >= 0 && c->usage + size <= c->cache_max_size) {
+        c->usage += size;
+        write_usage(h, fd, c->usage);
+    } else {
+        ret = scan_dir(h, fd);
+    }
+    unlock_dir(fd);
+    return ret;
+}
+
+static void set_size(URLContext *h, int64_t size)
+{
+    Context *c = h->priv_data;
+    char *path, *info;
+
+    if (c->size >= 0 || size < 0)
+        return;
+    c->size = size;
+    path = av_asprintf("%s.info", c->prefix);
+    info = c->validator ? av_asprintf("%"PRId64"\n%s\n", size, c->validator) :
+                          av_asprintf("%"PRId64"\n", size);
+    if (path && info)
+        write_atomic(h, path, info, strlen(info));
+    av_free(path);
+    av_free(info);
+}
+
+/* The ETag or else the Last-Modified header of the resource, if the inner
+ * protocol exports them. */
+static char *get_validator(URLContext *inner)
+{
+    static const char *const names[] = { "etag", "last_modified" };
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(names); i++) {
+        uint8_t *val = NULL;
+
+        if (av_opt_get(inner, names[i], AV_OPT_SEARCH_CHILDREN, &val) >= 0 &&
+            val && val[0] && strlen(val) <= MAX_VALIDATOR_SIZE)
+            return val;
+        av_free(val);
+    }
+    return NULL;
+}
+
+/* Delete the blocks of the resource, before it is cached again. */
+static void remove_blocks(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int64_t removed = 0;
+    char path[1024];
+    struct stat st;
+
+    for (int64_t i = 0; i * c->block_size < c->size; i++) {
+        if (block_path(h, path, sizeof(path), i) >= 0 &&
+            !stat(path, &st) && unlink(path) >= 0)
+            removed += st.st_size;
+    }
+    if (removed)
+        update_usage(h, -removed);
+}
+
+/* Compare the size and the validator of the resource opened by the inner
+ * protocol to the cached ones, deleting its blocks if it changed. */
+static int check_resource(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int64_t size = ffurl_seek(c->inner, 0, AVSEEK_SIZE);
+    char *validator = get_validator(c->inner);
+    int changed;
+
+    changed = c->size >= 0 &&
+              (size >= 0 && size != c->size ||
+               strcmp(c->validator ? c->validator : "", validator ? validator : ""));
+    av_free(c->validator);
+    c->validator = validator;
+    if (changed) {
+        av_log(h, AV_LOG_WARNING, "%s changed since it was cached\n", c->url);
+        remove_blocks(h);
+        c->size        = -1;
+        c->block_index = -1;
+        /* the data already read from the cache belongs to the old version */
+        if (c->cache_hit)
+            return AVERROR(EIO);
+    }
+    set_size(h, size);
+    return 0;
+}
+
+static int open_inner(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int ret;
+
+    if (c->inner)
+        return 0;
+    ret = ffurl_open_whitelist(&c->inner, c->url, c->inner_flags, &h->interrupt_callback,
+                               &c->inner_opts, h->protocol_whitelist,
+                               h->protocol_blacklist, h);
+    c->inner_pos = 0;
+    if (ret < 0)
+        return ret;
+    return check_resource(h);
+}
+
+/* Make c->block hold the given block, from the cache directory if it is
+ * there, else from the inner protocol, storing it for later. */
+static int load_block(URLContext *h, int64_t index)
+{
+    Context *c = h->priv_data;
+    int64_t start = index * c->block_size;
+    char path[1024];
+    int fd, len = 0, ret;
+
+    c->block_index = -1;
+    if ((ret = block_path(h, path, sizeof(path), index)) < 0)
+        return ret;
+
+    fd = avpriv_open(path, O_RDONLY);
+    if (fd >= 0) {
+        while (len < c->block_size &&
+               (ret = read(fd, c->block + len, c->block_size - len)) > 0)
+            len += ret;
+        close(fd);
+        /* only the last block may be short */
+        if (len == c->block_size || (c->size >= 0 && start + len == c->size)) {
+            utime(path, NULL);
+            c->block_index = index;
+            c->block_len   = len;
+            c->cache_hit++;
+            return 0;
+        }
+        len = 0;
+    }
+
+    if ((ret = open_inner(h)) < 0)
+        return ret;
+    if (c->inner_pos != start) {
+        int64_t pos = ffurl_seek(c->inner, start, SEEK_SET);
+        if (pos < 0) {
+            av_log(h, AV_LOG_ERROR, "Failed to perform internal seek\n");
+            return pos;
+        }
+        c->inner_pos = pos;
+    }
+    while (len < c->block_size) {
+        ret = ffurl_read(c->inner, c->block + len, c->block_size - len);
+        if (ret == AVERROR_EOF || !ret) {
+            if (len || !start)
+                set_size(h, start + len);
+            break;
+        }
+        if (ret < 0)
+            return ret;
+        len += ret;
+        c->inner_pos += ret;
+    }
+    c->cache_miss++;
+    c->block_index = index;
+    c->block_len   = len;
+
+    if ((len == c->block_size || (c->size >= 0 && start + len == c->size)) &&
+        write_atomic(h, path, c->block, len) >= 0 &&
+        (ret = update_usage(h, len)) < 0)
+        av_log(h, AV_LOG_WARNING, "Failed to evict blocks from %s: %s\n",
+               c->cache_dir, av_err2str(ret));
+    return 0;
+}
+
+static int persistent_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
+    Context *c = h->priv_data;
+    struct AVSHA *sha;
+    uint8_t digest[20];
+    char key[41], *path, info[MAX_VALIDATOR_SIZE + 32];
+    int fd, i, len, ret;
+
+    c->size        = -1;
+    c->block_index = -1;
+    c->inner_flags = flags;
+    c->url         = av_strdup(arg);
+    c->block       = av_malloc(c->block_size);
+    sha            = av_sha_alloc();
+    if (!c->url || !c->block || !sha) {
+        av_free(sha);
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    av_sha_init(sha, 160);
+    av_sha_update(sha, arg, strlen(arg));
+    av_sha_final(sha, digest);
+    av_free(sha);
+    for (i = 0; i < 20; i++)
+        snprintf(key + 2 * i, 3, "%02x", digest[i]);
+
+    if (mkdir(c->cache_dir, 0777) < 0 && errno != EEXIST) {
+        ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Could not create %s\n", c->cache_dir);
+        goto fail;
+    }
+    c->prefix = av_asprintf("%s/%s-%d", c->cache_dir, key, c->block_size);
+    path      = av_asprintf("%s.info", c->prefix);
+    if (!c->prefix || !path) {
+        av_free(path);
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    fd = avpriv_open(path, O_RDONLY);
+    av_free(path);
+    if (fd >= 0) {
+        /* the size, then the validator on the next line */
+        if ((len = read(fd, info, sizeof(info) - 1)) > 0) {
+            char *validator;
+
+            info[len] = 0;
+            c->size = strtoll(info, &validator, 10);
+            if (*validator == '\n' && validator[1] && validator[1] != '\n') {
+                validator++;
+                validator[strcspn(validator, "\n")] = 0;
+                c->validator = av_strdup(validator);
+            }
+        }
+        close(fd);
+    }
+
+    /* the directory is only scanned if its size is unknown or too large */
+    if ((ret = update_usage(h, 0)) < 0)
+        av_log(h, AV_LOG_WARNING, "Failed to scan %s: %s\n",
+               c->cache_dir, av_err2str(ret));
+
+    /* the inner protocol is only opened once a block is missing, unless
+     * the resource was never seen, so that open errors are reported here */
+    if (options)
+        av_dict_copy(&c->inner_opts, *options, 0);
+    if (c->size < 0 && (ret = open_inner(h)) < 0)
+        goto fail;
+    return 0;
+
+fail:
+    /* the protocol is not closed when opening it fails */
+    persistent_free(c);
+    return ret;
+}
+
+static int persistent_read(URLContext *h, unsigned char *buf, int size)
+{
+    Context *c = h->priv_data;
+    int64_t index = c->logical_pos / c->block_size;
+    int64_t pos;
+    int ret;
+
+    if (c->size >= 0 && c->logical_pos >= c->size)
+        return AVERROR_EOF;
+    if (index != c->block_index && (ret = load_block(h, index)) < 0)
+        return ret;
+
+    pos = c->logical_pos - index * c->block_size;
+    if (pos >= c->block_len)
+        return AVERROR_EOF;
+    size = FFMIN(size, c->block_len - pos);
+    memcpy(buf, c->block + pos, size);
+    c->logical_pos += size;
+    return size;
+}
+
+static int64_t persistent_seek(URLContext *h, int64_t pos, int whence)
+{
+    Context *c = h->priv_data;
+    int ret;
+
+    if (whence == AVSEEK_SIZE || whence == SEEK_END) {
+        if (c->size < 0) {
+            if ((ret = open_inner(h)) < 0)
+                return ret;
+            set_size(h, ffurl_seek(c->inner, 0, AVSEEK_SIZE));
+        }
+        if (c->size < 0)
+            return AVERROR(ENOSYS);
+        if (whence == AVSEEK_SIZE)
+            return c->size;
+        pos += c->size;
+    } else if (whence == SEEK_CUR) {
+        pos += c->logical_pos;
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    /* blocks are fetched when read */
+    c->logical_pos = pos;
+    return pos;
+}
+#endif /* HAVE_PERSISTENT_CACHE */
+
 static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     int ret;
@@ -79,6 +638,15 @@ static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "cache:", &arg);
 
+    if (c->cache_dir) {
+#if HAVE_PERSISTENT_CACHE
+        return persistent_open(h, arg, flags, options);
+#else
+        av_log(h, AV_LOG_ERROR, "Persistent cache not supported on this platform\n");
+        return AVERROR(ENOSYS);
+#endif
+    }
+
     c->fd = avpriv_tempfile("ffcache", &buffername, 0, h);
     if (c->fd < 0){
         av_log(h, AV_LOG_ERROR, "Failed to create tempfile\n");
@@ -165,6 +733,11 @@ static int cache_read(URLContext *h, unsigned char *buf, int size)
     CacheEntry *entry, *next[2] = {NULL, NULL};
     int64_t r;
 
+#if HAVE_PERSISTENT_CACHE
+    if (c->cache_dir)
+        return persistent_read(h, buf, size);
+#endif
+
     entry = av_tree_find(c->root, &c->logical_pos, cmp, (void**)next);
 
     if (!entry)
@@ -229,6 +802,11 @@ static int64_t cache_seek(URLContext *h, int64_t pos, int whence)
     Context *c= h->priv_data;
     int64_t ret;
 
+#if HAVE_PERSISTENT_CACHE
+    if (c->cache_dir)
+        return persistent_seek(h, pos, whence);
+#endif
+
     if (whence == AVSEEK_SIZE) {
         pos= ffurl_seek(c->inner, pos, whence);
         if(pos <= 0){
@@ -303,6 +881,11 @@ static int cache_close(URLContext *h)
     av_log(h, AV_LOG_INFO, "Statistics, cache hits:%"PRId64" cache misses:%"PRId64"\n",
            c->cache_hit, c->cache_miss);
 
+    if (c->cache_dir) {
+        persistent_free(c);
+        return 0;
+    }
+
     close(c->fd);
     if (c->filename) {
         ret = unlink(c->filename);
@@ -322,6 +905,11 @@ static int cache_close(URLContext *h)
 
 static const AVOption options[] = {
     { "read_ahead_limit", "Amount in bytes that may be read ahead when seeking isn't supported, -1 for unlimited", OFFSET(read_ahead_limit), AV_OPT_TYPE_INT, { .i64 = 65536 }, -1, INT_MAX, D },
+    { "cache_dir", "Directory of a persistent cache shared between processes", OFFSET(cache_dir), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
+    { "cache_max_size", "Maximum size in bytes of the persistent cache", OFFSET(cache_max_size), AV_OPT_TYPE_INT64, { .i64 = 1LL << 30 }, 0, INT64_MAX, D },
+    { "cache_block_size", "Size in bytes of the blocks of the persistent cache", OFFSET(block_size), AV_OPT_TYPE_INT, { .i64 = 512 * 1024 }, 4096, 64 * 1024 * 1024, D },
+    { "cache_hits", "Number of reads, or of blocks with a persistent cache, served from the cache", OFFSET(cache_hit), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "cache_misses", "Number of reads, or of blocks with a persistent cache, which were not in the cache", OFFSET(cache_miss), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     {NULL},
 };
 
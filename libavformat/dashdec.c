@@ -20,10 +20,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 #include <libxml/parser.h>
+#include <stdatomic.h>
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "internal.h"
 #include "avio_internal.h"
 #include "dash.h"
@@ -38,6 +40,18 @@ struct fragment {
     char *url;
 };
 
+/* A fragment downloaded into memory by the fetch thread of a representation */
+struct fetched_fragment {
+    int64_t seq_no;
+    int64_t duration;       /* in AV_TIME_BASE units */
+    int ret;                /* result of the download */
+    uint8_t *buf;
+    unsigned int buf_size;
+    int64_t len;
+    int64_t read_offset;
+    struct fetched_fragment *next;
+};
+
 /*
  * reference to : ISO_IEC_23009-1-DASH-2012
  * Section: 5.3.9.6.2
@@ -116,6 +130,20 @@ struct representation {
     uint32_t init_sec_buf_read_offset;
     int64_t cur_timestamp;
     int is_restart_needed;
+
+    /* fragments downloaded ahead by fetch_thread(), in order, and the one
+     * currently being read */
+#if HAVE_THREADS
+    pthread_t fetch_thread;
+#endif
+    int fetch_started;
+    atomic_int fetch_quit;
+    int fetch_eof;
+    int64_t fetch_seq_no;
+    int64_t fetch_buffered;
+    AVDictionary *fetch_opts;
+    struct fetched_fragment *fetch_queue;
+    struct fetched_fragment *fetch_cur;
 };
 
 typedef struct DASHContext {
@@ -157,6 +185,12 @@ typedef struct DASHContext {
     int is_init_section_common_audio;
     int is_init_section_common_subtitle;
 
+    int64_t prefetch_duration;
+#if HAVE_THREADS
+    int fetch_init;
+    pthread_mutex_t fetch_lock;
+    pthread_cond_t fetch_cond;
+#endif
 } DASHContext;
 
 static int ishttp(char *url)
@@ -345,6 +379,8 @@ static void free_timelines_list(struct representation *pls)
     pls->n_timelines = 0;
 }
 
+static void fetch_stop(DASHContext *c, struct representation *pls);
+
 static void free_representation(struct representation *pls)
 {
     free_fragment_list(pls);
@@ -370,6 +406,7 @@ static void free_video_list(DASHContext *c)
     int i;
     for (i = 0; i < c->n_videos; i++) {
         struct representation *pls = c->videos[i];
+        fetch_stop(c, pls);
         free_representation(pls);
     }
     av_freep(&c->videos);
@@ -381,6 +418,7 @@ static void free_audio_list(DASHContext *c)
     int i;
     for (i = 0; i < c->n_audios; i++) {
         struct representation *pls = c->audios[i];
+        fetch_stop(c, pls);
         free_representation(pls);
     }
     av_freep(&c->audios);
@@ -392,14 +430,17 @@ static void free_subtitle_list(DASHContext *c)
     int i;
     for (i = 0; i < c->n_subtitles; i++) {
         struct representation *pls = c->subtitles[i];
+        fetch_stop(c, pls);
         free_representation(pls);
     }
     av_freep(&c->subtitles);
     c->n_subtitles = 0;
 }
 
-static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary **opts, AVDictionary *opts2, int *is_http)
+/* Open url with int_cb, or with the interrupt callback of s if not set. */
+static int open_url_cb(AVFormatContext *s, AVIOContext **pb, const char *url,
+                       AVDictionary **opts, AVDictionary *opts2, int *is_http,
+                       const AVIOInterruptCB *int_cb)
 {
     DASHContext *c = s->priv_data;
     AVDictionary *tmp = NULL;
@@ -441,7 +482,8 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     av_freep(pb);
     av_dict_copy(&tmp, *opts, 0);
     av_dict_copy(&tmp, opts2, 0);
-    ret = avio_open2(pb, url, AVIO_FLAG_READ, c->interrupt_callback, &tmp);
+    ret = avio_open2(pb, url, AVIO_FLAG_READ,
+                     int_cb ? int_cb : c->interrupt_callback, &tmp);
     if (ret >= 0) {
         // update cookies on http response with setcookies.
         char *new_cookies = NULL;
@@ -463,6 +505,12 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     return ret;
 }
 
+static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
+                    AVDictionary **opts, AVDictionary *opts2, int *is_http)
+{
+    return open_url_cb(s, pb, url, opts, opts2, is_http, NULL);
+}
+
 static char *get_content_url(xmlNodePtr *baseurl_nodes,
                              int n_baseurl_nodes,
                              int max_url_size,
@@ -1582,29 +1630,69 @@ finish:
     return ret;
 }
 
+static struct fragment *copy_fragment(const struct fragment *seg_ptr)
+{
+    struct fragment *seg = av_mallocz(sizeof(struct fragment));
+
+    if (!seg) {
+        return NULL;
+    }
+    seg->url = av_strdup(seg_ptr->url);
+    if (!seg->url) {
+        av_free(seg);
+        return NULL;
+    }
+    seg->size = seg_ptr->size;
+    seg->url_offset = seg_ptr->url_offset;
+    return seg;
+}
+
+static struct fragment *get_template_fragment(struct representation *pls, int64_t seq_no)
+{
+    DASHContext *c = pls->parent->priv_data;
+    struct fragment *seg;
+    char *tmpfilename;
+
+    if (!pls->url_template) {
+        av_log(pls->parent, AV_LOG_ERROR, "Cannot get fragment, missing template URL\n");
+        return NULL;
+    }
+    seg = av_mallocz(sizeof(struct fragment));
+    if (!seg) {
+        return NULL;
+    }
+    tmpfilename = av_mallocz(c->max_url_size);
+    if (!tmpfilename) {
+        av_free(seg);
+        return NULL;
+    }
+    ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, seq_no, 0, get_segment_start_time_based_on_timeline(pls, seq_no));
+    seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
+    if (!seg->url) {
+        av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
+        seg->url = av_strdup(pls->url_template);
+        if (!seg->url) {
+            av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
+            av_free(tmpfilename);
+            av_free(seg);
+            return NULL;
+        }
+    }
+    av_free(tmpfilename);
+    seg->size = -1;
+
+    return seg;
+}
+
 static struct fragment *get_current_fragment(struct representation *pls)
 {
     int64_t min_seq_no = 0;
     int64_t max_seq_no = 0;
-    struct fragment *seg = NULL;
-    struct fragment *seg_ptr = NULL;
     DASHContext *c = pls->parent->priv_data;
 
     while (( !ff_check_interrupt(c->interrupt_callback)&& pls->n_fragments > 0)) {
         if (pls->cur_seq_no < pls->n_fragments) {
-            seg_ptr = pls->fragments[pls->cur_seq_no];
-            seg = av_mallocz(sizeof(struct fragment));
-            if (!seg) {
-                return NULL;
-            }
-            seg->url = av_strdup(seg_ptr->url);
-            if (!seg->url) {
-                av_free(seg);
-                return NULL;
-            }
-            seg->size = seg_ptr->size;
-            seg->url_offset = seg_ptr->url_offset;
-            return seg;
+            return copy_fragment(pls->fragments[pls->cur_seq_no]);
         } else if (c->is_live) {
             refresh_manifest(pls->parent);
         } else {
@@ -1624,45 +1712,36 @@ static struct fragment *get_current_fragment(struct representation *pls)
         } else if (pls->cur_seq_no > max_seq_no) {
             av_log(pls->parent, AV_LOG_VERBOSE, "new fragment: min[%"PRId64"] max[%"PRId64"]\n", min_seq_no, max_seq_no);
         }
-        seg = av_mallocz(sizeof(struct fragment));
-        if (!seg) {
-            return NULL;
-        }
+        return get_template_fragment(pls, pls->cur_seq_no);
     } else if (pls->cur_seq_no <= pls->last_seq_no) {
-        seg = av_mallocz(sizeof(struct fragment));
-        if (!seg) {
-            return NULL;
-        }
-    }
-    if (seg) {
-        char *tmpfilename;
-        if (!pls->url_template) {
-            av_log(pls->parent, AV_LOG_ERROR, "Cannot get fragment, missing template URL\n");
-            av_free(seg);
-            return NULL;
-        }
-        tmpfilename = av_mallocz(c->max_url_size);
-        if (!tmpfilename) {
-            av_free(seg);
-            return NULL;
-        }
-        ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, pls->cur_seq_no, 0, get_segment_start_time_based_on_timeline(pls, pls->cur_seq_no));
-        seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
-        if (!seg->url) {
-            av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
-            seg->url = av_strdup(pls->url_template);
-            if (!seg->url) {
-                av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
-                av_free(tmpfilename);
-                av_free(seg);
-                return NULL;
-            }
-        }
-        av_free(tmpfilename);
-        seg->size = -1;
+        return get_template_fragment(pls, pls->cur_seq_no);
     }
 
-    return seg;
+    return NULL;
+}
+
+/* Fragment lookup without manifest refresh, for static manifests only. */
+static struct fragment *get_static_fragment(struct representation *pls, int64_t seq_no)
+{
+    if (seq_no < pls->n_fragments)
+        return copy_fragment(pls->fragments[seq_no]);
+    if (seq_no <= pls->last_seq_no)
+        return get_template_fragment(pls, seq_no);
+    return NULL;
+}
+
+/* Duration of a fragment in AV_TIME_BASE units, 0 if unknown */
+static int64_t get_fragment_duration(struct representation *pls, int64_t seq_no)
+{
+    if (pls->fragment_timescale <= 0)
+        return 0;
+    if (pls->n_timelines)
+        return av_rescale(get_segment_start_time_based_on_timeline(pls, seq_no + 1) -
+                          get_segment_start_time_based_on_timeline(pls, seq_no),
+                          AV_TIME_BASE, pls->fragment_timescale);
+    if (pls->fragment_duration > 0)
+        return av_rescale(pls->fragment_duration, AV_TIME_BASE, pls->fragment_timescale);
+    return 0;
 }
 
 static int read_from_url(struct representation *pls, struct fragment *seg,
@@ -1674,7 +1753,19 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, pls->cur_seg_size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->fetch_cur) {
+        struct fetched_fragment *ff = pls->fetch_cur;
+
+        ret = FFMIN(buf_size, ff->len - ff->read_offset);
+        if (ret > 0) {
+            memcpy(buf, ff->buf + ff->read_offset, ret);
+            ff->read_offset += ret;
+        } else {
+            ret = ff->ret < 0 ? ff->ret : AVERROR_EOF;
+        }
+    } else {
+        ret = avio_read(pls->input, buf, buf_size);
+    }
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1759,6 +1850,259 @@ static int update_init_section(struct representation *pls)
     return 0;
 }
 
+#if HAVE_THREADS
+static void free_fetched_fragment(struct fetched_fragment **pff)
+{
+    if (!*pff)
+        return;
+    av_freep(&(*pff)->buf);
+    av_freep(pff);
+}
+
+/* The interrupt callback of the caller is not called from the fetch threads;
+ * their requests are aborted when fetching stops. */
+static int fetch_interrupt_cb(void *opaque)
+{
+    struct representation *pls = opaque;
+    return atomic_load(&pls->fetch_quit);
+}
+
+static int fetch_fragment(DASHContext *c, struct representation *pls,
+                          struct fragment *seg, struct fetched_fragment *ff)
+{
+    const AVIOInterruptCB int_cb = { fetch_interrupt_cb, pls };
+    AVIOContext *pb = NULL;
+    AVDictionary *opts = NULL;
+    char *url;
+    int ret;
+
+    url = av_mallocz(c->max_url_size);
+    if (!url)
+        return AVERROR(ENOMEM);
+    ff_make_absolute_url(url, c->max_url_size, c->base_url, seg->url);
+
+    /* keep the connection open for the next fragments */
+    if (ishttp(url))
+        av_dict_set(&opts, "connection_pool", "1", 0);
+    if (seg->size >= 0) {
+        av_dict_set_int(&opts, "offset", seg->url_offset, 0);
+        av_dict_set_int(&opts, "end_offset", seg->url_offset + seg->size, 0);
+    }
+
+    av_log(pls->parent, AV_LOG_VERBOSE, "DASH fetch for url '%s', offset %"PRId64"\n",
+           url, seg->url_offset);
+    ret = open_url_cb(pls->parent, &pb, url, &pls->fetch_opts, opts, NULL, &int_cb);
+    av_dict_free(&opts);
+    if (ret < 0)
+        goto end;
+
+    for (;;) {
+        int64_t want = INITIAL_BUFFER_SIZE;
+        uint8_t *buf;
+
+        if (seg->size >= 0)
+            want = FFMIN(want, seg->size - ff->len);
+        if (want <= 0)
+            break;
+
+        if (atomic_load(&pls->fetch_quit)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+
+        buf = av_fast_realloc(ff->buf, &ff->buf_size, ff->len + want);
+        if (!buf) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        ff->buf = buf;
+
+        ret = avio_read(pb, ff->buf + ff->len, want);
+        if (ret <= 0)
+            break;
+        ff->len += ret;
+        ret = 0;
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+    ff_format_io_close(pls->parent, &pb);
+
+end:
+    av_free(url);
+    return ret;
+}
+
+/*
+ * Download the fragments of a representation in order, keeping at most
+ * prefetch_duration of them buffered ahead of the one being read.
+ * Only used with static manifests, whose fragment list does not change.
+ */
+static void *fetch_thread(void *arg)
+{
+    struct representation *pls = arg;
+    DASHContext *c = pls->parent->priv_data;
+
+    pthread_mutex_lock(&c->fetch_lock);
+    while (!atomic_load(&pls->fetch_quit)) {
+        struct fetched_fragment *ff, **tail;
+        struct fragment *seg;
+
+        if (pls->fetch_eof ||
+            (pls->fetch_queue && pls->fetch_buffered >= c->prefetch_duration)) {
+            pthread_cond_wait(&c->fetch_cond, &c->fetch_lock);
+            continue;
+        }
+
+        seg = get_static_fragment(pls, pls->fetch_seq_no);
+        ff  = av_mallocz(sizeof(*ff));
+        if (!seg || !ff) {
+            free_fragment(&seg);
+            av_free(ff);
+            pls->fetch_eof = 1;
+            pthread_cond_broadcast(&c->fetch_cond);
+            continue;
+        }
+        ff->seq_no   = pls->fetch_seq_no++;
+        /* fragments of unknown duration count as one second each */
+        ff->duration = get_fragment_duration(pls, ff->seq_no);
+        if (ff->duration <= 0)
+            ff->duration = AV_TIME_BASE;
+        pthread_mutex_unlock(&c->fetch_lock);
+
+        ff->ret = fetch_fragment(c, pls, seg, ff);
+        free_fragment(&seg);
+
+        pthread_mutex_lock(&c->fetch_lock);
+        for (tail = &pls->fetch_queue; *tail; tail = &(*tail)->next)
+            ;
+        *tail = ff;
+        pls->fetch_buffered += ff->duration;
+        pthread_cond_broadcast(&c->fetch_cond);
+    }
+    pthread_mutex_unlock(&c->fetch_lock);
+
+    return NULL;
+}
+
+static void fetch_stop(DASHContext *c, struct representation *pls)
+{
+    if (!pls->fetch_started)
+        return;
+
+    pthread_mutex_lock(&c->fetch_lock);
+    /* also aborts the request in progress */
+    atomic_store(&pls->fetch_quit, 1);
+    pthread_cond_broadcast(&c->fetch_cond);
+    pthread_mutex_unlock(&c->fetch_lock);
+    pthread_join(pls->fetch_thread, NULL);
+
+    while (pls->fetch_queue) {
+        struct fetched_fragment *ff = pls->fetch_queue;
+        pls->fetch_queue = ff->next;
+        free_fetched_fragment(&ff);
+    }
+    free_fetched_fragment(&pls->fetch_cur);
+    av_dict_free(&pls->fetch_opts);
+    pls->fetch_buffered = 0;
+    pls->fetch_started  = 0;
+}
+
+static void fetch_release(DASHContext *c, struct representation *pls)
+{
+    free_fetched_fragment(&pls->fetch_cur);
+}
+
+/*
+ * Take the current fragment of the representation from its fetch thread,
+ * starting the thread if needed. Returns AVERROR(ENOSYS) if the fragment
+ * has to be opened directly.
+ */
+static int fetch_current(DASHContext *c, struct representation *pls)
+{
+    struct fetched_fragment *ff;
+    int ret;
+
+    if (!pls->fetch_started) {
+        atomic_init(&pls->fetch_quit, 0);
+        pls->fetch_eof      = 0;
+        pls->fetch_seq_no   = pls->cur_seq_no;
+        pls->fetch_buffered = 0;
+        if (av_dict_copy(&pls->fetch_opts, c->avio_opts, 0) < 0)
+            return AVERROR(ENOMEM);
+        ret = pthread_create(&pls->fetch_thread, NULL, fetch_thread, pls);
+        if (ret) {
+            av_log(pls->parent, AV_LOG_WARNING, "Could not start fragment fetching: %s\n",
+                   av_err2str(AVERROR(ret)));
+            av_dict_free(&pls->fetch_opts);
+            return AVERROR(ENOSYS);
+        }
+        pls->fetch_started = 1;
+    }
+
+    pthread_mutex_lock(&c->fetch_lock);
+    for (;;) {
+        /* fragments the reader skipped */
+        while ((ff = pls->fetch_queue) && ff->seq_no < pls->cur_seq_no) {
+            pls->fetch_queue = ff->next;
+            pls->fetch_buffered -= ff->duration;
+            free_fetched_fragment(&ff);
+        }
+        if (ff || pls->fetch_eof)
+            break;
+
+        {
+            int64_t t = av_gettime() + 100000;
+            struct timespec tv = { .tv_sec  =  t / 1000000,
+                                   .tv_nsec = (t % 1000000) * 1000 };
+            pthread_cond_timedwait(&c->fetch_cond, &c->fetch_lock, &tv);
+        }
+        if (ff_check_interrupt(c->interrupt_callback)) {
+            pthread_mutex_unlock(&c->fetch_lock);
+            return AVERROR_EXIT;
+        }
+    }
+    if (ff && ff->seq_no == pls->cur_seq_no) {
+        pls->fetch_queue = ff->next;
+        pls->fetch_buffered -= ff->duration;
+        ff->next = NULL;
+        pthread_cond_broadcast(&c->fetch_cond);
+    } else {
+        ff = NULL;
+    }
+    pthread_mutex_unlock(&c->fetch_lock);
+
+    if (!ff) {
+        /* the reader jumped ahead of the thread, start over from there */
+        fetch_stop(c, pls);
+        return AVERROR(ENOSYS);
+    }
+
+    /* a download that failed before getting any data fails the fragment */
+    if (ff->ret < 0 && !ff->len) {
+        ret = ff->ret;
+        free_fetched_fragment(&ff);
+        return ret;
+    }
+
+    pls->fetch_cur = ff;
+    return 0;
+}
+#else
+static void fetch_stop(DASHContext *c, struct representation *pls)
+{
+}
+
+static void fetch_release(DASHContext *c, struct representation *pls)
+{
+}
+
+static int fetch_current(DASHContext *c, struct representation *pls)
+{
+    return AVERROR(ENOSYS);
+}
+#endif /* HAVE_THREADS */
+
 static int64_t seek_data(void *opaque, int64_t offset, int whence)
 {
     struct representation *v = opaque;
@@ -1776,7 +2120,7 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     DASHContext *c = v->parent->priv_data;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->fetch_cur) {
         free_fragment(&v->cur_seg);
         v->cur_seg = get_current_fragment(v);
         if (!v->cur_seg) {
@@ -1789,7 +2133,17 @@ restart:
         if (ret)
             goto end;
 
-        ret = open_input(c, v, v->cur_seg);
+        /* seek_data() needs the connection of single file representations */
+        ret = AVERROR(ENOSYS);
+        if (c->prefetch_duration > 0 && !c->is_live &&
+            !(v->n_fragments && !v->init_sec_data_len))
+            ret = fetch_current(c, v);
+        if (ret == AVERROR(ENOSYS)) {
+            ret = open_input(c, v, v->cur_seg);
+        } else if (ret >= 0) {
+            v->cur_seg_offset = 0;
+            v->cur_seg_size = v->cur_seg->size;
+        }
         if (ret < 0) {
             if (ff_check_interrupt(c->interrupt_callback)) {
                 ret = AVERROR_EXIT;
@@ -1836,7 +2190,8 @@ static int save_avio_options(AVFormatContext *s)
 {
     DASHContext *c = s->priv_data;
     const char *opts[] = {
-        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy", NULL };
+        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy",
+        "connection_pool", NULL };
     const char **opt = opts;
     uint8_t *buf = NULL;
     int ret = 0;
@@ -2061,6 +2416,28 @@ static int dash_read_header(AVFormatContext *s)
     if ((ret = save_avio_options(s)) < 0)
         goto fail;
 
+#if HAVE_THREADS
+    if (c->prefetch_duration > 0 && !ff_format_io_is_default(s)) {
+        av_log(s, AV_LOG_WARNING, "Fragment prefetching is not supported "
+               "with custom I/O callbacks, disabling it\n");
+        c->prefetch_duration = 0;
+    }
+    if (c->prefetch_duration > 0) {
+        if ((ret = pthread_mutex_init(&c->fetch_lock, NULL))) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        if ((ret = pthread_cond_init(&c->fetch_cond, NULL))) {
+            pthread_mutex_destroy(&c->fetch_lock);
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        c->fetch_init = 1;
+    }
+#else
+    c->prefetch_duration = 0;
+#endif
+
     if ((ret = parse_manifest(s, s->url, s->pb)) < 0)
         goto fail;
 
@@ -2190,6 +2567,7 @@ static void recheck_discard_flags(AVFormatContext *s, struct representation **p,
         } else if (!needed && pls->ctx) {
             close_demux_for_component(pls);
             ff_format_io_close(pls->parent, &pls->input);
+            fetch_stop(s->priv_data, pls);
             av_log(s, AV_LOG_INFO, "No longer receiving stream_index %d\n", pls->stream_index);
         }
     }
@@ -2251,6 +2629,7 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
             cur->cur_seg_offset = 0;
             cur->init_sec_buf_read_offset = 0;
             ff_format_io_close(cur->parent, &cur->input);
+            fetch_release(c, cur);
             ret = reopen_demux_for_component(s, cur);
             cur->is_restart_needed = 0;
         }
@@ -2264,6 +2643,13 @@ static int dash_close(AVFormatContext *s)
     free_audio_list(c);
     free_video_list(c);
     free_subtitle_list(c);
+#if HAVE_THREADS
+    if (c->fetch_init) {
+        pthread_cond_destroy(&c->fetch_cond);
+        pthread_mutex_destroy(&c->fetch_lock);
+        c->fetch_init = 0;
+    }
+#endif
     av_dict_free(&c->avio_opts);
     av_freep(&c->base_url);
     return 0;
@@ -2290,6 +2676,8 @@ static int dash_seek(AVFormatContext *s, struct representation *pls, int64_t see
     }
 
     ff_format_io_close(pls->parent, &pls->input);
+    if (!dry_run)
+        fetch_stop(s->priv_data, pls);
 
     // find the nearest fragment
     if (pls->n_timelines > 0 && pls->fragment_timescale > 0) {
@@ -2387,6 +2775,8 @@ static const AVOption dash_options[] = {
         OFFSET(allowed_extensions), AV_OPT_TYPE_STRING,
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm,ts"},
         INT_MIN, INT_MAX, FLAGS},
+    {"prefetch_duration", "Duration of fragments downloaded ahead by one thread per representation, 0 = disable",
+        OFFSET(prefetch_duration), AV_OPT_TYPE_DURATION, {.i64 = 0}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
@@ -19,9 +19,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _DEFAULT_SOURCE /* needed for syscall() */
+
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 #include "avformat.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -35,9 +38,26 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
+#if HAVE_LINUX_IO_URING_H
+#include <stdatomic.h>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include "libavutil/thread.h"
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define FILE_URING 1
+#endif
+#endif
+#ifndef FILE_URING
+#define FILE_URING 0
+#endif
+
 /* Some systems may not have S_ISFIFO */
 #ifndef S_ISFIFO
 #  ifdef S_IFIFO
@@ -74,9 +94,18 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int use_mmap;
+    AVBufferRef *map;
+    int64_t map_size;
+    int64_t map_checked;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+#if FILE_URING
+    int uring_depth;
+    int uring_block_size;
+    struct FileURing *uring;
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
@@ -84,6 +113,13 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+#if HAVE_MMAP
+    { "mmap", "map the file to read packets without copying them", offsetof(FileContext, use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+#endif
+#if FILE_URING
+    { "uring_depth", "number of io_uring requests kept in flight, 0 to use blocking I/O", offsetof(FileContext, uring_depth), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 256, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "uring_block_size", "size of each io_uring request", offsetof(FileContext, uring_block_size), AV_OPT_TYPE_INT, { .i64 = 262144 }, 4096, 64 << 20, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+#endif
     { NULL }
 };
 
@@ -106,11 +142,645 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if FILE_URING
+/* The ring is driven through the io_uring system calls directly. The
+ * submission and completion rings are shared with the kernel: entries are
+ * published by a release store of the tail and consumed after an acquire
+ * load of it. */
+
+typedef struct URingBuffer {
+    uint8_t *data;
+    int64_t pos;            ///< file offset of the request
+    int len;                ///< bytes requested, or queued for writing
+    int res;                ///< result of the completed request
+    int busy;               ///< request in flight
+} URingBuffer;
+
+typedef struct FileURing {
+    int fd;                 ///< ring
+    int file_fd;
+    int write;
+    int fixed;              ///< buffers registered with the kernel
+
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned sq_entries;
+    unsigned to_submit;
+    int inflight;
+
+    URingBuffer *bufs;
+    struct iovec *iovs;
+    int nb_bufs;
+    int block_size;
+
+    int64_t pos;            ///< logical file position
+
+    /* reading: blocks requested ahead, oldest first */
+    int head, count;
+    int64_t next_pos;
+
+    /* writing */
+    int cur;                ///< buffer being filled, or -1
+    int err;                ///< first write error
+    dev_t dev;
+    ino_t ino;
+    AVMutex lock;
+    struct FileURing *next;
+} FileURing;
+
+/* Files being written with write-behind, so that opening one of them again
+ * first waits for the data to reach the file. */
+static AVMutex uring_writers_lock = AV_MUTEX_INITIALIZER;
+static FileURing *uring_writers;
+
+static unsigned uring_load(const unsigned *p)
+{
+    unsigned v = *(const volatile unsigned *)p;
+    atomic_thread_fence(memory_order_acquire);
+    return v;
+}
+
+static void uring_store(unsigned *p, unsigned v)
+{
+    atomic_thread_fence(memory_order_release);
+    *(volatile unsigned *)p = v;
+}
+
+/* Submit the queued requests and, if wait is set, wait for one completion. */
+static int uring_enter(FileURing *r, int wait)
+{
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, r->fd, r->to_submit, wait,
+                      wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+        return AVERROR(errno);
+    r->to_submit -= ret;
+    return 0;
+}
+
+/* Complete a short write synchronously. */
+static int uring_write_rest(FileURing *r, URingBuffer *b)
+{
+    int done = b->res;
+
+    if (done < 0)
+        return AVERROR(-done);
+    while (done < b->len) {
+        ssize_t ret = pwrite(r->file_fd, b->data + done, b->len - done, b->pos + done);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            return AVERROR(errno);
+        if (!ret)
+            return AVERROR(EIO);
+        done += ret;
+    }
+    return 0;
+}
+
+static void uring_reap(FileURing *r)
+{
+    unsigned head = *r->cq_head, tail = uring_load(r->cq_tail);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        URingBuffer *b = &r->bufs[cqe->user_data];
+
+        b->res  = cqe->res;
+        b->busy = 0;
+        r->inflight--;
+        if (r->write && b->res != b->len && !r->err)
+            r->err = uring_write_rest(r, b);
+    }
+    uring_store(r->cq_head, head);
+}
+
+/* Wait for the request on b to complete, or for all of them if b is NULL. */
+static int uring_wait(FileURing *r, URingBuffer *b)
+{
+    int ret;
+
+    uring_reap(r);
+    while (b ? b->busy : r->inflight > 0) {
+        if ((ret = uring_enter(r, 1)) < 0)
+            return ret;
+        uring_reap(r);
+    }
+    return 0;
+}
+
+static int uring_queue(FileURing *r, URingBuffer *b, int64_t pos, int len)
+{
+    unsigned tail = *r->sq_tail, idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    int i = b - r->bufs, ret;
+
+    /* the entries not consumed by the kernel yet must be submitted first */
+    if (tail - uring_load(r->sq_head) >= r->sq_entries) {
+        if ((ret = uring_enter(r, 0)) < 0)
+            return ret;
+        if (tail - uring_load(r->sq_head) >= r->sq_entries)
+            return AVERROR(EBUSY);
+    }
+
+    memset(sqe, 0, sizeof(*sqe));
+    if (r->fixed) {
+        sqe->opcode    = r->write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->addr      = (uintptr_t)b->data;
+        sqe->len       = len;
+        sqe->buf_index = i;
+    } else {
+        r->iovs[i].iov_len = len;
+        sqe->opcode    = r->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->addr      = (uintptr_t)&r->iovs[i];
+        sqe->len       = 1;
+    }
+    sqe->fd        = r->file_fd;
+    sqe->off       = pos;
+    sqe->user_data = i;
+    r->sq_array[idx] = idx;
+    uring_store(r->sq_tail, tail + 1);
+
+    b->pos  = pos;
+    b->len  = len;
+    b->busy = 1;
+    r->inflight++;
+    r->to_submit++;
+    return 0;
+}
+
+static void uring_free(FileURing **pr)
+{
+    FileURing *r = *pr;
+
+    if (!r)
+        return;
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_size);
+    if (r->cq_ring)
+        munmap(r->cq_ring, r->cq_ring_size);
+    if (r->sq_ring)
+        munmap(r->sq_ring, r->sq_ring_size);
+    if (r->fd >= 0)
+        close(r->fd);
+    for (int i = 0; r->bufs && i < r->nb_bufs; i++)
+        av_free(r->bufs[i].data);
+    av_free(r->bufs);
+    av_free(r->iovs);
+    ff_mutex_destroy(&r->lock);
+    av_freep(pr);
+}
+
+static void *uring_map(int fd, size_t size, off_t off)
+{
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, off);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static int uring_init(URLContext *h, const struct stat *st, int write)
+{
+    FileContext *c = h->priv_data;
+    struct io_uring_params p = { 0 };
+    FileURing *r;
+    int ret;
+
+    r = av_mallocz(sizeof(*r));
+    if (!r)
+        return AVERROR(ENOMEM);
+    ff_mutex_init(&r->lock, NULL);
+    r->file_fd    = c->fd;
+    r->write      = write;
+    r->cur        = -1;
+    r->nb_bufs    = c->uring_depth;
+    r->block_size = c->uring_block_size;
+    r->dev        = st->st_dev;
+    r->ino        = st->st_ino;
+
+    r->fd = syscall(__NR_io_uring_setup, r->nb_bufs, &p);
+    if (r->fd < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_size    = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sq_entries   = p.sq_entries;
+    /* every buffer has at most one request queued and one completion */
+    if (p.sq_entries < r->nb_bufs || p.cq_entries < r->nb_bufs) {
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+    r->sq_ring = uring_map(r->fd, r->sq_ring_size, IORING_OFF_SQ_RING);
+    r->cq_ring = uring_map(r->fd, r->cq_ring_size, IORING_OFF_CQ_RING);
+    r->sqes    = uring_map(r->fd, r->sqes_size,    IORING_OFF_SQES);
+    if (!r->sq_ring || !r->cq_ring || !r->sqes) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    r->sq_head  = (unsigned *)((uint8_t *)r->sq_ring + p.sq_off.head);
+    r->sq_tail  = (unsigned *)((uint8_t *)r->sq_ring + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)((uint8_t *)r->sq_ring + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((uint8_t *)r->sq_ring + p.sq_off.array);
+    r->cq_head  = (unsigned *)((uint8_t *)r->cq_ring + p.cq_off.head);
+    r->cq_tail  = (unsigned *)((uint8_t *)r->cq_ring + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)((uint8_t *)r->cq_ring + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)((uint8_t *)r->cq_ring + p.cq_off.cqes);
+
+    r->bufs = av_calloc(r->nb_bufs, sizeof(*r->bufs));
+    r->iovs = av_calloc(r->nb_bufs, sizeof(*r->iovs));
+    if (!r->bufs || !r->iovs) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (int i = 0; i < r->nb_bufs; i++) {
+        r->bufs[i].data = av_malloc(r->block_size);
+        if (!r->bufs[i].data) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        r->iovs[i].iov_base = r->bufs[i].data;
+        r->iovs[i].iov_len  = r->block_size;
+    }
+
+    /* Registering pins the buffers, which may exceed RLIMIT_MEMLOCK; plain
+     * vectored requests work as well, only with more overhead. */
+    r->fixed = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS,
+                       r->iovs, r->nb_bufs) >= 0;
+    if (!r->fixed)
+        av_log(h, AV_LOG_VERBOSE, "Could not register io_uring buffers: %s\n",
+               av_err2str(AVERROR(errno)));
+
+    if (write) {
+        ff_mutex_lock(&uring_writers_lock);
+        r->next = uring_writers;
+        uring_writers = r;
+        ff_mutex_unlock(&uring_writers_lock);
+    }
+    c->uring = r;
+    return 0;
+
+fail:
+    uring_free(&r);
+    return ret;
+}
+
+/* Drop the blocks read ahead and restart from the current position. */
+static int uring_discard(FileURing *r)
+{
+    int ret = uring_wait(r, NULL);
+
+    r->count    = 0;
+    r->next_pos = r->pos;
+    return ret;
+}
+
+static int uring_fill(FileURing *r)
+{
+    int ret;
+
+    while (r->count < r->nb_bufs) {
+        URingBuffer *b = &r->bufs[(r->head + r->count) % r->nb_bufs];
+        if ((ret = uring_queue(r, b, r->next_pos, r->block_size)) < 0)
+            return ret;
+        r->count++;
+        r->next_pos += r->block_size;
+    }
+    /* reading from the blocks already requested needs no system call */
+    return r->to_submit ? uring_enter(r, 0) : 0;
+}
+
+static int uring_read(URLContext *h, unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    FileURing *r = c->uring;
+    URingBuffer *b = &r->bufs[r->head];
+    int ret, off;
+
+    if (!r->count || r->pos < b->pos || r->pos >= b->pos + r->block_size) {
+        if ((ret = uring_discard(r)) < 0)
+            return ret;
+        r->head = 0;
+        b = &r->bufs[0];
+    }
+    if ((ret = uring_fill(r)) < 0 || (ret = uring_wait(r, b)) < 0)
+        return ret;
+
+    if (b->res < 0) {
+        ret = AVERROR(-b->res);
+        uring_discard(r);
+        return ret;
+    }
+    off = r->pos - b->pos;
+    if (off >= b->res) {
+        uring_discard(r);
+        return AVERROR_EOF;
+    }
+
+    size = FFMIN(size, b->res - off);
+    memcpy(buf, b->data + off, size);
+    r->pos += size;
+
+    if (r->pos == b->pos + b->res) {
+        if (b->res < r->block_size) {
+            /* a short read, the blocks after it may be misplaced */
+            if ((ret = uring_discard(r)) < 0)
+                return ret;
+        } else {
+            r->head = (r->head + 1) % r->nb_bufs;
+            r->count--;
+            if ((ret = uring_fill(r)) < 0)
+                return ret;
+        }
+    }
+    return size;
+}
+
+/* Queue the buffer being filled for writing. */
+static int uring_flush(FileURing *r)
+{
+    URingBuffer *b;
+    int ret;
+
+    if (r->cur < 0)
+        return r->err;
+    b = &r->bufs[r->cur];
+    r->cur = -1;
+
+    /* requests are not ordered, a write overlapping an earlier one must
+     * wait for it */
+    for (int i = 0; i < r->nb_bufs; i++) {
+        URingBuffer *o = &r->bufs[i];
+        if (o->busy && o->pos < b->pos + b->len && b->pos < o->pos + o->len &&
+            (ret = uring_wait(r, o)) < 0)
+            goto fail;
+    }
+    if ((ret = uring_queue(r, b, b->pos, b->len)) < 0 ||
+        (ret = uring_enter(r, 0)) < 0)
+        goto fail;
+    return r->err;
+fail:
+    if (!r->err)
+        r->err = ret;
+    return ret;
+}
+
+static int uring_drain(FileURing *r)
+{
+    int ret = uring_flush(r);
+
+    if (ret >= 0 && (ret = uring_wait(r, NULL)) < 0 && !r->err)
+        r->err = ret;
+    return ret < 0 ? ret : r->err;
+}
+
+static void uring_sync_writers(const struct stat *st)
+{
+    ff_mutex_lock(&uring_writers_lock);
+    for (FileURing *r = uring_writers; r; r = r->next) {
+        if (r->dev == st->st_dev && r->ino == st->st_ino) {
+            ff_mutex_lock(&r->lock);
+            uring_drain(r);
+            ff_mutex_unlock(&r->lock);
+        }
+    }
+    ff_mutex_unlock(&uring_writers_lock);
+}
+
+static int uring_write(URLContext *h, const unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    FileURing *r = c->uring;
+    URingBuffer *b;
+    int ret;
+
+    ff_mutex_lock(&r->lock);
+    while (r->cur < 0) {
+        uring_reap(r);
+        if ((ret = r->err) < 0)
+            goto end;
+        for (int i = 0; i < r->nb_bufs; i++) {
+            if (!r->bufs[i].busy) {
+                r->cur = i;
+                break;
+            }
+        }
+        if (r->cur >= 0) {
+            b = &r->bufs[r->cur];
+            b->pos = r->pos;
+            b->len = 0;
+        } else if ((ret = uring_enter(r, 1)) < 0) {
+            goto end;
+        }
+    }
+
+    b = &r->bufs[r->cur];
+    size = FFMIN(size, r->block_size - b->len);
+    memcpy(b->data + b->len, buf, size);
+    b->len += size;
+    r->pos += size;
+    if (b->len == r->block_size && (ret = uring_flush(r)) < 0)
+        goto end;
+    ret = size;
+end:
+    ff_mutex_unlock(&r->lock);
+    return ret;
+}
+
+static int64_t uring_seek(URLContext *h, int64_t pos, int whence)
+{
+    FileContext *c = h->priv_data;
+    FileURing *r = c->uring;
+    struct stat st;
+    int64_t ret;
+
+    ff_mutex_lock(&r->lock);
+    if (whence == AVSEEK_SIZE || whence == SEEK_END) {
+        /* the size only accounts for completed writes */
+        if (r->write && (ret = uring_drain(r)) < 0)
+            goto end;
+        if (fstat(r->file_fd, &st) < 0) {
+            ret = AVERROR(errno);
+            goto end;
+        }
+        if (whence == AVSEEK_SIZE) {
+            ret = st.st_size;
+            goto end;
+        }
+        pos += st.st_size;
+    } else if (whence == SEEK_CUR) {
+        pos += r->pos;
+    } else if (whence != SEEK_SET) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    if (pos < 0) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    if (r->write && pos != r->pos && (ret = uring_flush(r)) < 0)
+        goto end;
+    ret = r->pos = pos;
+end:
+    ff_mutex_unlock(&r->lock);
+    return ret;
+}
+
+static int uring_close(FileContext *c)
+{
+    FileURing *r = c->uring, **p;
+    int ret = 0;
+
+    if (r->write) {
+        ff_mutex_lock(&uring_writers_lock);
+        for (p = &uring_writers; *p != r; p = &(*p)->next)
+            ;
+        *p = r->next;
+        ff_mutex_unlock(&uring_writers_lock);
+        ret = uring_drain(r);
+    } else {
+        uring_wait(r, NULL);
+    }
+    uring_free(&c->uring);
+    return ret;
+}
+#endif /* FILE_URING */
+
+#if HAVE_MMAP
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    munmap(data, (uintptr_t)opaque);
+}
+
+static int file_map(URLContext *h, const struct stat *st)
+{
+    FileContext *c = h->priv_data;
+    void *data;
+
+    if (st->st_size > SIZE_MAX)
+        return AVERROR(ERANGE);
+    /* Packets referencing the mapping are read-only, a demuxer modifying one
+     * in place must copy it first. */
+    data = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, c->fd, 0);
+    if (data == MAP_FAILED)
+        return AVERROR(errno);
+    /* packets keep the mapping alive; its size may not fit the buffer size */
+    c->map = av_buffer_create(data, FFMIN(st->st_size, INT_MAX), file_unmap,
+                              (void *)(uintptr_t)st->st_size, AV_BUFFER_FLAG_READONLY);
+    if (!c->map) {
+        munmap(data, st->st_size);
+        return AVERROR(ENOMEM);
+    }
+    c->map_size = st->st_size;
+    return 0;
+}
+
+/**
+ * Time in microseconds during which the result of the truncation check of
+ * the mapping is reused, sparing demuxers reading small packets one fstat()
+ * per packet.
+ */
+#define MAP_CHECK_INTERVAL 100000
+
+static int check_mapping(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    int64_t now;
+    struct stat st;
+
+    if (!c->map)
+        return AVERROR(ENOSYS);
+    now = av_gettime_relative();
+    if (c->map_checked && now - c->map_checked < MAP_CHECK_INTERVAL)
+        return 0;
+    /* touching the pages past the end of a truncated file raises SIGBUS */
+    if (fstat(c->fd, &st) < 0 || st.st_size < c->map_size) {
+        av_log(h, AV_LOG_WARNING, "File truncated, no longer using its mapping\n");
+        av_buffer_unref(&c->map);
+        return AVERROR(ENOSYS);
+    }
+    c->map_checked = now;
+    return 0;
+}
+
+static int file_get_mapping(URLContext *h, AVBufferRef **map, int64_t *size)
+{
+    FileContext *c = h->priv_data;
+    int ret;
+
+    if ((ret = check_mapping(h)) < 0)
+        return ret;
+    *map  = c->map;
+    *size = c->map_size;
+    return 0;
+}
+
+static void file_unmap_packet(void *opaque, uint8_t *data)
+{
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+
+    munmap((void *)((uintptr_t)data & ~(page - 1)), (uintptr_t)opaque);
+}
+
+/* The bytes following the packet in the file cannot serve as its padding,
+ * so the packet gets a mapping of its own: the whole pages it covers are
+ * mapped from the file, and are followed by anonymous zeroed memory holding
+ * a copy of its last partial page. */
+static int file_map_packet(URLContext *h, int64_t pos, int size, int padding,
+                           AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    int64_t start = pos & ~(int64_t)(page - 1);
+    int64_t tail  = (pos + size) & ~(int64_t)(page - 1);
+    size_t file_len = tail - start;
+    size_t tail_len = pos + size - tail;
+    size_t len      = file_len + FFALIGN(tail_len + padding, page);
+    uint8_t *p;
+    int ret;
+
+    if ((ret = check_mapping(h)) < 0)
+        return ret;
+    if (pos < 0 || pos > c->map_size - size)
+        return AVERROR(ENOSYS);
+
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return AVERROR(errno);
+    if (file_len &&
+        mmap(p, file_len, PROT_READ, MAP_PRIVATE | MAP_FIXED, c->fd, start) == MAP_FAILED) {
+        ret = AVERROR(errno);
+        munmap(p, len);
+        return ret;
+    }
+    memcpy(p + file_len, c->map->data + tail, tail_len);
+    mprotect(p + file_len, len - file_len, PROT_READ);
+
+    *buf = av_buffer_create(p + (pos - start), size + padding, file_unmap_packet,
+                            (void *)(uintptr_t)len, AV_BUFFER_FLAG_READONLY);
+    if (!*buf) {
+        munmap(p, len);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+#endif /* HAVE_MMAP */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if FILE_URING
+    if (c->uring)
+        return uring_read(h, buf, size);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -124,6 +794,10 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if FILE_URING
+    if (c->uring)
+        return uring_write(h, buf, size);
+#endif
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
@@ -209,7 +883,7 @@ static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
     int access;
-    int fd;
+    int fd, ret;
     struct stat st;
 
     av_strstart(filename, "file:", &filename);
@@ -233,7 +907,8 @@ static int file_open(URLContext *h, const char *filename, int flags)
         return AVERROR(errno);
     c->fd = fd;
 
-    h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
+    ret = fstat(fd, &st);
+    h->is_streamed = !ret && S_ISFIFO(st.st_mode);
 
     /* Buffer writes more than the default 32k to improve throughput especially
      * with networked file systems */
@@ -243,6 +918,27 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+#if HAVE_MMAP
+    if (c->use_mmap && !ret && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        !(flags & AVIO_FLAG_WRITE) && !c->follow) {
+        int err = file_map(h, &st);
+        if (err < 0)
+            av_log(h, AV_LOG_VERBOSE, "Could not map the file: %s\n", av_err2str(err));
+    }
+#endif
+
+#if FILE_URING
+    if (!ret) {
+        uring_sync_writers(&st);
+        /* read-write access would need reads to wait for pending writes */
+        if (c->uring_depth && S_ISREG(st.st_mode) && !c->follow && !c->map &&
+            (flags & AVIO_FLAG_READ_WRITE) != AVIO_FLAG_READ_WRITE &&
+            (ret = uring_init(h, &st, flags & AVIO_FLAG_WRITE)) < 0)
+            av_log(h, AV_LOG_VERBOSE, "io_uring unavailable (%s), using blocking I/O\n",
+                   av_err2str(ret));
+    }
+#endif
+
     return 0;
 }
 
@@ -252,6 +948,11 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+#if FILE_URING
+    if (c->uring)
+        return uring_seek(h, pos, whence);
+#endif
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -266,6 +967,15 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+    av_buffer_unref(&c->map);
+#if FILE_URING
+    if (c->uring) {
+        int ret = uring_close(c);
+        if (close(c->fd) < 0 && ret >= 0)
+            ret = AVERROR(errno);
+        return ret;
+    }
+#endif
     return close(c->fd);
 }
 
@@ -364,6 +1074,10 @@ const URLProtocol ff_file_protocol = {
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
+#if HAVE_MMAP
+    .url_get_mapping     = file_get_mapping,
+    .url_map_packet      = file_map_packet,
+#endif
     .priv_data_size      = sizeof(FileContext),
     .priv_data_class     = &file_class,
     .url_open_dir        = file_open_dir,
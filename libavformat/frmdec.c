@@ -93,6 +93,8 @@ static int frm_read_packet(AVFormatContext *avctx, AVPacket *pkt)
 
     if (par->format == AV_PIX_FMT_BGRA) {
         int i;
+        if ((ret = av_packet_make_writable(pkt)) < 0)
+            return ret;
         for (i = 3; i + 1 <= pkt->size; i += 4)
             pkt->data[i] = 0xFF - pkt->data[i];
     }
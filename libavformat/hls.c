@@ -26,6 +26,8 @@
  * https://www.rfc-editor.org/rfc/rfc8216.txt
  */
 
+#include <stdatomic.h>
+
 #include "libavformat/http.h"
 #include "libavutil/avstring.h"
 #include "libavutil/avassert.h"
@@ -33,6 +35,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "internal.h"
@@ -79,6 +82,32 @@ struct segment {
 
 struct rendition;
 
+enum PrefetchState {
+    PREFETCH_QUEUED,
+    PREFETCH_RUNNING,
+    PREFETCH_DONE
+};
+
+/*
+ * A segment downloaded into memory ahead of time by the prefetch workers.
+ * The segment fields are copied since a live playlist reload frees the
+ * segment list.
+ */
+struct prefetch {
+    struct playlist *pls;   /* NULL once abandoned while downloading */
+    int64_t seq_no;
+    char *url;
+    int64_t url_offset;
+    int64_t size;
+    AVDictionary *avio_opts;
+    enum PrefetchState state;
+    int ret;                /* result of the download */
+    uint8_t *buf;
+    unsigned int buf_size;
+    int64_t len;
+    int64_t read_offset;
+};
+
 enum PlaylistType {
     PLS_TYPE_UNSPECIFIED,
     PLS_TYPE_EVENT,
@@ -98,6 +127,11 @@ struct playlist {
     int input_read_done;
     AVIOContext *input_next;
     int input_next_requested;
+    /* window of segments queued for prefetching, sorted by sequence number,
+     * and the prefetched segment currently being read, if any */
+    struct prefetch **prefetch;
+    int n_prefetch;
+    struct prefetch *prefetch_cur;
     AVFormatContext *parent;
     int index;
     AVFormatContext *ctx;
@@ -212,7 +246,20 @@ typedef struct HLSContext {
     int http_persistent;
     int http_multiple;
     int http_seekable;
+    int prefetch_segments;
+    int prefetch_threads;
+    int64_t prefetch_max_size;
     AVIOContext *playlist_pb;
+#if HAVE_THREADS
+    pthread_t *prefetch_workers;
+    int nb_prefetch_workers;
+    int prefetch_init;
+    atomic_int prefetch_quit;
+    int64_t prefetch_bytes;
+    pthread_mutex_t prefetch_lock;
+    pthread_cond_t prefetch_cond;
+    pthread_cond_t prefetch_done;
+#endif
 } HLSContext;
 
 static void free_segment_dynarray(struct segment **segments, int n_segments)
@@ -262,6 +309,7 @@ static void free_playlist_list(HLSContext *c)
         pls->input_read_done = 0;
         ff_format_io_close(c->ctx, &pls->input_next);
         pls->input_next_requested = 0;
+        av_freep(&pls->prefetch);
         if (pls->ctx) {
             pls->ctx->pb = NULL;
             avformat_close_input(&pls->ctx);
@@ -621,8 +669,11 @@ static int open_url_keepalive(AVFormatContext *s, AVIOContext **pb,
 #endif
 }
 
-static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+/* Open url with the I/O callbacks of s, or with the default ones and
+ * int_cb if set. */
+static int open_url_cb(AVFormatContext *s, AVIOContext **pb, const char *url,
+                       AVDictionary **opts, AVDictionary *opts2, int *is_http_out,
+                       const AVIOInterruptCB *int_cb)
 {
     HLSContext *c = s->priv_data;
     AVDictionary *tmp = NULL;
@@ -684,8 +735,13 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
                     url, av_err2str(ret));
             av_dict_copy(&tmp, *opts, 0);
             av_dict_copy(&tmp, opts2, 0);
-            ret = s->io_open(s, pb, url, AVIO_FLAG_READ, &tmp);
+            ret = int_cb ? ffio_open_whitelist(pb, url, AVIO_FLAG_READ, int_cb, &tmp,
+                                               s->protocol_whitelist, s->protocol_blacklist)
+                         : s->io_open(s, pb, url, AVIO_FLAG_READ, &tmp);
         }
+    } else if (int_cb) {
+        ret = ffio_open_whitelist(pb, url, AVIO_FLAG_READ, int_cb, &tmp,
+                                  s->protocol_whitelist, s->protocol_blacklist);
     } else {
         ret = s->io_open(s, pb, url, AVIO_FLAG_READ, &tmp);
     }
@@ -708,6 +764,12 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     return ret;
 }
 
+static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
+                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+{
+    return open_url_cb(s, pb, url, opts, opts2, is_http_out, NULL);
+}
+
 static int parse_playlist(HLSContext *c, const char *url,
                           struct playlist *pls, AVIOContext *in)
 {
@@ -1021,7 +1083,19 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->prefetch_cur) {
+        struct prefetch *pf = pls->prefetch_cur;
+
+        ret = FFMIN(buf_size, pf->len - pf->read_offset);
+        if (ret > 0) {
+            memcpy(buf, pf->buf + pf->read_offset, ret);
+            pf->read_offset += ret;
+        } else if (pf->ret < 0) {
+            ret = pf->ret;
+        }
+    } else {
+        ret = avio_read(pls->input, buf, buf_size);
+    }
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1370,6 +1444,424 @@ static int update_init_section(struct playlist *pls, struct segment *seg)
     return 0;
 }
 
+#if HAVE_THREADS
+static void prefetch_free(HLSContext *c, struct prefetch **ppf)
+{
+    struct prefetch *pf = *ppf;
+
+    if (!pf)
+        return;
+    c->prefetch_bytes -= pf->buf_size;
+    av_freep(&pf->buf);
+    av_freep(&pf->url);
+    av_dict_free(&pf->avio_opts);
+    av_freep(ppf);
+}
+
+/* Called with the lock held. A download in progress is left to the worker,
+ * which frees it once done. */
+static void prefetch_abandon(HLSContext *c, struct prefetch *pf)
+{
+    if (pf->state == PREFETCH_RUNNING)
+        pf->pls = NULL;
+    else
+        prefetch_free(c, &pf);
+}
+
+/* The interrupt callback of the caller is not called from the workers, which
+ * only run with the default I/O callbacks; their requests are aborted when
+ * prefetching stops. */
+static int prefetch_interrupt_cb(void *opaque)
+{
+    HLSContext *c = opaque;
+    return atomic_load(&c->prefetch_quit);
+}
+
+/* Download a whole segment into memory. The connection is kept in *pb for
+ * the next request of the worker if it can be reused. */
+static int prefetch_download(HLSContext *c, struct prefetch *pf, AVIOContext **pb)
+{
+    const AVIOInterruptCB int_cb = { prefetch_interrupt_cb, c };
+    AVDictionary *opts = NULL;
+    int is_http = 0;
+    int ret;
+
+    if (c->http_persistent)
+        av_dict_set(&opts, "multiple_requests", "1", 0);
+
+    if (pf->size >= 0) {
+        av_dict_set_int(&opts, "offset", pf->url_offset, 0);
+        av_dict_set_int(&opts, "end_offset", pf->url_offset + pf->size, 0);
+    }
+
+    av_log(c->ctx, AV_LOG_VERBOSE, "HLS prefetch request for url '%s', offset %"PRId64"\n",
+           pf->url, pf->url_offset);
+
+    ret = open_url_cb(c->ctx, pb, pf->url, &pf->avio_opts, opts, &is_http, &int_cb);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    /* see open_input() */
+    if (!is_http && pf->url_offset) {
+        int64_t seekret = avio_seek(*pb, pf->url_offset, SEEK_SET);
+        if (seekret < 0) {
+            ff_format_io_close(c->ctx, pb);
+            return seekret;
+        }
+    }
+
+    for (;;) {
+        int64_t want = INITIAL_BUFFER_SIZE;
+        unsigned int old_size = pf->buf_size, buf_size = pf->buf_size;
+        uint8_t *buf;
+
+        if (pf->size >= 0)
+            want = FFMIN(want, pf->size - pf->len);
+        if (want <= 0)
+            break;
+
+        /* on failure, the old buffer is kept and so is its size */
+        buf = av_fast_realloc(pf->buf, &buf_size, pf->len + want);
+        if (!buf) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        pf->buf      = buf;
+        pf->buf_size = buf_size;
+
+        pthread_mutex_lock(&c->prefetch_lock);
+        c->prefetch_bytes += pf->buf_size - old_size;
+        if (atomic_load(&c->prefetch_quit) || !pf->pls)
+            ret = AVERROR_EXIT;
+        pthread_mutex_unlock(&c->prefetch_lock);
+        if (ret < 0)
+            break;
+
+        ret = avio_read(*pb, pf->buf + pf->len, want);
+        if (ret <= 0)
+            break;
+        pf->len += ret;
+        ret = 0;
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+    if (ret < 0 || !is_http || !c->http_persistent)
+        ff_format_io_close(c->ctx, pb);
+
+    return ret;
+}
+
+/* Called with the lock held. The first queued segment of each window is
+ * served first and regardless of the memory cap, so that the segments
+ * being waited for always make progress. */
+static struct prefetch *prefetch_pick(HLSContext *c)
+{
+    int i, j;
+
+    for (i = 0; i < c->n_playlists; i++) {
+        struct playlist *pls = c->playlists[i];
+        for (j = 0; j < pls->n_prefetch; j++) {
+            if (pls->prefetch[j]->state == PREFETCH_QUEUED)
+                break;
+        }
+        if (j < pls->n_prefetch && !j)
+            return pls->prefetch[j];
+    }
+    if (c->prefetch_bytes >= c->prefetch_max_size)
+        return NULL;
+    for (i = 0; i < c->n_playlists; i++) {
+        struct playlist *pls = c->playlists[i];
+        for (j = 0; j < pls->n_prefetch; j++) {
+            if (pls->prefetch[j]->state == PREFETCH_QUEUED)
+                return pls->prefetch[j];
+        }
+    }
+    return NULL;
+}
+
+static void *prefetch_worker(void *arg)
+{
+    HLSContext *c = arg;
+    AVIOContext *pb = NULL;
+
+    pthread_mutex_lock(&c->prefetch_lock);
+    while (!atomic_load(&c->prefetch_quit)) {
+        struct prefetch *pf = prefetch_pick(c);
+        int ret;
+
+        if (!pf) {
+            pthread_cond_wait(&c->prefetch_cond, &c->prefetch_lock);
+            continue;
+        }
+
+        pf->state = PREFETCH_RUNNING;
+        pthread_mutex_unlock(&c->prefetch_lock);
+
+        ret = prefetch_download(c, pf, &pb);
+
+        pthread_mutex_lock(&c->prefetch_lock);
+        pf->ret   = ret;
+        pf->state = PREFETCH_DONE;
+        if (!pf->pls) {
+            prefetch_free(c, &pf);
+            pthread_cond_broadcast(&c->prefetch_cond);
+        }
+        pthread_cond_broadcast(&c->prefetch_done);
+    }
+    pthread_mutex_unlock(&c->prefetch_lock);
+
+    ff_format_io_close(c->ctx, &pb);
+    return NULL;
+}
+
+static int prefetch_start(HLSContext *c)
+{
+    int nb_threads = c->prefetch_threads ? c->prefetch_threads : c->prefetch_segments;
+    int ret;
+
+    c->prefetch_workers = av_calloc(nb_threads, sizeof(*c->prefetch_workers));
+    if (!c->prefetch_workers)
+        return AVERROR(ENOMEM);
+
+    if ((ret = pthread_mutex_init(&c->prefetch_lock, NULL))) {
+        av_freep(&c->prefetch_workers);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->prefetch_cond, NULL))) {
+        pthread_mutex_destroy(&c->prefetch_lock);
+        av_freep(&c->prefetch_workers);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->prefetch_done, NULL))) {
+        pthread_cond_destroy(&c->prefetch_cond);
+        pthread_mutex_destroy(&c->prefetch_lock);
+        av_freep(&c->prefetch_workers);
+        return AVERROR(ret);
+    }
+    atomic_init(&c->prefetch_quit, 0);
+    c->prefetch_init = 1;
+
+    for (; c->nb_prefetch_workers < nb_threads; c->nb_prefetch_workers++) {
+        ret = pthread_create(&c->prefetch_workers[c->nb_prefetch_workers], NULL,
+                             prefetch_worker, c);
+        if (ret) {
+            if (!c->nb_prefetch_workers)
+                return AVERROR(ret);
+            break;
+        }
+    }
+
+    av_log(c->ctx, AV_LOG_VERBOSE, "Prefetching %d segments per playlist with %d threads\n",
+           c->prefetch_segments, c->nb_prefetch_workers);
+    return 0;
+}
+
+static void prefetch_flush(HLSContext *c, struct playlist *pls);
+
+static void prefetch_stop(HLSContext *c)
+{
+    int i;
+
+    if (!c->prefetch_init)
+        return;
+
+    /* also aborts the requests in progress */
+    pthread_mutex_lock(&c->prefetch_lock);
+    atomic_store(&c->prefetch_quit, 1);
+    pthread_cond_broadcast(&c->prefetch_cond);
+    pthread_mutex_unlock(&c->prefetch_lock);
+
+    for (i = 0; i < c->nb_prefetch_workers; i++)
+        pthread_join(c->prefetch_workers[i], NULL);
+    av_freep(&c->prefetch_workers);
+    c->nb_prefetch_workers = 0;
+
+    for (i = 0; i < c->n_playlists; i++)
+        prefetch_flush(c, c->playlists[i]);
+
+    pthread_cond_destroy(&c->prefetch_done);
+    pthread_cond_destroy(&c->prefetch_cond);
+    pthread_mutex_destroy(&c->prefetch_lock);
+    c->prefetch_init = 0;
+}
+
+static int compare_prefetch(const void *a, const void *b)
+{
+    const struct prefetch *pa = *(const struct prefetch * const *)a;
+    const struct prefetch *pb = *(const struct prefetch * const *)b;
+    return FFDIFFSIGN(pa->seq_no, pb->seq_no);
+}
+
+/* Called with the lock held. Make the window of the playlist hold the
+ * prefetch_segments segments starting at start. */
+static int prefetch_fill(HLSContext *c, struct playlist *pls, int64_t start)
+{
+    int64_t end = FFMIN(start + c->prefetch_segments,
+                        pls->start_seq_no + pls->n_segments);
+    int64_t seq_no;
+    int i, j;
+
+    if (!pls->prefetch) {
+        pls->prefetch = av_calloc(c->prefetch_segments, sizeof(*pls->prefetch));
+        if (!pls->prefetch)
+            return AVERROR(ENOMEM);
+    }
+
+    /* drop what left the window or changed with a playlist reload */
+    for (i = j = 0; i < pls->n_prefetch; i++) {
+        struct prefetch *pf = pls->prefetch[i];
+        struct segment *seg = NULL;
+
+        if (pf->seq_no >= start && pf->seq_no < end &&
+            pf->seq_no >= pls->start_seq_no)
+            seg = pls->segments[pf->seq_no - pls->start_seq_no];
+        if (seg && !strcmp(seg->url, pf->url) && seg->url_offset == pf->url_offset)
+            pls->prefetch[j++] = pf;
+        else
+            prefetch_abandon(c, pf);
+    }
+    pls->n_prefetch = j;
+
+    for (seq_no = FFMAX(start, pls->start_seq_no); seq_no < end; seq_no++) {
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+        struct prefetch *pf;
+
+        for (i = 0; i < j; i++) {
+            if (pls->prefetch[i]->seq_no == seq_no)
+                break;
+        }
+        if (i < j || seg->key_type != KEY_NONE)
+            continue;
+
+        pf = av_mallocz(sizeof(*pf));
+        if (!pf)
+            return AVERROR(ENOMEM);
+        pf->pls        = pls;
+        pf->seq_no     = seq_no;
+        pf->url_offset = seg->url_offset;
+        pf->size       = seg->size;
+        pf->url        = av_strdup(seg->url);
+        if (!pf->url || av_dict_copy(&pf->avio_opts, c->avio_opts, 0) < 0) {
+            prefetch_free(c, &pf);
+            return AVERROR(ENOMEM);
+        }
+        pls->prefetch[pls->n_prefetch++] = pf;
+    }
+    qsort(pls->prefetch, pls->n_prefetch, sizeof(*pls->prefetch), compare_prefetch);
+
+    pthread_cond_broadcast(&c->prefetch_cond);
+    return 0;
+}
+
+/*
+ * Take the current segment of the playlist from the prefetch window,
+ * waiting for its download to finish, and queue the following ones.
+ * Returns AVERROR(ENOSYS) if the segment is to be opened directly.
+ */
+static int prefetch_current(HLSContext *c, struct playlist *pls)
+{
+    struct prefetch *pf = NULL;
+    int ret;
+
+    if (!c->prefetch_init && !ff_format_io_is_default(c->ctx)) {
+        av_log(c->ctx, AV_LOG_WARNING, "Segment prefetching is not supported "
+               "with custom I/O callbacks, disabling it\n");
+        c->prefetch_segments = 0;
+        return AVERROR(ENOSYS);
+    }
+    if (!c->prefetch_init && (ret = prefetch_start(c)) < 0) {
+        av_log(c->ctx, AV_LOG_WARNING, "Could not start segment prefetching: %s\n",
+               av_err2str(ret));
+        c->prefetch_segments = 0;
+        return AVERROR(ENOSYS);
+    }
+
+    pthread_mutex_lock(&c->prefetch_lock);
+    ret = prefetch_fill(c, pls, pls->cur_seq_no);
+    if (ret >= 0 && pls->n_prefetch && pls->prefetch[0]->seq_no == pls->cur_seq_no)
+        pf = pls->prefetch[0];
+    while (pf && pf->state != PREFETCH_DONE) {
+        int64_t t = av_gettime() + 100000;
+        struct timespec tv = { .tv_sec  =  t / 1000000,
+                               .tv_nsec = (t % 1000000) * 1000 };
+        pthread_cond_timedwait(&c->prefetch_done, &c->prefetch_lock, &tv);
+        if (ff_check_interrupt(c->interrupt_callback)) {
+            pthread_mutex_unlock(&c->prefetch_lock);
+            return AVERROR_EXIT;
+        }
+    }
+    if (pf) {
+        const AVDictionaryEntry *e = av_dict_get(pf->avio_opts, "cookies", NULL, 0);
+
+        /* the cookies set by the server apply to the following requests */
+        if (e && av_dict_set(&c->avio_opts, "cookies", e->value, 0) < 0)
+            av_log(c->ctx, AV_LOG_WARNING, "Failed to keep the cookies of '%s'\n", pf->url);
+        memmove(pls->prefetch, pls->prefetch + 1, --pls->n_prefetch * sizeof(*pls->prefetch));
+        /* a download that failed before getting any data fails the segment,
+         * a partial one is read like a connection dropping mid-segment */
+        if (pf->ret < 0 && !pf->len) {
+            ret = pf->ret;
+            prefetch_free(c, &pf);
+        }
+        /* the slot is free, queue the next segment */
+        if (prefetch_fill(c, pls, pls->cur_seq_no + 1) < 0)
+            av_log(c->ctx, AV_LOG_WARNING, "Failed to queue segments for prefetching\n");
+    }
+    pthread_mutex_unlock(&c->prefetch_lock);
+
+    if (!pf)
+        return ret < 0 ? ret : AVERROR(ENOSYS);
+
+    pls->prefetch_cur = pf;
+    pls->cur_seg_offset = 0;
+    return 0;
+}
+
+/* Drop the prefetch window of a playlist, e.g. after seeking. */
+static void prefetch_flush(HLSContext *c, struct playlist *pls)
+{
+    int i;
+
+    if (!c->prefetch_init)
+        return;
+
+    pthread_mutex_lock(&c->prefetch_lock);
+    prefetch_free(c, &pls->prefetch_cur);
+    for (i = 0; i < pls->n_prefetch; i++)
+        prefetch_abandon(c, pls->prefetch[i]);
+    pls->n_prefetch = 0;
+    pthread_cond_broadcast(&c->prefetch_cond);
+    pthread_mutex_unlock(&c->prefetch_lock);
+}
+
+static void prefetch_release(HLSContext *c, struct playlist *pls)
+{
+    pthread_mutex_lock(&c->prefetch_lock);
+    prefetch_free(c, &pls->prefetch_cur);
+    pthread_cond_broadcast(&c->prefetch_cond);
+    pthread_mutex_unlock(&c->prefetch_lock);
+}
+#else
+static int prefetch_current(HLSContext *c, struct playlist *pls)
+{
+    return AVERROR(ENOSYS);
+}
+
+static void prefetch_stop(HLSContext *c)
+{
+}
+
+static void prefetch_flush(HLSContext *c, struct playlist *pls)
+{
+}
+
+static void prefetch_release(HLSContext *c, struct playlist *pls)
+{
+}
+#endif /* HAVE_THREADS */
+
 static int64_t default_reload_interval(struct playlist *pls)
 {
     return pls->n_segments > 0 ?
@@ -1436,7 +1928,7 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input || (c->http_persistent && v->input_read_done)) {
+    if ((!v->input && !v->prefetch_cur) || (c->http_persistent && v->input_read_done)) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1507,7 +1999,12 @@ reload:
         if (ret)
             return ret;
 
-        if (c->http_multiple == 1 && v->input_next_requested) {
+        if (c->prefetch_segments > 0 && seg->key_type == KEY_NONE &&
+            (ret = prefetch_current(c, v)) != AVERROR(ENOSYS)) {
+            /* the segment comes from memory, the connection is not needed */
+            if (ret >= 0)
+                ff_format_io_close(v->parent, &v->input);
+        } else if (c->http_multiple == 1 && v->input_next_requested) {
             FFSWAP(AVIOContext *, v->input, v->input_next);
             v->cur_seg_offset = 0;
             v->input_next_requested = 0;
@@ -1527,7 +2024,7 @@ reload:
         just_opened = 1;
     }
 
-    if (c->http_multiple == -1) {
+    if (c->http_multiple == -1 && v->input) {
         uint8_t *http_version_opt = NULL;
         int r = av_opt_get(v->input, "http_version", AV_OPT_SEARCH_CHILDREN, &http_version_opt);
         if (r >= 0) {
@@ -1537,7 +2034,7 @@ reload:
     }
 
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !v->input_next_requested && c->prefetch_segments <= 0 &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1570,7 +2067,9 @@ reload:
 
         return ret;
     }
-    if (c->http_persistent &&
+    if (v->prefetch_cur) {
+        prefetch_release(c, v);
+    } else if (c->http_persistent &&
         seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
     } else {
@@ -1708,7 +2207,8 @@ static int save_avio_options(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
     static const char * const opts[] = {
-        "headers", "http_proxy", "user_agent", "cookies", "referer", "rw_timeout", "icy", NULL };
+        "headers", "http_proxy", "user_agent", "cookies", "referer", "rw_timeout", "icy",
+        "connection_pool", NULL };
     const char * const * opt = opts;
     uint8_t *buf;
     int ret = 0;
@@ -1845,6 +2345,7 @@ static int hls_close(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
 
+    prefetch_stop(c);
     free_playlist_list(c);
     free_variant_list(c);
     free_rendition_list(c);
@@ -2098,6 +2599,7 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next_requested = 0;
+            prefetch_flush(c, pls);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -2338,6 +2840,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
+        prefetch_flush(c, pls);
         av_packet_unref(pls->pkt);
         pls->pb.eof_reached = 0;
         /* Clear any buffered data */
@@ -2399,6 +2902,12 @@ static const AVOption hls_options[] = {
         OFFSET(http_multiple), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, FLAGS},
     {"http_seekable", "Use HTTP partial requests, 0 = disable, 1 = enable, -1 = auto",
         OFFSET(http_seekable), AV_OPT_TYPE_BOOL, { .i64 = -1}, -1, 1, FLAGS},
+    {"prefetch_segments", "Number of segments per playlist to download ahead in background threads, 0 = disable",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
+    {"prefetch_threads", "Number of threads downloading prefetched segments, 0 = same as prefetch_segments",
+        OFFSET(prefetch_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
+    {"prefetch_max_size", "Maximum amount of memory used by prefetched segments",
+        OFFSET(prefetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
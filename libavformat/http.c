@@ -21,6 +21,8 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
+
 #if CONFIG_ZLIB
 #include <zlib.h>
 #endif /* CONFIG_ZLIB */
@@ -31,6 +33,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -52,6 +55,8 @@
 #define HTTP_MUTLI    2
 #define MAX_EXPIRY    19
 #define WHITESPACES " \n\t\r"
+#define POOL_MAX_IDLE      16
+#define POOL_IDLE_TIMEOUT  (30 * 1000000)
 typedef enum {
     LOWER_PROTO,
     READ_HEADERS,
@@ -59,6 +64,18 @@ typedef enum {
     FINISH
 }HandshakeState;
 
+/* A connection opened with the connection_pool option. The lower protocol
+ * is opened with an interrupt callback pointing here, which forwards to the
+ * callback of the current owner, so that the connection can outlive the
+ * context which opened it. */
+typedef struct HTTPPoolConn {
+    URLContext *hd;
+    AVIOInterruptCB int_cb;
+    char *key;
+    int nb_requests;
+    int64_t idle_since;
+} HTTPPoolConn;
+
 typedef struct HTTPContext {
     const AVClass *class;
     URLContext *hd;
@@ -76,6 +93,8 @@ typedef struct HTTPContext {
     char *headers;
     char *mime_type;
     char *http_version;
+    char *etag;
+    char *last_modified;
     char *user_agent;
     char *referer;
     char *content_type;
@@ -126,6 +145,12 @@ typedef struct HTTPContext {
     int is_multi_client;
     HandshakeState handshake_step;
     int is_connected_server;
+    int connection_pool;
+    HTTPPoolConn *conn;
+    int range_cache;
+    int range_block_size;
+    int range_parallel;
+    struct HTTPRangeCache *rc;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -145,9 +170,15 @@ static const AVOption options[] = {
     { "user-agent", "use the \"user_agent\" option instead", OFFSET(user_agent), AV_OPT_TYPE_STRING, { .str = DEFAULT_USER_AGENT }, 0, 0, D|AV_OPT_FLAG_DEPRECATED },
 #endif
     { "multiple_requests", "use persistent connections", OFFSET(multiple_requests), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D | E },
+    { "range_cache", "number of blocks fetched with range requests to cache, 0 = disable", OFFSET(range_cache), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1024, D },
+    { "range_block_size", "size of the blocks of the range cache", OFFSET(range_block_size), AV_OPT_TYPE_INT, { .i64 = 512 * 1024 }, 4096, 64 * 1024 * 1024, D },
+    { "range_parallel", "number of parallel range requests", OFFSET(range_parallel), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, 16, D },
+    { "connection_pool", "share persistent connections with other contexts of the process", OFFSET(connection_pool), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
     { "post_data", "set custom HTTP post data", OFFSET(post_data), AV_OPT_TYPE_BINARY, .flags = D | E },
     { "mime_type", "export the MIME type", OFFSET(mime_type), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { "http_version", "export the http response version", OFFSET(http_version), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "etag", "export the ETag of the resource", OFFSET(etag), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "last_modified", "export the modification date of the resource", OFFSET(last_modified), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { "cookies", "set cookies to be sent in applicable future requests, use newline delimited Set-Cookie HTTP field value syntax", OFFSET(cookies), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
     { "icy", "request ICY metadata", OFFSET(icy), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, D },
     { "icy_metadata_headers", "return ICY metadata headers", OFFSET(icy_metadata_headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT },
@@ -178,6 +209,167 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                         const char *proxyauth, int *new_location);
 static int http_read_header(URLContext *h, int *new_location);
 static int http_shutdown(URLContext *h, int flags);
+static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int force_reconnect);
+static int range_init(URLContext *h);
+static int range_read(URLContext *h, uint8_t *buf, int size);
+static void range_free(HTTPContext *s);
+
+static AVMutex pool_lock = AV_MUTEX_INITIALIZER;
+static HTTPPoolConn *pool[POOL_MAX_IDLE];
+static int nb_pool;
+static AVIOConnectionPoolStats pool_stats;
+
+static int pool_interrupt_cb(void *opaque)
+{
+    HTTPPoolConn *conn = opaque;
+    return conn->int_cb.callback ? conn->int_cb.callback(conn->int_cb.opaque) : 0;
+}
+
+static void close_connection(URLContext **hd, HTTPPoolConn **conn)
+{
+    ffurl_closep(hd);
+    if (*conn)
+        av_freep(&(*conn)->key);
+    av_freep(conn);
+}
+
+/* Connections are only shared between requests made with the same options
+ * for the lower protocols, e.g. the TLS certificates and verification, and
+ * the same protocol lists. */
+static int pool_key(URLContext *h, const char *lower_url,
+                    AVDictionary *options, char **key)
+{
+    AVBPrint bp;
+    char *opts;
+    int ret;
+
+    if ((ret = av_dict_get_string(options, &opts, '=', ',')) < 0)
+        return ret;
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&bp, "%s|%s|%s|%s", lower_url, opts,
+               h->protocol_whitelist ? h->protocol_whitelist : "",
+               h->protocol_blacklist ? h->protocol_blacklist : "");
+    av_free(opts);
+    return av_bprint_finalize(&bp, key);
+}
+
+/* Take an idle connection to lower_url from the pool, or open a new one. */
+static int pool_open(URLContext *h, const char *lower_url,
+                     AVDictionary **options, int reuse)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPPoolConn *conn = NULL;
+    char *key;
+    int64_t start;
+    int i, err;
+
+    if ((err = pool_key(h, lower_url, *options, &key)) < 0)
+        return err;
+
+    ff_mutex_lock(&pool_lock);
+    start = av_gettime_relative();
+    for (i = nb_pool - 1; reuse && i >= 0; i--) {
+        if (!strcmp(pool[i]->key, key) &&
+            start - pool[i]->idle_since < POOL_IDLE_TIMEOUT) {
+            conn = pool[i];
+            memmove(&pool[i], &pool[i + 1], (nb_pool - i - 1) * sizeof(*pool));
+            nb_pool--;
+            pool_stats.nb_hits++;
+            pool_stats.nb_idle = nb_pool;
+            break;
+        }
+    }
+    ff_mutex_unlock(&pool_lock);
+
+    if (!conn) {
+        conn = av_mallocz(sizeof(*conn));
+        if (!conn) {
+            av_free(key);
+            return AVERROR(ENOMEM);
+        }
+        conn->key    = key;
+        conn->int_cb = h->interrupt_callback;
+        err = ffurl_open_whitelist(&conn->hd, lower_url, AVIO_FLAG_READ_WRITE,
+                                   &(AVIOInterruptCB){ pool_interrupt_cb, conn },
+                                   options, h->protocol_whitelist,
+                                   h->protocol_blacklist, h);
+        if (err < 0) {
+            close_connection(&conn->hd, &conn);
+            return err;
+        }
+        start = av_gettime_relative() - start;
+
+        ff_mutex_lock(&pool_lock);
+        pool_stats.nb_misses++;
+        pool_stats.connect_time    += start;
+        pool_stats.max_connect_time = FFMAX(pool_stats.max_connect_time, start);
+        ff_mutex_unlock(&pool_lock);
+    } else {
+        av_free(key);
+        av_log(h, AV_LOG_DEBUG, "Reusing pooled connection to %s\n", lower_url);
+    }
+
+    conn->int_cb = h->interrupt_callback;
+    s->conn = conn;
+    s->hd   = conn->hd;
+    return 0;
+}
+
+/* Give the connection of a context whose last response was fully read back
+ * to the pool, closing the oldest and the expired idle connections. */
+static void pool_put(HTTPContext *s)
+{
+    HTTPPoolConn *expired[POOL_MAX_IDLE];
+    int64_t now = av_gettime_relative();
+    int i, j, nb_expired = 0;
+
+    s->conn->int_cb     = (AVIOInterruptCB){ 0 };
+    s->conn->idle_since = now;
+
+    ff_mutex_lock(&pool_lock);
+    for (i = j = 0; i < nb_pool; i++) {
+        if (now - pool[i]->idle_since >= POOL_IDLE_TIMEOUT)
+            expired[nb_expired++] = pool[i];
+        else
+            pool[j++] = pool[i];
+    }
+    nb_pool = j;
+    if (nb_pool == POOL_MAX_IDLE) {
+        expired[nb_expired++] = pool[0];
+        memmove(&pool[0], &pool[1], --nb_pool * sizeof(*pool));
+    }
+    pool[nb_pool++] = s->conn;
+    pool_stats.nb_idle = nb_pool;
+    ff_mutex_unlock(&pool_lock);
+
+    s->conn = NULL;
+    s->hd   = NULL;
+    for (i = 0; i < nb_expired; i++)
+        close_connection(&expired[i]->hd, &expired[i]);
+}
+
+void ff_http_get_pool_stats(AVIOConnectionPoolStats *stats)
+{
+    ff_mutex_lock(&pool_lock);
+    *stats = pool_stats;
+    ff_mutex_unlock(&pool_lock);
+}
+
+void ff_http_pool_close(void)
+{
+    HTTPPoolConn *idle[POOL_MAX_IDLE];
+    int i, nb_idle;
+
+    ff_mutex_lock(&pool_lock);
+    nb_idle = nb_pool;
+    memcpy(idle, pool, nb_pool * sizeof(*pool));
+    nb_pool = 0;
+    pool_stats.nb_idle = 0;
+    ff_mutex_unlock(&pool_lock);
+
+    for (i = 0; i < nb_idle; i++)
+        close_connection(&idle[i]->hd, &idle[i]);
+}
 
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
 {
@@ -250,15 +442,36 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
-        err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                                   &h->interrupt_callback, options,
-                                   h->protocol_whitelist, h->protocol_blacklist, h);
+        if (s->connection_pool)
+            err = pool_open(h, buf, options, 1);
+        else
+            err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
+                                       &h->interrupt_callback, options,
+                                       h->protocol_whitelist, h->protocol_blacklist, h);
         if (err < 0)
             return err;
     }
 
+    /* reset here too, http_connect() only does it once the request is sent */
+    s->line_count = 0;
     err = http_connect(h, path, local_path, hoststr,
                        auth, proxyauth, &location_changed);
+    if (err < 0 && s->conn && s->conn->nb_requests && !s->line_count &&
+        err != AVERROR_EXIT) {
+        /* The server closed the connection while it was idle: retry once
+         * on a new one. */
+        av_log(h, AV_LOG_DEBUG, "Pooled connection to %s was closed, reconnecting\n", buf);
+        ff_mutex_lock(&pool_lock);
+        pool_stats.nb_stale++;
+        ff_mutex_unlock(&pool_lock);
+        close_connection(&s->hd, &s->conn);
+        if ((err = pool_open(h, buf, options, 0)) < 0)
+            return err;
+        err = http_connect(h, path, local_path, hoststr,
+                           auth, proxyauth, &location_changed);
+    }
+    if (s->conn)
+        s->conn->nb_requests++;
     if (err < 0)
         return err;
 
@@ -329,7 +542,7 @@ redo:
         /* restore the offset (http_connect resets it) */
         s->off = off;
 
-        ffurl_closep(&s->hd);
+        close_connection(&s->hd, &s->conn);
         goto redo;
     }
 
@@ -337,7 +550,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            close_connection(&s->hd, &s->conn);
             goto redo;
         } else
             goto fail;
@@ -345,7 +558,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            close_connection(&s->hd, &s->conn);
             goto redo;
         } else
             goto fail;
@@ -354,7 +567,7 @@ redo:
          s->http_code == 303 || s->http_code == 307 || s->http_code == 308) &&
         location_changed == 1) {
         /* url moved, get next */
-        ffurl_closep(&s->hd);
+        close_connection(&s->hd, &s->conn);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
         /* Restart the authentication process with the new target, which
@@ -368,7 +581,7 @@ redo:
 
 fail:
     if (s->hd)
-        ffurl_closep(&s->hd);
+        close_connection(&s->hd, &s->conn);
     if (location_changed < 0)
         return location_changed;
     return ff_http_averror(s->http_code, AVERROR(EIO));
@@ -615,7 +828,7 @@ static int http_open(URLContext *h, const char *uri, int flags,
                      AVDictionary **options)
 {
     HTTPContext *s = h->priv_data;
-    int ret;
+    int range, ret;
 
     if( s->seekable == 1 )
         h->is_streamed = 0;
@@ -646,7 +859,26 @@ static int http_open(URLContext *h, const char *uri, int flags,
     if (s->listen) {
         return http_listen(h, uri, flags, options);
     }
+    /* limit the initial request to the first block of the range cache */
+    range = HAVE_THREADS && s->range_cache > 0 && !(flags & AVIO_FLAG_WRITE) &&
+            s->seekable && !s->end_off;
+    if (range)
+        s->end_off = s->off - s->off % s->range_block_size + s->range_block_size;
     ret = http_open_cnx(h, options);
+    if (range && ret >= 0) {
+        if (s->http_code == 206 && !h->is_streamed && s->filesize != UINT64_MAX) {
+            ret = range_init(h);
+            if (ret != AVERROR(ENOSYS))
+                goto bail_out;
+        }
+        /* no range cache, reopen without the limit if the server honored it */
+        s->end_off = 0;
+        ret = 0;
+        if (s->http_code == 206) {
+            int64_t pos = http_seek_internal(h, s->off, SEEK_SET, 1);
+            ret = pos < 0 ? pos : 0;
+        }
+    }
 bail_out:
     if (ret < 0)
         av_dict_free(&s->chained_options);
@@ -1095,6 +1327,12 @@ static int process_line(URLContext *h, char *line, int line_count,
         } else if (!av_strcasecmp(tag, "Content-Type")) {
             av_free(s->mime_type);
             s->mime_type = av_strdup(p);
+        } else if (!av_strcasecmp(tag, "ETag")) {
+            av_free(s->etag);
+            s->etag = av_strdup(p);
+        } else if (!av_strcasecmp(tag, "Last-Modified")) {
+            av_free(s->last_modified);
+            s->last_modified = av_strdup(p);
         } else if (!av_strcasecmp(tag, "Set-Cookie")) {
             if (parse_cookie(s, p, &s->cookie_dict))
                 av_log(h, AV_LOG_WARNING, "Unable to parse '%s'\n", p);
@@ -1353,7 +1591,8 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
         av_bprintf(&request, "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: "))
-        av_bprintf(&request, "Connection: %s\r\n", s->multiple_requests ? "keep-alive" : "close");
+        av_bprintf(&request, "Connection: %s\r\n",
+                   s->multiple_requests || s->connection_pool ? "keep-alive" : "close");
 
     if (!has_header(s->headers, "\r\nHost: "))
         av_bprintf(&request, "Host: %s\r\n", hoststr);
@@ -1458,14 +1697,14 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
                    "Chunked encoding data size: %"PRIu64"\n",
                     s->chunksize);
 
-            if (!s->chunksize && s->multiple_requests) {
+            if (!s->chunksize && (s->multiple_requests || s->connection_pool)) {
                 http_get_line(s, line, sizeof(line)); // read empty chunk
                 s->chunkend = 1;
                 return 0;
             }
             else if (!s->chunksize) {
                 av_log(h, AV_LOG_DEBUG, "Last chunk received, closing conn\n");
-                ffurl_closep(&s->hd);
+                close_connection(&s->hd, &s->conn);
                 return 0;
             }
             else if (s->chunksize == UINT64_MAX) {
@@ -1541,8 +1780,6 @@ static int http_buf_read_compressed(URLContext *h, uint8_t *buf, int size)
 }
 #endif /* CONFIG_ZLIB */
 
-static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int force_reconnect);
-
 static int http_read_stream(URLContext *h, uint8_t *buf, int size)
 {
     HTTPContext *s = h->priv_data;
@@ -1681,6 +1918,9 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
 {
     HTTPContext *s = h->priv_data;
 
+    if (s->rc)
+        return range_read(h, buf, size);
+
     if (s->icy_metaint > 0) {
         size = store_icy(h, size);
         if (size < 0)
@@ -1749,11 +1989,406 @@ static int http_shutdown(URLContext *h, int flags)
     return ret;
 }
 
+/* Whether the connection can carry another request: the server keeps it
+ * open and the whole response body has been read. */
+static int http_conn_reusable(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    if ((h->flags & AVIO_FLAG_WRITE) || s->willclose ||
+        s->buf_ptr != s->buf_end)
+        return 0;
+    if (s->chunksize != UINT64_MAX)
+        return s->chunkend;
+    return s->off >= (s->end_off ? s->end_off : s->filesize);
+}
+
+#if HAVE_THREADS
+enum RangeBlockState {
+    BLOCK_UNUSED,
+    BLOCK_QUEUED,
+    BLOCK_FETCHING,
+    BLOCK_DONE,
+    BLOCK_ERROR,
+};
+
+typedef struct RangeBlock {
+    int64_t index;
+    enum RangeBlockState state;
+    uint8_t *data;
+    int size;
+    int err;
+    uint64_t last_use;
+} RangeBlock;
+
+/* Blocks of a seekable resource, fetched with byte-range requests by worker
+ * threads and kept in a small LRU cache. */
+typedef struct HTTPRangeCache {
+    URLContext *h;
+    char *url;
+    AVDictionary *opts;
+    int64_t block_size;
+    uint64_t filesize;
+
+    RangeBlock *blocks;
+    int nb_blocks;
+    pthread_t *workers;
+    int nb_workers;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    atomic_int quit;
+
+    uint64_t tick;
+    int64_t cur_block;
+    int64_t last_block;
+} HTTPRangeCache;
+
+/* The interrupt callback of the caller is only called from its thread, by
+ * range_read(); the requests of the workers are aborted on close. */
+static int range_interrupt_cb(void *opaque)
+{
+    HTTPRangeCache *rc = opaque;
+    return atomic_load(&rc->quit);
+}
+
+static RangeBlock *range_find(HTTPRangeCache *rc, int64_t index)
+{
+    for (int i = 0; i < rc->nb_blocks; i++)
+        if (rc->blocks[i].state != BLOCK_UNUSED && rc->blocks[i].index == index)
+            return &rc->blocks[i];
+    return NULL;
+}
+
+/* Queue a block for fetching, in a slot that is unused, or else holds the
+ * least recently used block, or else, for a block needed right away, the
+ * queued block farthest from the current one. */
+static RangeBlock *range_queue(HTTPRangeCache *rc, int64_t index, int needed)
+{
+    RangeBlock *blk = NULL, *lru = NULL, *far = NULL;
+
+    for (int i = 0; i < rc->nb_blocks; i++) {
+        RangeBlock *b = &rc->blocks[i];
+
+        if (b->state == BLOCK_UNUSED) {
+            blk = b;
+            break;
+        }
+        if ((b->state == BLOCK_DONE || b->state == BLOCK_ERROR) &&
+            b->index != rc->cur_block && (!lru || b->last_use < lru->last_use))
+            lru = b;
+        if (needed && b->state == BLOCK_QUEUED &&
+            (!far || FFABS(b->index - index) > FFABS(far->index - index)))
+            far = b;
+    }
+    if (!blk)
+        blk = lru ? lru : far;
+    if (!blk)
+        return NULL;
+
+    blk->index    = index;
+    blk->state    = BLOCK_QUEUED;
+    blk->size     = 0;
+    blk->err      = 0;
+    /* so that blocks read ahead are not the first ones evicted */
+    blk->last_use = ++rc->tick;
+    pthread_cond_broadcast(&rc->cond);
+    return blk;
+}
+
+static int range_fetch(HTTPRangeCache *rc, URLContext **hd, RangeBlock *blk)
+{
+    int64_t start = blk->index * rc->block_size;
+    int64_t end   = FFMIN(start + rc->block_size, rc->filesize);
+    AVDictionary *opts = NULL;
+    int ret;
+
+    av_dict_copy(&opts, rc->opts, 0);
+    av_dict_set_int(&opts, "offset", start, 0);
+    av_dict_set_int(&opts, "end_offset", end, 0);
+
+    ret = AVERROR(EINVAL);
+    if (*hd) {
+        ret = ff_http_do_new_request2(*hd, rc->url, &opts);
+        if (ret < 0)
+            ffurl_closep(hd);
+    }
+    if (!*hd)
+        ret = ffurl_open_whitelist(hd, rc->url, AVIO_FLAG_READ,
+                                   &(AVIOInterruptCB){ range_interrupt_cb, rc },
+                                   &opts, rc->h->protocol_whitelist,
+                                   rc->h->protocol_blacklist, rc->h);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    while (blk->size < end - start) {
+        ret = ffurl_read(*hd, blk->data + blk->size, end - start - blk->size);
+        if (ret == AVERROR_EOF || !ret)
+            break;
+        if (ret < 0) {
+            ffurl_closep(hd);
+            return ret;
+        }
+        blk->size += ret;
+    }
+    /* the connection was closed early, the block is fetched again on the
+     * next read */
+    if (blk->size < end - start) {
+        ffurl_closep(hd);
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
+static void *range_worker(void *arg)
+{
+    HTTPRangeCache *rc = arg;
+    URLContext *hd = NULL;
+
+    pthread_mutex_lock(&rc->lock);
+    while (!atomic_load(&rc->quit)) {
+        RangeBlock *blk = NULL;
+        int ret;
+
+        /* the queued block nearest to the one being read first */
+        for (int i = 0; i < rc->nb_blocks; i++) {
+            RangeBlock *b = &rc->blocks[i];
+            if (b->state == BLOCK_QUEUED && b->index >= rc->cur_block &&
+                (!blk || b->index < blk->index))
+                blk = b;
+        }
+        for (int i = 0; !blk && i < rc->nb_blocks; i++)
+            if (rc->blocks[i].state == BLOCK_QUEUED)
+                blk = &rc->blocks[i];
+        if (!blk) {
+            pthread_cond_wait(&rc->cond, &rc->lock);
+            continue;
+        }
+
+        blk->state = BLOCK_FETCHING;
+        pthread_mutex_unlock(&rc->lock);
+        ret = range_fetch(rc, &hd, blk);
+        pthread_mutex_lock(&rc->lock);
+
+        blk->state = ret < 0 ? BLOCK_ERROR : BLOCK_DONE;
+        blk->err   = ret;
+        pthread_cond_broadcast(&rc->cond);
+    }
+    pthread_mutex_unlock(&rc->lock);
+
+    ffurl_closep(&hd);
+    return NULL;
+}
+
+static void range_free(HTTPContext *s)
+{
+    HTTPRangeCache *rc = s->rc;
+
+    if (!rc)
+        return;
+
+    pthread_mutex_lock(&rc->lock);
+    atomic_store(&rc->quit, 1);
+    pthread_cond_broadcast(&rc->cond);
+    pthread_mutex_unlock(&rc->lock);
+    for (int i = 0; i < rc->nb_workers; i++)
+        pthread_join(rc->workers[i], NULL);
+    pthread_cond_destroy(&rc->cond);
+    pthread_mutex_destroy(&rc->lock);
+
+    for (int i = 0; i < rc->nb_blocks; i++)
+        av_free(rc->blocks[i].data);
+    av_free(rc->blocks);
+    av_free(rc->workers);
+    av_free(rc->url);
+    av_dict_free(&rc->opts);
+    av_freep(&s->rc);
+}
+
+/* Switch a freshly opened context to the range cache. The response of the
+ * initial request, limited to the first block, fills that block. */
+static int range_init(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPRangeCache *rc;
+    RangeBlock *blk;
+    uint64_t off = s->off;
+    int ret;
+
+#if CONFIG_ZLIB
+    if (s->compressed)
+        return AVERROR(ENOSYS);
+#endif
+    rc = s->rc = av_mallocz(sizeof(*rc));
+    if (!rc)
+        return AVERROR(ENOMEM);
+    atomic_init(&rc->quit, 0);
+    rc->h          = h;
+    rc->block_size = s->range_block_size;
+    rc->filesize   = s->filesize;
+    rc->nb_blocks  = FFMAX(s->range_cache, s->range_parallel + 2);
+    rc->cur_block  = off / rc->block_size;
+    rc->last_block = rc->cur_block;
+
+    rc->url     = av_strdup(s->location);
+    rc->blocks  = av_calloc(rc->nb_blocks, sizeof(*rc->blocks));
+    rc->workers = av_calloc(s->range_parallel, sizeof(*rc->workers));
+    if (!rc->url || !rc->blocks || !rc->workers) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (int i = 0; i < rc->nb_blocks; i++) {
+        rc->blocks[i].data = av_malloc(rc->block_size);
+        if (!rc->blocks[i].data) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+    av_dict_copy(&rc->opts, s->chained_options, 0);
+    av_dict_set(&rc->opts, "range_cache", "0", 0);
+    av_dict_set(&rc->opts, "multiple_requests", "1", 0);
+    av_dict_set(&rc->opts, "seekable", "1", 0);
+    if (s->cookies)
+        av_dict_set(&rc->opts, "cookies", s->cookies, 0);
+
+    /* unless the initial offset is not aligned, in which case the block is
+     * fetched again, as it is when the response ends early */
+    blk = &rc->blocks[0];
+    if (!(off % rc->block_size)) {
+        int64_t end = FFMIN(off + rc->block_size, rc->filesize);
+
+        while (blk->size < end - off) {
+            ret = http_read_stream(h, blk->data + blk->size, end - off - blk->size);
+            if (ret == AVERROR_EXIT)
+                goto fail;
+            if (ret <= 0)
+                break;
+            blk->size += ret;
+        }
+        if (blk->size == end - off) {
+            blk->index    = rc->cur_block;
+            blk->state    = BLOCK_DONE;
+            blk->last_use = ++rc->tick;
+        } else {
+            blk->size = 0;
+        }
+    }
+    if (s->conn && http_conn_reusable(h))
+        pool_put(s);
+    close_connection(&s->hd, &s->conn);
+    s->off = off;
+
+    if ((ret = pthread_mutex_init(&rc->lock, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&rc->cond, NULL))) {
+        pthread_mutex_destroy(&rc->lock);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    for (; rc->nb_workers < s->range_parallel; rc->nb_workers++) {
+        if ((ret = pthread_create(&rc->workers[rc->nb_workers], NULL, range_worker, rc))) {
+            range_free(s);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+
+fail:
+    close_connection(&s->hd, &s->conn);
+    for (int i = 0; rc->blocks && i < rc->nb_blocks; i++)
+        av_free(rc->blocks[i].data);
+    av_free(rc->blocks);
+    av_free(rc->workers);
+    av_free(rc->url);
+    av_dict_free(&rc->opts);
+    av_freep(&s->rc);
+    return ret;
+}
+
+static int range_read(URLContext *h, uint8_t *buf, int size)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPRangeCache *rc = s->rc;
+    int64_t index = s->off / rc->block_size;
+    RangeBlock *blk;
+    int ret;
+
+    if (s->off >= rc->filesize)
+        return AVERROR_EOF;
+
+    pthread_mutex_lock(&rc->lock);
+    rc->cur_block = index;
+    blk = range_find(rc, index);
+    if (!blk)
+        blk = range_queue(rc, index, 1);
+    /* read ahead only while the blocks are read in sequence */
+    if (index == rc->last_block + 1) {
+        for (int64_t i = index + 1; i <= index + rc->nb_workers &&
+                                    i * rc->block_size < rc->filesize; i++)
+            if (!range_find(rc, i) && !range_queue(rc, i, 0))
+                break;
+    }
+    rc->last_block = index;
+
+    while (blk && blk->state != BLOCK_DONE && blk->state != BLOCK_ERROR) {
+        int64_t t = av_gettime() + 100000;
+        struct timespec tv = { .tv_sec  =  t / 1000000,
+                               .tv_nsec = (t % 1000000) * 1000 };
+        pthread_cond_timedwait(&rc->cond, &rc->lock, &tv);
+        if (ff_check_interrupt(&h->interrupt_callback)) {
+            pthread_mutex_unlock(&rc->lock);
+            return AVERROR_EXIT;
+        }
+    }
+
+    if (!blk) {
+        ret = AVERROR_BUG;
+    } else if (blk->state == BLOCK_ERROR) {
+        /* let a later read try again */
+        ret = blk->err;
+        blk->state = BLOCK_UNUSED;
+    } else {
+        int64_t pos = s->off - index * rc->block_size;
+
+        ret = FFMIN(size, blk->size - pos);
+        if (ret <= 0) {
+            ret = AVERROR_EOF;
+        } else {
+            memcpy(buf, blk->data + pos, ret);
+            s->off += ret;
+        }
+        blk->last_use = ++rc->tick;
+    }
+    pthread_mutex_unlock(&rc->lock);
+
+    return ret;
+}
+#else
+static void range_free(HTTPContext *s)
+{
+}
+
+static int range_init(URLContext *h)
+{
+    return AVERROR(ENOSYS);
+}
+
+static int range_read(URLContext *h, uint8_t *buf, int size)
+{
+    return AVERROR(ENOSYS);
+}
+#endif /* HAVE_THREADS */
+
 static int http_close(URLContext *h)
 {
     int ret = 0;
     HTTPContext *s = h->priv_data;
 
+    range_free(s);
+
 #if CONFIG_ZLIB
     inflateEnd(&s->inflate_stream);
     av_freep(&s->inflate_buffer);
@@ -1763,8 +2398,10 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
+    if (s->conn && http_conn_reusable(h))
+        pool_put(s);
     if (s->hd)
-        ffurl_closep(&s->hd);
+        close_connection(&s->hd, &s->conn);
     av_dict_free(&s->chained_options);
     return ret;
 }
@@ -1773,6 +2410,7 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = s->hd;
+    HTTPPoolConn *old_conn = s->conn;
     uint64_t old_off = s->off;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size, ret;
@@ -1797,6 +2435,10 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         return AVERROR(EINVAL);
     s->off = off;
 
+    /* the range cache fetches whatever block the next read needs */
+    if (s->rc)
+        return off;
+
     if (s->off && h->is_streamed)
         return AVERROR(ENOSYS);
 
@@ -1810,7 +2452,8 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    s->hd   = NULL;
+    s->conn = NULL;
 
     /* if it fails, continue on old connection */
     if ((ret = http_open_cnx(h, &options)) < 0) {
@@ -1819,11 +2462,12 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
         s->hd      = old_hd;
+        s->conn    = old_conn;
         s->off     = old_off;
         return ret;
     }
     av_dict_free(&options);
-    ffurl_close(old_hd);
+    close_connection(&old_hd, &old_conn);
     return off;
 }
 
@@ -71,4 +71,14 @@ int ff_http_do_new_request2(URLContext *h, const char *uri, AVDictionary **optio
 
 int ff_http_averror(int status_code, int default_averror);
 
+/**
+ * Get the statistics of the process-wide pool of persistent connections.
+ */
+void ff_http_get_pool_stats(AVIOConnectionPoolStats *stats);
+
+/**
+ * Close the idle connections of the pool.
+ */
+void ff_http_pool_close(void);
+
 #endif /* AVFORMAT_HTTP_H */
@@ -542,6 +542,32 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
                        unsigned int *index_entries_allocated_size,
                        int64_t pos, int64_t timestamp, int size, int distance, int flags);
 
+/**
+ * The arguments of av_add_index_entry() for an entry of a batch. The size
+ * is not stored in an AVIndexEntry yet, which could not hold invalid ones.
+ */
+typedef struct FFIndexEntry {
+    int64_t pos;
+    int64_t timestamp;
+    int size;
+    int distance;
+    int flags;
+} FFIndexEntry;
+
+/**
+ * Add a batch of index entries to a stream, in any order.
+ *
+ * The result is the same as calling av_add_index_entry() for each entry in
+ * turn, but the entries are sorted and merged with the existing index in a
+ * single pass instead of being inserted one by one, which is quadratic when
+ * they do not arrive after the existing ones. Entries av_add_index_entry()
+ * would reject are skipped.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_add_index_entries(AVStream *st, const FFIndexEntry *entries,
+                         int nb_entries);
+
 void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance);
 
 /**
@@ -808,6 +834,15 @@ int ff_format_output_open(AVFormatContext *s, const char *url, AVDictionary **op
  */
 void ff_format_io_close(AVFormatContext *s, AVIOContext **pb);
 
+/**
+ * Check whether the I/O callbacks of the context are the default ones.
+ * Callbacks set by the caller may not expect to be called from other
+ * threads, so background downloads must not be made through them.
+ *
+ * @return 1 if the default callbacks are used, 0 otherwise
+ */
+int ff_format_io_is_default(AVFormatContext *s);
+
 /**
  * Utility function to check if the file uses http or https protocol
  *
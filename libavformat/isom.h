@@ -155,6 +155,22 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * Position in the sample tables of a lazily indexed stream.
+ */
+typedef struct MOVIndexCursor {
+    unsigned int sample;        ///< sample the cursor points to
+    unsigned int chunk;
+    unsigned int chunk_sample;  ///< index of the sample in its chunk
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    unsigned int distance;      ///< samples since the last keyframe
+    int64_t next_key;           ///< next keyframe, -1 if there is none
+    int64_t pos;
+    int64_t dts;
+} MOVIndexCursor;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -193,6 +209,12 @@ typedef struct MOVStreamContext {
     int64_t current_index;
     MOVIndexRange* index_ranges;
     MOVIndexRange* current_index_range;
+    int lazy_index;              ///< index_entries only hold a window of the samples
+    unsigned int lazy_count;     ///< number of samples of a lazily indexed stream
+    unsigned int index_base;     ///< sample number of index_entries[0]
+    int64_t first_dts;
+    int key_off;
+    MOVIndexCursor index_cursor; ///< sample following the index window
     unsigned int bytes_per_frame;
     unsigned int samples_per_frame;
     int dv_audio_container;
@@ -269,6 +291,7 @@ typedef struct MOVContext {
     int advanced_editlist;
     int ignore_chapters;
     int seek_individually;
+    int lazy_index;
     int64_t next_root_atom; ///< offset of the next root atom
     int export_all;
     int export_xmp;
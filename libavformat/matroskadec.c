@@ -1947,8 +1947,10 @@ static void matroska_add_index_entries(MatroskaDemuxContext *matroska)
 {
     EbmlList *index_list;
     MatroskaIndex *index;
+    FFIndexEntry *entries, *batch;
+    int *stream_idx;
     uint64_t index_scale = 1;
-    int i, j;
+    int i, j, n, nb_pos = 0;
 
     if (matroska->ctx->flags & AVFMT_FLAG_IGNIDX)
         return;
@@ -1961,19 +1963,47 @@ static void matroska_add_index_entries(MatroskaDemuxContext *matroska)
         av_log(matroska->ctx, AV_LOG_WARNING, "Dropping apparently-broken index.\n");
         return;
     }
-    for (i = 0; i < index_list->nb_elem; i++) {
+    for (i = 0; i < index_list->nb_elem; i++)
+        nb_pos += index[i].pos.nb_elem;
+
+    entries    = av_malloc_array(nb_pos, sizeof(*entries));
+    batch      = av_malloc_array(nb_pos, sizeof(*batch));
+    stream_idx = av_malloc_array(nb_pos, sizeof(*stream_idx));
+    if (!entries || !batch || !stream_idx)
+        goto end;
+
+    /* Cues may arrive after clusters already added entries to the index,
+     * so hand them over per stream in one batch rather than one by one. */
+    for (i = n = 0; i < index_list->nb_elem; i++) {
         EbmlList *pos_list    = &index[i].pos;
         MatroskaIndexPos *pos = pos_list->elem;
         for (j = 0; j < pos_list->nb_elem; j++) {
             MatroskaTrack *track = matroska_find_track_by_num(matroska,
                                                               pos[j].track);
-            if (track && track->stream)
-                av_add_index_entry(track->stream,
-                                   pos[j].pos + matroska->segment_start,
-                                   index[i].time / index_scale, 0, 0,
-                                   AVINDEX_KEYFRAME);
+            if (track && track->stream) {
+                stream_idx[n] = track->stream->index;
+                entries[n++]  = (FFIndexEntry) {
+                    .pos       = pos[j].pos + matroska->segment_start,
+                    .timestamp = index[i].time / index_scale,
+                    .flags     = AVINDEX_KEYFRAME,
+                };
+            }
         }
     }
+    nb_pos = n;
+
+    for (i = 0; i < matroska->ctx->nb_streams; i++) {
+        for (j = n = 0; j < nb_pos; j++)
+            if (stream_idx[j] == i)
+                batch[n++] = entries[j];
+        if (n)
+            ff_add_index_entries(matroska->ctx->streams[i], batch, n);
+    }
+
+end:
+    av_free(entries);
+    av_free(batch);
+    av_free(stream_idx);
 }
 
 static void matroska_parse_cues(MatroskaDemuxContext *matroska) {
@@ -3382,16 +3382,445 @@ static int64_t add_ctts_entry(MOVStts** ctts_data, unsigned int* ctts_count, uns
     return *ctts_count;
 }
 
+#define MOV_INDEX_WINDOW 4096
+
+/**
+ * Check whether mov_fix_index() would leave the index of a stream as it is:
+ * the edit list must be a single edit of the whole media from its start, and
+ * without ctts no sample is presented before or after it.
+ */
+static int mov_lazy_editlist_supported(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t media_time, duration, end = 0;
+    unsigned i;
+
+    if (sc->elst_count != 1 || sc->elst_data[0].rate != 1.0 || sc->ctts_count)
+        return 0;
+    if (!get_edit_list_entry(mov, sc, 0, &media_time, &duration, mov->time_scale) || media_time)
+        return 0;
+    for (i = 0; i < sc->stts_count; i++)
+        end = av_sat_add64(end, (int64_t)sc->stts_data[i].count * sc->stts_data[i].duration);
+    return duration >= FFMAX(end, st->duration);
+}
+
+/**
+ * Check whether the index of a stream can be built on demand: the sample
+ * tables must map one to one to the index entries, without any of the
+ * rewrites done by mov_fix_index() and the fixups of mov_build_index().
+ */
+static int mov_lazy_index_supported(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+    unsigned i, j;
+
+    if (st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
+        st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+        return 0;
+    /* uncompressed audio chunk demuxing */
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+        sc->stts_count == 1 && sc->stts_data[0].duration == 1)
+        return 0;
+    if (!sc->sample_count || !sc->chunk_count || !sc->stts_count || !sc->stsc_count ||
+        st->nb_index_entries || sc->rap_group_count)
+        return 0;
+    if (sc->elst_count && !mov->ignore_editlist && mov->advanced_editlist &&
+        !mov_lazy_editlist_supported(mov, st))
+        return 0;
+    /* the check for a too large stsz sample size depends on the chunk */
+    if (sc->sample_size > 0 && sc->sample_size < sc->stsz_sample_size)
+        return 0;
+    if (!sc->stsz_sample_size && !sc->sample_sizes)
+        return 0;
+
+    for (i = 0; i < sc->stts_count; i++)
+        if (sc->stts_data[i].duration < 0)
+            return 0;
+    if (sc->stsc_data[0].first != 1)
+        return 0;
+    for (i = 0; i < sc->stsc_count; i++)
+        if (!sc->stsc_data[i].count ||
+            (i && sc->stsc_data[i].first <= sc->stsc_data[i - 1].first) ||
+            (sc->pseudo_stream_id != -1 && sc->stsc_data[i].id - 1 != sc->pseudo_stream_id))
+            return 0;
+    for (i = 0; i < sc->keyframe_count; i++)
+        if (sc->keyframes[i] < key_off || (i && sc->keyframes[i] <= sc->keyframes[i - 1]))
+            return 0;
+    for (i = 0; i < sc->stps_count; i++)
+        if (sc->stps_data[i] < key_off || (i && sc->stps_data[i] <= sc->stps_data[i - 1]))
+            return 0;
+    /* a sample in both stss and stps stalls the stps lookup of mov_build_index() */
+    if (!sc->keyframe_absent) {
+        for (i = j = 0; i < sc->keyframe_count; i++) {
+            while (j < sc->stps_count && sc->stps_data[j] < sc->keyframes[i])
+                j++;
+            if (j < sc->stps_count && sc->stps_data[j] == sc->keyframes[i])
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Search a sorted stss or stps table.
+ * @return the closest value not greater than val if backward is set, not
+ *         lower than val otherwise, -1 if there is none
+ */
+static int64_t mov_search_sync_table(const unsigned *tab, unsigned count,
+                                     int64_t val, int backward)
+{
+    unsigned lo = 0, hi = count;
+
+    while (lo < hi) {
+        unsigned mid = (lo + hi) >> 1;
+        if (tab[mid] < val)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (!backward)
+        return lo < count ? tab[lo] : -1;
+    if (lo < count && tab[lo] == val)
+        return val;
+    return lo ? tab[lo - 1] : -1;
+}
+
+/**
+ * Find the keyframe closest to a sample of a lazily indexed stream.
+ * @return the keyframe, not after the sample if backward is set, not before
+ *         it otherwise, -1 if there is none
+ */
+static int64_t mov_lazy_find_keyframe(AVStream *st, int64_t sample, int backward)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t key = -1, stps_key;
+
+    if (sc->keyframe_absent && !sc->stps_count) {
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+            return sample;
+        return backward || !sample ? 0 : -1;
+    }
+    if (!sc->keyframe_absent && !sc->keyframe_count)
+        return sample;
+
+    if (!sc->keyframe_absent) {
+        key = mov_search_sync_table((const unsigned *)sc->keyframes, sc->keyframe_count,
+                                    sample + sc->key_off, backward);
+        if (key >= 0)
+            key -= sc->key_off;
+    }
+    if (sc->stps_count) {
+        stps_key = mov_search_sync_table(sc->stps_data, sc->stps_count,
+                                         sample + sc->key_off, backward);
+        if (stps_key >= 0) {
+            stps_key -= sc->key_off;
+            if (key < 0 || (backward ? stps_key > key : stps_key < key))
+                key = stps_key;
+        }
+    }
+    return key;
+}
+
+/**
+ * Point a cursor to a sample, walking the stts and stsc tables.
+ */
+static void mov_index_cursor_seek(AVStream *st, MOVIndexCursor *c, unsigned sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t n = 0, key;
+    unsigned i;
+
+    memset(c, 0, sizeof(*c));
+    c->sample = sample;
+    c->dts    = sc->first_dts;
+
+    for (i = 0; i < sc->stts_count; i++) {
+        unsigned count = sc->stts_data[i].count;
+        c->stts_index = i;
+        /* mov_build_index() never leaves an empty entry either */
+        if (i + 1 == sc->stts_count || !count || sample - n < count)
+            break;
+        c->dts += (int64_t)count * sc->stts_data[i].duration;
+        n += count;
+    }
+    c->stts_sample = sample - n;
+    c->dts += (int64_t)c->stts_sample * sc->stts_data[c->stts_index].duration;
+
+    for (i = n = 0; i < sc->stsc_count; i++) {
+        int64_t samples = mov_get_stsc_samples(sc, i);
+        c->stsc_index = i;
+        if (i + 1 == sc->stsc_count || sample - n < samples)
+            break;
+        n += samples;
+    }
+    c->chunk        = sc->stsc_data[c->stsc_index].first - 1 +
+                      (sample - n) / sc->stsc_data[c->stsc_index].count;
+    c->chunk_sample = (sample - n) % sc->stsc_data[c->stsc_index].count;
+
+    if (c->chunk < sc->chunk_count) {
+        c->pos = sc->chunk_offsets[c->chunk];
+        if (sc->stsz_sample_size > 0)
+            c->pos += (int64_t)c->chunk_sample * sc->stsz_sample_size;
+        else
+            for (i = sample - c->chunk_sample; i < sample; i++)
+                c->pos += (unsigned)sc->sample_sizes[i];
+    }
+
+    key = mov_lazy_find_keyframe(st, sample, 1);
+    c->distance = sample - FFMAX(key, 0);
+    c->next_key = mov_lazy_find_keyframe(st, sample, 0);
+}
+
+/**
+ * Fill the index entry of the sample a cursor points to, the same way
+ * mov_build_index() does, and move the cursor to the next sample.
+ */
+static void mov_index_cursor_next(AVStream *st, MOVIndexCursor *c, AVIndexEntry *e)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[c->sample];
+    int keyframe = c->sample == c->next_key;
+
+    if (keyframe) {
+        c->distance = 0;
+        c->next_key = mov_lazy_find_keyframe(st, c->sample + 1, 0);
+    }
+    e->pos          = c->pos;
+    e->timestamp    = c->dts;
+    e->size         = size;
+    e->min_distance = c->distance;
+    e->flags        = keyframe ? AVINDEX_KEYFRAME : 0;
+
+    c->pos += size;
+    c->dts += sc->stts_data[c->stts_index].duration;
+    c->distance++;
+    c->sample++;
+    c->stts_sample++;
+    if (c->stts_index + 1 < sc->stts_count && c->stts_sample == sc->stts_data[c->stts_index].count) {
+        c->stts_sample = 0;
+        c->stts_index++;
+    }
+    if (++c->chunk_sample == sc->stsc_data[c->stsc_index].count) {
+        c->chunk_sample = 0;
+        c->chunk++;
+        if (mov_stsc_index_valid(c->stsc_index, sc->stsc_count) &&
+            c->chunk + 1 == sc->stsc_data[c->stsc_index + 1].first)
+            c->stsc_index++;
+        if (c->chunk < sc->chunk_count)
+            c->pos = sc->chunk_offsets[c->chunk];
+    }
+}
+
+static void mov_fill_index_window(AVStream *st, unsigned sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned i, n = FFMIN(MOV_INDEX_WINDOW, sc->lazy_count - sample);
+
+    if (sc->index_cursor.sample != sample)
+        mov_index_cursor_seek(st, &sc->index_cursor, sample);
+    for (i = 0; i < n; i++)
+        mov_index_cursor_next(st, &sc->index_cursor, &st->index_entries[i]);
+    sc->index_base       = sample;
+    st->nb_index_entries = n;
+}
+
+/**
+ * Get the index entry of a sample. The index window of lazily indexed
+ * streams is moved to the sample if needed, so the entry is then only valid
+ * until the next call for the same stream.
+ *
+ * @return the entry, NULL if there is no such sample
+ */
+static AVIndexEntry *mov_get_index_entry(AVStream *st, int64_t sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (!sc->lazy_index)
+        return sample >= 0 && sample < st->nb_index_entries ? &st->index_entries[sample] : NULL;
+    if (sample < 0 || sample >= sc->lazy_count)
+        return NULL;
+    if (sample < sc->index_base || sample - sc->index_base >= st->nb_index_entries)
+        mov_fill_index_window(st, sample);
+    return &st->index_entries[sample - sc->index_base];
+}
+
+/**
+ * av_index_search_timestamp() for lazily indexed streams, looking the
+ * sample up in the stts table.
+ */
+static int mov_lazy_search_timestamp(AVStream *st, int64_t wanted, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int backward = flags & AVSEEK_FLAG_BACKWARD;
+    int64_t dts = sc->first_dts, last_dts = AV_NOPTS_VALUE;
+    int64_t n = 0, sample = -1;
+    unsigned i;
+
+    /* find the last sample with a dts not after the wanted one */
+    for (i = 0; i < sc->stts_count && n < sc->lazy_count && dts <= wanted; i++) {
+        int64_t count    = sc->lazy_count - n;
+        int64_t duration = sc->stts_data[i].duration;
+        int64_t k;
+
+        if (i + 1 < sc->stts_count && sc->stts_data[i].count)
+            count = FFMIN(count, sc->stts_data[i].count);
+        k = duration ? FFMIN((wanted - dts) / duration, count - 1) : count - 1;
+        sample   = n + k;
+        last_dts = dts + k * duration;
+        dts += count * duration;
+        n   += count;
+    }
+    if (!backward && (sample < 0 || last_dts != wanted))
+        sample++;
+    if (sample < 0 || sample >= sc->lazy_count)
+        return -1;
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        sample = mov_lazy_find_keyframe(st, sample, backward);
+    return sample < sc->lazy_count ? sample : -1;
+}
+
+/**
+ * Set up the on-demand index of a stream, see mov_get_index_entry().
+ */
+static void mov_init_lazy_index(MOVContext *mov, AVStream *st, int64_t first_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    uint64_t stream_size = 0;
+    int64_t chunk_samples = 0;
+    unsigned i, count;
+
+    if (sc->stsz_sample_size > 0 && sc->stsz_sample_size < sc->sample_size) {
+        av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
+        sc->stsz_sample_size = sc->sample_size;
+    }
+
+    for (i = 0; i < sc->stsc_count; i++)
+        chunk_samples += mov_get_stsc_samples(sc, i);
+    if (chunk_samples > sc->sample_count)
+        av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+    count = FFMIN(chunk_samples, sc->sample_count);
+
+    if (sc->stsz_sample_size > 0) {
+        if (sc->stsz_sample_size > 0x3FFFFFFF) {
+            av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", sc->stsz_sample_size);
+            return;
+        }
+        stream_size = (uint64_t)count * sc->stsz_sample_size;
+    } else {
+        for (i = 0; i < count; i++) {
+            unsigned size = sc->sample_sizes[i];
+            if (size > 0x3FFFFFFF) {
+                av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", size);
+                count = i;
+                break;
+            }
+            stream_size += size;
+        }
+    }
+    if (!count)
+        return;
+
+    st->index_entries = av_malloc_array(FFMIN(count, MOV_INDEX_WINDOW), sizeof(*st->index_entries));
+    if (!st->index_entries)
+        return;
+    st->index_entries_allocated_size = FFMIN(count, MOV_INDEX_WINDOW) * sizeof(*st->index_entries);
+
+    sc->lazy_index = 1;
+    sc->lazy_count = count;
+    sc->first_dts  = first_dts;
+    sc->key_off    = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+    mov_index_cursor_seek(st, &sc->index_cursor, 0);
+    mov_fill_index_window(st, 0);
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: indexing %u samples on demand\n", st->index, count);
+
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+        for (i = 0; i < FFMIN(st->nb_index_entries, 99); i++)
+            ff_rfps_add_frame(mov->fc, st, st->index_entries[i].timestamp);
+    if (st->duration > 0)
+        st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
+}
+
+/* Expand ctts entries such that we have a 1-1 mapping with samples */
+static int mov_expand_ctts(MOVStreamContext *sc)
+{
+    MOVStts *ctts_data_old = sc->ctts_data;
+    unsigned int ctts_count_old = sc->ctts_count;
+    unsigned int i, j;
+
+    if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
+        return AVERROR(EINVAL);
+    sc->ctts_count = 0;
+    sc->ctts_allocated_size = 0;
+    sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
+                            sc->sample_count * sizeof(*sc->ctts_data));
+    if (!sc->ctts_data) {
+        av_free(ctts_data_old);
+        return AVERROR(ENOMEM);
+    }
+
+    memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
+
+    for (i = 0; i < ctts_count_old &&
+                sc->ctts_count < sc->sample_count; i++)
+        for (j = 0; j < ctts_data_old[i].count &&
+                    sc->ctts_count < sc->sample_count; j++)
+            add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
+                           &sc->ctts_allocated_size, 1,
+                           ctts_data_old[i].duration);
+    av_free(ctts_data_old);
+    return 0;
+}
+
+/**
+ * Turn the on-demand index of a stream into a complete one, for the code
+ * editing the index in place.
+ */
+static int mov_expand_lazy_index(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *entries;
+    unsigned i;
+    int ret;
+
+    entries = av_realloc_array(st->index_entries, sc->lazy_count, sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    st->index_entries = entries;
+    st->index_entries_allocated_size = sc->lazy_count * sizeof(*entries);
+
+    mov_index_cursor_seek(st, &sc->index_cursor, 0);
+    for (i = 0; i < sc->lazy_count; i++)
+        mov_index_cursor_next(st, &sc->index_cursor, &entries[i]);
+    st->nb_index_entries = sc->lazy_count;
+    sc->index_base = 0;
+    sc->lazy_index = 0;
+
+    if (sc->ctts_data) {
+        if ((ret = mov_expand_ctts(sc)) < 0)
+            return ret;
+        sc->ctts_index  = sc->current_sample;
+        sc->ctts_sample = 0;
+    }
+    return 0;
+}
+
 #define MAX_REORDER_DELAY 16
 static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
 {
     MOVStreamContext *msc = st->priv_data;
+    AVIndexEntry *e;
     int ind;
     int ctts_ind = 0;
     int ctts_sample = 0;
     int64_t pts_buf[MAX_REORDER_DELAY + 1]; // Circular buffer to sort pts.
     int buf_start = 0;
     int j, r, num_swaps;
+    /* Only look at the first window of lazily indexed streams, instead of
+     * walking all their samples when opening the file. */
+    int nb_samples = msc->lazy_index ? FFMIN(msc->lazy_count, MOV_INDEX_WINDOW) : INT_MAX;
 
     for (j = 0; j < MAX_REORDER_DELAY + 1; j++)
         pts_buf[j] = INT64_MIN;
@@ -3399,14 +3828,15 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
     if (st->codecpar->video_delay <= 0 && msc->ctts_data &&
         st->codecpar->codec_id == AV_CODEC_ID_H264) {
         st->codecpar->video_delay = 0;
-        for (ind = 0; ind < st->nb_index_entries && ctts_ind < msc->ctts_count; ++ind) {
+        for (ind = 0; ind < nb_samples && (e = mov_get_index_entry(st, ind)) &&
+                      ctts_ind < msc->ctts_count; ++ind) {
             // Point j to the last elem of the buffer and insert the current pts there.
             j = buf_start;
             buf_start = (buf_start + 1);
             if (buf_start == MAX_REORDER_DELAY + 1)
                 buf_start = 0;
 
-            pts_buf[j] = st->index_entries[ind].timestamp + msc->ctts_data[ctts_ind].duration;
+            pts_buf[j] = e->timestamp + msc->ctts_data[ctts_ind].duration;
 
             // The timestamps that are already in the sorted buffer, and are greater than the
             // current pts, are exactly the timestamps that need to be buffered to output PTS
@@ -3806,8 +4236,7 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     unsigned int stps_index = 0;
     unsigned int i, j;
     uint64_t stream_size = 0;
-    MOVStts *ctts_data_old = sc->ctts_data;
-    unsigned int ctts_count_old = sc->ctts_count;
+    int lazy_index;
 
     if (sc->elst_count) {
         int i, edit_start_index = 0, multiple_edits = 0;
@@ -3852,8 +4281,15 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             sc->start_pad = start_time;
     }
 
+    lazy_index = mov->lazy_index && mov_lazy_index_supported(mov, st);
+    if (mov->lazy_index && !lazy_index)
+        av_log(mov->fc, AV_LOG_VERBOSE, "stream %d: cannot index on demand, "
+               "building the full index\n", st->index);
+
+    if (lazy_index) {
+        mov_init_lazy_index(mov, st, current_dts - sc->dts_shift);
     /* only use old uncompressed audio chunk demuxing when stts specifies it */
-    if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+    } else if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
           sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
         unsigned int current_sample = 0;
         unsigned int stts_sample = 0;
@@ -3881,30 +4317,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
         st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
 
-        if (ctts_data_old) {
-            // Expand ctts entries such that we have a 1-1 mapping with samples
-            if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
-                return;
-            sc->ctts_count = 0;
-            sc->ctts_allocated_size = 0;
-            sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
-                                    sc->sample_count * sizeof(*sc->ctts_data));
-            if (!sc->ctts_data) {
-                av_free(ctts_data_old);
-                return;
-            }
-
-            memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
-
-            for (i = 0; i < ctts_count_old &&
-                        sc->ctts_count < sc->sample_count; i++)
-                for (j = 0; j < ctts_data_old[i].count &&
-                            sc->ctts_count < sc->sample_count; j++)
-                    add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
-                                   &sc->ctts_allocated_size, 1,
-                                   ctts_data_old[i].duration);
-            av_free(ctts_data_old);
-        }
+        if (sc->ctts_data && mov_expand_ctts(sc) < 0)
+            return;
 
         for (i = 0; i < sc->chunk_count; i++) {
             int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
@@ -4112,8 +4526,15 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     }
 
     if (!mov->ignore_editlist && mov->advanced_editlist) {
-        // Fix index according to edit lists.
-        mov_fix_index(mov, st);
+        if (!sc->lazy_index) {
+            // Fix index according to edit lists.
+            mov_fix_index(mov, st);
+        } else if (sc->elst_count) {
+            // The single edit of the whole media only resets what mov_fix_index() would.
+            st->start_time = 0;
+            if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+                st->internal->skip_samples = sc->start_pad = 0;
+        }
     }
 
     // Update start time of the stream.
@@ -4355,12 +4776,14 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             st->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
+    /* Do not need those anymore, unless the index is built on demand. */
+    if (!sc->lazy_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+        av_freep(&sc->stps_data);
+    }
     av_freep(&sc->elst_data);
     av_freep(&sc->rap_group);
 
@@ -4811,6 +5234,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if (sc->lazy_index && (i = mov_expand_lazy_index(st)) < 0)
+        return i;
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -6755,6 +7180,8 @@ static int cenc_filter(MOVContext *mov, AVStream* st, MOVStreamContext *sc, AVPa
         }
 
         if (mov->decryption_key) {
+            if ((ret = av_packet_make_writable(pkt)) < 0)
+                return ret;
             return cenc_decrypt(mov, sc, encrypted_sample, pkt->data, pkt->size);
         } else {
             size_t size;
@@ -7248,10 +7675,11 @@ static void mov_read_chapters(AVFormatContext *s)
         cur_pos = avio_tell(sc->pb);
 
         if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            AVIndexEntry *sample;
+
             st->disposition |= AV_DISPOSITION_ATTACHED_PIC | AV_DISPOSITION_TIMED_THUMBNAILS;
-            if (st->nb_index_entries) {
+            if ((sample = mov_get_index_entry(st, 0))) {
                 // Retrieve the first frame, if possible
-                AVIndexEntry *sample = &st->index_entries[0];
                 if (avio_seek(sc->pb, sample->pos, SEEK_SET) != sample->pos) {
                     av_log(s, AV_LOG_ERROR, "Failed to retrieve first frame\n");
                     goto finish;
@@ -7835,8 +8263,8 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        AVIndexEntry *current_sample;
+        if (msc->pb && (current_sample = mov_get_index_entry(avst, msc->current_sample))) {
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL) && current_sample->pos < sample->pos) ||
@@ -7944,7 +8372,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    AVIndexEntry *sample, lazy_sample;
     AVStream *st = NULL;
     int64_t current_index;
     int ret;
@@ -7959,6 +8387,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         goto retry;
     }
     sc = st->priv_data;
+    if (sc->lazy_index) {
+        /* the index window may move before we are done with the sample */
+        lazy_sample = *sample;
+        sample = &lazy_sample;
+    }
     /* must be done just before reading, to avoid infinite loop on sample */
     current_index = sc->current_index;
     mov_current_sample_inc(sc);
@@ -8039,8 +8472,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             sc->ctts_sample = 0;
         }
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        AVIndexEntry *next = mov_get_index_entry(st, sc->current_sample);
+        int64_t next_dts = next ? next->timestamp : st->duration;
 
         if (next_dts >= pkt->dts)
             pkt->duration = next_dts - pkt->dts;
@@ -8075,8 +8508,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         }
     }
 
-    if (mov->aax_mode)
+    if (mov->aax_mode) {
+        if ((ret = av_packet_make_writable(pkt)) < 0)
+            return ret;
         aax_filter(pkt->data, pkt->size, mov);
+    }
 
     ret = cenc_filter(mov, st, sc, pkt, current_index);
     if (ret < 0) {
@@ -8108,6 +8544,7 @@ static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *first;
     int sample, time_sample, ret;
     unsigned int i;
 
@@ -8119,9 +8556,12 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     if (ret < 0)
         return ret;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->lazy_index)
+        sample = mov_lazy_search_timestamp(st, timestamp, flags);
+    else
+        sample = av_index_search_timestamp(st, timestamp, flags);
     av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && (first = mov_get_index_entry(st, 0)) && timestamp < first->timestamp)
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -8162,8 +8602,8 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
 static int64_t mov_get_skip_samples(AVStream *st, int sample)
 {
     MOVStreamContext *sc = st->priv_data;
-    int64_t first_ts = st->index_entries[0].timestamp;
-    int64_t ts = st->index_entries[sample].timestamp;
+    int64_t first_ts = mov_get_index_entry(st, 0)->timestamp;
+    int64_t ts = mov_get_index_entry(st, sample)->timestamp;
     int64_t off;
 
     if (st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
@@ -8192,7 +8632,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->index_entries[sample].timestamp;
+        int64_t seek_timestamp = mov_get_index_entry(st, sample)->timestamp;
         st->internal->skip_samples = mov_get_skip_samples(st, sample);
 
         for (i = 0; i < s->nb_streams; i++) {
@@ -8239,6 +8679,9 @@ static const AVOption mov_options[] = {
         "Seek each stream individually to the closest point",
         OFFSET(seek_individually), AV_OPT_TYPE_BOOL, { .i64 = 1 },
         0, 1, FLAGS},
+    {"lazy_index", "Build the sample index on demand around the read position.",
+        OFFSET(lazy_index), AV_OPT_TYPE_BOOL, {.i64 = 0},
+        0, 1, FLAGS},
     {"ignore_editlist", "Ignore the edit list atom.", OFFSET(ignore_editlist), AV_OPT_TYPE_BOOL, {.i64 = 0},
         0, 1, FLAGS},
     {"advanced_editlist",
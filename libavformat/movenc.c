@@ -69,6 +69,7 @@ static const AVOption options[] = {
     { "frag_custom", "Flush fragments on caller requests", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_CUSTOM}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "isml", "Create a live smooth streaming feed (for pushing to a publishing point)", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_ISML}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "faststart", "Run a second pass to put the index (moov atom) at the beginning of the file", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FASTSTART}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "reserve_moov", "Reserve space for the moov atom at the beginning of the file, run the faststart second pass only if it is too small", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RESERVE_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "omit_tfhd_offset", "Omit the base data offset in tfhd atoms", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_OMIT_TFHD_OFFSET}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "disable_chpl", "Disable Nero chapter atom", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DISABLE_CHPL}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "default_base_moof", "Set the default-base-is-moof flag in tfhd atoms", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DEFAULT_BASE_MOOF}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -119,6 +120,7 @@ static const AVClass flavor ## _muxer_class = {\
 };
 
 static int get_moov_size(AVFormatContext *s);
+static int estimate_moov_size(AVFormatContext *s);
 
 static int utf8len(const uint8_t *b)
 {
@@ -6471,6 +6473,27 @@ static int mov_init(AVFormatContext *s)
         mov->flags &= ~FF_MOV_FLAG_SKIP_SIDX;
     }
 
+    if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV) {
+        mov->flags &= ~FF_MOV_FLAG_FASTSTART;
+        if (mov->flags & FF_MOV_FLAG_FRAGMENT) {
+            av_log(s, AV_LOG_WARNING, "reserve_moov is not supported with fragmentation, ignoring\n");
+            mov->flags &= ~FF_MOV_FLAG_RESERVE_MOOV;
+        } else if (!mov->reserved_moov_size) {
+            int size = estimate_moov_size(s);
+            if (size < 0) {
+                av_log(s, AV_LOG_WARNING, "Cannot estimate the moov size without "
+                       "the stream durations, using faststart\n");
+                mov->flags &= ~FF_MOV_FLAG_RESERVE_MOOV;
+                mov->flags |=  FF_MOV_FLAG_FASTSTART;
+            } else {
+                av_log(s, AV_LOG_VERBOSE, "Reserving %d bytes for the moov atom\n", size);
+                mov->reserved_moov_size = size;
+            }
+        }
+        if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV)
+            mov->reserved_moov_size = FFMAX(mov->reserved_moov_size, 8);
+    }
+
     if (mov->flags & FF_MOV_FLAG_FASTSTART) {
         mov->reserved_moov_size = -1;
     }
@@ -6832,7 +6855,12 @@ static int mov_write_header(AVFormatContext *s)
 
     if (mov->reserved_moov_size){
         mov->reserved_header_pos = avio_tell(pb);
-        if (mov->reserved_moov_size > 0)
+        if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV) {
+            /* a valid atom, in case the data still has to be shifted */
+            avio_wb32(pb, mov->reserved_moov_size);
+            ffio_wfourcc(pb, "free");
+            avio_skip(pb, mov->reserved_moov_size - 8);
+        } else if (mov->reserved_moov_size > 0)
             avio_skip(pb, mov->reserved_moov_size);
     }
 
@@ -6907,6 +6935,58 @@ static int mov_write_header(AVFormatContext *s)
     return 0;
 }
 
+/* Upper bounds of the sample table sizes per sample: stsz, stts, ctts and
+ * stss entries, and co64 and stsc entries in case interleaving puts every
+ * sample in its own chunk. */
+#define MOOV_VIDEO_SAMPLE_SIZE (4 + 8 + 8 + 4 + 8 + 12)
+#define MOOV_SAMPLE_SIZE       (4 + 8 + 8 + 12)
+/* headers, sample description and edit list of a track */
+#define MOOV_TRACK_SIZE        4096
+
+/*
+ * Estimate the moov size from the expected duration of the streams, which
+ * must all be known.
+ */
+static int estimate_moov_size(AVFormatContext *s)
+{
+    double size = 16384 + s->nb_chapters * 256.0;
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVCodecParameters *par = st->codecpar;
+        double rate, duration;
+        int sample_size = MOOV_SAMPLE_SIZE;
+
+        if (st->duration <= 0 || st->duration == AV_NOPTS_VALUE)
+            return AVERROR(EINVAL);
+        duration = st->duration * av_q2d(st->time_base);
+
+        switch (par->codec_type) {
+        case AVMEDIA_TYPE_VIDEO:
+            if (st->avg_frame_rate.num && st->avg_frame_rate.den)
+                rate = av_q2d(st->avg_frame_rate);
+            else if (st->r_frame_rate.num && st->r_frame_rate.den)
+                rate = av_q2d(st->r_frame_rate);
+            else
+                return AVERROR(EINVAL);
+            sample_size = MOOV_VIDEO_SAMPLE_SIZE;
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            if (par->sample_rate <= 0)
+                return AVERROR(EINVAL);
+            rate = par->sample_rate / (double)(par->frame_size > 0 ? par->frame_size : 1024);
+            break;
+        default:
+            rate = 2;
+            break;
+        }
+        size += MOOV_TRACK_SIZE + par->extradata_size + duration * rate * sample_size;
+    }
+
+    return size < INT_MAX ? (int)size : AVERROR(ERANGE);
+}
+
 static int get_moov_size(AVFormatContext *s)
 {
     int ret;
@@ -7108,6 +7188,19 @@ static int mov_write_trailer(AVFormatContext *s)
             ffio_wfourcc(pb, "mdat");
             avio_wb64(pb, mov->mdat_size + 16);
         }
+
+        if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV) {
+            int moov_size = get_moov_size(s);
+            if (moov_size < 0)
+                return moov_size;
+            if (moov_size + 8 > mov->reserved_moov_size) {
+                av_log(s, AV_LOG_INFO, "Reserved moov size %d is too small (%d needed), "
+                       "falling back to faststart\n", mov->reserved_moov_size, moov_size);
+                /* the reserved free atom is shifted along with the data */
+                mov->reserved_moov_size = -1;
+                mov->flags |= FF_MOV_FLAG_FASTSTART;
+            }
+        }
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_header_pos : moov_pos, SEEK_SET);
 
         if (mov->flags & FF_MOV_FLAG_FASTSTART) {
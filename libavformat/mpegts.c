@@ -140,6 +140,18 @@ struct MpegTSContext {
     /** compute exact PCR for each transport stream packet */
     int mpeg2ts_compute_pcr;
 
+    /** program passed through in raw mode, 0 to return all packets */
+    int raw_service_id;
+    /** PMT PID of the passed through program, -1 if not known yet */
+    int raw_pmt_pid;
+    /** continuity counter of the rewritten PAT */
+    int raw_pat_cc;
+    /** a rewritten PAT packet is ready in raw_pat */
+    int raw_pat_ready;
+    uint8_t raw_pat[TS_PACKET_SIZE];
+    /** elementary stream and PCR PIDs of the passed through program */
+    uint8_t raw_pids[NB_PID_MAX];
+
     /** fix dvb teletext pts                                 */
     int fix_teletext_pts;
 
@@ -213,6 +225,9 @@ static const AVOption raw_options[] = {
     { "compute_pcr",   "compute exact PCR for each transport stream packet",
           offsetof(MpegTSContext, mpeg2ts_compute_pcr), AV_OPT_TYPE_BOOL,
           { .i64 = 0 }, 0, 1,  AV_OPT_FLAG_DECODING_PARAM },
+    { "service_id",    "only return the packets of this program, with a rewritten PAT",
+          offsetof(MpegTSContext, raw_service_id), AV_OPT_TYPE_INT,
+          { .i64 = 0 }, 0, 0xffff, AV_OPT_FLAG_DECODING_PARAM },
     { "ts_packetsize", "output option carrying the raw packet size",
       offsetof(MpegTSContext, raw_packet_size), AV_OPT_TYPE_INT,
       { .i64 = 0 }, 0, 0,
@@ -2929,12 +2944,52 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+#define PACKET_BATCH 128
+
+/* Check the sync bytes of the whole packets buffered at the read position of
+ * the I/O context, up to PACKET_BATCH of them, and extract their PID and
+ * payload unit start bits, so that the packets handle_packet() would ignore
+ * can be dropped before reading them.
+ * Return the number of packets starting with a sync byte. */
+static int scan_buffered_packets(AVIOContext *pb, int raw_packet_size,
+                                 uint16_t *pids)
+{
+    const uint8_t *p = pb->buf_ptr;
+    int nb = FFMIN((pb->buf_end - pb->buf_ptr) / raw_packet_size, PACKET_BATCH);
+    int i;
+
+    for (i = 0; i < nb; i++, p += raw_packet_size) {
+        if (p[0] != 0x47)
+            break;
+        pids[i] = AV_RB16(p + 1) & 0x5fff;
+    }
+    return i;
+}
+
+/* Return the number of leading packets of a scanned run that handle_packet()
+ * would ignore without side effects: no filter and no PES stream to guess,
+ * or a discarded filter whose discard flag is not updated by the packet. */
+static int count_ignored_packets(MpegTSContext *ts, const uint16_t *pids, int nb)
+{
+    int i;
+
+    for (i = 0; i < nb; i++) {
+        MpegTSFilter *tss = ts->pids[pids[i] & 0x1fff];
+        int is_start = pids[i] & 0x4000;
+        if (tss ? !tss->discard || is_start : ts->auto_guess && is_start)
+            break;
+    }
+    return i;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
     uint8_t packet[TS_PACKET_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
+    uint16_t pids[PACKET_BATCH];
     const uint8_t *data;
     int64_t packet_num;
+    int nb_buffered = 0, next = 0;
     int ret = 0;
 
     if (avio_tell(s->pb) != ts->last_pos) {
@@ -2970,11 +3025,34 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
-        ret = read_packet(s, packet, ts->raw_packet_size, &data);
-        if (ret != 0)
-            break;
-        ret = handle_packet(ts, data, avio_tell(s->pb));
-        finished_reading_packet(s, ts->raw_packet_size);
+        if (next == nb_buffered) {
+            nb_buffered = scan_buffered_packets(s->pb, ts->raw_packet_size, pids);
+            next = 0;
+        }
+        if (next < nb_buffered) {
+            int nb = nb_buffered - next, skip;
+            if (nb_packets)
+                nb = FFMIN(nb, nb_packets - packet_num);
+            skip = count_ignored_packets(ts, pids + next, nb);
+            if (skip) {
+                avio_skip(s->pb, (int64_t)skip * ts->raw_packet_size);
+                packet_num += skip - 1;
+                next       += skip;
+                continue;
+            }
+            /* the sync byte was checked when scanning the run, and the whole
+             * packet is buffered, so this does not copy */
+            ffio_read_indirect(s->pb, packet, ts->raw_packet_size, &data);
+            next++;
+            ret = handle_packet(ts, data, avio_tell(s->pb) -
+                                ts->raw_packet_size + TS_PACKET_SIZE);
+        } else {
+            ret = read_packet(s, packet, ts->raw_packet_size, &data);
+            if (ret != 0)
+                break;
+            ret = handle_packet(ts, data, avio_tell(s->pb));
+            finished_reading_packet(s, ts->raw_packet_size);
+        }
         if (ret != 0)
             break;
     }
@@ -3051,6 +3129,116 @@ static int parse_pcr(int64_t *ppcr_high, int *ppcr_low, const uint8_t *packet)
     return 0;
 }
 
+static void raw_pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len)
+{
+    MpegTSContext *ts = filter->u.section_filter.opaque;
+    MpegTSSectionFilter *tssf = &filter->u.section_filter;
+    SectionHeader h1, *h = &h1;
+    const uint8_t *p, *p_end;
+    int pcr_pid, pid, len;
+
+    p_end = section + section_len - 4;
+    p     = section;
+    if (parse_section_header(h, &p, p_end) < 0)
+        return;
+    if (h->tid != PMT_TID || h->id != ts->raw_service_id)
+        return;
+    if (skip_identical(h, tssf))
+        return;
+
+    memset(ts->raw_pids, 0, sizeof(ts->raw_pids));
+    pcr_pid = get16(&p, p_end);
+    if (pcr_pid < 0)
+        return;
+    pcr_pid &= 0x1fff;
+    if (pcr_pid != 0x1fff)
+        ts->raw_pids[pcr_pid] = 1;
+
+    len = get16(&p, p_end);
+    if (len < 0)
+        return;
+    len &= 0xfff;
+    if (len > p_end - p)
+        return;
+    p += len;
+
+    for (;;) {
+        if (get8(&p, p_end) < 0) /* stream type */
+            break;
+        pid = get16(&p, p_end);
+        if (pid < 0)
+            break;
+        ts->raw_pids[pid & 0x1fff] = 1;
+        len = get16(&p, p_end);
+        if (len < 0)
+            break;
+        len &= 0xfff;
+        if (len > p_end - p)
+            break;
+        p += len;
+    }
+}
+
+static void raw_pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len)
+{
+    MpegTSContext *ts = filter->u.section_filter.opaque;
+    SectionHeader h1, *h = &h1;
+    const uint8_t *p, *p_end;
+    uint8_t *q;
+    int sid, pmt_pid;
+
+    p_end = section + section_len - 4;
+    p     = section;
+    if (parse_section_header(h, &p, p_end) < 0)
+        return;
+    if (h->tid != PAT_TID)
+        return;
+
+    do {
+        sid = get16(&p, p_end);
+        if (sid < 0)
+            return;
+        pmt_pid = get16(&p, p_end);
+        if (pmt_pid < 0)
+            return;
+        pmt_pid &= 0x1fff;
+    } while (sid != ts->raw_service_id);
+    if (pmt_pid == PAT_PID)
+        return;
+
+    if (pmt_pid != ts->raw_pmt_pid) {
+        if (ts->raw_pmt_pid >= 0 && ts->pids[ts->raw_pmt_pid])
+            mpegts_close_filter(ts, ts->pids[ts->raw_pmt_pid]);
+        memset(ts->raw_pids, 0, sizeof(ts->raw_pids));
+        ts->raw_pmt_pid = pmt_pid;
+        if (!mpegts_open_section_filter(ts, pmt_pid, raw_pmt_cb, ts, 1))
+            return;
+    }
+
+    /* single program PAT keeping the transport stream id and version */
+    q    = ts->raw_pat;
+    q[0] = 0x47;
+    q[1] = 0x40 | PAT_PID >> 8;
+    q[2] = PAT_PID;
+    q[3] = 0x10 | ts->raw_pat_cc;
+    q[4] = 0; /* pointer field */
+    ts->raw_pat_cc = (ts->raw_pat_cc + 1) & 0xf;
+
+    q   += 5;
+    q[0] = PAT_TID;
+    AV_WB16(q + 1, 0xb000 | 13); /* 5 byte header + 1 program + 4 byte CRC */
+    AV_WB16(q + 3, h->id);
+    q[5] = 0xc1 | h->version << 1;
+    q[6] = 0;
+    q[7] = 0;
+    AV_WB16(q + 8, sid);
+    AV_WB16(q + 10, 0xe000 | pmt_pid);
+    AV_WL32(q + 12, av_crc(av_crc_get_table(AV_CRC_32_IEEE), -1, q, 12));
+    memset(q + 16, 0xff, TS_PACKET_SIZE - 21);
+
+    ts->raw_pat_ready = 1;
+}
+
 static void seek_back(AVFormatContext *s, AVIOContext *pb, int64_t pos) {
 
     /* NOTE: We attempt to seek on non-seekable files as well, as the
@@ -3155,6 +3343,11 @@ static int mpegts_read_header(AVFormatContext *s)
         st->start_time      = ts->cur_pcr;
         av_log(ts->stream, AV_LOG_TRACE, "start=%0.3f pcr=%0.3f incr=%"PRId64"\n",
                 st->start_time / 1000000.0, pcrs[0] / 27e6, ts->pcr_incr);
+
+        if (ts->raw_service_id) {
+            ts->raw_pmt_pid = -1;
+            mpegts_open_section_filter(ts, PAT_PID, raw_pat_cb, ts, 1);
+        }
     }
 
     seek_back(s, pb, pos);
@@ -3162,26 +3355,63 @@ static int mpegts_read_header(AVFormatContext *s)
 }
 
 #define MAX_PACKET_READAHEAD ((128 * 1024) / 188)
+#define RAW_PASSTHROUGH_PACKETS 32
+
+/* Return whether a packet belongs to the program passed through by the
+ * raw demuxer, replacing PAT packets by the rewritten PAT. */
+static int raw_filter_packet(MpegTSContext *ts, uint8_t *packet, int64_t pos)
+{
+    int pid = AV_RB16(packet + 1) & 0x1fff;
+
+    if (pid == PAT_PID || pid == ts->raw_pmt_pid) {
+        ts->raw_pat_ready = 0;
+        handle_packet(ts, packet, pos);
+        if (pid == PAT_PID) {
+            if (!ts->raw_pat_ready)
+                return 0;
+            memcpy(packet, ts->raw_pat, TS_PACKET_SIZE);
+        }
+        return 1;
+    }
+    return ts->raw_pids[pid];
+}
 
 static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MpegTSContext *ts = s->priv_data;
-    int ret, i;
+    int ret, i, n;
     int64_t pcr_h, next_pcr_h, pos;
     int pcr_l, next_pcr_l;
     uint8_t pcr_buf[12];
     const uint8_t *data;
+    /* without per packet timestamps, passed through packets are grouped */
+    int nb_packets = ts->raw_service_id && !ts->mpeg2ts_compute_pcr ?
+                     RAW_PASSTHROUGH_PACKETS : 1;
 
-    if ((ret = av_new_packet(pkt, TS_PACKET_SIZE)) < 0)
-        return ret;
-    ret = read_packet(s, pkt->data, ts->raw_packet_size, &data);
-    pkt->pos = avio_tell(s->pb);
-    if (ret < 0) {
+    if ((ret = av_new_packet(pkt, TS_PACKET_SIZE * nb_packets)) < 0)
         return ret;
+    for (n = 0; n < nb_packets;) {
+        uint8_t *buf = pkt->data + n * TS_PACKET_SIZE;
+        /* do not wait for more input to complete a group */
+        if (n && s->pb->buf_end - s->pb->buf_ptr < ts->raw_packet_size)
+            break;
+        ret = read_packet(s, buf, ts->raw_packet_size, &data);
+        pos = avio_tell(s->pb);
+        if (ret < 0) {
+            if (n)
+                break;
+            pkt->pos = pos;
+            return ret;
+        }
+        if (data != buf)
+            memcpy(buf, data, TS_PACKET_SIZE);
+        finished_reading_packet(s, ts->raw_packet_size);
+        if (ts->raw_service_id && !raw_filter_packet(ts, buf, pos))
+            continue;
+        if (!n++)
+            pkt->pos = pos;
     }
-    if (data != pkt->data)
-        memcpy(pkt->data, data, TS_PACKET_SIZE);
-    finished_reading_packet(s, ts->raw_packet_size);
+    av_shrink_packet(pkt, n * TS_PACKET_SIZE);
     if (ts->mpeg2ts_compute_pcr) {
         /* compute exact PCR for each packet */
         if (parse_pcr(&pcr_h, &pcr_l, pkt->data) == 0) {
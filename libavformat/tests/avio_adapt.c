@@ -0,0 +1,118 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "libavutil/dict.h"
+#include "libavformat/avio.h"
+
+#include "file_fixture.h"
+
+#define FILE_SIZE  (8 << 20)
+#define BUFFER_MIN 8192
+#define BUFFER_MAX (1 << 20)
+
+static int open_file(AVIOContext **pb, int adapt)
+{
+    AVDictionary *opts = NULL;
+    int ret;
+
+    if (adapt) {
+        av_dict_set_int(&opts, "io_buffer_min", BUFFER_MIN, 0);
+        av_dict_set_int(&opts, "io_buffer_max", BUFFER_MAX, 0);
+    }
+    ret = avio_open2(pb, path, AVIO_FLAG_READ, NULL, &opts);
+    av_dict_free(&opts);
+    return ret;
+}
+
+/* Read the whole file in small pieces: every refill of the buffer is
+ * complete, so it grows. */
+static int read_sequential(int adapt)
+{
+    AVIOContext *pb;
+    AVIOStats stats;
+    uint8_t buf[1000];
+    int ret, pos = 0, bad = 0, max_size = 0;
+
+    if ((ret = open_file(&pb, adapt)) < 0)
+        return ret;
+    while ((ret = avio_read(pb, buf, sizeof(buf))) > 0) {
+        bad += count_bad(buf, ret, pos);
+        pos += ret;
+        avio_get_stats(pb, &stats);
+        max_size = FFMAX(max_size, stats.buffer_size);
+    }
+    avio_get_stats(pb, &stats);
+    avio_closep(&pb);
+
+    printf("sequential, %s: %d bytes, %d bad, %"PRId64" bytes read, "
+           "buffer %s, %s, %s\n",
+           adapt ? "adaptive" : "fixed", pos, bad, stats.bytes_read,
+           max_size > 32768 ? "grown" : "not grown",
+           max_size <= (adapt ? BUFFER_MAX : 32768) ? "within bounds" : "too large",
+           stats.wait_time ? "wait time measured" : "no wait time");
+    return 0;
+}
+
+/* Read a few bytes at positions far apart: the data read ahead is wasted,
+ * so the buffer shrinks to its minimum size. */
+static int read_seeking(void)
+{
+    AVIOContext *pb;
+    AVIOStats stats;
+    uint8_t buf[100];
+    int ret, bad = 0, grown_size;
+
+    if ((ret = open_file(&pb, 1)) < 0)
+        return ret;
+    /* grow the buffer first */
+    for (int i = 0; i < 2 * FILE_SIZE / 3; i += sizeof(buf))
+        avio_read(pb, buf, sizeof(buf));
+    avio_get_stats(pb, &stats);
+    grown_size = stats.buffer_size;
+    for (int i = 0; i < 200; i++) {
+        int64_t pos = (int64_t)i * 1000003 % (FILE_SIZE - sizeof(buf));
+
+        if ((ret = avio_seek(pb, pos, SEEK_SET)) < 0 ||
+            (ret = avio_read(pb, buf, sizeof(buf))) != sizeof(buf))
+            break;
+        bad += count_bad(buf, sizeof(buf), pos);
+    }
+    avio_get_stats(pb, &stats);
+    avio_closep(&pb);
+    if (ret < 0)
+        return ret;
+
+    printf("seeking: %d bad, %"PRId64" seeks, buffer %s, then size %d\n",
+           bad, stats.nb_seeks, grown_size > 32768 ? "grown" : "not grown",
+           stats.buffer_size);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_path(argc, argv) < 0 || write_fixture(FILE_SIZE) < 0 ||
+        read_sequential(0) < 0 || read_sequential(1) < 0 ||
+        read_seeking() < 0)
+        return 1;
+
+    unlink(path);
+    return 0;
+}
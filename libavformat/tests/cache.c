@@ -0,0 +1,235 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/dict.h"
+#include "libavutil/opt.h"
+#include "libavformat/avformat.h"
+#include "libavformat/url.h"
+
+#include "file_fixture.h"
+
+#define BLOCK_SIZE 4096
+#define NB_BLOCKS  11
+#define FILE_SIZE  (10 * BLOCK_SIZE + 1000)
+
+static char dir[1100];
+
+static int write_file(const char *file, const char *buf, int size, time_t mtime)
+{
+    FILE *f = fopen(file, "wb");
+
+    if (!f || fwrite(buf, 1, size, f) != size) {
+        if (f)
+            fclose(f);
+        return AVERROR(EIO);
+    }
+    fclose(f);
+    if (mtime) {
+        struct utimbuf t = { mtime, mtime };
+        utime(file, &t);
+    }
+    return 0;
+}
+
+/* Call func on each file of the cache directory, with the index of the
+ * block if it is one, -1 otherwise. */
+static void for_each_file(void (*func)(const char *file, const char *name, int block, void *opaque),
+                          void *opaque)
+{
+    struct dirent *entry;
+    DIR *d = opendir(dir);
+
+    if (!d)
+        return;
+    while ((entry = readdir(d))) {
+        const char *dash = strrchr(entry->d_name, '-');
+        char file[2048];
+        int block = -1;
+
+        if (entry->d_name[0] == '.')
+            continue;
+        if (dash && av_match_ext(entry->d_name, "blk"))
+            block = atoi(dash + 1);
+        snprintf(file, sizeof(file), "%s/%s", dir, entry->d_name);
+        func(file, entry->d_name, block, opaque);
+    }
+    closedir(d);
+}
+
+static void remove_file(const char *file, const char *name, int block, void *opaque)
+{
+    unlink(file);
+}
+
+static void remove_block(const char *file, const char *name, int block, void *opaque)
+{
+    if (block == *(int *)opaque)
+        unlink(file);
+}
+
+typedef struct Listing {
+    int blocks[NB_BLOCKS];
+    int nb_info, nb_tmp;
+} Listing;
+
+static void count_file(const char *file, const char *name, int block, void *opaque)
+{
+    Listing *l = opaque;
+
+    if (block >= 0 && block < NB_BLOCKS)
+        l->blocks[block] = 1;
+    else if (av_match_ext(name, "info"))
+        l->nb_info++;
+    else if (av_match_ext(name, "tmp"))
+        l->nb_tmp++;
+}
+
+/* Make the blocks least recently used in order, long ago. */
+static void age_block(const char *file, const char *name, int block, void *opaque)
+{
+    time_t now = *(time_t *)opaque;
+    struct utimbuf t;
+
+    if (block < 0)
+        return;
+    t.actime = t.modtime = now - 10000 + block * 10;
+    utime(file, &t);
+}
+
+static void print_dir(const char *name)
+{
+    Listing l = { { 0 } };
+    char file[1200], usage[32] = "";
+    FILE *f;
+
+    for_each_file(count_file, &l);
+    printf("%s: blocks", name);
+    for (int i = 0; i < NB_BLOCKS; i++)
+        if (l.blocks[i])
+            printf(" %d", i);
+    snprintf(file, sizeof(file), "%s/lock", dir);
+    if ((f = fopen(file, "r"))) {
+        if (!fgets(usage, sizeof(usage), f))
+            usage[0] = 0;
+        fclose(f);
+    }
+    printf(", %d info, %d tmp, size %"PRId64"\n",
+           l.nb_info, l.nb_tmp, (int64_t)strtoll(usage, NULL, 10));
+}
+
+static int open_cache(URLContext **h, int64_t max_size)
+{
+    AVDictionary *opts = NULL;
+    char url[1200];
+    int ret;
+
+    snprintf(url, sizeof(url), "cache:file:%s", path);
+    av_dict_set(&opts, "cache_dir", dir, 0);
+    av_dict_set_int(&opts, "cache_block_size", BLOCK_SIZE, 0);
+    av_dict_set_int(&opts, "cache_max_size", max_size, 0);
+    ret = ffurl_open_whitelist(h, url, AVIO_FLAG_READ, NULL, &opts,
+                               NULL, NULL, NULL);
+    av_dict_free(&opts);
+    return ret;
+}
+
+static int read_all(const char *name, int64_t max_size, int size)
+{
+    URLContext *h = NULL;
+    uint8_t buf[3000];
+    int64_t hits = -1, misses = -1;
+    int ret, pos = 0, bad = 0;
+
+    if ((ret = open_cache(&h, max_size)) < 0)
+        return ret;
+    while ((ret = ffurl_read(h, buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < ret; i++)
+            bad += pos + i >= size || buf[i] != file_byte(pos + i);
+        pos += ret;
+    }
+    av_opt_get_int(h, "cache_hits",   AV_OPT_SEARCH_CHILDREN, &hits);
+    av_opt_get_int(h, "cache_misses", AV_OPT_SEARCH_CHILDREN, &misses);
+    ffurl_closep(&h);
+
+    printf("%s: %d bytes, %d bad, %"PRId64" hits, %"PRId64" misses\n",
+           name, pos, bad, hits, misses);
+    print_dir(name);
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+int main(int argc, char **argv)
+{
+    URLContext *h = NULL;
+    time_t now = time(NULL);
+    char file[1200];
+
+    if (parse_path(argc, argv) < 0)
+        return 1;
+    snprintf(dir, sizeof(dir), "%s.dir", path);
+    mkdir(dir, 0777);
+    for_each_file(remove_file, NULL);
+
+    if (write_fixture(FILE_SIZE) < 0)
+        return 1;
+
+    if (read_all("first read", 1 << 30, FILE_SIZE) < 0 ||
+        read_all("second read", 1 << 30, FILE_SIZE) < 0)
+        return 1;
+
+    /* the info file of a resource without blocks, and temporary files of a
+     * process writing a block and of a process which was killed */
+    for_each_file(age_block, &now);
+    snprintf(file, sizeof(file), "%s/0123-%d.info", dir, BLOCK_SIZE);
+    write_file(file, "5\n", 2, 0);
+    snprintf(file, sizeof(file), "%s/0123-%d-0.blk.1.0x1.tmp", dir, BLOCK_SIZE);
+    write_file(file, "0123456789", 10, 0);
+    snprintf(file, sizeof(file), "%s/0123-%d-1.blk.2.0x1.tmp", dir, BLOCK_SIZE);
+    write_file(file, "0123456789", 10, now - 7200);
+
+    /* opening with a lower limit evicts the least recently used blocks */
+    if (open_cache(&h, 20000) < 0)
+        return 1;
+    ffurl_closep(&h);
+    print_dir("eviction");
+
+    if (read_all("third read", 1 << 30, FILE_SIZE) < 0)
+        return 1;
+
+    /* a resource whose size changed is cached again once a block is missing */
+    if (write_fixture(FILE_SIZE - 1000) < 0)
+        return 1;
+    for_each_file(remove_block, &(int){ 0 });
+    if (read_all("changed", 1 << 30, FILE_SIZE - 1000) < 0)
+        return 1;
+
+    for_each_file(remove_file, NULL);
+    rmdir(dir);
+    unlink(path);
+    return 0;
+}
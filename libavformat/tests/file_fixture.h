@@ -0,0 +1,85 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Test data shared by the protocol tests: every byte is a function of its
+ * position, so that any range read back can be checked without keeping a
+ * copy of the file.
+ */
+
+#ifndef AVFORMAT_TESTS_FILE_FIXTURE_H
+#define AVFORMAT_TESTS_FILE_FIXTURE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavformat/avio.h"
+
+/* the test file, given on the command line */
+static av_unused char path[1024];
+
+static av_unused uint8_t file_byte(int64_t pos)
+{
+    return pos * 7 ^ pos >> 12;
+}
+
+/* Return the number of bytes of buf differing from the file at pos. */
+static av_unused int count_bad(const uint8_t *buf, int size, int64_t pos)
+{
+    int bad = 0;
+
+    for (int i = 0; i < size; i++)
+        bad += buf[i] != file_byte(pos + i);
+    return bad;
+}
+
+static av_unused int parse_path(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file>\n", argv[0]);
+        return AVERROR(EINVAL);
+    }
+    av_strlcpy(path, argv[1], sizeof(path));
+    return 0;
+}
+
+/* Write the first size bytes of the file. */
+static av_unused int write_fixture(int64_t size)
+{
+    static uint8_t buf[65536];
+    AVIOContext *pb;
+    int ret;
+
+    if ((ret = avio_open(&pb, path, AVIO_FLAG_WRITE)) < 0)
+        return ret;
+    for (int64_t pos = 0; pos < size; pos += sizeof(buf)) {
+        int len = FFMIN(sizeof(buf), size - pos);
+
+        for (int i = 0; i < len; i++)
+            buf[i] = file_byte(pos + i);
+        avio_write(pb, buf, len);
+    }
+    return avio_closep(&pb);
+}
+
+#endif /* AVFORMAT_TESTS_FILE_FIXTURE_H */
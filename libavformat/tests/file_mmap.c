@@ -0,0 +1,86 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "libavutil/dict.h"
+#include "libavformat/avformat.h"
+
+#include "file_fixture.h"
+
+static const int sizes[] = {
+    70000,
+    196608 - 70000,     /* ends on a page boundary */
+    100,                /* too small to be mapped */
+    200000,
+    65536,
+    80000,              /* ends at the end of the file */
+};
+
+#define NB_PACKETS FF_ARRAY_ELEMS(sizes)
+
+/* Read the file as packets of the given sizes, the last one ending at the
+ * end of the file, and check them after closing it. */
+static int read_packets(void)
+{
+    AVPacket pkt[NB_PACKETS] = { { 0 } };
+    AVDictionary *opts = NULL;
+    AVIOContext *pb;
+    int ret, pos = 0;
+
+    av_dict_set(&opts, "mmap", "1", 0);
+    ret = avio_open2(&pb, path, AVIO_FLAG_READ, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    for (int i = 0; i < NB_PACKETS; i++)
+        if ((ret = av_get_packet(pb, &pkt[i], sizes[i])) != sizes[i])
+            break;
+    avio_closep(&pb);
+
+    for (int i = 0; i < NB_PACKETS && ret >= 0; i++) {
+        int bad = count_bad(pkt[i].data, pkt[i].size, pos), padding = 0;
+
+        for (int j = 0; j < AV_INPUT_BUFFER_PADDING_SIZE; j++)
+            padding += pkt[i].data[pkt[i].size + j] != 0;
+        printf("packet %d: pos %"PRId64", size %d, %d bad, %s padding, %s\n",
+               i, pkt[i].pos, pkt[i].size, bad, padding ? "nonzero" : "zero",
+               av_buffer_is_writable(pkt[i].buf) ? "copied" : "mapped");
+        pos += pkt[i].size;
+    }
+    for (int i = 0; i < NB_PACKETS; i++)
+        av_packet_unref(&pkt[i]);
+    return ret < 0 ? ret : 0;
+}
+
+int main(int argc, char **argv)
+{
+    int size = 0;
+
+    if (parse_path(argc, argv) < 0)
+        return 1;
+
+    for (int i = 0; i < NB_PACKETS; i++)
+        size += sizes[i];
+    if (write_fixture(size) < 0 || read_packets() < 0)
+        return 1;
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _DEFAULT_SOURCE /* needed for syscall() */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+#include "libavutil/dict.h"
+#include "libavformat/avformat.h"
+#include "libavformat/url.h"
+
+#include "file_fixture.h"
+
+#define URING_BLOCK 4096
+#define FILE_SIZE  (10 * URING_BLOCK + 123)
+
+/* The file protocol falls back to blocking I/O when a ring cannot be set
+ * up, e.g. in containers filtering the io_uring system calls. */
+static int uring_available(void)
+{
+#ifdef __NR_io_uring_setup
+    struct io_uring_params p = { 0 };
+    int fd = syscall(__NR_io_uring_setup, 1, &p);
+
+    if (fd >= 0) {
+        close(fd);
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+static int open_file(URLContext **h, int flags, int depth)
+{
+    AVDictionary *opts = NULL;
+    char url[1100];
+    int ret;
+
+    snprintf(url, sizeof(url), "file:%s", path);
+    av_dict_set_int(&opts, "uring_depth", depth, 0);
+    av_dict_set_int(&opts, "uring_block_size", URING_BLOCK, 0);
+    av_dict_set(&opts, "truncate", "1", 0);
+    ret = ffurl_open_whitelist(h, url, flags, NULL, &opts, NULL, NULL, NULL);
+    av_dict_free(&opts);
+    return ret;
+}
+
+/* Write the file in pieces of odd sizes, with a range first written wrong
+ * and rewritten after seeking back, then check it with stdio. */
+static int write_file(int depth)
+{
+    static uint8_t buf[FILE_SIZE];
+    URLContext *h = NULL;
+    FILE *f;
+    int ret, pos = 0, bad = 0, size;
+
+    for (int i = 0; i < FILE_SIZE; i++)
+        buf[i] = file_byte(i) ^ (i >= 5000 && i < 13000 ? 0xff : 0);
+    if ((ret = open_file(&h, AVIO_FLAG_WRITE, depth)) < 0)
+        return ret;
+    for (int i = 0; pos < FILE_SIZE; i++) {
+        size = FFMIN(1 + i * 997 % 6000, FILE_SIZE - pos);
+        while (size > 0) {
+            if ((ret = ffurl_write(h, buf + pos, size)) < 0)
+                goto end;
+            pos  += ret;
+            size -= ret;
+        }
+    }
+    for (int i = 5000; i < 13000; i++)
+        buf[i] = file_byte(i);
+    if ((ret = ffurl_seek(h, 5000, SEEK_SET)) < 0)
+        goto end;
+    for (pos = 5000; pos < 13000; pos += ret)
+        if ((ret = ffurl_write(h, buf + pos, 13000 - pos)) < 0)
+            goto end;
+    ret = ffurl_seek(h, 0, AVSEEK_SIZE);
+end:
+    ffurl_closep(&h);
+    if (ret < 0)
+        return ret;
+    size = ret;
+
+    if (!(f = fopen(path, "rb")))
+        return AVERROR(errno);
+    for (pos = 0; fread(buf, 1, 1, f) == 1; pos++)
+        bad += buf[0] != file_byte(pos);
+    fclose(f);
+    printf("write depth %d: size %d, %d bytes, %d bad\n", depth, size, pos, bad);
+    return 0;
+}
+
+/* Read the file through, then at pseudo-random positions. */
+static int read_file(int depth)
+{
+    URLContext *h = NULL;
+    uint8_t buf[5000];
+    unsigned seed = 1;
+    int ret, pos = 0, bad = 0, nb_seeks = 0, seek_bad = 0;
+
+    if ((ret = open_file(&h, AVIO_FLAG_READ, depth)) < 0)
+        return ret;
+    while ((ret = ffurl_read(h, buf, 1500)) > 0) {
+        bad += count_bad(buf, ret, pos);
+        pos += ret;
+    }
+    if (ret != AVERROR_EOF)
+        goto end;
+
+    for (int i = 0; i < 100; i++) {
+        int len;
+
+        seed = seed * 1664525 + 1013904223;
+        pos  = seed % (FILE_SIZE + 100);
+        len  = 1 + (seed >> 16) % sizeof(buf);
+        if ((ret = ffurl_seek(h, pos, SEEK_SET)) < 0)
+            goto end;
+        ret = ffurl_read(h, buf, len);
+        if (ret == AVERROR_EOF && pos >= FILE_SIZE)
+            ret = 0;
+        if (ret < 0)
+            goto end;
+        seek_bad += count_bad(buf, ret, pos);
+        nb_seeks++;
+    }
+    ret = 0;
+    printf("read depth %d: %d bytes, %d bad, %d seeks, %d bad\n",
+           depth, FILE_SIZE, bad, nb_seeks, seek_bad);
+end:
+    ffurl_closep(&h);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static const int depths[] = { 1, 3, 16, 256 };
+
+    if (parse_path(argc, argv) < 0)
+        return 1;
+    if (!uring_available())
+        fprintf(stderr, "io_uring unavailable, only testing blocking I/O\n");
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(depths); i++)
+        if (write_file(depths[i]) < 0 || read_file(depths[i]) < 0)
+            return 1;
+
+    unlink(path);
+    return 0;
+}
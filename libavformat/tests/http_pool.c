@@ -0,0 +1,221 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+#include "libavformat/avio.h"
+#include "libavformat/network.h"
+#include "libavformat/url.h"
+
+#define MAX_CONNS 8
+
+static const char reply[] = "HTTP/1.1 200 OK\r\n"
+                            "Content-Length: 5\r\n"
+                            "\r\n"
+                            "hello";
+
+/* A keep-alive HTTP server on the loopback interface, which answers every
+ * request with the same reply and counts the connections. */
+typedef struct Server {
+    int listen_fd;
+    int port;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int nb_accepted;
+    int nb_closed;
+    int quit;
+} Server;
+
+static void *server_thread(void *arg)
+{
+    Server *srv = arg;
+    struct pollfd p[MAX_CONNS + 1] = { { srv->listen_fd, POLLIN } };
+    char req[MAX_CONNS][4096];
+    int len[MAX_CONNS] = { 0 };
+    int nb_conns = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&srv->lock);
+        if (srv->quit) {
+            pthread_mutex_unlock(&srv->lock);
+            break;
+        }
+        pthread_mutex_unlock(&srv->lock);
+
+        if (poll(p, nb_conns + 1, 10) <= 0)
+            continue;
+        if (p[0].revents & POLLIN && nb_conns < MAX_CONNS) {
+            int fd = accept(srv->listen_fd, NULL, NULL);
+            if (fd >= 0) {
+                p[++nb_conns] = (struct pollfd){ fd, POLLIN };
+                len[nb_conns - 1] = 0;
+                pthread_mutex_lock(&srv->lock);
+                srv->nb_accepted++;
+                pthread_mutex_unlock(&srv->lock);
+            }
+        }
+        for (int i = 1; i <= nb_conns; i++) {
+            char *r = req[i - 1];
+            int ret;
+
+            if (!(p[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            ret = recv(p[i].fd, r + len[i - 1], sizeof(req[0]) - 1 - len[i - 1], 0);
+            if (ret <= 0) {
+                closesocket(p[i].fd);
+                p[i]       = p[nb_conns];
+                len[i - 1] = len[nb_conns - 1];
+                memcpy(r, req[nb_conns - 1], len[i - 1]);
+                nb_conns--;
+                i--;
+                pthread_mutex_lock(&srv->lock);
+                srv->nb_closed++;
+                pthread_mutex_unlock(&srv->lock);
+                continue;
+            }
+            len[i - 1] += ret;
+            r[len[i - 1]] = 0;
+            if (strstr(r, "\r\n\r\n")) {
+                send(p[i].fd, reply, sizeof(reply) - 1, 0);
+                len[i - 1] = 0;
+            }
+        }
+    }
+    for (int i = 1; i <= nb_conns; i++)
+        closesocket(p[i].fd);
+    return NULL;
+}
+
+static int server_start(Server *srv)
+{
+    struct sockaddr_in addr = { 0 };
+    socklen_t addr_len = sizeof(addr);
+
+    srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (srv->listen_fd < 0)
+        return AVERROR(errno);
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(srv->listen_fd, MAX_CONNS) < 0 ||
+        getsockname(srv->listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        closesocket(srv->listen_fd);
+        return AVERROR(errno);
+    }
+    srv->port = ntohs(addr.sin_port);
+    pthread_mutex_init(&srv->lock, NULL);
+    if (pthread_create(&srv->thread, NULL, server_thread, srv)) {
+        closesocket(srv->listen_fd);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static void server_stop(Server *srv)
+{
+    pthread_mutex_lock(&srv->lock);
+    srv->quit = 1;
+    pthread_mutex_unlock(&srv->lock);
+    pthread_join(srv->thread, NULL);
+    pthread_mutex_destroy(&srv->lock);
+    closesocket(srv->listen_fd);
+}
+
+static int server_count(Server *srv, int *closed)
+{
+    int accepted;
+
+    pthread_mutex_lock(&srv->lock);
+    accepted = srv->nb_accepted;
+    *closed  = srv->nb_closed;
+    pthread_mutex_unlock(&srv->lock);
+    return accepted;
+}
+
+/* Read the reply of one request made with the given lower protocol
+ * options, then print where its connection came from. */
+static int request(Server *srv, const char *name, const char *lower_opts)
+{
+    AVIOConnectionPoolStats before, after;
+    AVDictionary *opts = NULL;
+    URLContext *h = NULL;
+    char url[64], buf[16];
+    int ret, len = 0, closed;
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", srv->port);
+    av_dict_set(&opts, "connection_pool", "1", 0);
+    av_dict_parse_string(&opts, lower_opts, "=", ",", 0);
+
+    avio_get_connection_pool_stats(&before);
+    ret = ffurl_open_whitelist(&h, url, AVIO_FLAG_READ, NULL, &opts,
+                               NULL, NULL, NULL);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    while ((ret = ffurl_read(h, buf + len, sizeof(buf) - 1 - len)) > 0)
+        len += ret;
+    ffurl_closep(&h);
+    avio_get_connection_pool_stats(&after);
+
+    buf[len] = 0;
+    printf("%s: %s, %s, %d connections\n", name, buf,
+           after.nb_hits > before.nb_hits ? "reused" : "new",
+           server_count(srv, &closed));
+    return 0;
+}
+
+int main(void)
+{
+    AVIOConnectionPoolStats stats;
+    Server srv = { 0 };
+    int closed = 0;
+
+    avformat_network_init();
+    if (server_start(&srv) < 0)
+        return 1;
+
+    if (request(&srv, "first",        "")                       < 0 ||
+        request(&srv, "same options", "")                       < 0 ||
+        request(&srv, "tcp_nodelay",  "tcp_nodelay=1")          < 0 ||
+        request(&srv, "tcp_nodelay",  "tcp_nodelay=1")          < 0 ||
+        request(&srv, "defaults",     "")                       < 0 ||
+        request(&srv, "send buffer",  "send_buffer_size=65536") < 0)
+        return 1;
+
+    avio_get_connection_pool_stats(&stats);
+    printf("idle before deinit: %"PRIu64"\n", stats.nb_idle);
+    avformat_network_deinit();
+    avio_get_connection_pool_stats(&stats);
+    printf("idle after deinit: %"PRIu64"\n", stats.nb_idle);
+
+    /* the server sees the idle connections being closed */
+    for (int i = 0; i < 500 && closed < 3; i++) {
+        server_count(&srv, &closed);
+        av_usleep(10000);
+    }
+    printf("closed: %d\n", closed);
+    server_stop(&srv);
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/thread.h"
+#include "libavformat/avformat.h"
+#include "libavformat/network.h"
+#include "libavformat/url.h"
+
+#include "file_fixture.h"
+
+#define MAX_CONNS  8
+#define BLOCK_SIZE 4096
+#define FILE_SIZE  (3 * BLOCK_SIZE + 1808)
+
+/* A keep-alive HTTP server on the loopback interface, which answers range
+ * requests on a generated file. The responses starting at trunc_offset end
+ * after half of their body, trunc_count times. */
+typedef struct Server {
+    int listen_fd;
+    int port;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int quit;
+    int trunc_offset;
+    int trunc_count;
+} Server;
+
+/* Answer a request, return 0 if the connection is to be closed. */
+static int serve(Server *srv, int fd, const char *req)
+{
+    const char *range = strstr(req, "\r\nRange: bytes=");
+    uint8_t body[FILE_SIZE];
+    char head[256];
+    int start = 0, end = FILE_SIZE - 1, len, trunc = 0;
+
+    if (range)
+        sscanf(range, "\r\nRange: bytes=%d-%d", &start, &end);
+    end = FFMIN(end, FILE_SIZE - 1);
+    len = end - start + 1;
+    for (int i = 0; i < len; i++)
+        body[i] = file_byte(start + i);
+
+    pthread_mutex_lock(&srv->lock);
+    if (start == srv->trunc_offset && srv->trunc_count) {
+        srv->trunc_count--;
+        trunc = 1;
+    }
+    pthread_mutex_unlock(&srv->lock);
+
+    snprintf(head, sizeof(head), "HTTP/1.1 206 Partial Content\r\n"
+             "Content-Range: bytes %d-%d/%d\r\n"
+             "Content-Length: %d\r\n"
+             "\r\n", start, end, FILE_SIZE, len);
+    send(fd, head, strlen(head), 0);
+    send(fd, body, trunc ? len / 2 : len, 0);
+    return !trunc;
+}
+
+static void *server_thread(void *arg)
+{
+    Server *srv = arg;
+    struct pollfd p[MAX_CONNS + 1] = { { srv->listen_fd, POLLIN } };
+    static char req[MAX_CONNS][4096];
+    int len[MAX_CONNS] = { 0 };
+    int nb_conns = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&srv->lock);
+        if (srv->quit) {
+            pthread_mutex_unlock(&srv->lock);
+            break;
+        }
+        pthread_mutex_unlock(&srv->lock);
+
+        if (poll(p, nb_conns + 1, 10) <= 0)
+            continue;
+        if (p[0].revents & POLLIN && nb_conns < MAX_CONNS) {
+            int fd = accept(srv->listen_fd, NULL, NULL);
+            if (fd >= 0) {
+                p[++nb_conns] = (struct pollfd){ fd, POLLIN };
+                len[nb_conns - 1] = 0;
+            }
+        }
+        for (int i = 1; i <= nb_conns; i++) {
+            char *r = req[i - 1];
+            int ret = 0;
+
+            if (!(p[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            ret = recv(p[i].fd, r + len[i - 1], sizeof(req[0]) - 1 - len[i - 1], 0);
+            if (ret > 0) {
+                len[i - 1] += ret;
+                r[len[i - 1]] = 0;
+                if (!strstr(r, "\r\n\r\n"))
+                    continue;
+                len[i - 1] = 0;
+                if (serve(srv, p[i].fd, r))
+                    continue;
+            }
+            closesocket(p[i].fd);
+            p[i]       = p[nb_conns];
+            len[i - 1] = len[nb_conns - 1];
+            memcpy(r, req[nb_conns - 1], len[i - 1]);
+            nb_conns--;
+            i--;
+        }
+    }
+    for (int i = 1; i <= nb_conns; i++)
+        closesocket(p[i].fd);
+    return NULL;
+}
+
+static int server_start(Server *srv)
+{
+    struct sockaddr_in addr = { 0 };
+    socklen_t addr_len = sizeof(addr);
+
+    srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (srv->listen_fd < 0)
+        return AVERROR(errno);
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(srv->listen_fd, MAX_CONNS) < 0 ||
+        getsockname(srv->listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        closesocket(srv->listen_fd);
+        return AVERROR(errno);
+    }
+    srv->port = ntohs(addr.sin_port);
+    pthread_mutex_init(&srv->lock, NULL);
+    if (pthread_create(&srv->thread, NULL, server_thread, srv)) {
+        closesocket(srv->listen_fd);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static void server_stop(Server *srv)
+{
+    pthread_mutex_lock(&srv->lock);
+    srv->quit = 1;
+    pthread_mutex_unlock(&srv->lock);
+    pthread_join(srv->thread, NULL);
+    pthread_mutex_destroy(&srv->lock);
+    closesocket(srv->listen_fd);
+}
+
+static pthread_t main_thread;
+static atomic_int nb_foreign_calls;
+
+/* counts the calls made from the threads of the range cache */
+static int interrupt_cb(void *opaque)
+{
+    if (!pthread_equal(pthread_self(), main_thread))
+        atomic_fetch_add(&nb_foreign_calls, 1);
+    return 0;
+}
+
+/* Read the whole file through the range cache, retrying once after an
+ * error, and check its contents. */
+static int run(Server *srv, const char *name, int trunc_offset, int trunc_count)
+{
+    const AVIOInterruptCB int_cb = { interrupt_cb, NULL };
+    AVDictionary *opts = NULL;
+    URLContext *h = NULL;
+    uint8_t buf[1000];
+    char url[64];
+    int ret, pos = 0, bad = 0, nb_errors = 0, eio = 1;
+
+    pthread_mutex_lock(&srv->lock);
+    srv->trunc_offset = trunc_offset;
+    srv->trunc_count  = trunc_count;
+    pthread_mutex_unlock(&srv->lock);
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/file", srv->port);
+    av_dict_set(&opts, "range_cache", "8", 0);
+    av_dict_set_int(&opts, "range_block_size", BLOCK_SIZE, 0);
+    av_dict_set(&opts, "range_parallel", "2", 0);
+    ret = ffurl_open_whitelist(&h, url, AVIO_FLAG_READ, &int_cb, &opts,
+                               NULL, NULL, NULL);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    while (pos < FILE_SIZE) {
+        ret = ffurl_read(h, buf, sizeof(buf));
+        if (ret < 0) {
+            eio &= ret == AVERROR(EIO);
+            if (++nb_errors > 3)
+                break;
+            continue;
+        }
+        bad += count_bad(buf, ret, pos);
+        pos += ret;
+    }
+    ffurl_closep(&h);
+
+    printf("%s: %d bytes, %d bad, %d errors%s\n", name, pos, bad, nb_errors,
+           nb_errors ? eio ? " (EIO)" : " (other)" : "");
+    return 0;
+}
+
+int main(void)
+{
+    Server srv = { 0 };
+
+    main_thread = pthread_self();
+    if (server_start(&srv) < 0)
+        return 1;
+
+    if (run(&srv, "complete",                 -1,          0) < 0 ||
+        run(&srv, "short first block",         0,          1) < 0 ||
+        run(&srv, "short block",               BLOCK_SIZE, 1) < 0 ||
+        run(&srv, "short block, twice",        BLOCK_SIZE, 2) < 0 ||
+        run(&srv, "short last block",      3 * BLOCK_SIZE, 1) < 0)
+        return 1;
+    printf("interrupt callbacks from other threads: %d\n",
+           atomic_load(&nb_foreign_calls));
+
+    server_stop(&srv);
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+#include "libavutil/lfg.h"
+#include "libavformat/avformat.h"
+#include "libavformat/internal.h"
+
+#define NB_TRIALS  2000
+#define MAX_ENTRIES 64
+
+static int random_size(AVLFG *lfg)
+{
+    switch (av_lfg_get(lfg) % 16) {
+    case 0:  return -1;
+    case 1:  return 0x40000000;     /* does not fit an AVIndexEntry */
+    case 2:  return 0x3FFFFFFF;
+    default: return av_lfg_get(lfg) % 10;
+    }
+}
+
+static int64_t random_timestamp(AVLFG *lfg)
+{
+    return av_lfg_get(lfg) % 32 ? av_lfg_get(lfg) % 100 : AV_NOPTS_VALUE;
+}
+
+static int same_index(const AVStream *a, const AVStream *b)
+{
+    if (a->nb_index_entries != b->nb_index_entries)
+        return 0;
+    for (int i = 0; i < a->nb_index_entries; i++) {
+        const AVIndexEntry *x = &a->index_entries[i], *y = &b->index_entries[i];
+        if (x->pos != y->pos || x->timestamp != y->timestamp ||
+            x->flags != y->flags || x->size != y->size ||
+            x->min_distance != y->min_distance)
+            return 0;
+    }
+    return 1;
+}
+
+/* Build the same index on two streams, adding a random batch of entries to
+ * random existing ones, entry by entry on the first and at once on the
+ * second. */
+static int trial(AVLFG *lfg)
+{
+    AVFormatContext *s = avformat_alloc_context();
+    FFIndexEntry batch[MAX_ENTRIES];
+    AVStream *a, *b;
+    int ret = -1, nb_old, nb_new;
+
+    if (!s || !(a = avformat_new_stream(s, NULL)) ||
+        !(b = avformat_new_stream(s, NULL)))
+        goto end;
+
+    nb_old = av_lfg_get(lfg) % MAX_ENTRIES;
+    nb_new = av_lfg_get(lfg) % MAX_ENTRIES;
+    for (int i = 0; i < nb_old; i++) {
+        int64_t pos = av_lfg_get(lfg) % 3, timestamp = av_lfg_get(lfg) % 100;
+        int size = av_lfg_get(lfg) % 10, distance = av_lfg_get(lfg) % 5;
+        int flags = av_lfg_get(lfg) % 2;
+        av_add_index_entry(a, pos, timestamp, size, distance, flags);
+        av_add_index_entry(b, pos, timestamp, size, distance, flags);
+    }
+    for (int i = 0; i < nb_new; i++) {
+        FFIndexEntry *e = &batch[i];
+        e->pos       = av_lfg_get(lfg) % 3;
+        e->timestamp = random_timestamp(lfg);
+        e->size      = random_size(lfg);
+        e->distance  = av_lfg_get(lfg) % 5;
+        e->flags     = av_lfg_get(lfg) % 2;
+        av_add_index_entry(a, e->pos, e->timestamp, e->size, e->distance, e->flags);
+    }
+    if (ff_add_index_entries(b, batch, nb_new) < 0)
+        goto end;
+    ret = same_index(a, b);
+end:
+    avformat_free_context(s);
+    return ret;
+}
+
+int main(void)
+{
+    AVLFG lfg;
+    int nb_mismatches = 0;
+
+    av_lfg_init(&lfg, 1);
+    for (int i = 0; i < NB_TRIALS; i++) {
+        int ret = trial(&lfg);
+        if (ret < 0)
+            return 1;
+        nb_mismatches += !ret;
+    }
+    printf("%d trials, %d mismatches\n", NB_TRIALS, nb_mismatches);
+
+    return nb_mismatches != 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/opt.h"
+#include "libavformat/avformat.h"
+#include "libavformat/url.h"
+
+#define NB_DATAGRAMS 200
+
+static int datagram_size(int i)
+{
+    return 16 + i * 37 % 1400;
+}
+
+static void fill_datagram(uint8_t *buf, int i)
+{
+    for (int j = 0; j < datagram_size(i); j++)
+        buf[j] = i * 3 + j;
+}
+
+/* Send datagrams of varying sizes through the circular buffer threads of a
+ * writer and a reader on the loopback interface, batching on either side. */
+static int run(int rx_batch, int tx_batch)
+{
+    URLContext *rx = NULL, *tx = NULL;
+    AVDictionary *opts = NULL;
+    uint8_t buf[2048], ref[2048];
+    char url[256];
+    int64_t port, received = -1;
+    int ret, nb = 0, bad = 0;
+
+    snprintf(url, sizeof(url), "udp://127.0.0.1:0?localaddr=127.0.0.1"
+             "&fifo_size=10000&batch_size=%d", rx_batch);
+    /* do not wait forever for a lost datagram */
+    av_dict_set(&opts, "rw_timeout", "5000000", 0);
+    ret = ffurl_open_whitelist(&rx, url, AVIO_FLAG_READ, NULL, &opts,
+                               NULL, NULL, NULL);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    if ((ret = av_opt_get_int(rx, "localport", AV_OPT_SEARCH_CHILDREN, &port)) < 0)
+        goto end;
+
+    /* the bitrate and fifo_size start the thread of the writer */
+    snprintf(url, sizeof(url), "udp://127.0.0.1:%"PRId64"?fifo_size=10000"
+             "&bitrate=100000000&batch_size=%d", port, tx_batch);
+    ret = ffurl_open_whitelist(&tx, url, AVIO_FLAG_WRITE, NULL, NULL,
+                               NULL, NULL, NULL);
+    if (ret < 0)
+        goto end;
+    for (int i = 0; i < NB_DATAGRAMS; i++) {
+        fill_datagram(buf, i);
+        if ((ret = ffurl_write(tx, buf, datagram_size(i))) < 0)
+            goto end;
+    }
+    /* closing waits for the queued datagrams to be sent */
+    ffurl_closep(&tx);
+
+    for (nb = 0; nb < NB_DATAGRAMS; nb++) {
+        ret = ffurl_read(rx, buf, sizeof(buf));
+        if (ret < 0)
+            break;
+        fill_datagram(ref, nb);
+        bad += ret != datagram_size(nb) || memcmp(buf, ref, ret);
+    }
+    ret = av_opt_get_int(rx, "packets_received", AV_OPT_SEARCH_CHILDREN, &received);
+    printf("rx batch %d tx batch %d: %d datagrams, %d bad, %"PRId64" counted\n",
+           rx_batch, tx_batch, nb, bad, received);
+
+end:
+    ffurl_closep(&tx);
+    ffurl_closep(&rx);
+    return ret;
+}
+
+int main(void)
+{
+    static const int batch[][2] = { { 1, 1 }, { 8, 1 }, { 1, 8 }, { 8, 8 }, { 64, 64 } };
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(batch); i++)
+        if (run(batch[i][0], batch[i][1]) < 0)
+            return 1;
+
+    return 0;
+}
@@ -26,12 +26,12 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
 #include "libavutil/avassert.h"
 #include "libavutil/parseutils.h"
-#include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
@@ -67,6 +67,8 @@
 #endif
 
 #if HAVE_PTHREAD_CANCEL
+#include <stdatomic.h>
+#include "libavutil/spscring.h"
 #include "libavutil/thread.h"
 #endif
 
@@ -79,6 +81,13 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_BATCH_SIZE 256
+/* each datagram of a batch is preceded by its length, as in the ring */
+#define UDP_BATCH_SLOT_SIZE (UDP_MAX_PKT_SIZE + 4)
+
+#if defined(SO_RXQ_OVFL) && HAVE_RECVMMSG
+#define UDP_CMSG_SIZE CMSG_SPACE(sizeof(uint32_t))
+#endif
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -98,18 +107,35 @@ typedef struct UDPContext {
 
     /* Circular Buffer variables for use in UDP receive code */
     int circular_buffer_size;
-    AVFifoBuffer *fifo;
-    int circular_buffer_error;
     int64_t bitrate; /* number of bits to send per second */
     int64_t burst_bits;
-    int close_req;
 #if HAVE_PTHREAD_CANCEL
+    /* the thread is the only producer (rx) or consumer (tx) of the ring */
+    AVSPSCRing *ring;
+    atomic_int circular_buffer_error;
     pthread_t circular_buffer_thread;
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
     int thread_started;
+    /* counters of the receive thread, copied to the exported options below
+     * by the reading thread */
+    atomic_int_least64_t thread_received;
+    atomic_int_least64_t thread_dropped;
+    atomic_int_least64_t thread_kernel_drops;
+#endif
+    /* datagrams moved between the socket and the ring by the thread */
+    int batch_size;
+    uint8_t *batch_buf;
+    int *batch_len;
+    struct sockaddr_storage *batch_addr;
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+#endif
+#ifdef UDP_CMSG_SIZE
+    uint8_t *control;
 #endif
-    uint8_t tmp[UDP_MAX_PKT_SIZE+4];
+    int64_t packets_received;
+    int64_t packets_dropped;
+    int64_t kernel_drops;
     int remaining_in_dg;
     char *localaddr;
     int timeout;
@@ -138,6 +164,10 @@ static const AVOption options[] = {
     { "connect",        "set if connect() should be called on socket",     OFFSET(is_connected),   AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = D|E },
     { "fifo_size",      "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
     { "overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,    D },
+    { "batch_size",     "Maximum number of datagrams received or sent per system call by the circular buffer thread", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, UDP_MAX_BATCH_SIZE, .flags = D|E },
+    { "packets_received", "export the number of datagrams received", OFFSET(packets_received), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "packets_dropped", "export the number of datagrams dropped on circular buffer overrun", OFFSET(packets_dropped), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "kernel_drops",   "export the number of datagrams dropped by the system because the socket buffer was full", OFFSET(kernel_drops), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { "timeout",        "set raise error timeout, in microseconds (only in read mode)",OFFSET(timeout),         AV_OPT_TYPE_INT,  {.i64 = 0}, 0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -460,6 +490,154 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+static int udp_alloc_batch(UDPContext *s)
+{
+    s->batch_buf  = av_malloc_array(s->batch_size, UDP_BATCH_SLOT_SIZE);
+    s->batch_len  = av_malloc_array(s->batch_size, sizeof(*s->batch_len));
+    s->batch_addr = av_malloc_array(s->batch_size, sizeof(*s->batch_addr));
+    if (!s->batch_buf || !s->batch_len || !s->batch_addr)
+        return AVERROR(ENOMEM);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    s->msgs = av_mallocz_array(s->batch_size, sizeof(*s->msgs));
+    s->iov  = av_mallocz_array(s->batch_size, sizeof(*s->iov));
+    if (!s->msgs || !s->iov)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < s->batch_size; i++) {
+        s->iov[i].iov_base            = s->batch_buf + i * UDP_BATCH_SLOT_SIZE + 4;
+        s->msgs[i].msg_hdr.msg_iov    = &s->iov[i];
+        s->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+#ifdef UDP_CMSG_SIZE
+    s->control = av_malloc_array(s->batch_size, UDP_CMSG_SIZE);
+    if (!s->control)
+        return AVERROR(ENOMEM);
+#endif
+    return 0;
+}
+#endif
+
+static void udp_free_batch(UDPContext *s)
+{
+    av_freep(&s->batch_buf);
+    av_freep(&s->batch_len);
+    av_freep(&s->batch_addr);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+#endif
+#ifdef UDP_CMSG_SIZE
+    av_freep(&s->control);
+#endif
+}
+
+#if HAVE_PTHREAD_CANCEL
+/**
+ * Receive up to batch_size datagrams into the batch slots, waiting for the
+ * first one only.
+ *
+ * @return the number of datagrams received, or a negative value on error,
+ *         with the error in ff_neterrno()
+ */
+static int udp_recv_batch(UDPContext *s)
+{
+#if HAVE_RECVMMSG
+    int i, nb;
+
+    for (i = 0; i < s->batch_size; i++) {
+        struct msghdr *hdr = &s->msgs[i].msg_hdr;
+        s->iov[i].iov_len   = UDP_MAX_PKT_SIZE;
+        hdr->msg_name       = &s->batch_addr[i];
+        hdr->msg_namelen    = sizeof(s->batch_addr[i]);
+#ifdef UDP_CMSG_SIZE
+        hdr->msg_control    = s->control + i * UDP_CMSG_SIZE;
+        hdr->msg_controllen = UDP_CMSG_SIZE;
+#endif
+    }
+
+    nb = recvmmsg(s->udp_fd, s->msgs, s->batch_size, MSG_WAITFORONE, NULL);
+    for (i = 0; i < nb; i++) {
+#ifdef UDP_CMSG_SIZE
+        struct cmsghdr *cmsg;
+        for (cmsg = CMSG_FIRSTHDR(&s->msgs[i].msg_hdr); cmsg;
+             cmsg = CMSG_NXTHDR(&s->msgs[i].msg_hdr, cmsg)) {
+            /* the counter is cumulative since the socket was created */
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+                atomic_store_explicit(&s->thread_kernel_drops, AV_RN32(CMSG_DATA(cmsg)),
+                                      memory_order_relaxed);
+        }
+#endif
+        s->batch_len[i] = s->msgs[i].msg_len;
+    }
+    return nb;
+#else
+    socklen_t addr_len = sizeof(s->batch_addr[0]);
+    int len = recvfrom(s->udp_fd, s->batch_buf + 4, UDP_MAX_PKT_SIZE, 0,
+                       (struct sockaddr *)&s->batch_addr[0], &addr_len);
+    if (len < 0)
+        return len;
+    s->batch_len[0] = len;
+    return 1;
+#endif
+}
+
+/**
+ * Send the first nb datagrams of the batch slots.
+ *
+ * @return 0 on success, a negative AVERROR on failure
+ */
+static int udp_send_batch(UDPContext *s, int nb)
+{
+    int i = 0, ret;
+
+#if HAVE_SENDMMSG
+    for (i = 0; i < nb; i++) {
+        struct msghdr *hdr = &s->msgs[i].msg_hdr;
+        s->iov[i].iov_len   = s->batch_len[i];
+        hdr->msg_name       = s->is_connected ? NULL : &s->dest_addr;
+        hdr->msg_namelen    = s->is_connected ? 0    : s->dest_addr_len;
+        hdr->msg_control    = NULL;
+        hdr->msg_controllen = 0;
+    }
+
+    i = 0;
+    while (i < nb) {
+        ret = sendmmsg(s->udp_fd, s->msgs + i, nb - i, 0);
+        if (ret >= 0) {
+            i += ret;
+        } else {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+        }
+    }
+#else
+    for (i = 0; i < nb; i++) {
+        const uint8_t *p = s->batch_buf + i * UDP_BATCH_SLOT_SIZE + 4;
+        int len = s->batch_len[i];
+
+        while (len) {
+            av_assert0(len > 0);
+            if (!s->is_connected) {
+                ret = sendto (s->udp_fd, p, len, 0,
+                            (struct sockaddr *) &s->dest_addr,
+                            s->dest_addr_len);
+            } else
+                ret = send(s->udp_fd, p, len, 0);
+            if (ret >= 0) {
+                len -= ret;
+                p   += ret;
+            } else {
+                ret = ff_neterrno();
+                if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                    return ret;
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -467,57 +645,57 @@ static void *circular_buffer_task_rx( void *_URLContext)
     int old_cancelstate;
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-    pthread_mutex_lock(&s->mutex);
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
-        goto end;
+        av_spsc_ring_set_err_read(s->ring, AVERROR(EIO));
+        return NULL;
     }
     while(1) {
-        int len;
-        struct sockaddr_storage addr;
-        socklen_t addr_len = sizeof(addr);
+        int i, nb;
 
-        pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
+        nb = udp_recv_batch(s);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-        pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
+        if (nb < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
-                goto end;
+                av_spsc_ring_set_err_read(s->ring, ff_neterrno());
+                return NULL;
             }
             continue;
         }
-        if (ff_ip_check_source_lists(&addr, &s->filters))
-            continue;
-        AV_WL32(s->tmp, len);
+        /* each datagram is published with its length in a single write,
+         * the reader is only woken up if it waits for data */
+        for (i = 0; i < nb; i++) {
+            uint8_t *buf = s->batch_buf + i * UDP_BATCH_SLOT_SIZE;
+            int len = s->batch_len[i];
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+            if (ff_ip_check_source_lists(&s->batch_addr[i], &s->filters))
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+            atomic_fetch_add_explicit(&s->thread_received, 1, memory_order_relaxed);
+            AV_WL32(buf, len);
+
+            if (av_spsc_ring_can_write(s->ring) < len + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    atomic_fetch_add_explicit(&s->thread_dropped, 1, memory_order_relaxed);
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    av_spsc_ring_set_err_read(s->ring, AVERROR(EIO));
+                    return NULL;
+                }
             }
+            av_spsc_ring_write(s->ring, buf, len + 4, 0);
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
-        pthread_cond_signal(&s->cond);
     }
 
-end:
-    pthread_cond_signal(&s->cond);
-    pthread_mutex_unlock(&s->mutex);
     return NULL;
 }
 
@@ -531,41 +709,38 @@ static void *circular_buffer_task_tx( void *_URLContext)
     int64_t burst_interval = s->bitrate ? (s->burst_bits * 1000000 / s->bitrate) : 0;
     int64_t max_delay = s->bitrate ?  ((int64_t)h->max_packet_size * 8 * 1000000 / s->bitrate + 1) : 0;
 
-    pthread_mutex_lock(&s->mutex);
-
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
-        goto end;
+        atomic_store(&s->circular_buffer_error, AVERROR(EIO));
+        av_spsc_ring_set_err_write(s->ring, AVERROR(EIO));
+        return NULL;
     }
 
     for(;;) {
-        int len;
-        const uint8_t *p;
+        int len, nb, ret;
         uint8_t tmp[4];
         int64_t timestamp;
 
-        len = av_fifo_size(s->fifo);
-
-        while (len<4) {
-            if (s->close_req)
-                goto end;
-            if (pthread_cond_wait(&s->cond, &s->mutex) < 0) {
-                goto end;
-            }
-            len = av_fifo_size(s->fifo);
+        /* wait for one datagram, then take whatever else is already queued,
+         * up to a batch; udp_close() ends the ring with AVERROR_EOF */
+        len = 0;
+        for (nb = 0; nb < s->batch_size; nb++) {
+            if (nb && av_spsc_ring_can_read(s->ring) < 4)
+                break;
+            if (av_spsc_ring_read(s->ring, tmp, 4, -1) < 0)
+                return NULL;
+            s->batch_len[nb] = AV_RL32(tmp);
+
+            av_assert0(s->batch_len[nb] >= 0);
+            av_assert0(s->batch_len[nb] <= UDP_MAX_PKT_SIZE);
+
+            /* udp_write() publishes the data right after its length */
+            if (av_spsc_ring_read(s->ring, s->batch_buf + nb * UDP_BATCH_SLOT_SIZE + 4,
+                                  s->batch_len[nb], -1) < 0)
+                return NULL;
+            len += s->batch_len[nb];
         }
 
-        av_fifo_generic_read(s->fifo, tmp, 4, NULL);
-        len = AV_RL32(tmp);
-
-        av_assert0(len >= 0);
-        av_assert0(len <= sizeof(s->tmp));
-
-        av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
-
-        pthread_mutex_unlock(&s->mutex);
-
         if (s->bitrate) {
             timestamp = av_gettime_relative();
             if (timestamp < target_timestamp) {
@@ -586,36 +761,13 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
-        p = s->tmp;
-        while (len) {
-            int ret;
-            av_assert0(len > 0);
-            if (!s->is_connected) {
-                ret = sendto (s->udp_fd, p, len, 0,
-                            (struct sockaddr *) &s->dest_addr,
-                            s->dest_addr_len);
-            } else
-                ret = send(s->udp_fd, p, len, 0);
-            if (ret >= 0) {
-                len -= ret;
-                p   += ret;
-            } else {
-                ret = ff_neterrno();
-                if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
-                    pthread_mutex_lock(&s->mutex);
-                    s->circular_buffer_error = ret;
-                    pthread_mutex_unlock(&s->mutex);
-                    return NULL;
-                }
-            }
+        ret = udp_send_batch(s, nb);
+        if (ret < 0) {
+            atomic_store(&s->circular_buffer_error, ret);
+            av_spsc_ring_set_err_write(s->ring, ret);
+            return NULL;
         }
-
-        pthread_mutex_lock(&s->mutex);
     }
-
-end:
-    pthread_mutex_unlock(&s->mutex);
-    return NULL;
 }
 
 
@@ -706,6 +858,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                        "'bitrate' option was set but it is not supported "
                        "on this build (pthread support is required)\n");
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_BATCH_SIZE);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
             s->burst_bits = strtoll(buf, NULL, 10);
         }
@@ -875,6 +1030,13 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                 av_log(h, AV_LOG_WARNING, "attempted to set receive buffer to size %d but it only ended up set as %d\n", s->buffer_size, tmp);
         }
 
+#ifdef UDP_CMSG_SIZE
+        /* have the kernel report the datagrams dropped on this socket */
+        tmp = 1;
+        if (setsockopt(udp_fd, SOL_SOCKET, SO_RXQ_OVFL, &tmp, sizeof(tmp)) < 0)
+            ff_log_net_error(h, AV_LOG_DEBUG, "setsockopt(SO_RXQ_OVFL)");
+#endif
+
         /* make the socket non-blocking */
         ff_socket_nonblock(udp_fd, 1);
     }
@@ -902,44 +1064,33 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
         /* start the task going */
-        s->fifo = av_fifo_alloc(s->circular_buffer_size);
-        if (!s->fifo) {
-            ret = AVERROR(ENOMEM);
+        ret = av_spsc_ring_alloc(&s->ring, s->circular_buffer_size);
+        if (ret < 0)
             goto fail;
-        }
-        ret = pthread_mutex_init(&s->mutex, NULL);
-        if (ret != 0) {
-            av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
-            ret = AVERROR(ret);
+        atomic_init(&s->circular_buffer_error, 0);
+        atomic_init(&s->thread_received, 0);
+        atomic_init(&s->thread_dropped, 0);
+        atomic_init(&s->thread_kernel_drops, 0);
+        if ((ret = udp_alloc_batch(s)) < 0)
             goto fail;
-        }
-        ret = pthread_cond_init(&s->cond, NULL);
-        if (ret != 0) {
-            av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
-            ret = AVERROR(ret);
-            goto cond_fail;
-        }
         ret = pthread_create(&s->circular_buffer_thread, NULL, is_output?circular_buffer_task_tx:circular_buffer_task_rx, h);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
             ret = AVERROR(ret);
-            goto thread_fail;
+            goto fail;
         }
         s->thread_started = 1;
     }
 #endif
 
     return 0;
-#if HAVE_PTHREAD_CANCEL
- thread_fail:
-    pthread_cond_destroy(&s->cond);
- cond_fail:
-    pthread_mutex_destroy(&s->mutex);
-#endif
  fail:
     if (udp_fd >= 0)
         closesocket(udp_fd);
-    av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL
+    av_spsc_ring_free(&s->ring);
+#endif
+    udp_free_batch(s);
     ff_ip_reset_filters(&s->filters);
     return ret;
 }
@@ -954,6 +1105,15 @@ static int udplite_open(URLContext *h, const char *uri, int flags)
     return udp_open(h, uri, flags);
 }
 
+#if HAVE_PTHREAD_CANCEL
+static void udp_update_thread_stats(UDPContext *s)
+{
+    s->packets_received = atomic_load_explicit(&s->thread_received,     memory_order_relaxed);
+    s->packets_dropped  = atomic_load_explicit(&s->thread_dropped,      memory_order_relaxed);
+    s->kernel_drops     = atomic_load_explicit(&s->thread_kernel_drops, memory_order_relaxed);
+}
+#endif
+
 static int udp_read(URLContext *h, uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
@@ -963,45 +1123,25 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
 #if HAVE_PTHREAD_CANCEL
     int avail, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
 
-    if (s->fifo) {
-        pthread_mutex_lock(&s->mutex);
-        do {
-            avail = av_fifo_size(s->fifo);
-            if (avail) { // >=size) {
-                uint8_t tmp[4];
-
-                av_fifo_generic_read(s->fifo, tmp, 4, NULL);
-                avail = AV_RL32(tmp);
-                if(avail > size){
-                    av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
-                    avail = size;
-                }
+    if (s->ring) {
+        uint8_t tmp[4];
 
-                av_fifo_generic_read(s->fifo, buf, avail, NULL);
-                av_fifo_drain(s->fifo, AV_RL32(tmp) - avail);
-                pthread_mutex_unlock(&s->mutex);
-                return avail;
-            } else if(s->circular_buffer_error){
-                int err = s->circular_buffer_error;
-                pthread_mutex_unlock(&s->mutex);
-                return err;
-            } else if(nonblock) {
-                pthread_mutex_unlock(&s->mutex);
-                return AVERROR(EAGAIN);
-            } else {
-                /* FIXME: using the monotonic clock would be better,
-                   but it does not exist on all supported platforms. */
-                int64_t t = av_gettime() + 100000;
-                struct timespec tv = { .tv_sec  =  t / 1000000,
-                                       .tv_nsec = (t % 1000000) * 1000 };
-                int err = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
-                if (err) {
-                    pthread_mutex_unlock(&s->mutex);
-                    return AVERROR(err == ETIMEDOUT ? EAGAIN : err);
-                }
-                nonblock = 1;
-            }
-        } while(1);
+        /* the thread writes a datagram and its length at once, so only the
+         * length has to be waited for */
+        ret = av_spsc_ring_read(s->ring, tmp, 4, nonblock ? 0 : 100000);
+        udp_update_thread_stats(s);
+        if (ret < 0)
+            return ret;
+        avail = AV_RL32(tmp);
+        if(avail > size){
+            av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+            avail = size;
+        }
+
+        av_spsc_ring_read(s->ring, buf, avail, 0);
+        if (AV_RL32(tmp) > avail)
+            av_spsc_ring_read(s->ring, NULL, AV_RL32(tmp) - avail, 0);
+        return avail;
     }
 #endif
 
@@ -1015,6 +1155,7 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
         return ff_neterrno();
     if (ff_ip_check_source_lists(&addr, &s->filters))
         return AVERROR(EINTR);
+    s->packets_received++;
     return ret;
 }
 
@@ -1024,31 +1165,25 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     int ret;
 
 #if HAVE_PTHREAD_CANCEL
-    if (s->fifo) {
+    if (s->ring) {
         uint8_t tmp[4];
-
-        pthread_mutex_lock(&s->mutex);
+        int err;
 
         /*
           Return error if last tx failed.
           Here we can't know on which packet error was, but it needs to know that error exists.
         */
-        if (s->circular_buffer_error<0) {
-            int err = s->circular_buffer_error;
-            pthread_mutex_unlock(&s->mutex);
+        if ((err = atomic_load(&s->circular_buffer_error)) < 0)
             return err;
-        }
 
-        if(av_fifo_space(s->fifo) < size + 4) {
+        if (av_spsc_ring_can_write(s->ring) < size + 4) {
             /* What about a partial packet tx ? */
-            pthread_mutex_unlock(&s->mutex);
             return AVERROR(ENOMEM);
         }
         AV_WL32(tmp, size);
-        av_fifo_generic_write(s->fifo, tmp, 4, NULL); /* size of packet */
-        av_fifo_generic_write(s->fifo, (uint8_t *)buf, size, NULL); /* the data */
-        pthread_cond_signal(&s->cond);
-        pthread_mutex_unlock(&s->mutex);
+        if ((err = av_spsc_ring_write(s->ring, tmp, 4, 0)) < 0 || /* size of packet */
+            (err = av_spsc_ring_write(s->ring, buf, size, 0)) < 0) /* the data */
+            return err;
         return size;
     }
 #endif
@@ -1074,12 +1209,8 @@ static int udp_close(URLContext *h)
 
 #if HAVE_PTHREAD_CANCEL
     // Request close once writing is finished
-    if (s->thread_started && !(h->flags & AVIO_FLAG_READ)) {
-        pthread_mutex_lock(&s->mutex);
-        s->close_req = 1;
-        pthread_cond_signal(&s->cond);
-        pthread_mutex_unlock(&s->mutex);
-    }
+    if (s->thread_started && !(h->flags & AVIO_FLAG_READ))
+        av_spsc_ring_set_err_read(s->ring, AVERROR_EOF);
 #endif
 
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
@@ -1102,12 +1233,12 @@ static int udp_close(URLContext *h)
         ret = pthread_join(s->circular_buffer_thread, NULL);
         if (ret != 0)
             av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", strerror(ret));
-        pthread_mutex_destroy(&s->mutex);
-        pthread_cond_destroy(&s->cond);
+        udp_update_thread_stats(s);
     }
+    av_spsc_ring_free(&s->ring);
 #endif
     closesocket(s->udp_fd);
-    av_fifo_freep(&s->fifo);
+    udp_free_batch(s);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
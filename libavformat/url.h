@@ -27,6 +27,7 @@
 #include "avio.h"
 #include "libavformat/version.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -49,6 +50,8 @@ typedef struct URLContext {
     const char *protocol_whitelist;
     const char *protocol_blacklist;
     int min_packet_size;        /**< if non zero, the stream is packetized with this min packet size */
+    int io_buffer_min;          /**< minimum size of the adaptive AVIOContext read buffer */
+    int io_buffer_max;          /**< maximum size of the adaptive AVIOContext read buffer, 0 if fixed */
 } URLContext;
 
 typedef struct URLProtocol {
@@ -87,6 +90,9 @@ typedef struct URLProtocol {
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
     int (*url_shutdown)(URLContext *h, int flags);
+    int (*url_get_mapping)(URLContext *h, AVBufferRef **map, int64_t *size);
+    int (*url_map_packet)(URLContext *h, int64_t pos, int size, int padding,
+                          AVBufferRef **buf);
     const AVClass *priv_data_class;
     int priv_data_size;
     int flags;
@@ -266,6 +272,30 @@ int ffurl_get_short_seek(URLContext *h);
  */
 int ffurl_shutdown(URLContext *h, int flags);
 
+/**
+ * Return a read-only memory mapping of the whole resource.
+ *
+ * @param map  set to the mapping, owned by h: it must be referenced with
+ *             av_buffer_ref() to be used after h is closed. Its data field
+ *             points to the start of the resource, its size field is not
+ *             meaningful.
+ * @param size set to the size of the mapping
+ * @return 0 on success, AVERROR(ENOSYS) if the resource is not mapped
+ */
+int ffurl_get_mapping(URLContext *h, AVBufferRef **map, int64_t *size);
+
+/**
+ * Return a read-only reference to a memory mapping of size bytes of the
+ * resource at pos, followed by padding zero bytes.
+ *
+ * @param buf set to the new reference, whose data field points to the bytes
+ *            at pos and whose size is size + padding
+ * @return 0 on success, AVERROR(ENOSYS) if the resource is not mapped or
+ *         the bytes are not entirely within the mapping
+ */
+int ffurl_map_packet(URLContext *h, int64_t pos, int size, int padding,
+                     AVBufferRef **buf);
+
 /**
  * Check if the user has requested to interrupt a blocking function
  * associated with cb.
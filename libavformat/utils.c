@@ -42,6 +42,7 @@
 
 #include "avformat.h"
 #include "avio_internal.h"
+#include "http.h"
 #include "id3v2.h"
 #include "internal.h"
 #if CONFIG_NETWORK
@@ -309,6 +310,8 @@ static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
 
 int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
+    int ret;
+
 #if FF_API_INIT_PACKET
 FF_DISABLE_DEPRECATION_WARNINGS
     av_init_packet(pkt);
@@ -320,6 +323,15 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
     pkt->pos  = avio_tell(s);
 
+    ret = ffio_read_mapped(s, size, &pkt->buf);
+    if (ret != AVERROR(ENOSYS)) {
+        if (ret >= 0) {
+            pkt->data = pkt->buf->data;
+            pkt->size = ret;
+        }
+        return ret;
+    }
+
     return append_packet_chunked(s, pkt, size);
 }
 
@@ -2019,6 +2031,120 @@ int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                               timestamp, size, distance, flags);
 }
 
+typedef struct IndexBatchEntry {
+    AVIndexEntry e;
+    int seq;
+} IndexBatchEntry;
+
+static int index_batch_cmp(const void *a, const void *b)
+{
+    const IndexBatchEntry *x = a, *y = b;
+    if (x->e.timestamp != y->e.timestamp)
+        return x->e.timestamp < y->e.timestamp ? -1 : 1;
+    return x->seq - y->seq;
+}
+
+/* Overwrite o with n, which has the same timestamp, the way
+ * ff_add_index_entry() replaces an existing entry. */
+static void index_entry_replace(AVIndexEntry *o, const AVIndexEntry *n)
+{
+    int distance = n->min_distance;
+    if (o->pos == n->pos && distance < o->min_distance)
+        distance = o->min_distance;
+    *o = *n;
+    o->min_distance = distance;
+}
+
+int ff_add_index_entries(AVStream *st, const FFIndexEntry *new_entries,
+                         int nb_new_entries)
+{
+    IndexBatchEntry *batch;
+    AVIndexEntry *entries;
+    int nb_batch = 0, nb_old = st->nb_index_entries, nb_replaced = 0;
+    int i, j, k;
+
+    if (nb_new_entries <= 0)
+        return 0;
+    if ((unsigned)nb_old + nb_new_entries >= UINT_MAX / sizeof(AVIndexEntry))
+        return AVERROR(ENOMEM);
+
+    batch = av_malloc_array(nb_new_entries, sizeof(*batch));
+    if (!batch)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_new_entries; i++) {
+        const FFIndexEntry *n = &new_entries[i];
+        int64_t timestamp;
+
+        if (n->size < 0 || n->size > 0x3FFFFFFF)
+            continue;
+        timestamp = wrap_timestamp(st, n->timestamp);
+        if (timestamp == AV_NOPTS_VALUE)
+            continue;
+        if (is_relative(timestamp))
+            timestamp -= RELATIVE_TS_BASE;
+        batch[nb_batch].e = (AVIndexEntry) {
+            .pos          = n->pos,
+            .timestamp    = timestamp,
+            .flags        = n->flags,
+            .size         = n->size,
+            .min_distance = n->distance,
+        };
+        batch[nb_batch].seq = nb_batch;
+        nb_batch++;
+    }
+
+    qsort(batch, nb_batch, sizeof(*batch), index_batch_cmp);
+
+    /* Collapse equal timestamps into one entry, folding them in order into
+     * the existing entry with that timestamp if there is one. */
+    for (i = j = 0; i < nb_batch; i++) {
+        if (j && batch[j - 1].e.timestamp == batch[i].e.timestamp) {
+            index_entry_replace(&batch[j - 1].e, &batch[i].e);
+            continue;
+        }
+        k = ff_index_search_timestamp(st->index_entries, nb_old,
+                                      batch[i].e.timestamp, AVSEEK_FLAG_ANY);
+        batch[j] = batch[i];
+        if (k >= 0 && st->index_entries[k].timestamp == batch[j].e.timestamp) {
+            AVIndexEntry e = st->index_entries[k];
+            index_entry_replace(&e, &batch[j].e);
+            batch[j].e = e;
+            nb_replaced++;
+        }
+        j++;
+    }
+    nb_batch = j;
+
+    entries = av_fast_realloc(st->index_entries,
+                              &st->index_entries_allocated_size,
+                              (nb_old + nb_batch) * sizeof(AVIndexEntry));
+    if (!entries) {
+        av_free(batch);
+        return AVERROR(ENOMEM);
+    }
+    st->index_entries = entries;
+
+    /* Merge from the back so that every entry is moved at most once. */
+    i = nb_old - 1;
+    j = nb_batch - 1;
+    k = nb_old + nb_batch - nb_replaced;
+    st->nb_index_entries = k;
+    while (j >= 0) {
+        if (i >= 0 && entries[i].timestamp > batch[j].e.timestamp) {
+            entries[--k] = entries[i--];
+        } else {
+            if (i >= 0 && entries[i].timestamp == batch[j].e.timestamp)
+                i--;
+            entries[--k] = batch[j--].e;
+        }
+    }
+    av_assert0(k == i + 1);
+
+    av_free(batch);
+    return 0;
+}
+
 int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
                               int64_t wanted_timestamp, int flags)
 {
@@ -5068,6 +5194,9 @@ int avformat_network_init(void)
 int avformat_network_deinit(void)
 {
 #if CONFIG_NETWORK
+#if CONFIG_HTTP_PROTOCOL || CONFIG_HTTPS_PROTOCOL || CONFIG_HTTPPROXY_PROTOCOL
+    ff_http_pool_close();
+#endif
     ff_network_close();
     ff_tls_deinit();
 #endif
@@ -26,6 +26,23 @@
 #include "mem.h"
 #include "thread.h"
 
+#define MAX_COPY_SITES 256
+
+typedef struct CopySite {
+    const char *site;
+    atomic_uint_least64_t nb_copies;
+    atomic_uint_least64_t bytes;
+} CopySite;
+
+/* Sites are only ever appended, under copy_site_mutex; the entries below
+ * nb_copy_sites may be read without it. */
+static CopySite copy_sites[MAX_COPY_SITES];
+static atomic_int nb_copy_sites;
+static AVMutex copy_site_mutex = AV_MUTEX_INITIALIZER;
+
+static AVMutex pool_list_mutex = AV_MUTEX_INITIALIZER;
+static AVBufferPool *pool_list;
+
 AVBufferRef *av_buffer_create(uint8_t *data, buffer_size_t size,
                               void (*free)(void *opaque, uint8_t *data),
                               void *opaque, int flags)
@@ -148,7 +165,7 @@ int av_buffer_get_ref_count(const AVBufferRef *buf)
     return atomic_load(&buf->buffer->refcount);
 }
 
-int av_buffer_make_writable(AVBufferRef **pbuf)
+int avpriv_buffer_make_writable(AVBufferRef **pbuf, const char *site)
 {
     AVBufferRef *newbuf, *buf = *pbuf;
 
@@ -160,12 +177,18 @@ int av_buffer_make_writable(AVBufferRef **pbuf)
         return AVERROR(ENOMEM);
 
     memcpy(newbuf->data, buf->data, buf->size);
+    avpriv_buffer_count_copy(site, buf->size);
 
     buffer_replace(pbuf, &newbuf);
 
     return 0;
 }
 
+int av_buffer_make_writable(AVBufferRef **pbuf)
+{
+    return avpriv_buffer_make_writable(pbuf, "av_buffer_make_writable");
+}
+
 int av_buffer_realloc(AVBufferRef **pbuf, buffer_size_t size)
 {
     AVBufferRef *buf = *pbuf;
@@ -202,6 +225,7 @@ int av_buffer_realloc(AVBufferRef **pbuf, buffer_size_t size)
             return ret;
 
         memcpy(new->data, buf->data, FFMIN(size, buf->size));
+        avpriv_buffer_count_copy("av_buffer_realloc", FFMIN(size, buf->size));
 
         buffer_replace(pbuf, &new);
         return 0;
@@ -242,6 +266,97 @@ int av_buffer_replace(AVBufferRef **pdst, AVBufferRef *src)
     return 0;
 }
 
+/* Keep only the last directory of source locations. configure strips the
+ * source directory from them at compile time where the compiler supports
+ * it, this covers the other compilers and the sites given by callers. */
+static const char *copy_site_name(const char *site)
+{
+    const char *p = strrchr(site, '/');
+
+    if (!p)
+        return site;
+    while (p > site && p[-1] != '/')
+        p--;
+    return p;
+}
+
+static CopySite *find_copy_site(const char *site, int start, int end)
+{
+    for (int i = start; i < end; i++)
+        if (copy_sites[i].site == site || !strcmp(copy_sites[i].site, site))
+            return &copy_sites[i];
+    return NULL;
+}
+
+void avpriv_buffer_count_copy(const char *site, size_t size)
+{
+    int nb = atomic_load_explicit(&nb_copy_sites, memory_order_acquire);
+    CopySite *s;
+
+    site = copy_site_name(site);
+    s    = find_copy_site(site, 0, nb);
+    if (!s) {
+        ff_mutex_lock(&copy_site_mutex);
+        nb = atomic_load_explicit(&nb_copy_sites, memory_order_relaxed);
+        s  = find_copy_site(site, 0, nb);
+        if (!s && nb == MAX_COPY_SITES) {
+            /* the last entry collects the sites which do not fit */
+            s = &copy_sites[nb - 1];
+        } else if (!s) {
+            s       = &copy_sites[nb];
+            s->site = nb == MAX_COPY_SITES - 1 ? "other" : site;
+            atomic_store_explicit(&nb_copy_sites, nb + 1, memory_order_release);
+        }
+        ff_mutex_unlock(&copy_site_mutex);
+    }
+
+    atomic_fetch_add_explicit(&s->nb_copies, 1,    memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->bytes,     size, memory_order_relaxed);
+}
+
+int av_buffer_get_copy_stats(AVBufferCopyStats **pstats, size_t *nb_stats)
+{
+    int nb = atomic_load_explicit(&nb_copy_sites, memory_order_acquire);
+    AVBufferCopyStats *stats = NULL;
+
+    if (nb) {
+        stats = av_malloc_array(nb, sizeof(*stats));
+        if (!stats)
+            return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < nb; i++) {
+        stats[i].site      = copy_sites[i].site;
+        stats[i].nb_copies = atomic_load_explicit(&copy_sites[i].nb_copies, memory_order_relaxed);
+        stats[i].bytes     = atomic_load_explicit(&copy_sites[i].bytes,     memory_order_relaxed);
+    }
+
+    *pstats   = stats;
+    *nb_stats = nb;
+    return 0;
+}
+
+static void pool_list_add(AVBufferPool *pool)
+{
+    ff_mutex_lock(&pool_list_mutex);
+    pool->next = pool_list;
+    if (pool_list)
+        pool_list->prev = pool;
+    pool_list = pool;
+    ff_mutex_unlock(&pool_list_mutex);
+}
+
+static void pool_list_remove(AVBufferPool *pool)
+{
+    ff_mutex_lock(&pool_list_mutex);
+    if (pool->prev)
+        pool->prev->next = pool->next;
+    else
+        pool_list = pool->next;
+    if (pool->next)
+        pool->next->prev = pool->prev;
+    ff_mutex_unlock(&pool_list_mutex);
+}
+
 AVBufferPool *av_buffer_pool_init2(buffer_size_t size, void *opaque,
                                    AVBufferRef* (*alloc)(void *opaque, buffer_size_t size),
                                    void (*pool_free)(void *opaque))
@@ -259,6 +374,7 @@ AVBufferPool *av_buffer_pool_init2(buffer_size_t size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+    pool_list_add(pool);
 
     return pool;
 }
@@ -275,6 +391,7 @@ AVBufferPool *av_buffer_pool_init(buffer_size_t size, AVBufferRef* (*alloc)(buff
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+    pool_list_add(pool);
 
     return pool;
 }
@@ -284,6 +401,8 @@ static void buffer_pool_flush(AVBufferPool *pool)
     while (pool->pool) {
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
+        pool->nb_free--;
+        pool->nb_allocated--;
 
         buf->free(buf->opaque, buf->data);
         av_freep(&buf);
@@ -296,6 +415,7 @@ static void buffer_pool_flush(AVBufferPool *pool)
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
+    pool_list_remove(pool);
     buffer_pool_flush(pool);
     ff_mutex_destroy(&pool->mutex);
 
@@ -333,6 +453,8 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     ff_mutex_lock(&pool->mutex);
     buf->next = pool->pool;
     pool->pool = buf;
+    pool->nb_free++;
+    pool->nb_in_use--;
     ff_mutex_unlock(&pool->mutex);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
@@ -383,9 +505,18 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
         if (ret) {
             pool->pool = buf->next;
             buf->next = NULL;
+            pool->nb_free--;
         }
     } else {
+        pool->nb_misses++;
         ret = pool_alloc_buffer(pool);
+        if (ret)
+            pool->nb_allocated++;
+    }
+    pool->nb_gets++;
+    if (ret) {
+        pool->nb_in_use++;
+        pool->max_in_use = FFMAX(pool->max_in_use, pool->nb_in_use);
     }
     ff_mutex_unlock(&pool->mutex);
 
@@ -401,3 +532,41 @@ void *av_buffer_pool_buffer_get_opaque(AVBufferRef *ref)
     av_assert0(buf);
     return buf->opaque;
 }
+
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats)
+{
+    ff_mutex_lock(&pool->mutex);
+    stats->size         = pool->size;
+    stats->nb_allocated = pool->nb_allocated;
+    stats->nb_free      = pool->nb_free;
+    stats->nb_in_use    = pool->nb_in_use;
+    stats->max_in_use   = pool->max_in_use;
+    stats->nb_gets      = pool->nb_gets;
+    stats->nb_misses    = pool->nb_misses;
+    ff_mutex_unlock(&pool->mutex);
+}
+
+int av_buffer_pool_get_all_stats(AVBufferPoolStats **pstats, size_t *nb_stats)
+{
+    AVBufferPoolStats *stats = NULL;
+    AVBufferPool *pool;
+    size_t nb = 0, i = 0;
+
+    ff_mutex_lock(&pool_list_mutex);
+    for (pool = pool_list; pool; pool = pool->next)
+        nb++;
+    if (nb) {
+        stats = av_malloc_array(nb, sizeof(*stats));
+        if (!stats) {
+            ff_mutex_unlock(&pool_list_mutex);
+            return AVERROR(ENOMEM);
+        }
+    }
+    for (pool = pool_list; pool; pool = pool->next)
+        av_buffer_pool_get_stats(pool, &stats[i++]);
+    ff_mutex_unlock(&pool_list_mutex);
+
+    *pstats   = stats;
+    *nb_stats = nb;
+    return 0;
+}
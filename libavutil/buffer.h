@@ -236,6 +236,36 @@ int av_buffer_realloc(AVBufferRef **buf, size_t size);
  */
 int av_buffer_replace(AVBufferRef **dst, AVBufferRef *src);
 
+/**
+ * Copy-on-write statistics of one call site, accumulated over the whole
+ * process.
+ */
+typedef struct AVBufferCopyStats {
+    /**
+     * The place the copies were made for: the source location of the call
+     * inside the FFmpeg libraries, e.g. "libavfilter/vf_telecine.c:190", the
+     * name of the filter the filtering framework copied an input frame for,
+     * or the name of the public function for calls from outside the
+     * libraries, e.g. "av_frame_make_writable".
+     */
+    const char *site;
+    uint64_t nb_copies; ///< number of times the data had to be copied
+    uint64_t bytes;     ///< total number of bytes copied
+} AVBufferCopyStats;
+
+/**
+ * Get the copy-on-write statistics of every call site which copied data to
+ * get a writable buffer or frame, in the order the sites first copied.
+ *
+ * The counters are updated atomically and may be read from any thread.
+ *
+ * @param stats    set to an array of statistics, one entry per call site,
+ *                 which must be freed with av_free()
+ * @param nb_stats set to the number of entries in stats
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int av_buffer_get_copy_stats(AVBufferCopyStats **stats, size_t *nb_stats);
+
 /**
  * @}
  */
@@ -346,6 +376,43 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
  */
 void *av_buffer_pool_buffer_get_opaque(AVBufferRef *ref);
 
+/**
+ * Usage statistics of a buffer pool.
+ */
+typedef struct AVBufferPoolStats {
+    size_t   size;         ///< size of the buffers of the pool
+    size_t   nb_allocated; ///< number of buffers allocated by the pool and not freed yet
+    size_t   nb_free;      ///< number of buffers waiting in the pool to be reused
+    size_t   nb_in_use;    ///< number of buffers currently handed out
+    size_t   max_in_use;   ///< highest value nb_in_use has reached
+    uint64_t nb_gets;      ///< number of av_buffer_pool_get() calls
+    /**
+     * number of av_buffer_pool_get() calls which found no free buffer and
+     * had to allocate a new one
+     */
+    uint64_t nb_misses;
+} AVBufferPoolStats;
+
+/**
+ * Get the usage statistics of a pool.
+ * This function may be called simultaneously with av_buffer_pool_get().
+ *
+ * @param pool  the pool
+ * @param stats filled with the statistics
+ */
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats);
+
+/**
+ * Get the usage statistics of every buffer pool alive in the process,
+ * including the pools which were uninited but still have buffers in use.
+ *
+ * @param stats    set to an array of statistics, one entry per pool, which
+ *                 must be freed with av_free()
+ * @param nb_stats set to the number of entries in stats
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int av_buffer_pool_get_all_stats(AVBufferPoolStats **stats, size_t *nb_stats);
+
 /**
  * @}
  */
@@ -95,6 +95,21 @@ struct AVBufferPool {
     AVBufferRef* (*alloc)(buffer_size_t size);
     AVBufferRef* (*alloc2)(void *opaque, buffer_size_t size);
     void         (*pool_free)(void *opaque);
+
+    /*
+     * Statistics, protected by mutex.
+     */
+    size_t   nb_allocated;
+    size_t   nb_free;
+    size_t   nb_in_use;
+    size_t   max_in_use;
+    uint64_t nb_gets;
+    uint64_t nb_misses;
+
+    /*
+     * List of all the live pools, protected by the global pool list mutex.
+     */
+    struct AVBufferPool *prev, *next;
 };
 
 #endif /* AVUTIL_BUFFER_INTERNAL_H */
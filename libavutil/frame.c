@@ -23,6 +23,7 @@
 #include "dict.h"
 #include "frame.h"
 #include "imgutils.h"
+#include "internal.h"
 #include "mem.h"
 #include "samplefmt.h"
 #include "hwcontext.h"
@@ -608,7 +609,21 @@ int av_frame_is_writable(AVFrame *frame)
     return ret;
 }
 
-int av_frame_make_writable(AVFrame *frame)
+/* The number of bytes av_frame_copy() copies from the frame. */
+static size_t frame_copy_size(const AVFrame *frame)
+{
+    int size;
+
+    if (frame->width > 0 && frame->height > 0)
+        size = av_image_get_buffer_size(frame->format, frame->width,
+                                        frame->height, 1);
+    else
+        size = av_samples_get_buffer_size(NULL, frame->channels,
+                                          frame->nb_samples, frame->format, 1);
+    return FFMAX(size, 0);
+}
+
+int avpriv_frame_make_writable(AVFrame *frame, const char *site)
 {
     AVFrame tmp;
     int ret;
@@ -646,6 +661,8 @@ int av_frame_make_writable(AVFrame *frame)
         return ret;
     }
 
+    avpriv_buffer_count_copy(site, frame_copy_size(frame));
+
     av_frame_unref(frame);
 
     *frame = tmp;
@@ -655,6 +672,11 @@ int av_frame_make_writable(AVFrame *frame)
     return 0;
 }
 
+int av_frame_make_writable(AVFrame *frame)
+{
+    return avpriv_frame_make_writable(frame, "av_frame_make_writable");
+}
+
 int av_frame_copy_props(AVFrame *dst, const AVFrame *src)
 {
     return frame_copy_props(dst, src, 1);
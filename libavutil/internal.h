@@ -266,6 +266,31 @@ int avpriv_tempfile(const char *prefix, char **filename, int log_offset, void *l
 
 int avpriv_set_systematic_pal2(uint32_t pal[256], enum AVPixelFormat pix_fmt);
 
+/**
+ * Account a copy of size bytes made to get a writable buffer or frame.
+ *
+ * @param site the call site the copy is counted for, see
+ *             AVBufferCopyStats.site; must stay valid until the process exits
+ */
+void avpriv_buffer_count_copy(const char *site, size_t size);
+
+struct AVBufferRef;
+struct AVFrame;
+
+/**
+ * Same as av_buffer_make_writable() and av_frame_make_writable(), counting
+ * the copies for the given call site instead of the public function.
+ */
+int avpriv_buffer_make_writable(struct AVBufferRef **buf, const char *site);
+int avpriv_frame_make_writable(struct AVFrame *frame, const char *site);
+
+/* __FILE__ is relative to the source tree when the compiler supports
+ * -fmacro-prefix-map, see configure. */
+#define FF_CALL_SITE __FILE__ ":" AV_STRINGIFY(__LINE__)
+
+#define ff_buffer_make_writable(buf)  avpriv_buffer_make_writable(buf, FF_CALL_SITE)
+#define ff_frame_make_writable(frame) avpriv_frame_make_writable(frame, FF_CALL_SITE)
+
 static av_always_inline av_const int avpriv_mirror(int x, int w)
 {
     if (!w)
@@ -18,21 +18,49 @@
 
 #include <stdatomic.h>
 #include "slicethread.h"
+#include "cpu.h"
 #include "mem.h"
 #include "thread.h"
 #include "avassert.h"
 
 #if HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS
 
+enum {
+    TASK_IDLE,
+    TASK_QUEUED,
+    TASK_RUNNING,
+};
+
+struct AVSliceThreadPool {
+    pthread_mutex_t     lock;
+    pthread_cond_t      work_cond;  ///< signaled when a task is queued
+    pthread_cond_t      done_cond;  ///< signaled when a task has finished
+    AVSliceThreadTask   *first_task[AV_SLICETHREAD_NB_PRIORITIES];
+    AVSliceThreadTask   *last_task[AV_SLICETHREAD_NB_PRIORITIES];
+    int                 nb_queued;
+    pthread_t           *threads;
+    int                 nb_threads;
+    int                 nb_target;  ///< number of threads which should be runnable
+    int                 nb_idle;
+    int                 nb_blocked;
+    int                 finished;
+    int                 refcount;   ///< protected by pool_lock
+};
+
+static AVMutex pool_lock = AV_MUTEX_INITIALIZER;
+static AVSliceThreadPool *shared_pool;
+
 typedef struct WorkerContext {
     AVSliceThread   *ctx;
     pthread_mutex_t mutex;
     pthread_cond_t  cond;
     pthread_t       thread;
     int             done;
+    AVSliceThreadTask task;
 } WorkerContext;
 
 struct AVSliceThread {
+    AVSliceThreadPool *pool;
     WorkerContext   *workers;
     int             nb_threads;
     int             nb_active_threads;
@@ -91,6 +119,309 @@ static void *attribute_align_arg thread_worker(void *v)
     }
 }
 
+static void *attribute_align_arg pool_worker(void *v)
+{
+    AVSliceThreadPool *pool = v;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        AVSliceThreadTask *task;
+        int prio = AV_SLICETHREAD_NB_PRIORITIES - 1;
+
+        while (!pool->nb_queued && !pool->finished) {
+            pool->nb_idle++;
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+            pool->nb_idle--;
+        }
+        if (!pool->nb_queued)
+            break;
+
+        while (!pool->first_task[prio])
+            prio--;
+        task = pool->first_task[prio];
+        pool->first_task[prio] = task->next;
+        if (!pool->first_task[prio])
+            pool->last_task[prio] = NULL;
+        pool->nb_queued--;
+        task->state = TASK_RUNNING;
+        pthread_mutex_unlock(&pool->lock);
+
+        task->func(task->priv);
+
+        pthread_mutex_lock(&pool->lock);
+        task->state = TASK_IDLE;
+        pthread_cond_broadcast(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/* must be called with pool->lock held */
+static int pool_add_thread(AVSliceThreadPool *pool)
+{
+    pthread_t *threads;
+    int ret;
+
+    threads = av_realloc_array(pool->threads, pool->nb_threads + 1, sizeof(*threads));
+    if (!threads)
+        return AVERROR(ENOMEM);
+    pool->threads = threads;
+
+    if (ret = pthread_create(&threads[pool->nb_threads], NULL, pool_worker, pool))
+        return AVERROR(ret);
+    pool->nb_threads++;
+
+    return 0;
+}
+
+static void pool_free(AVSliceThreadPool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->finished = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+    av_freep(&pool->threads);
+    av_free(pool);
+}
+
+static AVSliceThreadPool *pool_alloc(void)
+{
+    AVSliceThreadPool *pool = av_mallocz(sizeof(*pool));
+    int i, ret = 0;
+
+    if (!pool)
+        return NULL;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pool->nb_target = av_cpu_count();
+
+    pthread_mutex_lock(&pool->lock);
+    for (i = 0; i < pool->nb_target && ret >= 0; i++)
+        ret = pool_add_thread(pool);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!pool->nb_threads) {
+        pool_free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+int avpriv_slicethread_pool_ref(AVSliceThreadPool **ppool)
+{
+    int ret = 0;
+
+    ff_mutex_lock(&pool_lock);
+    if (!shared_pool)
+        shared_pool = pool_alloc();
+    if (shared_pool)
+        shared_pool->refcount++;
+    else
+        ret = AVERROR(ENOMEM);
+    *ppool = shared_pool;
+    ff_mutex_unlock(&pool_lock);
+
+    return ret;
+}
+
+void avpriv_slicethread_pool_unref(AVSliceThreadPool **ppool)
+{
+    AVSliceThreadPool *pool = *ppool;
+
+    if (!pool)
+        return;
+    *ppool = NULL;
+
+    ff_mutex_lock(&pool_lock);
+    av_assert0(pool == shared_pool && pool->refcount > 0);
+    if (!--pool->refcount)
+        shared_pool = NULL;
+    else
+        pool = NULL;
+    ff_mutex_unlock(&pool_lock);
+
+    if (pool)
+        pool_free(pool);
+}
+
+void avpriv_slicethread_pool_submit(AVSliceThreadPool *pool, AVSliceThreadTask *task)
+{
+    int prio = task->priority;
+
+    av_assert0(prio >= 0 && prio < AV_SLICETHREAD_NB_PRIORITIES);
+
+    pthread_mutex_lock(&pool->lock);
+    av_assert0(task->state == TASK_IDLE);
+    task->state = TASK_QUEUED;
+    task->next  = NULL;
+    if (pool->last_task[prio])
+        pool->last_task[prio]->next = task;
+    else
+        pool->first_task[prio] = task;
+    pool->last_task[prio] = task;
+    pool->nb_queued++;
+    if (pool->nb_idle)
+        pthread_cond_signal(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int avpriv_slicethread_pool_cancel(AVSliceThreadPool *pool, AVSliceThreadTask *task)
+{
+    AVSliceThreadTask **p, *prev = NULL;
+    int ret = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    if (task->state == TASK_QUEUED) {
+        int prio = task->priority;
+
+        for (p = &pool->first_task[prio]; *p != task; p = &(*p)->next)
+            prev = *p;
+        *p = task->next;
+        if (pool->last_task[prio] == task)
+            pool->last_task[prio] = prev;
+        pool->nb_queued--;
+        task->state = TASK_IDLE;
+        ret = 1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return ret;
+}
+
+void avpriv_slicethread_pool_wait(AVSliceThreadPool *pool, AVSliceThreadTask *task)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (task->state != TASK_IDLE)
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void avpriv_slicethread_pool_block(AVSliceThreadPool *pool, int blocking)
+{
+    pthread_mutex_lock(&pool->lock);
+    if (blocking) {
+        pool->nb_blocked++;
+        /* Threads never exit before the pool is freed, so the total only
+         * grows up to the largest number of simultaneously blocked tasks. */
+        if (pool->nb_threads - pool->nb_blocked < pool->nb_target)
+            pool_add_thread(pool);
+    } else {
+        pool->nb_blocked--;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void run_shared_jobs(AVSliceThread *ctx)
+{
+    unsigned nb_jobs  = ctx->nb_jobs;
+    unsigned threadnr = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
+    unsigned jobnr;
+
+    while ((jobnr = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs)
+        ctx->worker_func(ctx->priv, jobnr, threadnr, nb_jobs, ctx->nb_active_threads);
+}
+
+static void shared_worker(void *v)
+{
+    WorkerContext *w = v;
+    run_shared_jobs(w->ctx);
+}
+
+static void execute_shared(AVSliceThread *ctx, int nb_jobs, int execute_main)
+{
+    int nb_workers, i, nb_cancelled = 0;
+
+    ctx->nb_jobs           = nb_jobs;
+    ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
+    atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
+    atomic_store_explicit(&ctx->current_job, 0, memory_order_relaxed);
+    nb_workers             = ctx->nb_active_threads;
+    if (!ctx->main_func || !execute_main)
+        nb_workers--;
+
+    for (i = 0; i < nb_workers; i++)
+        avpriv_slicethread_pool_submit(ctx->pool, &ctx->workers[i].task);
+
+    if (ctx->main_func && execute_main)
+        ctx->main_func(ctx->priv);
+    else
+        run_shared_jobs(ctx);
+
+    /* Take back the helpers the pool did not get to, and do their jobs
+     * here; this keeps threadnr below nb_active_threads. */
+    for (i = 0; i < nb_workers; i++)
+        nb_cancelled += avpriv_slicethread_pool_cancel(ctx->pool, &ctx->workers[i].task);
+    if (ctx->main_func && execute_main && nb_cancelled)
+        run_shared_jobs(ctx);
+
+    for (i = 0; i < nb_workers; i++)
+        avpriv_slicethread_pool_wait(ctx->pool, &ctx->workers[i].task);
+}
+
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     void (*main_func)(void *priv),
+                                     int nb_threads)
+{
+    AVSliceThread *ctx;
+    int i, ret;
+
+    av_assert0(nb_threads >= 0);
+    if (!nb_threads) {
+        int nb_cpus = av_cpu_count();
+        if (nb_cpus > 1)
+            nb_threads = nb_cpus + 1;
+        else
+            nb_threads = 1;
+    }
+
+    *pctx = ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+
+    if (!(ctx->workers = av_calloc(nb_threads, sizeof(*ctx->workers)))) {
+        av_freep(pctx);
+        return AVERROR(ENOMEM);
+    }
+
+    if ((ret = avpriv_slicethread_pool_ref(&ctx->pool)) < 0) {
+        av_freep(&ctx->workers);
+        av_freep(pctx);
+        return ret;
+    }
+
+    ctx->priv        = priv;
+    ctx->worker_func = worker_func;
+    ctx->main_func   = main_func;
+    ctx->nb_threads  = nb_threads;
+
+    atomic_init(&ctx->first_job, 0);
+    atomic_init(&ctx->current_job, 0);
+
+    for (i = 0; i < nb_threads; i++) {
+        WorkerContext *w = &ctx->workers[i];
+        w->ctx       = ctx;
+        w->task.func     = shared_worker;
+        w->task.priv     = w;
+        w->task.priority = AV_SLICETHREAD_PRIORITY_HIGH;
+    }
+
+    return nb_threads;
+}
+
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
@@ -166,6 +497,11 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     int nb_workers, i, is_last = 0;
 
     av_assert0(nb_jobs > 0);
+    if (ctx->pool) {
+        execute_shared(ctx, nb_jobs, execute_main);
+        return;
+    }
+
     ctx->nb_jobs           = nb_jobs;
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
@@ -205,6 +541,13 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+    if (ctx->pool) {
+        avpriv_slicethread_pool_unref(&ctx->pool);
+        av_freep(&ctx->workers);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
@@ -242,6 +585,15 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return AVERROR(EINVAL);
 }
 
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     void (*main_func)(void *priv),
+                                     int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(EINVAL);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     av_assert0(0);
@@ -252,4 +604,34 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
     av_assert0(!pctx || !*pctx);
 }
 
+int avpriv_slicethread_pool_ref(AVSliceThreadPool **ppool)
+{
+    *ppool = NULL;
+    return AVERROR(ENOSYS);
+}
+
+void avpriv_slicethread_pool_unref(AVSliceThreadPool **ppool)
+{
+    av_assert0(!*ppool);
+}
+
+void avpriv_slicethread_pool_submit(AVSliceThreadPool *pool, AVSliceThreadTask *task)
+{
+    av_assert0(0);
+}
+
+int avpriv_slicethread_pool_cancel(AVSliceThreadPool *pool, AVSliceThreadTask *task)
+{
+    av_assert0(0);
+    return 0;
+}
+
+void avpriv_slicethread_pool_wait(AVSliceThreadPool *pool, AVSliceThreadTask *task)
+{
+}
+
+void avpriv_slicethread_pool_block(AVSliceThreadPool *pool, int blocking)
+{
+}
+
 #endif /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS32THREADS */
@@ -20,6 +20,31 @@
 #define AVUTIL_SLICETHREAD_H
 
 typedef struct AVSliceThread AVSliceThread;
+typedef struct AVSliceThreadPool AVSliceThreadPool;
+
+/**
+ * Priorities of AVSliceThreadPool tasks. Queued tasks of a higher priority
+ * are started before those of a lower one.
+ */
+enum AVSliceThreadPriority {
+    AV_SLICETHREAD_PRIORITY_LOW,    ///< nobody waits for the result yet
+    AV_SLICETHREAD_PRIORITY_NORMAL, ///< asynchronous work, e.g. frame threads
+    AV_SLICETHREAD_PRIORITY_HIGH,   ///< a thread is blocked until the task is done
+    AV_SLICETHREAD_NB_PRIORITIES
+};
+
+/**
+ * Unit of work run by an AVSliceThreadPool.
+ */
+typedef struct AVSliceThreadTask {
+    void (*func)(void *priv);
+    void *priv;
+    enum AVSliceThreadPriority priority;
+
+    /* The following fields are private to the pool. */
+    struct AVSliceThreadTask *next;
+    int state;
+} AVSliceThreadTask;
 
 /**
  * Create slice threading context.
@@ -35,6 +60,20 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*main_func)(void *priv),
                               int nb_threads);
 
+/**
+ * Create slice threading context whose jobs run on the process-wide worker
+ * pool instead of on threads of its own. The calling thread always takes
+ * part in avpriv_slicethread_execute(), so jobs make progress even when all
+ * pool threads are busy, and the jobs are queued at
+ * AV_SLICETHREAD_PRIORITY_HIGH. Parameters are the same as for
+ * avpriv_slicethread_create(), nb_threads being the maximum number of
+ * threads working on the jobs of one execute call.
+ */
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     void (*main_func)(void *priv),
+                                     int nb_threads);
+
 /**
  * Execute slice threading.
  * @param ctx slice threading context
@@ -49,4 +88,46 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
  */
 void avpriv_slicethread_free(AVSliceThread **pctx);
 
+/**
+ * Get a reference to the process-wide worker pool, creating it if needed.
+ * The pool starts one thread per CPU and is destroyed along with its
+ * threads when the last reference is dropped.
+ * @param ppool pointer to the pool returned here
+ * @return 0 on success, negative AVERROR on failure
+ */
+int avpriv_slicethread_pool_ref(AVSliceThreadPool **ppool);
+
+/**
+ * Drop a reference obtained with avpriv_slicethread_pool_ref().
+ * @param ppool pointer to the pool, set to NULL
+ */
+void avpriv_slicethread_pool_unref(AVSliceThreadPool **ppool);
+
+/**
+ * Queue a task. Tasks of the same priority are started in the order they
+ * were submitted, so a task may wait for the results of tasks of its
+ * priority submitted before it, but never for those submitted after it.
+ * @param task task to run, must not be queued or running
+ */
+void avpriv_slicethread_pool_submit(AVSliceThreadPool *pool, AVSliceThreadTask *task);
+
+/**
+ * Remove a task from the queue if it has not been started yet.
+ * @return 1 if the task was removed, 0 if it is running or already done
+ */
+int avpriv_slicethread_pool_cancel(AVSliceThreadPool *pool, AVSliceThreadTask *task);
+
+/**
+ * Wait until a task is neither queued nor running.
+ */
+void avpriv_slicethread_pool_wait(AVSliceThreadPool *pool, AVSliceThreadTask *task);
+
+/**
+ * Must bracket any wait of a running task on an event that only a thread
+ * outside of the pool can signal. The pool starts an additional thread if
+ * needed, so that queued tasks are not starved by blocked ones.
+ * @param blocking 1 before the wait, 0 after it
+ */
+void avpriv_slicethread_pool_block(AVSliceThreadPool *pool, int blocking);
+
 #endif
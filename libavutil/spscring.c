@@ -0,0 +1,299 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "common.h"
+#include "error.h"
+#include "mem.h"
+#include "spscring.h"
+#include "thread.h"
+#include "time.h"
+
+#define CACHE_LINE 64
+
+#define WAIT_READER 1
+#define WAIT_WRITER 2
+
+/* The state owned by one side: its position, written by it only, and its
+ * last look at the position of the other side. */
+typedef union RingSide {
+    struct {
+        atomic_size_t pos;
+        size_t        other;
+    } s;
+    uint8_t pad[CACHE_LINE];
+} RingSide;
+
+struct AVSPSCRing {
+#if HAVE_THREADS
+    RingSide writer;
+    RingSide reader;
+
+    uint8_t *buf;
+    size_t   size;
+    size_t   mask;
+
+    atomic_int waiting;
+    atomic_int err_read;
+    atomic_int err_write;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+#else
+    int dummy;
+#endif
+};
+
+int av_spsc_ring_alloc(AVSPSCRing **pring, size_t size)
+{
+#if HAVE_THREADS
+    AVSPSCRing *ring;
+    size_t cap = 1;
+    int ret;
+
+    *pring = NULL;
+    while (cap < size) {
+        if (cap > SIZE_MAX / 2)
+            return AVERROR(EINVAL);
+        cap <<= 1;
+    }
+
+    ring = av_mallocz(sizeof(*ring));
+    if (!ring)
+        return AVERROR(ENOMEM);
+    ring->buf = av_malloc(cap);
+    if (!ring->buf) {
+        av_free(ring);
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = pthread_mutex_init(&ring->lock, NULL))) {
+        av_free(ring->buf);
+        av_free(ring);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&ring->cond, NULL))) {
+        pthread_mutex_destroy(&ring->lock);
+        av_free(ring->buf);
+        av_free(ring);
+        return AVERROR(ret);
+    }
+
+    ring->size = cap;
+    ring->mask = cap - 1;
+    atomic_init(&ring->writer.s.pos, 0);
+    atomic_init(&ring->reader.s.pos, 0);
+    atomic_init(&ring->waiting,   0);
+    atomic_init(&ring->err_read,  0);
+    atomic_init(&ring->err_write, 0);
+
+    *pring = ring;
+    return 0;
+#else
+    *pring = NULL;
+    return AVERROR(ENOSYS);
+#endif /* HAVE_THREADS */
+}
+
+void av_spsc_ring_free(AVSPSCRing **pring)
+{
+#if HAVE_THREADS
+    AVSPSCRing *ring = *pring;
+
+    if (!ring)
+        return;
+    pthread_cond_destroy(&ring->cond);
+    pthread_mutex_destroy(&ring->lock);
+    av_free(ring->buf);
+    av_freep(pring);
+#endif
+}
+
+#if HAVE_THREADS
+/* Positions only ever grow; the size being a power of 2, their difference
+ * stays correct when they wrap around. */
+static size_t fill(AVSPSCRing *ring)
+{
+    return atomic_load(&ring->writer.s.pos) - atomic_load(&ring->reader.s.pos);
+}
+
+static int ready(AVSPSCRing *ring, int side, size_t size)
+{
+    if (side == WAIT_READER)
+        return fill(ring) >= size || atomic_load(&ring->err_read);
+    return ring->size - fill(ring) >= size || atomic_load(&ring->err_write);
+}
+
+static void wake(AVSPSCRing *ring, int side)
+{
+    /* Pairs with the store to waiting in ring_wait(): either the sleeper sees
+     * the new position, or we see it waiting and signal under the lock. */
+    if (atomic_load(&ring->waiting) & side) {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_broadcast(&ring->cond);
+        pthread_mutex_unlock(&ring->lock);
+    }
+}
+
+static int ring_wait(AVSPSCRing *ring, int side, size_t size, int64_t timeout)
+{
+    struct timespec tv;
+    int ret = 0;
+
+    if (timeout > 0) {
+        int64_t t = av_gettime() + timeout;
+        tv.tv_sec  =  t / 1000000;
+        tv.tv_nsec = (t % 1000000) * 1000;
+    }
+
+    pthread_mutex_lock(&ring->lock);
+    atomic_fetch_or(&ring->waiting, side);
+    while (!ready(ring, side, size)) {
+        if (timeout < 0) {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+        } else if (pthread_cond_timedwait(&ring->cond, &ring->lock, &tv)) {
+            ret = AVERROR(EAGAIN);
+            break;
+        }
+    }
+    atomic_fetch_and(&ring->waiting, ~side);
+    pthread_mutex_unlock(&ring->lock);
+
+    return ret;
+}
+#endif /* HAVE_THREADS */
+
+size_t av_spsc_ring_can_write(AVSPSCRing *ring)
+{
+#if HAVE_THREADS
+    size_t pos = atomic_load_explicit(&ring->writer.s.pos, memory_order_relaxed);
+    ring->writer.s.other = atomic_load_explicit(&ring->reader.s.pos, memory_order_acquire);
+    return ring->size - (pos - ring->writer.s.other);
+#else
+    return 0;
+#endif
+}
+
+size_t av_spsc_ring_can_read(AVSPSCRing *ring)
+{
+#if HAVE_THREADS
+    size_t pos = atomic_load_explicit(&ring->reader.s.pos, memory_order_relaxed);
+    ring->reader.s.other = atomic_load_explicit(&ring->writer.s.pos, memory_order_acquire);
+    return ring->reader.s.other - pos;
+#else
+    return 0;
+#endif
+}
+
+int av_spsc_ring_write(AVSPSCRing *ring, const void *buf, size_t size,
+                       int64_t timeout)
+{
+#if HAVE_THREADS
+    size_t pos = atomic_load_explicit(&ring->writer.s.pos, memory_order_relaxed);
+    size_t off, len;
+    int ret;
+
+    if (size > ring->size)
+        return AVERROR(EINVAL);
+
+    for (;;) {
+        if ((ret = atomic_load(&ring->err_write)))
+            return ret;
+        if (ring->size - (pos - ring->writer.s.other) >= size ||
+            av_spsc_ring_can_write(ring) >= size)
+            break;
+        if (!timeout)
+            return AVERROR(EAGAIN);
+        if ((ret = ring_wait(ring, WAIT_WRITER, size, timeout)) < 0)
+            return ret;
+    }
+
+    off = pos & ring->mask;
+    len = FFMIN(size, ring->size - off);
+    memcpy(ring->buf + off, buf, len);
+    memcpy(ring->buf, (const uint8_t *)buf + len, size - len);
+
+    atomic_store(&ring->writer.s.pos, pos + size);
+    wake(ring, WAIT_READER);
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+int av_spsc_ring_read(AVSPSCRing *ring, void *buf, size_t size,
+                      int64_t timeout)
+{
+#if HAVE_THREADS
+    size_t pos = atomic_load_explicit(&ring->reader.s.pos, memory_order_relaxed);
+    size_t off, len;
+    int ret;
+
+    if (size > ring->size)
+        return AVERROR(EINVAL);
+
+    for (;;) {
+        if (ring->reader.s.other - pos >= size ||
+            av_spsc_ring_can_read(ring) >= size)
+            break;
+        if ((ret = atomic_load(&ring->err_read))) {
+            /* data written before the error was set must still be read */
+            if (av_spsc_ring_can_read(ring) >= size)
+                break;
+            return ret;
+        }
+        if (!timeout)
+            return AVERROR(EAGAIN);
+        if ((ret = ring_wait(ring, WAIT_READER, size, timeout)) < 0)
+            return ret;
+    }
+
+    if (buf) {
+        off = pos & ring->mask;
+        len = FFMIN(size, ring->size - off);
+        memcpy(buf, ring->buf + off, len);
+        memcpy((uint8_t *)buf + len, ring->buf, size - len);
+    }
+
+    atomic_store(&ring->reader.s.pos, pos + size);
+    wake(ring, WAIT_WRITER);
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+void av_spsc_ring_set_err_read(AVSPSCRing *ring, int err)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&ring->lock);
+    atomic_store(&ring->err_read, err);
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+#endif
+}
+
+void av_spsc_ring_set_err_write(AVSPSCRing *ring, int err)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&ring->lock);
+    atomic_store(&ring->err_write, err);
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+#endif
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Lock-free single-producer, single-consumer byte ring
+ */
+
+#ifndef AVUTIL_SPSCRING_H
+#define AVUTIL_SPSCRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A ring buffer of bytes shared by exactly one writing thread and one
+ * reading thread.
+ *
+ * Data is transferred without taking any lock. The read and write
+ * positions live on separate cache lines, and each side only reads the
+ * position of the other when its cached copy says the ring is full or
+ * empty. A thread only sleeps when it has to wait for the other side, and
+ * the other side only takes a lock to wake it up when it is sleeping.
+ *
+ * The write functions must only be called from the producer thread and
+ * the read functions only from the consumer thread.
+ */
+typedef struct AVSPSCRing AVSPSCRing;
+
+/**
+ * Allocate a ring.
+ *
+ * @param ring  set to the new ring
+ * @param size  minimum capacity in bytes, rounded up to a power of 2
+ * @return  0 on success, a negative AVERROR on failure, in particular
+ *          AVERROR(ENOSYS) if lavu was built without thread support
+ */
+int av_spsc_ring_alloc(AVSPSCRing **ring, size_t size);
+
+/**
+ * Free a ring and set the pointer to NULL.
+ *
+ * The ring must no longer be in use by another thread.
+ */
+void av_spsc_ring_free(AVSPSCRing **ring);
+
+/**
+ * @return the number of bytes the producer can write without waiting
+ */
+size_t av_spsc_ring_can_write(AVSPSCRing *ring);
+
+/**
+ * @return the number of bytes the consumer can read without waiting
+ */
+size_t av_spsc_ring_can_read(AVSPSCRing *ring);
+
+/**
+ * Write size bytes to the ring, all of them or none.
+ *
+ * @param timeout  maximum time to wait for space in microseconds, 0 to
+ *                 return immediately, negative to wait without limit
+ * @return  0 on success, AVERROR(EAGAIN) if there is still not enough
+ *          space after timeout, the error set with
+ *          av_spsc_ring_set_err_write() if there is one, AVERROR(EINVAL)
+ *          if size exceeds the capacity of the ring
+ */
+int av_spsc_ring_write(AVSPSCRing *ring, const void *buf, size_t size,
+                       int64_t timeout);
+
+/**
+ * Read size bytes from the ring, all of them or none.
+ *
+ * @param buf      destination, or NULL to discard the data
+ * @param timeout  maximum time to wait for data in microseconds, 0 to
+ *                 return immediately, negative to wait without limit
+ * @return  0 on success, AVERROR(EAGAIN) if there is still not enough data
+ *          after timeout, the error set with av_spsc_ring_set_err_read()
+ *          once the ring does not hold enough data, AVERROR(EINVAL) if size
+ *          exceeds the capacity of the ring
+ */
+int av_spsc_ring_read(AVSPSCRing *ring, void *buf, size_t size,
+                      int64_t timeout);
+
+/**
+ * Set the error the consumer gets once it has read all the data, e.g.
+ * AVERROR_EOF when the producer stops. Wakes the consumer up.
+ * Usually called by the producer.
+ */
+void av_spsc_ring_set_err_read(AVSPSCRing *ring, int err);
+
+/**
+ * Set the error returned by all subsequent writes, e.g. when the consumer
+ * stops. Wakes the producer up. Usually called by the consumer.
+ */
+void av_spsc_ring_set_err_write(AVSPSCRing *ring, int err);
+
+#endif /* AVUTIL_SPSCRING_H */
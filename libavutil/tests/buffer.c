@@ -0,0 +1,148 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+static void print_pool(AVBufferPool *pool)
+{
+    AVBufferPoolStats st;
+
+    av_buffer_pool_get_stats(pool, &st);
+    printf("pool: size %zu allocated %zu free %zu in use %zu max %zu gets %"PRIu64" misses %"PRIu64"\n",
+           st.size, st.nb_allocated, st.nb_free, st.nb_in_use, st.max_in_use,
+           st.nb_gets, st.nb_misses);
+}
+
+static void print_copies(void)
+{
+    AVBufferCopyStats *st;
+    size_t nb;
+
+    if (av_buffer_get_copy_stats(&st, &nb) < 0)
+        return;
+    printf("copies: %zu sites\n", nb);
+    for (size_t i = 0; i < nb; i++)
+        printf("copies: %s %"PRIu64" (%"PRIu64" bytes)\n",
+               st[i].site, st[i].nb_copies, st[i].bytes);
+    av_free(st);
+}
+
+int main(void)
+{
+    AVBufferPool *pool;
+    AVBufferRef *bufs[4], *buf, *ref;
+    AVBufferPoolStats *all;
+    char site[] = "libavutil/tests/buffer.c:1";
+    AVFrame *frame, *frame_ref;
+    size_t nb_all, nb_pools = 0;
+
+    /* pool statistics */
+    pool = av_buffer_pool_init(1000, NULL);
+    if (!pool)
+        return 1;
+    for (int i = 0; i < 4; i++)
+        bufs[i] = av_buffer_pool_get(pool);
+    print_pool(pool);
+    for (int i = 0; i < 3; i++)
+        av_buffer_unref(&bufs[i]);
+    print_pool(pool);
+    for (int i = 0; i < 2; i++)
+        bufs[i] = av_buffer_pool_get(pool);
+    print_pool(pool);
+
+    /* an uninited pool is listed until its last buffer is released */
+    av_buffer_pool_uninit(&pool);
+    if (av_buffer_pool_get_all_stats(&all, &nb_all) < 0)
+        return 1;
+    for (size_t i = 0; i < nb_all; i++)
+        nb_pools += all[i].size == 1000;
+    av_free(all);
+    printf("uninited pool listed: %zu\n", nb_pools);
+    for (int i = 0; i < 4; i++)
+        av_buffer_unref(&bufs[i]);
+    if (av_buffer_pool_get_all_stats(&all, &nb_all) < 0)
+        return 1;
+    nb_pools = 0;
+    for (size_t i = 0; i < nb_all; i++)
+        nb_pools += all[i].size == 1000;
+    av_free(all);
+    printf("freed pool listed: %zu\n", nb_pools);
+
+    /* copy-on-write statistics */
+    print_copies();
+
+    buf = av_buffer_alloc(100);
+    ref = buf ? av_buffer_ref(buf) : NULL;
+    if (!ref)
+        return 1;
+    av_buffer_make_writable(&buf);          /* shared, copies 100 bytes */
+    av_buffer_make_writable(&buf);          /* already writable */
+    av_buffer_unref(&buf);
+
+    buf = av_buffer_ref(ref);
+    if (!buf)
+        return 1;
+    av_buffer_realloc(&buf, 300);           /* shared, copies the 100 bytes */
+    av_buffer_realloc(&buf, 200);           /* reallocatable, no copy */
+    av_buffer_unref(&buf);
+    buf = av_buffer_ref(ref);
+    if (!buf)
+        return 1;
+    av_buffer_realloc(&buf, 40);            /* shared, copies 40 bytes */
+    av_buffer_unref(&buf);
+    av_buffer_unref(&ref);
+
+    frame     = av_frame_alloc();
+    frame_ref = av_frame_alloc();
+    if (!frame || !frame_ref)
+        return 1;
+    frame->format = AV_PIX_FMT_GRAY8;
+    frame->width  = 16;
+    frame->height = 16;
+    if (av_frame_get_buffer(frame, 0) < 0 || av_frame_ref(frame_ref, frame) < 0)
+        return 1;
+    av_frame_make_writable(frame);          /* shared, copies 16x16 bytes */
+    av_frame_make_writable(frame);
+    av_frame_free(&frame);
+    av_frame_free(&frame_ref);
+
+    /* sites are merged by name, and named by their last directory */
+    buf = av_buffer_alloc(10);
+    ref = buf ? av_buffer_ref(buf) : NULL;
+    if (!ref)
+        return 1;
+    avpriv_buffer_make_writable(&buf, "/src/libavutil/tests/buffer.c:1");
+    av_buffer_unref(&buf);
+    buf = av_buffer_ref(ref);
+    if (!buf)
+        return 1;
+    avpriv_buffer_make_writable(&buf, site);
+    av_buffer_unref(&buf);
+    av_buffer_unref(&ref);
+
+    print_copies();
+
+    return 0;
+}
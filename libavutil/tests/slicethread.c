@@ -0,0 +1,229 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
+
+#define NB_TASKS 64
+#define NB_JOBS  100
+
+typedef struct Jobs {
+    atomic_int runs[NB_JOBS];
+    atomic_int bad_threadnr;
+    atomic_int main_runs;
+} Jobs;
+
+static atomic_int nb_done;
+
+static void count_task(void *priv)
+{
+    atomic_fetch_add(&nb_done, 1);
+}
+
+static void blocking_task(void *priv)
+{
+    AVSliceThreadPool *pool = priv;
+
+    /* stands for a wait on another thread, the pool must keep going */
+    avpriv_slicethread_pool_block(pool, 1);
+    avpriv_slicethread_pool_block(pool, 0);
+    atomic_fetch_add(&nb_done, 1);
+}
+
+static void worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    Jobs *jobs = priv;
+
+    atomic_fetch_add(&jobs->runs[jobnr], 1);
+    if (threadnr < 0 || threadnr >= nb_threads)
+        atomic_fetch_add(&jobs->bad_threadnr, 1);
+}
+
+static void main_func(void *priv)
+{
+    Jobs *jobs = priv;
+    atomic_fetch_add(&jobs->main_runs, 1);
+}
+
+static int run_tasks(AVSliceThreadPool *pool, int cancel)
+{
+    AVSliceThreadTask tasks[NB_TASKS] = { { 0 } };
+    int nb_cancelled = 0;
+
+    atomic_store(&nb_done, 0);
+    for (int i = 0; i < NB_TASKS; i++) {
+        tasks[i].func     = i % 8 ? count_task : blocking_task;
+        tasks[i].priv     = pool;
+        tasks[i].priority = i % AV_SLICETHREAD_NB_PRIORITIES;
+        avpriv_slicethread_pool_submit(pool, &tasks[i]);
+    }
+    if (cancel)
+        for (int i = NB_TASKS - 1; i >= 0; i -= 2)
+            nb_cancelled += avpriv_slicethread_pool_cancel(pool, &tasks[i]);
+    for (int i = 0; i < NB_TASKS; i++)
+        avpriv_slicethread_pool_wait(pool, &tasks[i]);
+
+    return atomic_load(&nb_done) + nb_cancelled == NB_TASKS;
+}
+
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  gate_cond = PTHREAD_COND_INITIALIZER;
+static int nb_started, nb_tickets;
+static char order[16];
+static int nb_order;
+
+static void gate_task(void *priv)
+{
+    pthread_mutex_lock(&gate_lock);
+    nb_started++;
+    pthread_cond_broadcast(&gate_cond);
+    while (!nb_tickets)
+        pthread_cond_wait(&gate_cond, &gate_lock);
+    nb_tickets--;
+    pthread_mutex_unlock(&gate_lock);
+}
+
+static void order_task(void *priv)
+{
+    pthread_mutex_lock(&gate_lock);
+    order[nb_order++] = *(char *)priv;
+    pthread_mutex_unlock(&gate_lock);
+}
+
+/* Occupy every pool thread, queue tasks of mixed priorities, then let
+ * a single thread through, so that they run in the order they are picked. */
+static int run_ordered(AVSliceThreadPool *pool, const char *names)
+{
+    int nb_gates = av_cpu_count(), nb_names = strlen(names);
+    AVSliceThreadTask *gates, tasks[16] = { { 0 } };
+
+    if (!(gates = av_calloc(nb_gates, sizeof(*gates))))
+        return AVERROR(ENOMEM);
+
+    nb_started = nb_tickets = nb_order = 0;
+    for (int i = 0; i < nb_gates; i++) {
+        gates[i].func = gate_task;
+        avpriv_slicethread_pool_submit(pool, &gates[i]);
+    }
+    pthread_mutex_lock(&gate_lock);
+    while (nb_started < nb_gates)
+        pthread_cond_wait(&gate_cond, &gate_lock);
+    pthread_mutex_unlock(&gate_lock);
+
+    for (int i = 0; i < nb_names; i++) {
+        tasks[i].func     = order_task;
+        tasks[i].priv     = (void *)&names[i];
+        tasks[i].priority = names[i] >= 'a' ? AV_SLICETHREAD_PRIORITY_LOW    :
+                            names[i] >= 'A' ? AV_SLICETHREAD_PRIORITY_NORMAL :
+                                              AV_SLICETHREAD_PRIORITY_HIGH;
+        avpriv_slicethread_pool_submit(pool, &tasks[i]);
+    }
+
+    pthread_mutex_lock(&gate_lock);
+    nb_tickets = 1;
+    pthread_cond_broadcast(&gate_cond);
+    pthread_mutex_unlock(&gate_lock);
+    for (int i = 0; i < nb_names; i++)
+        avpriv_slicethread_pool_wait(pool, &tasks[i]);
+
+    pthread_mutex_lock(&gate_lock);
+    nb_tickets = nb_gates;
+    pthread_cond_broadcast(&gate_cond);
+    pthread_mutex_unlock(&gate_lock);
+    for (int i = 0; i < nb_gates; i++)
+        avpriv_slicethread_pool_wait(pool, &gates[i]);
+    av_free(gates);
+
+    order[nb_order] = 0;
+    return 0;
+}
+
+static int run_jobs(int nb_threads, int nb_jobs, int execute_main)
+{
+    AVSliceThread *ctx;
+    Jobs jobs = { 0 };
+    int ret, bad = 0;
+
+    ret = avpriv_slicethread_create_shared(&ctx, &jobs, worker,
+                                           execute_main ? main_func : NULL,
+                                           nb_threads);
+    if (ret < 0)
+        return ret;
+
+    for (int n = 0; n < 3; n++) {
+        avpriv_slicethread_execute(ctx, nb_jobs, execute_main);
+        for (int i = 0; i < nb_jobs; i++)
+            bad += atomic_load(&jobs.runs[i]) != n + 1;
+    }
+    bad += atomic_load(&jobs.bad_threadnr);
+    bad += atomic_load(&jobs.main_runs) != 3 * !!execute_main;
+    avpriv_slicethread_free(&ctx);
+
+    return bad;
+}
+
+int main(void)
+{
+    static const int nb_threads[] = { 1, 2, 4, 8, 0 };
+    AVSliceThreadPool *pool, *pool2;
+
+    /* allocation and sharing */
+    if (avpriv_slicethread_pool_ref(&pool) < 0)
+        return 1;
+    if (avpriv_slicethread_pool_ref(&pool2) < 0)
+        return 1;
+    printf("shared: %d\n", pool == pool2);
+    avpriv_slicethread_pool_unref(&pool2);
+    printf("unref clears: %d\n", !pool2);
+    printf("tasks: %d\n", run_tasks(pool, 0));
+    printf("cancelled tasks: %d\n", run_tasks(pool, 1));
+    avpriv_slicethread_pool_unref(&pool);
+
+    /* the last reference is gone, a new pool is started on demand */
+    if (avpriv_slicethread_pool_ref(&pool) < 0)
+        return 1;
+    printf("recycled tasks: %d\n", run_tasks(pool, 0));
+
+    /* contexts of any size run on the same pool, one of them is held while
+     * the others come and go */
+    for (int i = 0; i < FF_ARRAY_ELEMS(nb_threads); i++)
+        printf("threads %d: %d %d %d\n", nb_threads[i],
+               run_jobs(nb_threads[i], NB_JOBS, 0),
+               run_jobs(nb_threads[i], NB_JOBS, 1),
+               run_jobs(nb_threads[i], 3, 0));
+    avpriv_slicethread_pool_unref(&pool);
+    printf("unreferenced: %d\n", run_jobs(4, NB_JOBS, 0));
+
+    /* a fresh pool, with one thread per CPU; high priority tasks are
+     * digits, normal ones upper case and low ones lower case letters */
+    if (avpriv_slicethread_pool_ref(&pool) < 0)
+        return 1;
+    if (run_ordered(pool, "aA0bB1cC2") < 0)
+        return 1;
+    printf("order: %s\n", order);
+    avpriv_slicethread_pool_unref(&pool);
+
+    return 0;
+}
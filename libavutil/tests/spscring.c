@@ -0,0 +1,92 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/spscring.h"
+#include "libavutil/thread.h"
+
+#define NB_RECORDS 100000
+
+static void *producer(void *arg)
+{
+    AVSPSCRing *ring = arg;
+    uint8_t rec[64];
+
+    for (unsigned i = 0; i < NB_RECORDS; i++) {
+        unsigned len = 1 + i % sizeof(rec);
+        for (unsigned j = 0; j < len; j++)
+            rec[j] = i + j;
+        /* a length byte first, published separately from the payload */
+        if (av_spsc_ring_write(ring, &(uint8_t){ len }, 1, -1) < 0 ||
+            av_spsc_ring_write(ring, rec, len, -1) < 0)
+            break;
+    }
+    av_spsc_ring_set_err_read(ring, AVERROR_EOF);
+    return NULL;
+}
+
+int main(void)
+{
+    AVSPSCRing *ring;
+    pthread_t thread;
+    uint8_t buf[64], len;
+    unsigned nb = 0, bad = 0;
+    int ret;
+
+    if (av_spsc_ring_alloc(&ring, 100) < 0)
+        return 1;
+
+    /* single-threaded behaviour */
+    printf("capacity: %zu\n", av_spsc_ring_can_write(ring));
+    printf("empty read: %d\n", av_spsc_ring_read(ring, buf, 1, 0) == AVERROR(EAGAIN));
+    printf("timed read: %d\n", av_spsc_ring_read(ring, buf, 1, 1000) == AVERROR(EAGAIN));
+    for (int i = 0; i < 2; i++)
+        av_spsc_ring_write(ring, buf, 60, 0);
+    printf("full write: %d\n", av_spsc_ring_write(ring, buf, 60, 0) == AVERROR(EAGAIN));
+    printf("oversized:  %d\n", av_spsc_ring_write(ring, buf, 129, 0) == AVERROR(EINVAL));
+    printf("readable:   %zu\n", av_spsc_ring_can_read(ring));
+    av_spsc_ring_read(ring, NULL, 120, 0);
+    printf("readable:   %zu\n", av_spsc_ring_can_read(ring));
+    av_spsc_ring_free(&ring);
+
+    /* records through a ring smaller than the total, wrapping many times */
+    if (av_spsc_ring_alloc(&ring, 128) < 0)
+        return 1;
+    if (pthread_create(&thread, NULL, producer, ring))
+        return 1;
+    while ((ret = av_spsc_ring_read(ring, &len, 1, -1)) >= 0) {
+        if ((ret = av_spsc_ring_read(ring, buf, len, -1)) < 0)
+            break;
+        if (len != 1 + nb % sizeof(buf))
+            bad++;
+        for (unsigned j = 0; j < len; j++)
+            bad += buf[j] != (uint8_t)(nb + j);
+        nb++;
+    }
+    pthread_join(thread, NULL);
+    printf("records: %u, errors: %u, eof: %d\n", nb, bad, ret == AVERROR_EOF);
+
+    av_spsc_ring_set_err_write(ring, AVERROR_EXIT);
+    printf("write error: %d\n", av_spsc_ring_write(ring, buf, 1, -1) == AVERROR_EXIT);
+    av_spsc_ring_free(&ring);
+
+    return 0;
+}
@@ -104,6 +104,8 @@
 #define INLINE_FMA3(flags)          CPUEXT_SUFFIX(flags, _INLINE, FMA3)
 #define INLINE_FMA4(flags)          CPUEXT_SUFFIX(flags, _INLINE, FMA4)
 #define INLINE_AVX2(flags)          CPUEXT_SUFFIX(flags, _INLINE, AVX2)
+#define INLINE_AVX2_FAST(flags)     CPUEXT_SUFFIX_FAST2(flags, _INLINE, AVX2, AVX)
+#define INLINE_AVX512(flags)        CPUEXT_SUFFIX(flags, _INLINE, AVX512)
 #define INLINE_AESNI(flags)         CPUEXT_SUFFIX(flags, _INLINE, AESNI)
 
 void ff_cpu_cpuid(int index, int *eax, int *ebx, int *ecx, int *edx);
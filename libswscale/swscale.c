@@ -235,14 +235,23 @@ static void lumRangeFromJpeg16_c(int16_t *_dst, int width)
     if (DEBUG_SWSCALE_BUFFERS)                  \
         av_log(c, AV_LOG_DEBUG, __VA_ARGS__)
 
-static int swscale(SwsContext *c, const uint8_t *src[],
-                   int srcStride[], int srcSliceY,
-                   int srcSliceH, uint8_t *dst[], int dstStride[])
+/**
+ * Scale the source slice into the destination lines dstSliceY to
+ * dstSliceY + dstSliceH - 1. When only a part of the destination is
+ * requested, the source slice must contain the complete frame and the
+ * vertical state of the context is not carried over between calls.
+ */
+static int swscale_lines(SwsContext *c, const uint8_t *src[],
+                         int srcStride[], int srcSliceY, int srcSliceH,
+                         uint8_t *dst[], int dstStride[],
+                         int dstSliceY, int dstSliceH)
 {
+    const int scale_dst = dstSliceY > 0 || dstSliceH < c->dstH;
+
     /* load a few things into local vars to make the code more readable?
      * and faster */
     const int dstW                   = c->dstW;
-    const int dstH                   = c->dstH;
+    int dstH                         = c->dstH;
 
     const enum AVPixelFormat dstFormat = c->dstFormat;
     const int flags                  = c->flags;
@@ -331,10 +340,15 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         }
     }
 
-    /* Note the user might start scaling the picture in the middle so this
-     * will not get executed. This is not really intended but works
-     * currently, so people might do it. */
-    if (srcSliceY == 0) {
+    if (scale_dst) {
+        dstY         = dstSliceY;
+        dstH         = dstSliceY + dstSliceH;
+        lastInLumBuf = -1;
+        lastInChrBuf = -1;
+    } else if (srcSliceY == 0) {
+        /* Note the user might start scaling the picture in the middle so this
+         * will not get executed. This is not really intended but works
+         * currently, so people might do it. */
         dstY         = 0;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
@@ -352,8 +366,8 @@ static int swscale(SwsContext *c, const uint8_t *src[],
             srcSliceY, srcSliceH, chrSrcSliceY, chrSrcSliceH, 1);
 
     ff_init_slice_from_src(vout_slice, (uint8_t**)dst, dstStride, c->dstW,
-            dstY, dstH, dstY >> c->chrDstVSubSample,
-            AV_CEIL_RSHIFT(dstH, c->chrDstVSubSample), 0);
+            dstY, scale_dst ? dstSliceH : dstH, dstY >> c->chrDstVSubSample,
+            AV_CEIL_RSHIFT(scale_dst ? dstSliceH : dstH, c->chrDstVSubSample), 0);
     if (srcSliceY == 0) {
         hout_slice->plane[0].sliceY = lastInLumBuf + 1;
         hout_slice->plane[1].sliceY = lastInChrBuf + 1;
@@ -373,7 +387,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
 
         // First line needed as input
         const int firstLumSrcY  = FFMAX(1 - vLumFilterSize, vLumFilterPos[dstY]);
-        const int firstLumSrcY2 = FFMAX(1 - vLumFilterSize, vLumFilterPos[FFMIN(dstY | ((1 << c->chrDstVSubSample) - 1), dstH - 1)]);
+        const int firstLumSrcY2 = FFMAX(1 - vLumFilterSize, vLumFilterPos[FFMIN(dstY | ((1 << c->chrDstVSubSample) - 1), c->dstH - 1)]);
         // First line needed as input
         const int firstChrSrcY  = FFMAX(1 - vChrFilterSize, vChrFilterPos[chrDstY]);
 
@@ -477,7 +491,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
             c->chrDither8 = ff_dither_8x8_128[chrDstY & 7];
             c->lumDither8 = ff_dither_8x8_128[dstY    & 7];
         }
-        if (dstY >= dstH - 2) {
+        if (dstY >= c->dstH - 2) {
             /* hmm looks like we can't use MMX here without overwriting
              * this array's tail */
             ff_sws_init_output_funcs(c, &yuv2plane1, &yuv2planeX, &yuv2nv12cX,
@@ -524,6 +538,41 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     return dstY - lastDstY;
 }
 
+static int swscale(SwsContext *c, const uint8_t *src[],
+                   int srcStride[], int srcSliceY,
+                   int srcSliceH, uint8_t *dst[], int dstStride[])
+{
+    return swscale_lines(c, src, srcStride, srcSliceY, srcSliceH,
+                         dst, dstStride, 0, c->dstH);
+}
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext *c      = parent->slice_ctx[threadnr];
+    /* keep the bands aligned to the chroma subsampling, so that every
+     * chroma line is written by exactly one thread */
+    const int align       = 1 << parent->chrDstVSubSample;
+    const int lines       = FFALIGN((parent->dstH + nb_jobs - 1) / nb_jobs, align);
+    const int slice_start = jobnr * lines;
+    const int slice_end   = FFMIN(slice_start + lines, parent->dstH);
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+
+    if (slice_start >= slice_end)
+        return;
+
+    memcpy(src,       parent->frame_src,       sizeof(src));
+    memcpy(srcStride, parent->frame_srcStride, sizeof(srcStride));
+    memcpy(dst,       parent->frame_dst,       sizeof(dst));
+    memcpy(dstStride, parent->frame_dstStride, sizeof(dstStride));
+
+    swscale_lines(c, src, srcStride, 0, parent->srcH, dst, dstStride,
+                  slice_start, slice_end - slice_start);
+}
+
 av_cold void ff_sws_init_range_convert(SwsContext *c)
 {
     c->lumConvertRange = NULL;
@@ -967,7 +1016,23 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     /* reset slice direction at end of frame */
     if (srcSliceY_internal + srcSliceH == c->srcH)
         c->sliceDir = 0;
-    ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
+    if (c->slicethread && c->swscale == swscale &&
+        srcSliceY_internal == 0 && srcSliceH == c->srcH) {
+        memcpy(c->frame_src,       src2,       sizeof(c->frame_src));
+        memcpy(c->frame_srcStride, srcStride2, sizeof(c->frame_srcStride));
+        memcpy(c->frame_dst,       dst2,       sizeof(c->frame_dst));
+        memcpy(c->frame_dstStride, dstStride2, sizeof(c->frame_dstStride));
+        if (usePal(c->srcFormat)) {
+            for (i = 0; i < c->nb_slice_ctx; i++) {
+                memcpy(c->slice_ctx[i]->pal_yuv, c->pal_yuv, sizeof(c->pal_yuv));
+                memcpy(c->slice_ctx[i]->pal_rgb, c->pal_rgb, sizeof(c->pal_rgb));
+            }
+        }
+        avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx, 0);
+        c->dstY = c->dstH;
+        ret     = c->dstH;
+    } else
+        ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
 
     if (c->dstXYZ && !(c->srcXYZ && c->srcW==c->dstW && c->srcH==c->dstH)) {
         int dstY = c->dstY ? c->dstY : srcSliceY + srcSliceH;
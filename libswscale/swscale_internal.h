@@ -33,6 +33,7 @@
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/ppc/util_altivec.h"
+#include "libavutil/slicethread.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
 
@@ -286,6 +287,22 @@ typedef struct SwsContext {
      */
     const AVClass *av_class;
 
+    /* The slice_* fields are used for slice threading: each thread scales a
+     * band of destination lines from the complete source frame with its own
+     * single-threaded context, see sws_scale().
+     */
+    AVSliceThread   *slicethread;
+    struct SwsContext **slice_ctx;
+    int             nb_slice_ctx;
+    int             nb_threads;   ///< Number of threads requested by the user, 0 for auto.
+    int             thread_pool;  ///< Run the slice threads on the shared worker pool.
+
+    /* per-frame parameters of the threaded scale, see sws_scale() */
+    const uint8_t *frame_src[4];
+    int            frame_srcStride[4];
+    uint8_t       *frame_dst[4];
+    int            frame_dstStride[4];
+
     /**
      * Note that src, dst, srcStride, dstStride will be copied in the
      * sws_scale() wrapper so they can be freely modified here.
@@ -872,6 +889,13 @@ void ff_get_unscaled_swscale_aarch64(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+/**
+ * Slice thread worker: scale one band of destination lines of the frame
+ * set up in the frame_* fields of the parent context.
+ */
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
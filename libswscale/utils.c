@@ -876,6 +876,15 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        int ret = sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange,
+                                           table, dstRange,
+                                           brightness, contrast, saturation);
+        if (ret < 0)
+            return ret;
+    }
 
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
@@ -1176,8 +1185,9 @@ static enum AVPixelFormat alphaless_fmt(enum AVPixelFormat fmt)
     }
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int sws_init_single_context(SwsContext *c,
+                                           SwsFilter *srcFilter,
+                                           SwsFilter *dstFilter)
 {
     int i;
     int usesVFilter, usesHFilter;
@@ -1889,6 +1899,99 @@ fail: // FIXME replace things by appropriate error codes
     return ret;
 }
 
+static int uses_error_diffusion(SwsContext *c)
+{
+    if (c->dither == SWS_DITHER_ED)
+        return 1;
+    /* the 8-bit and 4-bit RGB full chroma output falls back to error
+     * diffusion for everything but the arithmetic dithers */
+    return (c->dstFormat == AV_PIX_FMT_BGR4_BYTE ||
+            c->dstFormat == AV_PIX_FMT_RGB4_BYTE ||
+            c->dstFormat == AV_PIX_FMT_BGR8      ||
+            c->dstFormat == AV_PIX_FMT_RGB8) &&
+           (c->flags & SWS_FULL_CHR_H_INT) &&
+           c->dither != SWS_DITHER_A_DITHER &&
+           c->dither != SWS_DITHER_X_DITHER;
+}
+
+static av_cold int context_init_threaded(SwsContext *c, SwsContext *opts,
+                                         SwsFilter *srcFilter,
+                                         SwsFilter *dstFilter)
+{
+    int i, ret, nb_threads;
+
+    /* Only the generic scaler can work on bands of destination lines, and
+     * error diffusion carries state from one line to the next. */
+    if (!c->numDesc || c->cascaded_context[0] || uses_error_diffusion(c))
+        return 0;
+
+    if (c->thread_pool)
+        ret = avpriv_slicethread_create_shared(&c->slicethread, c,
+                                               ff_sws_slice_worker, NULL,
+                                               c->nb_threads);
+    else
+        ret = avpriv_slicethread_create(&c->slicethread, c,
+                                        ff_sws_slice_worker, NULL,
+                                        c->nb_threads);
+    if (ret == AVERROR(ENOSYS))
+        return 0;
+    if (ret < 0)
+        return ret;
+    nb_threads = ret;
+    if (nb_threads == 1) {
+        avpriv_slicethread_free(&c->slicethread);
+        return 0;
+    }
+
+    c->slice_ctx = av_mallocz_array(nb_threads, sizeof(*c->slice_ctx));
+    if (!c->slice_ctx)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_threads; i++) {
+        SwsContext *slice = sws_alloc_context();
+        if (!slice)
+            return AVERROR(ENOMEM);
+        c->slice_ctx[c->nb_slice_ctx++] = slice;
+
+        ret = av_opt_copy(slice, opts);
+        if (ret < 0)
+            return ret;
+        slice->nb_threads = 1;
+
+        ret = sws_init_single_context(slice, srcFilter, dstFilter);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    SwsContext *opts = NULL;
+    int ret;
+
+    if (c->nb_threads != 1) {
+        /* initialization modifies some of the options, keep the ones set
+         * by the user for the slice contexts */
+        opts = sws_alloc_context();
+        if (!opts)
+            return AVERROR(ENOMEM);
+        ret = av_opt_copy(opts, c);
+        if (ret < 0)
+            goto end;
+    }
+
+    ret = sws_init_single_context(c, srcFilter, dstFilter);
+    if (ret >= 0 && opts)
+        ret = context_init_threaded(c, opts, srcFilter, dstFilter);
+
+end:
+    sws_freeContext(opts);
+    return ret;
+}
+
 SwsContext *sws_alloc_set_opts(int srcW, int srcH, enum AVPixelFormat srcFormat,
                                int dstW, int dstH, enum AVPixelFormat dstFormat,
                                int flags, const double *param)
@@ -2340,6 +2443,11 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+    avpriv_slicethread_free(&c->slicethread);
+
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
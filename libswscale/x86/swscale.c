@@ -71,6 +71,22 @@ DECLARE_ASM_ALIGNED(8, const uint64_t, ff_w1111)        = 0x0001000100010001ULL;
 #include "swscale_template.c"
 #endif
 
+// high bit depth vertical scalers
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+#undef RENAME
+#define COMPILE_TEMPLATE_AVX512 0
+#define RENAME(a) a ## _avx2
+#include "vscale_template.c"
+#endif
+
+#if HAVE_AVX512_INLINE && ARCH_X86_64
+#undef RENAME
+#undef COMPILE_TEMPLATE_AVX512
+#define COMPILE_TEMPLATE_AVX512 1
+#define RENAME(a) a ## _avx512
+#include "vscale_template.c"
+#endif
+
 void ff_updateMMXDitherTables(SwsContext *c, int dstY)
 {
     const int dstH= c->dstH;
@@ -567,6 +583,15 @@ switch(c->dstBpc){ \
         }
     }
 
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    if (INLINE_AVX2_FAST(cpu_flags))
+        sws_init_vscale_avx2(c);
+#endif
+#if HAVE_AVX512_INLINE && ARCH_X86_64
+    if (INLINE_AVX512(cpu_flags))
+        sws_init_vscale_avx512(c);
+#endif
+
 #if ARCH_X86_64
     if (EXTERNAL_AVX2_FAST(cpu_flags)) {
         switch (c->dstFormat) {
@@ -0,0 +1,400 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Vertical scalers for the 9, 10 and 16 bit little-endian planar outputs and
+ * for P010, on ymm (AVX2) or zmm (AVX-512) registers. The loops only write
+ * whole registers of pixels, the few pixels left at the end of the line are
+ * computed in C, so nothing is written past it whatever the width.
+ */
+
+#include <stdint.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/x86/asm.h"
+#include "libswscale/swscale_internal.h"
+
+#undef REG
+#undef HALF
+#undef MOVA
+#undef MOVU
+#undef POR
+#undef STEP
+#undef NARROW_DW
+#undef PACK_SIGNED
+#undef PACK_UNSIGNED
+
+#if COMPILE_TEMPLATE_AVX512
+#define REG(n)  "%%zmm" #n
+#define HALF(n) "%%ymm" #n
+#define MOVA    "vmovdqa64 "
+#define MOVU    "vmovdqu64 "
+#define POR     "vpord "
+#define STEP    64
+#else
+#define REG(n)  "%%ymm" #n
+#define HALF(n) "%%xmm" #n
+#define MOVA    "vmovdqa "
+#define MOVU    "vmovdqu "
+#define POR     "vpor "
+#define STEP    32
+#endif
+
+/* Narrow the dwords of REG(a) and REG(b), in that order, to words in REG(a):
+ * with signed saturation if s is "s", unsigned one otherwise. The unsigned
+ * narrowing expects the dwords to be positive. */
+#if COMPILE_TEMPLATE_AVX512
+#define NARROW_DW(s, a, b) \
+    "vpmov" s "dw " REG(a) ", " HALF(a) "                \n\t" \
+    "vpmov" s "dw " REG(b) ", " HALF(b) "                \n\t" \
+    "vinserti64x4 $1, " HALF(b) ", " REG(a) ", " REG(a) "\n\t"
+#define PACK_SIGNED "s"
+#define PACK_UNSIGNED "us"
+#else
+#define NARROW_DW(s, a, b) \
+    "vpack" s "dw " REG(b) ", " REG(a) ", " REG(a) "     \n\t" \
+    "vpermq $0xd8, " REG(a) ", " REG(a) "                \n\t"
+#define PACK_SIGNED "ss"
+#define PACK_UNSIGNED "us"
+#endif
+
+static av_always_inline void
+RENAME(yuv2planeX_10_template)(const int16_t *filter, int filterSize,
+                               const int16_t **src, uint16_t *dest, int dstW,
+                               int output_bits, int p010)
+{
+    int shift = 11 + 16 - output_bits, lshift = p010 ? 6 : 0;
+    int32_t round = 1 << (shift - 1);
+    uint16_t max = (1 << output_bits) - 1;
+    /* the taps are taken by pairs, x86 vertical filters have an even size */
+    int w = filterSize & 1 ? 0 : dstW & ~(STEP / 2 - 1), i, j;
+
+    if (w) {
+        x86_reg pos = 0, tap, line;
+
+        /* two taps per iteration, interleaved for pmaddwd */
+        __asm__ volatile(
+            "vpbroadcastd %[round], "REG(7)"                \n\t"
+            "vpbroadcastw %[max], "REG(6)"                  \n\t"
+            "vmovd        %[shift], %%xmm5                  \n\t"
+            "vmovd        %[lshift], %%xmm4                 \n\t"
+            "1:                                             \n\t"
+            MOVA          REG(7)", "REG(0)"                 \n\t"
+            MOVA          REG(7)", "REG(1)"                 \n\t"
+            "xor          %[tap], %[tap]                    \n\t"
+            "2:                                             \n\t"
+            "vpbroadcastd (%[filter], %[tap], 2), "REG(2)"  \n\t"
+            "mov          (%[src], %[tap], 8), %[line]      \n\t"
+            MOVU          "(%[line], %[pos]), "REG(3)"      \n\t"
+            "mov          8(%[src], %[tap], 8), %[line]     \n\t"
+            "vpunpckhwd   (%[line], %[pos]), "REG(3)", "REG(8)" \n\t"
+            "vpunpcklwd   (%[line], %[pos]), "REG(3)", "REG(3)" \n\t"
+            "vpmaddwd     "REG(2)", "REG(3)", "REG(3)"      \n\t"
+            "vpmaddwd     "REG(2)", "REG(8)", "REG(8)"      \n\t"
+            "vpaddd       "REG(3)", "REG(0)", "REG(0)"      \n\t"
+            "vpaddd       "REG(8)", "REG(1)", "REG(1)"      \n\t"
+            "add          $2, %[tap]                        \n\t"
+            "cmp          %[size], %[tap]                   \n\t"
+            "jl           2b                                \n\t"
+            "vpsrad       %%xmm5, "REG(0)", "REG(0)"        \n\t"
+            "vpsrad       %%xmm5, "REG(1)", "REG(1)"        \n\t"
+            /* in-lane like the unpacking, so the pixels are back in order */
+            "vpackusdw    "REG(1)", "REG(0)", "REG(0)"      \n\t"
+            "vpminuw      "REG(6)", "REG(0)", "REG(0)"      \n\t"
+            "vpsllw       %%xmm4, "REG(0)", "REG(0)"        \n\t"
+            MOVU          REG(0)", (%[dest], %[pos])       \n\t"
+            "add          $"AV_STRINGIFY(STEP)", %[pos]     \n\t"
+            "cmp          %[w], %[pos]                      \n\t"
+            "jl           1b                                \n\t"
+            "vzeroupper                                     \n\t"
+            : [pos]"+&r"(pos), [tap]"=&r"(tap), [line]"=&r"(line)
+            : [filter]"r"(filter), [src]"r"(src), [dest]"r"(dest),
+              [size]"r"((x86_reg)filterSize), [w]"r"((x86_reg)w * 2),
+              [round]"m"(round), [max]"m"(max), [shift]"m"(shift), [lshift]"m"(lshift)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3", "xmm4",
+                           "xmm5", "xmm6", "xmm7", "xmm8",) "memory"
+        );
+    }
+
+    for (i = w; i < dstW; i++) {
+        int val = round;
+
+        for (j = 0; j < filterSize; j++)
+            val += src[j][i] * filter[j];
+        AV_WL16(&dest[i], av_clip_uintp2(val >> shift, output_bits) << lshift);
+    }
+}
+
+static void RENAME(yuv2planeX_16)(const int16_t *filter, int filterSize,
+                                  const int16_t **src, uint8_t *dest8, int dstW,
+                                  const uint8_t *dither, int offset)
+{
+    const int32_t **src32 = (const int32_t **)src;
+    uint16_t *dest = (uint16_t *)dest8;
+    /* see yuv2planeX_16_c_template() for the offset */
+    int32_t start = (1 << 14) - 0x40000000;
+    uint16_t bias = 0x8000;
+    int w = dstW & ~(STEP / 2 - 1), i, j;
+
+    if (w) {
+        x86_reg pos = 0, tap, line;
+
+        __asm__ volatile(
+            "vpbroadcastd %[start], "REG(7)"                \n\t"
+            "vpbroadcastw %[bias], "REG(6)"                 \n\t"
+            "1:                                             \n\t"
+            MOVA          REG(7)", "REG(0)"                 \n\t"
+            MOVA          REG(7)", "REG(1)"                 \n\t"
+            "xor          %[tap], %[tap]                    \n\t"
+            "2:                                             \n\t"
+            "vpbroadcastw (%[filter], %[tap], 2), "HALF(2)" \n\t"
+            "vpmovsxwd    "HALF(2)", "REG(2)"               \n\t"
+            "mov          (%[src], %[tap], 8), %[line]      \n\t"
+            "vpmulld      (%[line], %[pos], 4), "REG(2)", "REG(3)" \n\t"
+            "vpmulld      "AV_STRINGIFY(STEP)"(%[line], %[pos], 4), "REG(2)", "REG(4)" \n\t"
+            "vpaddd       "REG(3)", "REG(0)", "REG(0)"      \n\t"
+            "vpaddd       "REG(4)", "REG(1)", "REG(1)"      \n\t"
+            "inc          %[tap]                            \n\t"
+            "cmp          %[size], %[tap]                   \n\t"
+            "jl           2b                                \n\t"
+            "vpsrad       $15, "REG(0)", "REG(0)"           \n\t"
+            "vpsrad       $15, "REG(1)", "REG(1)"           \n\t"
+            NARROW_DW(PACK_SIGNED, 0, 1)
+            "vpaddw       "REG(6)", "REG(0)", "REG(0)"      \n\t"
+            MOVU          REG(0)", (%[dest], %[pos], 2)    \n\t"
+            "add          $"AV_STRINGIFY(STEP)" / 2, %[pos] \n\t"
+            "cmp          %[w], %[pos]                      \n\t"
+            "jl           1b                                \n\t"
+            "vzeroupper                                     \n\t"
+            : [pos]"+&r"(pos), [tap]"=&r"(tap), [line]"=&r"(line)
+            : [filter]"r"(filter), [src]"r"(src32), [dest]"r"(dest),
+              [size]"r"((x86_reg)filterSize), [w]"r"((x86_reg)w),
+              [start]"m"(start), [bias]"m"(bias)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3", "xmm4",
+                           "xmm6", "xmm7",) "memory"
+        );
+    }
+
+    for (i = w; i < dstW; i++) {
+        int val = start;
+
+        for (j = 0; j < filterSize; j++)
+            val += src32[j][i] * (unsigned)filter[j];
+        AV_WL16(&dest[i], bias + av_clip_int16(val >> 15));
+    }
+}
+
+static av_always_inline void
+RENAME(yuv2plane1_10_template)(const int16_t *src, uint16_t *dest, int dstW,
+                               int output_bits, int p010)
+{
+    int shift = 15 - output_bits, lshift = p010 ? 6 : 0;
+    uint16_t round = 1 << (shift - 1);
+    uint16_t max = (1 << output_bits) - 1;
+    int w = dstW & ~(STEP / 2 - 1), i;
+
+    if (w) {
+        x86_reg pos = 0;
+
+        /* the saturation only affects values clipped to max anyway */
+        __asm__ volatile(
+            "vpbroadcastw %[round], "REG(2)"                \n\t"
+            "vpxor        %%xmm3, %%xmm3, %%xmm3            \n\t"
+            "vpbroadcastw %[max], "REG(4)"                  \n\t"
+            "vmovd        %[shift], %%xmm5                  \n\t"
+            "vmovd        %[lshift], %%xmm6                 \n\t"
+            "1:                                             \n\t"
+            "vpaddsw      (%[src], %[pos]), "REG(2)", "REG(0)" \n\t"
+            "vpsraw       %%xmm5, "REG(0)", "REG(0)"        \n\t"
+            "vpmaxsw      "REG(3)", "REG(0)", "REG(0)"      \n\t"
+            "vpminsw      "REG(4)", "REG(0)", "REG(0)"      \n\t"
+            "vpsllw       %%xmm6, "REG(0)", "REG(0)"        \n\t"
+            MOVU          REG(0)", (%[dest], %[pos])       \n\t"
+            "add          $"AV_STRINGIFY(STEP)", %[pos]     \n\t"
+            "cmp          %[w], %[pos]                      \n\t"
+            "jl           1b                                \n\t"
+            "vzeroupper                                     \n\t"
+            : [pos]"+&r"(pos)
+            : [src]"r"(src), [dest]"r"(dest), [w]"r"((x86_reg)w * 2),
+              [round]"m"(round), [max]"m"(max), [shift]"m"(shift), [lshift]"m"(lshift)
+            : XMM_CLOBBERS("xmm0", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",) "memory"
+        );
+    }
+
+    for (i = w; i < dstW; i++) {
+        int val = src[i] + round;
+        AV_WL16(&dest[i], av_clip_uintp2(val >> shift, output_bits) << lshift);
+    }
+}
+
+static void RENAME(yuv2plane1_16)(const int16_t *src, uint8_t *dest8, int dstW,
+                                  const uint8_t *dither, int offset)
+{
+    const int32_t *src32 = (const int32_t *)src;
+    uint16_t *dest = (uint16_t *)dest8;
+    int32_t round = 4;
+    int w = dstW & ~(STEP / 2 - 1), i;
+
+    if (w) {
+        x86_reg pos = 0;
+
+        __asm__ volatile(
+            "vpbroadcastd %[round], "REG(2)"                \n\t"
+            "vpxor        %%xmm3, %%xmm3, %%xmm3            \n\t"
+            "1:                                             \n\t"
+            "vpaddd       (%[src], %[pos], 4), "REG(2)", "REG(0)" \n\t"
+            "vpaddd       "AV_STRINGIFY(STEP)"(%[src], %[pos], 4), "REG(2)", "REG(1)" \n\t"
+            "vpsrad       $3, "REG(0)", "REG(0)"            \n\t"
+            "vpsrad       $3, "REG(1)", "REG(1)"            \n\t"
+            "vpmaxsd      "REG(3)", "REG(0)", "REG(0)"      \n\t"
+            "vpmaxsd      "REG(3)", "REG(1)", "REG(1)"      \n\t"
+            NARROW_DW(PACK_UNSIGNED, 0, 1)
+            MOVU          REG(0)", (%[dest], %[pos], 2)    \n\t"
+            "add          $"AV_STRINGIFY(STEP)" / 2, %[pos] \n\t"
+            "cmp          %[w], %[pos]                      \n\t"
+            "jl           1b                                \n\t"
+            "vzeroupper                                     \n\t"
+            : [pos]"+&r"(pos)
+            : [src]"r"(src32), [dest]"r"(dest), [w]"r"((x86_reg)w),
+              [round]"m"(round)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",) "memory"
+        );
+    }
+
+    for (i = w; i < dstW; i++)
+        AV_WL16(&dest[i], av_clip_uint16((src32[i] + round) >> 3));
+}
+
+static void RENAME(yuv2p010cX)(enum AVPixelFormat dstFormat, const uint8_t *chrDither,
+                               const int16_t *chrFilter, int chrFilterSize,
+                               const int16_t **chrUSrc, const int16_t **chrVSrc,
+                               uint8_t *dest8, int chrDstW)
+{
+    uint16_t *dest = (uint16_t *)dest8;
+    int32_t round = 1 << 16, max = 1023;
+    int w = chrDstW & ~(STEP / 4 - 1), i, j;
+
+    if (w) {
+        x86_reg pos = 0, tap, line;
+
+        /* one u/v pair per dword, u in the low word */
+        __asm__ volatile(
+            "vpbroadcastd %[round], "REG(6)"                \n\t"
+            "vpbroadcastd %[max], "REG(7)"                  \n\t"
+            "vpxor        %%xmm5, %%xmm5, %%xmm5            \n\t"
+            "1:                                             \n\t"
+            MOVA          REG(6)", "REG(0)"                 \n\t"
+            MOVA          REG(6)", "REG(1)"                 \n\t"
+            "xor          %[tap], %[tap]                    \n\t"
+            "2:                                             \n\t"
+            "vpbroadcastw (%[filter], %[tap], 2), "HALF(2)" \n\t"
+            "vpmovsxwd    "HALF(2)", "REG(2)"               \n\t"
+            "mov          (%[u], %[tap], 8), %[line]        \n\t"
+            "vpmovsxwd    (%[line], %[pos], 2), "REG(3)"    \n\t"
+            "mov          (%[v], %[tap], 8), %[line]        \n\t"
+            "vpmovsxwd    (%[line], %[pos], 2), "REG(4)"    \n\t"
+            "vpmulld      "REG(2)", "REG(3)", "REG(3)"      \n\t"
+            "vpmulld      "REG(2)", "REG(4)", "REG(4)"      \n\t"
+            "vpaddd       "REG(3)", "REG(0)", "REG(0)"      \n\t"
+            "vpaddd       "REG(4)", "REG(1)", "REG(1)"      \n\t"
+            "inc          %[tap]                            \n\t"
+            "cmp          %[size], %[tap]                   \n\t"
+            "jl           2b                                \n\t"
+            "vpsrad       $17, "REG(0)", "REG(0)"           \n\t"
+            "vpsrad       $17, "REG(1)", "REG(1)"           \n\t"
+            "vpmaxsd      "REG(5)", "REG(0)", "REG(0)"      \n\t"
+            "vpmaxsd      "REG(5)", "REG(1)", "REG(1)"      \n\t"
+            "vpminsd      "REG(7)", "REG(0)", "REG(0)"      \n\t"
+            "vpminsd      "REG(7)", "REG(1)", "REG(1)"      \n\t"
+            "vpslld       $6, "REG(0)", "REG(0)"            \n\t"
+            "vpslld       $22, "REG(1)", "REG(1)"           \n\t"
+            POR           REG(1)", "REG(0)", "REG(0)"       \n\t"
+            MOVU          REG(0)", (%[dest], %[pos], 4)    \n\t"
+            "add          $"AV_STRINGIFY(STEP)" / 4, %[pos] \n\t"
+            "cmp          %[w], %[pos]                      \n\t"
+            "jl           1b                                \n\t"
+            "vzeroupper                                     \n\t"
+            : [pos]"+&r"(pos), [tap]"=&r"(tap), [line]"=&r"(line)
+            : [filter]"r"(chrFilter), [u]"r"(chrUSrc), [v]"r"(chrVSrc),
+              [dest]"r"(dest), [size]"r"((x86_reg)chrFilterSize), [w]"r"((x86_reg)w),
+              [round]"m"(round), [max]"m"(max)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3", "xmm4",
+                           "xmm5", "xmm6", "xmm7",) "memory"
+        );
+    }
+
+    for (i = w; i < chrDstW; i++) {
+        int u = round, v = round;
+
+        for (j = 0; j < chrFilterSize; j++) {
+            u += chrUSrc[j][i] * chrFilter[j];
+            v += chrVSrc[j][i] * chrFilter[j];
+        }
+        AV_WL16(&dest[2 * i],     av_clip_uintp2(u >> 17, 10) << 6);
+        AV_WL16(&dest[2 * i + 1], av_clip_uintp2(v >> 17, 10) << 6);
+    }
+}
+
+#define YUV2PLANE_10_FUNCS(name, bits, p010) \
+static void RENAME(yuv2planeX_ ## name)(const int16_t *filter, int filterSize, \
+                                        const int16_t **src, uint8_t *dest, int dstW, \
+                                        const uint8_t *dither, int offset) \
+{ \
+    RENAME(yuv2planeX_10_template)(filter, filterSize, src, (uint16_t *)dest, dstW, \
+                                   bits, p010); \
+} \
+ \
+static void RENAME(yuv2plane1_ ## name)(const int16_t *src, uint8_t *dest, int dstW, \
+                                        const uint8_t *dither, int offset) \
+{ \
+    RENAME(yuv2plane1_10_template)(src, (uint16_t *)dest, dstW, bits, p010); \
+}
+
+YUV2PLANE_10_FUNCS(9,    9,  0)
+YUV2PLANE_10_FUNCS(10,   10, 0)
+YUV2PLANE_10_FUNCS(p010, 10, 1)
+
+#undef YUV2PLANE_10_FUNCS
+
+static av_cold void RENAME(sws_init_vscale)(SwsContext *c)
+{
+    if (isBE(c->dstFormat))
+        return;
+
+    switch (c->dstBpc) {
+    case 16:
+        c->yuv2planeX = RENAME(yuv2planeX_16);
+        c->yuv2plane1 = RENAME(yuv2plane1_16);
+        break;
+    case 10:
+        if (c->dstFormat == AV_PIX_FMT_P010LE) {
+            c->yuv2planeX = RENAME(yuv2planeX_p010);
+            c->yuv2plane1 = RENAME(yuv2plane1_p010);
+            c->yuv2nv12cX = RENAME(yuv2p010cX);
+        } else {
+            c->yuv2planeX = RENAME(yuv2planeX_10);
+            c->yuv2plane1 = RENAME(yuv2plane1_10);
+        }
+        break;
+    case 9:
+        c->yuv2planeX = RENAME(yuv2planeX_9);
+        c->yuv2plane1 = RENAME(yuv2plane1_9);
+        break;
+    }
+}
@@ -23,6 +23,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/pixdesc.h"
 
 #include "libswscale/swscale.h"
 #include "libswscale/swscale_internal.h"
@@ -134,6 +135,228 @@ static void check_yuv2yuvX(void)
 #undef FILTER_SIZES
 }
 
+#define HBD_WIDTH 512
+#define HBD_FILTER_SIZES 4
+#define HBD_LARGEST_FILTER 16
+// pixels past the end of the line which must be left untouched
+#define HBD_GUARD 32
+
+static const enum AVPixelFormat hbd_formats[] = {
+    AV_PIX_FMT_YUV420P9LE, AV_PIX_FMT_YUV420P10LE,
+    AV_PIX_FMT_YUV420P16LE, AV_PIX_FMT_P010LE,
+};
+
+static struct SwsContext *hbd_context(enum AVPixelFormat fmt, int width)
+{
+    return sws_getContext(width / 2, 16, AV_PIX_FMT_YUV420P,
+                          width, 16, fmt, SWS_BILINEAR, NULL, NULL, NULL);
+}
+
+// The intermediate lines are 15 bits in int16_t for up to 14 bit output and
+// 19 bits in int32_t for 16 bit output. Keep the values positive and the
+// coefficients summing to 1.0 (1 << 12), the same range the scaler feeds in.
+static void hbd_fill_sources(int32_t *pixels, int size, int bits,
+                             int16_t *filter, int filter_size)
+{
+    int i, sum = 0;
+
+    for (i = 0; i < size; i++) {
+        if (bits == 16)
+            pixels[i] = rnd() & 0x7FFFF;
+        else
+            ((int16_t *)pixels)[i] = rnd() & 0x7FFF;
+    }
+    for (i = 0; i < filter_size - 1; i++) {
+        filter[i] = rnd() % ((1 << 12) / filter_size);
+        sum += filter[i];
+    }
+    filter[filter_size - 1] = (1 << 12) - sum;
+}
+
+// The SSE versions of the planar scalers write whole iterations of up to 16
+// pixels, the guard is only checked after the last one of the line.
+static int hbd_differ(const uint16_t *dst0, const uint16_t *dst1, int width)
+{
+    int end = FFALIGN(width, 16);
+
+    return memcmp(dst0, dst1, width * sizeof(dst0[0])) ||
+           memcmp(dst0 + end, dst1 + end, (HBD_WIDTH + HBD_GUARD - end) * sizeof(dst0[0]));
+}
+
+static void check_yuv2planeX_hbd(void)
+{
+    static const int filter_sizes[HBD_FILTER_SIZES] = { 2, 4, 8, 16 };
+    // the AVX2 and AVX-512 versions leave 4 and 20, then 8 and 8 pixels of
+    // the last two widths to their scalar tail, the last one has a chroma
+    // width below 32
+    static const int widths[] = { HBD_WIDTH, HBD_WIDTH - 12, 40 };
+    int fi, wi, fsi, i;
+
+    LOCAL_ALIGNED_32(int32_t, src_pixels, [HBD_LARGEST_FILTER * HBD_WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, filter, [HBD_LARGEST_FILTER]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [HBD_WIDTH + HBD_GUARD]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [HBD_WIDTH + HBD_GUARD]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+    const int16_t *src[HBD_LARGEST_FILTER];
+
+    declare_func(void, const int16_t *filter, int filterSize,
+                 const int16_t **src, uint8_t *dest, int dstW,
+                 const uint8_t *dither, int offset);
+
+    memset(dither, 0, sizeof(dither[0]) * 8);
+
+    for (fi = 0; fi < FF_ARRAY_ELEMS(hbd_formats); fi++) {
+        const char *name = av_get_pix_fmt_name(hbd_formats[fi]);
+
+        for (wi = 0; wi < FF_ARRAY_ELEMS(widths); wi++) {
+            int width = widths[wi];
+            struct SwsContext *ctx = hbd_context(hbd_formats[fi], width);
+            int bits = ctx ? ctx->dstBpc : 0;
+
+            if (!ctx) {
+                fail();
+                continue;
+            }
+
+            for (fsi = 0; fsi < HBD_FILTER_SIZES; fsi++) {
+                int filter_size = filter_sizes[fsi];
+
+                hbd_fill_sources(src_pixels, HBD_LARGEST_FILTER * HBD_WIDTH, bits,
+                                 filter, filter_size);
+                for (i = 0; i < filter_size; i++)
+                    src[i] = bits == 16 ? (const int16_t *)(src_pixels + i * HBD_WIDTH)
+                                        : (const int16_t *)src_pixels + i * HBD_WIDTH;
+
+                if (check_func(ctx->yuv2planeX, "yuv2planeX_%s_%d_%d", name, width, filter_size)) {
+                    memset(dst0, 0xAA, (HBD_WIDTH + HBD_GUARD) * sizeof(dst0[0]));
+                    memset(dst1, 0xAA, (HBD_WIDTH + HBD_GUARD) * sizeof(dst1[0]));
+
+                    call_ref(filter, filter_size, src, (uint8_t *)dst0, width, dither, 0);
+                    call_new(filter, filter_size, src, (uint8_t *)dst1, width, dither, 0);
+                    if (hbd_differ(dst0, dst1, width))
+                        fail();
+                    bench_new(filter, filter_size, src, (uint8_t *)dst1, width, dither, 0);
+                }
+            }
+            sws_freeContext(ctx);
+        }
+    }
+}
+
+static void check_yuv2plane1_hbd(void)
+{
+    // the same partial iterations as for yuv2planeX
+    static const int widths[] = { HBD_WIDTH, HBD_WIDTH - 12, 40 };
+    int fi, wi, i;
+
+    LOCAL_ALIGNED_32(int32_t, src, [HBD_WIDTH]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [HBD_WIDTH + HBD_GUARD]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [HBD_WIDTH + HBD_GUARD]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+
+    declare_func(void, const int16_t *src, uint8_t *dest, int dstW,
+                 const uint8_t *dither, int offset);
+
+    memset(dither, 0, sizeof(dither[0]) * 8);
+
+    for (fi = 0; fi < FF_ARRAY_ELEMS(hbd_formats); fi++) {
+        const char *name = av_get_pix_fmt_name(hbd_formats[fi]);
+
+        for (wi = 0; wi < FF_ARRAY_ELEMS(widths); wi++) {
+            int width = widths[wi];
+            struct SwsContext *ctx = hbd_context(hbd_formats[fi], width);
+
+            if (!ctx) {
+                fail();
+                continue;
+            }
+
+            // include out of range values on both sides to exercise the clipping
+            for (i = 0; i < HBD_WIDTH; i++) {
+                if (ctx->dstBpc == 16)
+                    src[i] = (int32_t)(rnd() & 0xFFFFF) - 0x40000;
+                else
+                    ((int16_t *)src)[i] = rnd();
+            }
+
+            if (check_func(ctx->yuv2plane1, "yuv2plane1_%s_%d", name, width)) {
+                memset(dst0, 0xAA, (HBD_WIDTH + HBD_GUARD) * sizeof(dst0[0]));
+                memset(dst1, 0xAA, (HBD_WIDTH + HBD_GUARD) * sizeof(dst1[0]));
+
+                call_ref((const int16_t *)src, (uint8_t *)dst0, width, dither, 0);
+                call_new((const int16_t *)src, (uint8_t *)dst1, width, dither, 0);
+                if (hbd_differ(dst0, dst1, width))
+                    fail();
+                bench_new((const int16_t *)src, (uint8_t *)dst1, width, dither, 0);
+            }
+            sws_freeContext(ctx);
+        }
+    }
+}
+
+static void check_yuv2p010cX(void)
+{
+    static const int filter_sizes[HBD_FILTER_SIZES] = { 1, 2, 4, 8 };
+    // the AVX2 and AVX-512 versions leave 2 and 10, then 5 and 13 pairs of
+    // the chroma lines of the last two widths to their scalar tail
+    static const int widths[] = { HBD_WIDTH, HBD_WIDTH - 12, 58 };
+    int wi, fsi, i;
+
+    LOCAL_ALIGNED_32(int16_t, u_pixels, [HBD_LARGEST_FILTER * HBD_WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, v_pixels, [HBD_LARGEST_FILTER * HBD_WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, filter, [HBD_LARGEST_FILTER]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [(HBD_WIDTH + HBD_GUARD) * 2]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [(HBD_WIDTH + HBD_GUARD) * 2]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+    const int16_t *u[HBD_LARGEST_FILTER], *v[HBD_LARGEST_FILTER];
+
+    declare_func(void, enum AVPixelFormat format, const uint8_t *dither,
+                 const int16_t *filter, int filterSize,
+                 const int16_t **u, const int16_t **v,
+                 uint8_t *dst, int dstWidth);
+
+    memset(dither, 0, sizeof(dither[0]) * 8);
+
+    for (wi = 0; wi < FF_ARRAY_ELEMS(widths); wi++) {
+        struct SwsContext *ctx = hbd_context(AV_PIX_FMT_P010LE, widths[wi]);
+        int width;
+
+        if (!ctx) {
+            fail();
+            continue;
+        }
+        width = ctx->chrDstW;
+
+        for (fsi = 0; fsi < HBD_FILTER_SIZES; fsi++) {
+            int filter_size = filter_sizes[fsi];
+
+            hbd_fill_sources((int32_t *)u_pixels, HBD_LARGEST_FILTER * HBD_WIDTH, 10,
+                             filter, filter_size);
+            hbd_fill_sources((int32_t *)v_pixels, HBD_LARGEST_FILTER * HBD_WIDTH, 10,
+                             filter, filter_size);
+            for (i = 0; i < filter_size; i++) {
+                u[i] = u_pixels + i * HBD_WIDTH;
+                v[i] = v_pixels + i * HBD_WIDTH;
+            }
+
+            if (check_func(ctx->yuv2nv12cX, "yuv2p010cX_%d_%d", widths[wi], filter_size)) {
+                memset(dst0, 0xAA, (HBD_WIDTH + HBD_GUARD) * 2 * sizeof(dst0[0]));
+                memset(dst1, 0xAA, (HBD_WIDTH + HBD_GUARD) * 2 * sizeof(dst1[0]));
+
+                call_ref(AV_PIX_FMT_P010LE, dither, filter, filter_size, u, v,
+                         (uint8_t *)dst0, width);
+                call_new(AV_PIX_FMT_P010LE, dither, filter, filter_size, u, v,
+                         (uint8_t *)dst1, width);
+                if (memcmp(dst0, dst1, (HBD_WIDTH + HBD_GUARD) * 2 * sizeof(dst0[0])))
+                    fail();
+                bench_new(AV_PIX_FMT_P010LE, dither, filter, filter_size, u, v,
+                          (uint8_t *)dst1, width);
+            }
+        }
+        sws_freeContext(ctx);
+    }
+}
+
 #undef SRC_PIXELS
 #define SRC_PIXELS 128
 
@@ -233,4 +456,10 @@ void checkasm_check_sw_scale(void)
     report("hscale");
     check_yuv2yuvX();
     report("yuv2yuvX");
+    check_yuv2planeX_hbd();
+    report("yuv2planeX_hbd");
+    check_yuv2plane1_hbd();
+    report("yuv2plane1_hbd");
+    check_yuv2p010cX();
+    report("yuv2p010cX");
 }
@@ -41,6 +41,34 @@ fate-ffmpeg-filter_colorkey: CMD = framecrc -auto_conversion_filters -idct simpl
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5 -fflags +bitexact
 
+# encoders running in their own threads
+FATE_FFMPEG_THREADS-$(call ALLYES, COLOR_FILTER SPLIT_FILTER NEGATE_FILTER AEVALSRC_FILTER) += fate-ffmpeg-pipeline
+fate-ffmpeg-pipeline: CMD = framecrc -pipeline -auto_conversion_filters \
+  -filter_complex "color=d=1:r=5,split[a][b]\;[b]negate[c]\;aevalsrc=0:d=1.2[d]" \
+  -map "[a]" -map "[c]" -map "[d]" -shortest -fflags +bitexact
+
+# a queue of one frame for the first output, so that frames are held back
+# for it and filtering has to wait for its encoder
+FATE_FFMPEG_THREADS-$(call ALLYES, TESTSRC_FILTER SPLIT_FILTER HFLIP_FILTER) += fate-ffmpeg-enc_queue_size
+fate-ffmpeg-enc_queue_size: CMD = framecrc -auto_conversion_filters \
+  -filter_complex "testsrc=d=2:r=25,split[a][b]\;[b]hflip[c]" \
+  -map "[a]" -enc_queue_size:v:0 1 -map "[c]" -enc_queue_size:v:1 3 -fflags +bitexact
+
+# -shortest ending the outputs of encoders with queues of their own sizes at
+# the same frame as fate-ffmpeg-pipeline
+FATE_FFMPEG_THREADS-$(call ALLYES, COLOR_FILTER SPLIT_FILTER NEGATE_FILTER AEVALSRC_FILTER) += fate-ffmpeg-shortest_enc_queue_size
+fate-ffmpeg-shortest_enc_queue_size: CMD = framecrc -auto_conversion_filters \
+  -filter_complex "color=d=1:r=5,split[a][b]\;[b]negate[c]\;aevalsrc=0:d=1.2[d]" \
+  -map "[a]" -enc_queue_size:v:0 1 -map "[c]" -enc_queue_size:v:1 3 -map "[d]" -shortest -fflags +bitexact
+fate-ffmpeg-shortest_enc_queue_size: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-pipeline
+
+# slice threaded filters on the shared worker pool
+FATE_FFMPEG_THREADS-$(call ALLYES, TESTSRC_FILTER HFLIP_FILTER NEGATE_FILTER) += fate-ffmpeg-filter_thread_pool
+fate-ffmpeg-filter_thread_pool: CMD = framecrc -filter_threads 4 -filter_thread_pool -auto_conversion_filters \
+  -filter_complex "testsrc=d=1:r=10,hflip,negate" -fflags +bitexact
+
+FATE_FFMPEG-$(HAVE_THREADS) += $(FATE_FFMPEG_THREADS-yes)
+
 FATE_SAMPLES_FFMPEG-$(CONFIG_RAWVIDEO_DEMUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth_lena.yuv
 fate-force_key_frames: CMD = enc_dec \
@@ -48,6 +76,27 @@ fate-force_key_frames: CMD = enc_dec \
   avi "-c mpeg4 -g 240 -qscale 10 -force_key_frames 0.5,0:00:01.5" \
   framecrc "" "" "-skip_frame nokey"
 
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER AVI_MUXER AVI_DEMUXER MPEG4_ENCODER MPEG4_DECODER DRAWBOX_FILTER) += fate-ffmpeg-filter_frame_pool
+fate-ffmpeg-filter_frame_pool: tests/data/vsynth1.yuv
+fate-ffmpeg-filter_frame_pool: CMD = enc_dec \
+  "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv \
+  avi "-c mpeg4 -qscale 10 -bf 2" \
+  rawvideo "-vf drawbox=16:16:64:64:red:fill" "-filter_frame_pool"
+
+FATE_FFMPEG-$(call ALLYES, FRAME_THREAD_ENCODER RAWVIDEO_DEMUXER MOV_MUXER MOV_DEMUXER PRORES_KS_ENCODER PRORES_DECODER) += fate-ffmpeg-frame_thread_depth
+fate-ffmpeg-frame_thread_depth: tests/data/vsynth1.yuv
+fate-ffmpeg-frame_thread_depth: CMP_UNIT = 1
+fate-ffmpeg-frame_thread_depth: CMD = enc_dec \
+  "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv \
+  mov "-c prores_ks -profile hq -threads 4 -thread_type frame -frame_thread_depth 7" \
+  rawvideo "-pix_fmt yuv420p"
+
+# more sizes and formats than the graph keeps shared pools for
+FRAME_POOL_SCALE = scale=$(1):flags=bicubic+accurate_rnd+bitexact,format=$(2)
+FATE_FFMPEG-$(call ALLYES, TESTSRC_FILTER FORMAT_FILTER SCALE_FILTER HFLIP_FILTER NEGATE_FILTER) += fate-ffmpeg-filter_frame_pool-formats
+fate-ffmpeg-filter_frame_pool-formats: CMD = framecrc -filter_frame_pool -auto_conversion_filters -filter_complex \
+  "testsrc=s=64x48:d=0.5:r=10,format=rgb24,hflip,$(call FRAME_POOL_SCALE,60x44,yuv420p),negate,$(call FRAME_POOL_SCALE,56x40,yuv422p),hflip,$(call FRAME_POOL_SCALE,52x36,yuv444p),negate,$(call FRAME_POOL_SCALE,48x32,gray),hflip,$(call FRAME_POOL_SCALE,44x28,bgr24),negate,$(call FRAME_POOL_SCALE,40x24,yuv410p),hflip,$(call FRAME_POOL_SCALE,36x20,yuv411p),negate,$(call FRAME_POOL_SCALE,32x16,rgba),hflip,$(call FRAME_POOL_SCALE,64x48,yuv420p)"
+
 FATE_SAMPLES_FFMPEG-$(call ALLYES, VOBSUB_DEMUXER DVDSUB_DECODER AVFILTER OVERLAY_FILTER DVDSUB_ENCODER) += fate-sub2video
 fate-sub2video: tests/data/vsynth_lena.yuv
 fate-sub2video: CMD = framecrc -auto_conversion_filters \
@@ -210,6 +210,27 @@ FATE_AFILTER-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FIL
 fate-filter-hls: tests/data/hls-list.m3u8
 fate-filter-hls: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls-list.m3u8 -af aresample
 
+FATE_AFILTER-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-filter-hls-prefetch
+fate-filter-hls-prefetch: tests/data/hls-list.m3u8
+fate-filter-hls-prefetch: CMD = framecrc -flags +bitexact -prefetch_segments 2 -i $(TARGET_PATH)/tests/data/hls-list.m3u8 -af aresample
+fate-filter-hls-prefetch: REF = $(SRC_PATH)/tests/ref/fate/filter-hls
+
+tests/data/dash-list.mpd: TAG = GEN
+tests/data/dash-list.mpd: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
+        -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" -f dash -seg_duration 2 -map 0 -flags +bitexact -fflags +bitexact -codec:a mp2fixed \
+        -init_seg_name 'dash-init-$$RepresentationID$$.m4s' -media_seg_name 'dash-chunk-$$RepresentationID$$-$$Number%05d$$.m4s' \
+        -y $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_AFILTER-$(call ALLYES, DASH_DEMUXER DASH_MUXER MP4_MUXER MOV_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-filter-dash fate-filter-dash-prefetch
+fate-filter-dash: tests/data/dash-list.mpd
+fate-filter-dash: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/dash-list.mpd -af aresample
+
+# the fragments are downloaded by a thread of the demuxer, the output is the same
+fate-filter-dash-prefetch: tests/data/dash-list.mpd
+fate-filter-dash-prefetch: CMD = framecrc -flags +bitexact -prefetch_duration 5 -i $(TARGET_PATH)/tests/data/dash-list.mpd -af aresample
+fate-filter-dash-prefetch: REF = $(SRC_PATH)/tests/ref/fate/filter-dash
+
 tests/data/hls-list-append.m3u8: TAG = GEN
 tests/data/hls-list-append.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
 	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
@@ -496,6 +496,23 @@ fate-filter-scale200: CMD = video_filter "scale=w=200:h=200"
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500
 fate-filter-scale500: CMD = video_filter "scale=w=500:h=500"
 
+FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500-threads
+fate-filter-scale500-threads: CMD = video_filter "scale=w=500:h=500:sws_threads=4"
+
+# an odd output size puts the band boundaries on odd lines, inside the
+# vertical filters of the luma and of the subsampled chroma
+FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale-odd
+fate-filter-scale-odd: CMD = video_filter "scale=w=373:h=279:flags=bicubic+accurate_rnd+bitexact"
+
+FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale-odd-threads
+fate-filter-scale-odd-threads: CMD = video_filter "scale=w=373:h=279:flags=bicubic+accurate_rnd+bitexact:sws_threads=3"
+
+FATE_FILTER_VSYNTH-$(CONFIG_MULTISCALE_FILTER) += fate-filter-multiscale
+fate-filter-multiscale: CMD = framemd5 -c:v pgmyuv -i $(SRC) -frames:v 5 -filter_complex "multiscale=sizes=256x192|128x96|64x48:format=yuv444p:cascade=1:flags=bicubic+accurate_rnd+bitexact[a][b][c]" -map "[a]" -map "[b]" -map "[c]" -flags +bitexact
+
+FATE_FILTER_VSYNTH-$(CONFIG_MULTISCALE_FILTER) += fate-filter-multiscale-shared
+fate-filter-multiscale-shared: CMD = framemd5 -c:v pgmyuv -i $(SRC) -frames:v 5 -filter_complex "multiscale=sizes=128x96|64x48|128x96:format=rgb24:in_color_matrix=bt709:in_range=full:flags=bicubic+accurate_rnd+bitexact[a][b][c]" -map "[a]" -map "[b]" -map "[c]" -flags +bitexact
+
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE2REF_FILTER) += fate-filter-scale2ref_keep_aspect
 fate-filter-scale2ref_keep_aspect: tests/data/filtergraphs/scale2ref_keep_aspect
 fate-filter-scale2ref_keep_aspect: CMD = framemd5 -frames:v 5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/scale2ref_keep_aspect -map "[main]"
@@ -2,6 +2,37 @@
 #fate-async: libavformat/tests/async$(EXESUF)
 #fate-async: CMD = run libavformat/tests/async
 
+FATE_LIBAVFORMAT-$(CONFIG_FILE_PROTOCOL) += fate-avio_adapt
+fate-avio_adapt: libavformat/tests/avio_adapt$(EXESUF)
+fate-avio_adapt: CMD = run libavformat/tests/avio_adapt$(EXESUF) $(TARGET_PATH)/tests/data/fate/avio_adapt.bin
+
+CACHE-FATE-$(call ALLYES, CACHE_PROTOCOL FILE_PROTOCOL) += fate-cache
+FATE_LIBAVFORMAT-$(HAVE_DIRENT_H) += $(CACHE-FATE-yes)
+fate-cache: libavformat/tests/cache$(EXESUF)
+fate-cache: CMD = run libavformat/tests/cache$(EXESUF) $(TARGET_PATH)/tests/data/fate/cache.bin
+
+FILE-FATE-$(CONFIG_FILE_PROTOCOL) += fate-file_uring
+FATE_LIBAVFORMAT-$(HAVE_LINUX_IO_URING_H) += $(FILE-FATE-yes)
+fate-file_uring: libavformat/tests/file_uring$(EXESUF)
+fate-file_uring: CMD = run libavformat/tests/file_uring$(EXESUF) $(TARGET_PATH)/tests/data/fate/file_uring.bin
+
+MMAP-FATE-$(CONFIG_FILE_PROTOCOL) += fate-file_mmap
+FATE_LIBAVFORMAT-$(HAVE_MMAP) += $(MMAP-FATE-yes)
+fate-file_mmap: libavformat/tests/file_mmap$(EXESUF)
+fate-file_mmap: CMD = run libavformat/tests/file_mmap$(EXESUF) $(TARGET_PATH)/tests/data/fate/file_mmap.bin
+
+HTTP-FATE-$(CONFIG_HTTP_PROTOCOL) += fate-http_pool fate-http_range
+FATE_LIBAVFORMAT-$(HAVE_THREADS) += $(HTTP-FATE-yes)
+fate-http_pool: libavformat/tests/http_pool$(EXESUF)
+fate-http_pool: CMD = run libavformat/tests/http_pool$(EXESUF)
+
+fate-http_range: libavformat/tests/http_range$(EXESUF)
+fate-http_range: CMD = run libavformat/tests/http_range$(EXESUF)
+
+FATE_LIBAVFORMAT-yes += fate-index_batch
+fate-index_batch: libavformat/tests/index_batch$(EXESUF)
+fate-index_batch: CMD = run libavformat/tests/index_batch$(EXESUF)
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/tests/noproxy$(EXESUF)
 fate-noproxy: CMD = run libavformat/tests/noproxy$(EXESUF)
@@ -14,6 +45,11 @@ FATE_LIBAVFORMAT-$(CONFIG_SRTP) += fate-srtp
 fate-srtp: libavformat/tests/srtp$(EXESUF)
 fate-srtp: CMD = run libavformat/tests/srtp$(EXESUF)
 
+UDP-FATE-$(CONFIG_UDP_PROTOCOL) += fate-udp
+FATE_LIBAVFORMAT-$(HAVE_PTHREAD_CANCEL) += $(UDP-FATE-yes)
+fate-udp: libavformat/tests/udp$(EXESUF)
+fate-udp: CMD = run libavformat/tests/udp$(EXESUF)
+
 FATE_LIBAVFORMAT-yes += fate-url
 fate-url: libavformat/tests/url$(EXESUF)
 fate-url: CMD = run libavformat/tests/url$(EXESUF)
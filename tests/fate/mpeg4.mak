@@ -15,5 +15,17 @@ FATE_MPEG4-$(call DEMDEC, M4V, MPEG4) += fate-m4v  fate-m4v-cfr
 fate-m4v:     CMD = framecrc -flags +bitexact -idct simple -i $(TARGET_SAMPLES)/mpeg4/demo.m4v
 fate-m4v-cfr: CMD = framecrc -flags +bitexact -idct simple -i $(TARGET_SAMPLES)/mpeg4/demo.m4v -vf fps=5
 
+# frame threads on the worker pool shared by the codec contexts must decode
+# the same frames as their own threads
+FATE_MPEG4_THREADS-$(call ENCDEC, MPEG4, AVI) += fate-mpeg4-frame-threads fate-mpeg4-thread-pool
+fate-mpeg4-frame-threads: CMD = threads=8 thread_type=frame framemd5 -flags +bitexact -idct simple -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-adap.avi
+fate-mpeg4-thread-pool: CMD = threads=8 thread_type=frame framemd5 -flags +bitexact -idct simple -thread_pool 1 -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-adap.avi
+fate-mpeg4-thread-pool: REF = $(SRC_PATH)/tests/ref/fate/mpeg4-frame-threads
+fate-mpeg4-frame-threads fate-mpeg4-thread-pool: fate-vsynth1-mpeg4-adap
+fate-vsynth1-mpeg4-adap: KEEP_OVERRIDE = -keep
+
+FATE_MPEG4_VSYNTH-$(HAVE_THREADS) += $(FATE_MPEG4_THREADS-yes)
+
 FATE_SAMPLES_AVCONV += $(FATE_MPEG4-yes)
-fate-mpeg4: $(FATE_MPEG4-yes)
+FATE_AVCONV += $(FATE_MPEG4_VSYNTH-yes)
+fate-mpeg4: $(FATE_MPEG4-yes) $(FATE_MPEG4_VSYNTH-yes)
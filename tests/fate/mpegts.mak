@@ -22,4 +22,22 @@ fate-mpegts-probe-pmt-merge: CMD = run $(PROBE_CODEC_NAME_COMMAND) -merge_pmt_ve
 
 FATE_SAMPLES_FFPROBE += $(FATE_MPEGTS_PROBE-yes)
 
-fate-mpegts: $(FATE_MPEGTS_PROBE-yes)
+# two programs carrying the same streams on different PIDs
+tests/data/mpegts-mpts.ts: TAG = GEN
+tests/data/mpegts-mpts.ts: ffmpeg$(PROGSSUF)$(EXESUF) fate-lavf-ts | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -i $(TARGET_PATH)/tests/data/lavf/lavf.ts \
+		-map 0 -map 0 -c copy -program program_num=1:st=0:st=1 -program program_num=2:st=2:st=3 \
+		-flags +bitexact -fflags +bitexact -f mpegts -y $(TARGET_PATH)/$@ 2> /dev/null
+
+FATE_MPEGTS_LAVF-$(call ENCDEC2, MPEG2VIDEO, MP2, MPEGTS) += fate-mpegtsraw-service
+fate-mpegtsraw-service: CMD = framecrc -f mpegtsraw -service_id 2 -i $(TARGET_PATH)/tests/data/mpegts-mpts.ts -map 0 -c copy
+fate-mpegtsraw-service: tests/data/mpegts-mpts.ts
+
+# the packets of the discarded program are dropped before being read
+FATE_MPEGTS_LAVF-$(call ENCDEC2, MPEG2VIDEO, MP2, MPEGTS) += fate-mpegts-program-discard
+fate-mpegts-program-discard: CMD = framecrc -i $(TARGET_PATH)/tests/data/mpegts-mpts.ts -map 0:p:2 -c copy
+fate-mpegts-program-discard: tests/data/mpegts-mpts.ts
+
+FATE_FFMPEG += $(FATE_MPEGTS_LAVF-yes)
+
+fate-mpegts: $(FATE_MPEGTS_PROBE-yes) $(FATE_MPEGTS_LAVF-yes)
@@ -266,6 +266,40 @@ fate-seek-mkv-codec-delay:   CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_
 
 FATE_SEEK_EXTRA += $(FATE_SEEK_EXTRA-yes)
 
+FATE_SEEK_LAVF_LAZY-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-seek-lavf-mov_lazy_index
+fate-seek-lavf-mov_lazy_index: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mov -advanced_editlist 0 -lazy_index 1
+fate-seek-lavf-mov_lazy_index: fate-lavf-mov libavformat/tests/seek$(EXESUF)
+
+# the single edit of the whole media does not need the full index
+FATE_SEEK_LAVF_LAZY-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-seek-lavf-mov_lazy_index_edts
+fate-seek-lavf-mov_lazy_index_edts: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mov -lazy_index 1
+fate-seek-lavf-mov_lazy_index_edts: REF = $(SRC_PATH)/tests/ref/seek/lavf-mov
+fate-seek-lavf-mov_lazy_index_edts: fate-lavf-mov libavformat/tests/seek$(EXESUF)
+
+# 5000 samples, more than the 4096 index entries a lazily indexed stream keeps
+tests/data/mov-index-window.mov: TAG = GEN
+tests/data/mov-index-window.mov: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
+		-f lavfi -i "sws_flags=+accurate_rnd+bitexact;testsrc=s=32x32:r=100:d=50" -sws_flags '+accurate_rnd+bitexact' -pix_fmt yuv420p \
+		-c:v mpeg4 -g 25 -bf 2 -idct simple -dct int -flags +bitexact -fflags +bitexact -y $(TARGET_PATH)/$@ 2> /dev/null
+
+# the full and the lazy index must give the same results
+MOV_INDEX_WINDOW_DEPS = $(call ALLYES, LAVFI_INDEV TESTSRC_FILTER FORMAT_FILTER MPEG4_ENCODER MPEG4_DECODER MOV_MUXER MOV_DEMUXER)
+FATE_SEEK_LAVF_LAZY-$(MOV_INDEX_WINDOW_DEPS) += fate-seek-mov-index-window fate-seek-mov-lazy-index-window
+fate-seek-mov-index-window: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/mov-index-window.mov -advanced_editlist 0 -duration 50
+fate-seek-mov-lazy-index-window: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/mov-index-window.mov -advanced_editlist 0 -duration 50 -lazy_index 1
+fate-seek-mov-lazy-index-window: REF = $(SRC_PATH)/tests/ref/seek/mov-index-window
+fate-seek-mov-index-window fate-seek-mov-lazy-index-window: tests/data/mov-index-window.mov libavformat/tests/seek$(EXESUF)
+
+FATE_SEEK_LAVF_LAZY-$(MOV_INDEX_WINDOW_DEPS) += fate-mov-index-window fate-mov-lazy-index-window
+fate-mov-index-window: CMD = md5pipe -advanced_editlist 0 -i $(TARGET_PATH)/tests/data/mov-index-window.mov -c copy -f framecrc
+fate-mov-lazy-index-window: CMD = md5pipe -advanced_editlist 0 -lazy_index 1 -i $(TARGET_PATH)/tests/data/mov-index-window.mov -c copy -f framecrc
+fate-mov-index-window fate-mov-lazy-index-window: CMP = oneline
+fate-mov-index-window fate-mov-lazy-index-window: REF = 3bf922196d2c042ecd726cb2755b5163
+fate-mov-index-window fate-mov-lazy-index-window: tests/data/mov-index-window.mov
+FATE_SEEK_LAVF_LAZY += $(FATE_SEEK_LAVF_LAZY-yes)
+FATE_AVCONV += $(FATE_SEEK_LAVF_LAZY)
+
 
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA): libavformat/tests/seek$(EXESUF)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC)
@@ -275,4 +309,4 @@ fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
 FATE_AVCONV += $(FATE_SEEK)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_LAVF_LAZY)